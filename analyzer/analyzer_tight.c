@@ -14,21 +14,51 @@
 #include <sys/stat.h>
 #include <time.h>
 #include "reader.h"
+#include "path_table.h"
+#include "profiler_common.h"
+#include "thread_pool.h"
 static char g_data_dir[256];
 static int get_env_int(const char* name, int defv){ const char* s=getenv(name); if(!s||!*s) return defv; char* e=NULL; long v=strtol(s,&e,10); if(e==s) return defv; return (int)v; }
 static double get_env_double(const char* name, double defv){ const char* s=getenv(name); if(!s||!*s) return defv; char* e=NULL; double v=strtod(s,&e); if(e==s) return defv; return v; }
-static int seen_in_reads_all(const ReadRecord* rr,int rc,const char* path){ if(!path) return 0; for(int i=0;i<rc;i++){ if(rr[i].file_path && strcmp(rr[i].file_path,path)==0) return 1; } return 0; }
-static void canonical_path(const char* in,char* out,size_t outsz){ if(!in){ if(outsz>0) out[0]='\0'; return;} char r[512]; char* rp = realpath(in, r); if(rp){ strncpy(out, rp, outsz-1); out[outsz-1]='\0'; } else { strncpy(out, in, outsz-1); out[outsz-1]='\0'; } }
-typedef struct { char path[256]; int off; int len; } Assigned;
-static Assigned assigned[MAX_RECORDS];
-static int assigned_cnt = 0;
-static int assigned_has(const char* p,int off,int len){ if(!p) return 0; for(int i=0;i<assigned_cnt;i++){ if(strcmp(assigned[i].path,p)==0 && assigned[i].off==off && assigned[i].len==len) return 1; } return 0; }
-static void assigned_add(const char* p,int off,int len){ if(!p) return; if(assigned_cnt<MAX_RECORDS){ strncpy(assigned[assigned_cnt].path,p,sizeof(assigned[assigned_cnt].path)-1); assigned[assigned_cnt].path[sizeof(assigned[assigned_cnt].path)-1]='\0'; assigned[assigned_cnt].off=off; assigned[assigned_cnt].len=len; assigned_cnt++; } }
-typedef struct { char path[256]; } AssignedPath;
-static AssignedPath assigned_paths[MAX_RECORDS];
-static int assigned_paths_cnt = 0;
-static int assigned_path_has(const char* p){ if(!p) return 0; for(int i=0;i<assigned_paths_cnt;i++){ if(strcmp(assigned_paths[i].path,p)==0) return 1; } return 0; }
-static void assigned_path_add(const char* p){ if(!p) return; if(assigned_paths_cnt<MAX_RECORDS){ strncpy(assigned_paths[assigned_paths_cnt].path,p,sizeof(assigned_paths[assigned_paths_cnt].path)-1); assigned_paths[assigned_paths_cnt].path[sizeof(assigned_paths[assigned_paths_cnt].path)-1]='\0'; assigned_paths_cnt++; } }
+/* 时间线事件：read / mmap / page_log（页缓存驻留区间或主缺页）三类 */
+enum { EV_READ, EV_MMAP, EV_PAGE };
+/* 列式时间线：事件按时间归并后逐字段分列存放，第 i 个事件即各列的第 i 项。
+ * 窗口扫描只顺序读取 ts / wbytes / stall 几列，不再经下标回到整条记录 */
+typedef struct {
+    int n;
+    double *ts;             /* epoch 秒 */
+    int *path_id;
+    long long *offset, *len;
+    unsigned char *kind;    /* EV_* */
+    double *stall;          /* 预估阻塞（微秒），见 stall_us */
+    long long *wbytes;      /* 计入窗口统计的字节数：可作预取项、长度为正且不早于起始时间时为 len，否则为 0 */
+} Timeline;
+/* 事件造成的阻塞（微秒）：有实测耗时的读直接取耗时；mmap/页缓存区间/主缺页与旧日志按字节数折算 */
+static double STALL_US_PER_KB = 10.0;
+static double stall_us(double io_time,long long len){ if(io_time>0) return io_time*1e6; return len>0 ? (double)len/1024.0*STALL_US_PER_KB : 0.0; }
+static void timeline_push(Timeline* t,double ts,int kind,int id,long long off,long long len,double io_time){ int i=t->n++; t->ts[i]=ts; t->kind[i]=(unsigned char)kind; t->path_id[i]=id; t->offset[i]=off; t->len[i]=len; t->stall[i]=stall_us(io_time,len); }
+static void timeline_free(Timeline* t){ free(t->ts); free(t->path_id); free(t->offset); free(t->len); free(t->kind); free(t->stall); free(t->wbytes); memset(t,0,sizeof(*t)); }
+static int timeline_alloc(Timeline* t,int cap){
+    size_t n = (size_t)(cap > 0 ? cap : 1);
+    memset(t, 0, sizeof(*t));
+    t->ts = malloc(n * sizeof(double)); t->path_id = malloc(n * sizeof(int));
+    t->offset = malloc(n * sizeof(long long)); t->len = malloc(n * sizeof(long long));
+    t->kind = malloc(n); t->stall = malloc(n * sizeof(double)); t->wbytes = malloc(n * sizeof(long long));
+    if (t->ts && t->path_id && t->offset && t->len && t->kind && t->stall && t->wbytes) return 0;
+    timeline_free(t);
+    return -1;
+}
+typedef struct { int j; long long len; double stall; } Item;
+static int cmp_item_stall(const void* a,const void* b){ const Item* x=a; const Item* y=b; if(x->stall!=y->stall) return x->stall<y->stall?1:-1; return x->j-y->j; }
+static int cmp_item_order(const void* a,const void* b){ return ((const Item*)a)->j-((const Item*)b)->j; }
+/* 按需倍增的数组：*cap 不足时扩到能放下 n 个元素 */
+static void* grow(void* v,int* cap,int n,size_t elem){ if(n<=*cap) return v; int nc=*cap?*cap:256; while(nc<n) nc*=2; void* nv=realloc(v,(size_t)nc*elem); if(!nv){ perror("realloc"); exit(1); } *cap=nc; return nv; }
+/* 已输出的预取项（规范化路径 ID, 偏移, 长度）与其规范化路径；规范化可能驻留新路径，按位图按需扩容 */
+static RangeSet assigned;
+static unsigned char* assigned_paths = NULL;
+static int assigned_paths_cap = 0;
+static int assigned_path_has(int cid){ return cid < assigned_paths_cap && assigned_paths[cid]; }
+static void assigned_path_add(int cid){ int old=assigned_paths_cap; assigned_paths=grow(assigned_paths,&assigned_paths_cap,cid+1,1); memset(assigned_paths+old,0,(size_t)(assigned_paths_cap-old)); assigned_paths[cid]=1; }
 
 static int MAX_PREFETCH_PER_TRIGGER = 16;
 static int MAX_PREFETCH_BYTES  = (128*1024);
@@ -62,25 +92,109 @@ static int skip_ext_path(const char* path){
 }
 /* 触发器不强制扩展类型偏好，保留在预取项上做过滤 */
 
-/* 记录文件最近一次触发时间 */
-static double last_trigger_ts(const char *path, char paths[MAX_RECORDS][256], double tss[MAX_RECORDS], int n) {
-    for (int i = 0; i < n; i++)
-        if (strcmp(paths[i], path) == 0) return tss[i];
-    return -1.0;
+/* 滑动窗口统计：事件 i 的窗口为 (i, hi)，即其后 PREFETCH_WINDOW_SEC 内的事件；结构内维护 [lo, hi) 的字节数/条数。
+ * 时间线按时间升序，i 递增（可跳过）时 lo、hi 都只前移，整条时间线合计 O(n) */
+typedef struct { int lo, hi; long long bytes; int cnt; } WinSum;
+static void win_advance(WinSum* w,const Timeline* t,int i,double t_end){
+    if (w->hi <= i + 1) { w->lo = w->hi = i + 1; w->bytes = 0; w->cnt = 0; }
+    for (; w->lo <= i; w->lo++) { w->bytes -= t->wbytes[w->lo]; w->cnt -= t->wbytes[w->lo] != 0; }
+    while (w->hi < t->n && t->ts[w->hi] <= t_end) { w->bytes += t->wbytes[w->hi]; w->cnt += t->wbytes[w->hi] != 0; w->hi++; }
+}
+
+typedef struct { int idx; int end; long long bsum; double stall; int rcnt; int id; long long off; long long len; double ts; } Cand;   /* end：窗口右端（不含） */
+static int g_rank_by_stall = 1;
+/* 候选触发器排序：阻塞（或字节）降序，相同时按时间先后 */
+static int cmp_cand(const void *a, const void *b) {
+    const Cand *x = a, *y = b;
+    if (g_rank_by_stall ? x->stall != y->stall : x->bsum != y->bsum)
+        return (g_rank_by_stall ? x->stall < y->stall : x->bsum < y->bsum) ? 1 : -1;
+    return x->idx - y->idx;
+}
+
+/* 候选打分与触发器选择分开：打分只读时间线与按路径 ID 的属性数组，各事件互不依赖，分段交给线程池；
+ * 冷却、已分配去重与触发器上限依赖先后，在随后的顺序扫描中按时间线次序施加，结果与逐事件处理相同 */
+enum { SC_TS = 1, SC_LEN, SC_MMAP, SC_PATH, SC_OK };
+typedef struct { unsigned char verdict; int end, cnt; long long bytes; } Score;   /* SC_OK 时带窗口统计 */
+typedef struct {
+    const Timeline *tl;
+    const unsigned char *in_reads, *legal, *item_ok;
+    double start_ts;
+    int allow_mmap_only, rank_by_stall;
+    Score *score;           /* 每个事件一项 */
+    Cand *cand; int ncand;
+    Item **items; int *item_cnt;   /* 前 ncand 个候选（已排序）各自选出的预取项 */
+} ScoreJob;
+#define SCORE_CHUNK 65536
+#define CAND_CHUNK  64
+
+/* 一段事件：静态过滤与窗口字节数/条数 */
+static void score_events(int c, void *arg) {
+    const ScoreJob *job = arg; const Timeline *t = job->tl;
+    int lo = c * SCORE_CHUNK, hi = t->n - lo > SCORE_CHUNK ? lo + SCORE_CHUNK : t->n;
+    WinSum win = { 0, 0, 0, 0 };
+    for (int i = lo; i < hi; i++) {
+        Score *s = &job->score[i]; int id = t->path_id[i];
+        if (job->start_ts > 0 && t->ts[i] < job->start_ts) s->verdict = SC_TS;
+        else if (t->len[i] < READ_SIZE_THRESHOLD) s->verdict = SC_LEN;
+        else if (t->kind[i] == EV_MMAP && !job->allow_mmap_only && !job->in_reads[id]) s->verdict = SC_MMAP;
+        else if (!job->legal[id]) s->verdict = SC_PATH;
+        else {
+            win_advance(&win, t, i, t->ts[i] + PREFETCH_WINDOW_SEC);
+            *s = (Score){ SC_OK, win.hi, win.cnt, win.bytes };
+        }
+    }
+}
+
+/* 一组候选的窗口阻塞：浮点累加，按时间顺序逐项求和，结果与逐项扫描一致 */
+static void score_stall(int c, void *arg) {
+    const ScoreJob *job = arg; const Timeline *t = job->tl;
+    for (int k = c * CAND_CHUNK; k < job->ncand && k < (c + 1) * CAND_CHUNK; k++) {
+        Cand *x = &job->cand[k]; double stall = 0;
+        for (int j = x->idx + 1; j < x->end; j++) stall += t->wbytes[j] ? t->stall[j] : 0.0;
+        x->stall = stall;
+    }
 }
-static void set_trigger_ts(const char *path, double ts, char paths[MAX_RECORDS][256], double tss[MAX_RECORDS], int *n) {
-    int idx = -1;
-    for (int i = 0; i < *n; i++)
-        if (strcmp(paths[i], path) == 0) { idx = i; break; }
-    if (idx < 0 && *n < MAX_RECORDS) idx = (*n)++;
-    if (idx >= 0) {
-        strcpy(paths[idx], path);
-        tss[idx] = ts;
+
+/* 按当前顺序取前若干项，直到条数或字节达到单触发器上限 */
+static int take_items(const Item* items,int n){ int take=0; long long bytes=0; while(take<n && take<MAX_PREFETCH_PER_TRIGGER && bytes<MAX_PREFETCH_BYTES) bytes+=items[take++].len; return take; }
+/* 第 k 个触发器窗口内的预取项：按阻塞排序时先挑阻塞最大的项填满条数/字节上限，再恢复时间顺序 */
+static void pick_items(int k, void *arg) {
+    const ScoreJob *job = arg; const Timeline *t = job->tl; const Cand *x = &job->cand[k];
+    int jn = x->end - x->idx - 1;
+    Item *items = malloc(sizeof(Item) * (jn > 0 ? jn : 1)); int n = 0;
+    if (!items) { perror("malloc"); exit(1); }
+    for (int j = x->idx + 1; j < x->end; j++) {
+        int id2 = t->path_id[j]; long long l2 = t->len[j];
+        if (!job->item_ok[id2]) continue;
+        if (id2 == x->id && t->offset[j] == x->off) continue;
+        if (l2 <= 0) continue;
+        items[n].j = j; items[n].stall = t->stall[j];
+        items[n].len = l2 > MAX_LEN_PER_ITEM ? MAX_LEN_PER_ITEM : l2; n++;
+    }
+    if (job->rank_by_stall) {
+        qsort(items, n, sizeof(Item), cmp_item_stall);
+        n = take_items(items, n);
+        qsort(items, n, sizeof(Item), cmp_item_order);
+    }
+    job->items[k] = items; job->item_cnt[k] = take_items(items, n);
+}
+
+/* 三路归并写入时间线：各日志已由 reader 按纳秒时间排序，mi/pi 为入选的 mmap/page 记录下标；
+ * 同一时刻按 read、mmap、page 的顺序 */
+static void merge_events(Timeline *t, const ReadRecord *r, int nr, const MmapRecord *m, const int *mi, int nm, const PageRecord *p, const int *pi, int np) {
+    int i = 0, j = 0, k = 0;
+    while (i < nr || j < nm || k < np) {
+        int src = -1; long long best = 0;
+        if (i < nr) { src = EV_READ; best = r[i].ts_ns; }
+        if (j < nm && (src < 0 || m[mi[j]].ts_ns < best)) { src = EV_MMAP; best = m[mi[j]].ts_ns; }
+        if (k < np && (src < 0 || p[pi[k]].ts_ns < best)) src = EV_PAGE;
+        if (src == EV_READ) { const ReadRecord *e = &r[i++]; timeline_push(t, e->timestamp, EV_READ, e->path_id, e->offset, e->read_len, e->io_time); }
+        else if (src == EV_MMAP) { const MmapRecord *e = &m[mi[j++]]; timeline_push(t, e->timestamp, EV_MMAP, e->path_id, e->file_offset, e->size, 0); }
+        else { const PageRecord *e = &p[pi[k++]]; timeline_push(t, e->timestamp, EV_PAGE, e->path_id, e->offset, e->length, 0); }
     }
 }
 
 int main() {
-    assigned_cnt = 0; assigned_paths_cnt = 0;
 
     MAX_PREFETCH_PER_TRIGGER = get_env_int("IFETCHER_PREFETCH_TOP_N", 16);
     SAME_FILE_COOLDOWN_SEC = get_env_double("IFETCHER_SAME_FILE_COOLDOWN_SEC", 5.0);
@@ -90,49 +204,75 @@ int main() {
     MIN_WINDOW_BYTES = get_env_int("IFETCHER_MIN_BYTES", 32*1024);
     MAX_PREFETCH_BYTES = get_env_int("IFETCHER_MAX_PREFETCH_BYTES_KB", 128) * 1024;
     MAX_LEN_PER_ITEM   = get_env_int("IFETCHER_MAX_LEN_PER_ITEM_KB", 64) * 1024;
+    STALL_US_PER_KB    = get_env_double("IFETCHER_STALL_US_PER_KB", 10.0);
+    /* 按阻塞时间而非字节数给触发器与预取项排序（IFETCHER_RANK_BY_STALL=0 恢复按字节/时间顺序） */
+    const int rank_by_stall = get_env_int("IFETCHER_RANK_BY_STALL", 1);
+    g_rank_by_stall = rank_by_stall;
 
     const char* dd = getenv("IFETCHER_DATA_DIR");
     if (dd && dd[0] != '\0') { strncpy(g_data_dir, dd, sizeof(g_data_dir)-1); g_data_dir[sizeof(g_data_dir)-1]='\0'; }
     const char *log_dir = getenv("IFETCHER_LOG_DIR");
-    char read_path[256], mmap_path[256];
+    char read_path[256], mmap_path[256], page_path[256];
     if (log_dir && log_dir[0] != '\0') {
         snprintf(read_path, sizeof(read_path), "%s/read_log", log_dir);
         snprintf(mmap_path, sizeof(mmap_path), "%s/mmap_log", log_dir);
+        snprintf(page_path, sizeof(page_path), "%s/page_log", log_dir);
     } else {
         strcpy(read_path, "/tmp/read_log");
         strcpy(mmap_path, "/tmp/mmap_log");
+        strcpy(page_path, "/tmp/page_log");
     }
-    ReadRecord  *reads  = malloc(sizeof(ReadRecord)  * MAX_RECORDS);
-    MmapRecord  *mmaps  = malloc(sizeof(MmapRecord)  * MAX_RECORDS);
-    int read_cnt = load_read_log(read_path, reads);
-    int mmap_cnt = load_mmap_log(mmap_path, mmaps);
-    if (read_cnt < 0) read_cnt = 0;
-    if (mmap_cnt < 0) mmap_cnt = 0;
+    // 三个日志并发载入
+    TraceLogs logs = { .read_path = read_path, .mmap_path = mmap_path, .page_path = page_path };
+    load_trace_logs(&logs);
+    ReadRecord  *reads  = logs.reads;
+    MmapRecord  *mmaps  = logs.mmaps;
+    PageRecord  *pages  = logs.pages;
+    int read_cnt = logs.read_count;
+    int mmap_cnt = logs.mmap_count;
+    int page_cnt = logs.page_count;
+    if (read_cnt < 0 || mmap_cnt < 0 || page_cnt < 0) return 1;   /* reader 已打印原因 */
 
-    /* 合并时间线 */
-    typedef struct { double ts; int is_read; int idx; } Event;
-    Event *events = malloc(sizeof(Event) * (read_cnt + mmap_cnt));
-    int ec = 0;
-    for (int i = 0; i < read_cnt; i++) {
-        events[ec].ts = reads[i].timestamp;
-        events[ec].is_read = 1;
-        events[ec].idx = i;
-        ec++;
+    /* 按路径 ID 预先算好的属性：出现在 read / page_log / 主缺页中，可作为触发器，可作为预取项 */
+    int npaths = path_count();
+    unsigned char *in_reads = calloc((size_t)npaths + 1, 1), *in_pages = calloc((size_t)npaths + 1, 1);
+    unsigned char *in_faults = calloc((size_t)npaths + 1, 1), *legal = calloc((size_t)npaths + 1, 1);
+    unsigned char *item_ok = calloc((size_t)npaths + 1, 1);
+    double *cool_ts = malloc(sizeof(double) * (size_t)(npaths + 1));   /* 文件最近一次触发时间，-1 为未触发 */
+    if (!in_reads || !in_pages || !in_faults || !legal || !item_ok || !cool_ts) { perror("malloc"); return 1; }
+    for (int i = 0; i < read_cnt; i++) in_reads[reads[i].path_id] = 1;
+    for (int i = 0; i < page_cnt; i++) { in_pages[pages[i].path_id] = 1; if (pages[i].op == OP_FAULT) in_faults[pages[i].path_id] = 1; }
+    for (int id = 0; id < npaths; id++) {
+        legal[id] = is_legal_path(path_str(id));
+        item_ok[id] = legal[id] && !skip_ext_path(path_str(id));
+        cool_ts[id] = -1.0;
     }
+
+    /* 合并时间线。page_log 给出的是真实进入页缓存的页区间与主缺页：
+     * 有此类记录的文件用它替代整段 mmap 事件；主缺页是真实的阻塞，始终计入；
+     * 驻留区间在已有 read 或主缺页记录的文件上不重复计入 */
+    int total = read_cnt + mmap_cnt + page_cnt;
+    Timeline tl;
+    int *staged = malloc(sizeof(int) * (size_t)(mmap_cnt + page_cnt + 1));
+    if (!staged || timeline_alloc(&tl, total) != 0) { perror("malloc"); return 1; }
+    int mn = 0, pn = 0, mmap_replaced = 0;
+    int *mmap_sel = staged, *page_sel = staged + mmap_cnt;
     for (int i = 0; i < mmap_cnt; i++) {
-        events[ec].ts = mmaps[i].timestamp;
-        events[ec].is_read = 0;
-        events[ec].idx = i;
-        ec++;
+        if (in_pages[mmaps[i].path_id]) { mmap_replaced++; continue; }
+        mmap_sel[mn++] = i;
     }
-    /* 按时间升序 */
-    for (int i = 0; i < ec; i++) {
-        for (int j = i + 1; j < ec; j++) {
-            if (events[j].ts < events[i].ts) {
-                Event t = events[i]; events[i] = events[j]; events[j] = t;
-            }
-        }
+    for (int i = 0; i < page_cnt; i++) {
+        if (pages[i].op == OP_CACHE && (in_reads[pages[i].path_id] || in_faults[pages[i].path_id])) continue;
+        page_sel[pn++] = i;
     }
+    /* 按时间升序（纳秒精度，同一秒内的事件也能区分先后）；之后只用时间线，原始记录即可释放 */
+    merge_events(&tl, reads, read_cnt, mmaps, mmap_sel, mn, pages, page_sel, pn);
+    int ec = tl.n;
+    int timed = 0;
+    for (int i = 0; i < read_cnt; i++) if (reads[i].io_time > 0) timed++;
+    free(staged); free(reads); free(mmaps); free(pages);
+    const double *ev_ts = tl.ts; const int *ev_id = tl.path_id;
+    const long long *ev_off = tl.offset, *ev_len = tl.len;
 
     FILE *ft = fopen("trigger_log.txt", "w");
     FILE *fp = fopen("prefetch_log.txt", "w");
@@ -141,37 +281,31 @@ int main() {
         return 1;
     }
     /* 写APP行 */
-    FILE *fr = fopen(read_path, "r");
-    if (fr) {
-        char line[512];
-        if (fgets(line, sizeof(line), fr)) {
-            if (strncmp(line, "APP=", 4) == 0) {
-                fputs(line, ft);
-                fputs(line, fp);
-            }
+    {
+        char line[1024];
+        if (load_log_app(read_path, line, sizeof(line)) || load_log_app(mmap_path, line, sizeof(line))) {
+            fputs(line, ft);
+            fputs(line, fp);
         }
-        fclose(fr);
     }
     double start_ts = get_env_double("IFETCHER_START_TS", -1.0);
     int allow_mmap_only = get_env_int("IFETCHER_ALLOW_MMAP_ONLY", 0);
 
-    fprintf(stderr, "[Analyzer] Loaded %d reads, %d mmaps\n", read_cnt, mmap_cnt);
+    fprintf(stderr, "[Analyzer] Loaded %d reads, %d mmaps, %d page ranges (%d mmaps replaced)\n", read_cnt, mmap_cnt, page_cnt, mmap_replaced);
     if (start_ts > 0) {
         int any_after = 0;
-        for (int i = 0; i < ec; i++) { if (events[i].ts >= start_ts) { any_after = 1; break; } }
+        for (int i = 0; i < ec; i++) { if (ev_ts[i] >= start_ts) { any_after = 1; break; } }
         if (!any_after) start_ts = -1.0;
     }
-    fprintf(stderr, "[Analyzer] Start TS: %.2f\n", start_ts);
-    fprintf(stderr, "[Analyzer] READ_THRESHOLD: %d, COOLDOWN: %.2f, WINDOW: %.2f\n", READ_SIZE_THRESHOLD, SAME_FILE_COOLDOWN_SEC, PREFETCH_WINDOW_SEC);
+    for (int j = 0; j < ec; j++)
+        tl.wbytes[j] = ((start_ts > 0 && ev_ts[j] < start_ts) || !item_ok[ev_id[j]] || ev_len[j] <= 0) ? 0 : ev_len[j];
+    fprintf(stderr, "[Analyzer] Start TS: %.3f\n", start_ts);
+    fprintf(stderr, "[Analyzer] READ_THRESHOLD: %d, COOLDOWN: %.3f, WINDOW: %.3f\n", READ_SIZE_THRESHOLD, SAME_FILE_COOLDOWN_SEC, PREFETCH_WINDOW_SEC);
     fprintf(stderr, "[Analyzer] ALLOW_MMAP_ONLY: %d\n", allow_mmap_only);
+    fprintf(stderr, "[Analyzer] RANK_BY_STALL: %d (%d/%d reads timed, %.1f us/KB otherwise)\n", rank_by_stall, timed, read_cnt, STALL_US_PER_KB);
 
-    char cool_paths[MAX_RECORDS][256];
-    double cool_tss[MAX_RECORDS];
-    int cool_cnt = 0;
-
-    typedef struct { int idx; long bsum; int rcnt; char path[256]; int off; int len; double ts; } Cand;
-    Cand cand[MAX_RECORDS];
-    int cand_cnt = 0;
+    Cand *cand = NULL;
+    int cand_cnt = 0, cand_cap = 0;
 
     int rejected_ts = 0;
     int rejected_len = 0;
@@ -180,76 +314,67 @@ int main() {
     int rejected_cooldown = 0;
     int passed_cand = 0;
 
+    /* 打分（并行） */
+    Score *score = malloc(sizeof(Score) * (size_t)(ec > 0 ? ec : 1));
+    if (!score) { perror("malloc"); return 1; }
+    ScoreJob job = { .tl = &tl, .in_reads = in_reads, .legal = legal, .item_ok = item_ok, .start_ts = start_ts,
+                     .allow_mmap_only = allow_mmap_only, .rank_by_stall = rank_by_stall, .score = score };
+    parallel_for((ec + SCORE_CHUNK - 1) / SCORE_CHUNK, score_events, &job);
+
+    /* 选择（顺序）：按时间线次序施加已分配去重与同文件冷却 */
     for (int i = 0; i < ec; i++) {
-        if (start_ts>0 && events[i].ts < start_ts) { rejected_ts++; continue; }
-        const char *path = NULL; int offset = 0, len = 0;
-        if (events[i].is_read) {
-            ReadRecord *r = &reads[events[i].idx]; path = r->file_path; offset = r->offset; len = r->req_len;
-            if (len < READ_SIZE_THRESHOLD) { rejected_len++; continue; }
-        } else {
-            MmapRecord *m = &mmaps[events[i].idx]; path = m->file_path; offset = m->file_offset; len = m->size;
-            if (len < READ_SIZE_THRESHOLD) { rejected_len++; continue; }
-            if (!allow_mmap_only && !seen_in_reads_all(reads, read_cnt, path)) { rejected_mmap_rule++; continue; }
+        switch (score[i].verdict) {
+        case SC_TS: rejected_ts++; continue;
+        case SC_LEN: rejected_len++; continue;
+        case SC_MMAP: rejected_mmap_rule++; continue;
+        case SC_PATH: rejected_path++; continue;
         }
-        if (!is_legal_path(path)) { rejected_path++; continue; }
-        { char tp[512]; canonical_path(path, tp, sizeof(tp)); if (assigned_path_has(tp)) continue; }
-        double last = last_trigger_ts(path, cool_paths, cool_tss, cool_cnt);
-        if (last >= 0 && (events[i].ts - last) < SAME_FILE_COOLDOWN_SEC) { rejected_cooldown++; continue; }
-        
+        int id = ev_id[i];
+        if (assigned_path_has(path_canonical(id))) continue;
+        double last = cool_ts[id];
+        if (last >= 0 && (ev_ts[i] - last) < SAME_FILE_COOLDOWN_SEC) { rejected_cooldown++; continue; }
+
         passed_cand++;
-        double t_end = events[i].ts + PREFETCH_WINDOW_SEC;
-        long bsum = 0; int rcnt = 0;
-        for (int j = i + 1; j < ec && events[j].ts <= t_end; j++) {
-            if (start_ts>0 && events[j].ts < start_ts) continue;
-            const char *p2 = NULL; int l2 = 0;
-            if (events[j].is_read) { p2 = reads[events[j].idx].file_path; l2 = reads[events[j].idx].req_len; }
-            else { p2 = mmaps[events[j].idx].file_path; l2 = mmaps[events[j].idx].size; }
-            if (!is_legal_path(p2)) continue;
-            /* 预取项不再要求同目录，保留扩展过滤避免配置/图片类 */
-            if (skip_ext_path(p2)) continue;
-            if (l2 <= 0) continue;
-            bsum += l2; rcnt++;
-        }
-        if (rcnt >= MIN_WINDOW_READS && bsum >= MIN_WINDOW_BYTES) {
-            if (cand_cnt < MAX_RECORDS) {
-                cand[cand_cnt].idx = i; cand[cand_cnt].bsum = bsum; cand[cand_cnt].rcnt = rcnt; strncpy(cand[cand_cnt].path, path, sizeof(cand[cand_cnt].path)-1); cand[cand_cnt].path[sizeof(cand[cand_cnt].path)-1] = '\0'; cand[cand_cnt].off = offset; cand[cand_cnt].len = len; cand[cand_cnt].ts = events[i].ts; cand_cnt++;
-                set_trigger_ts(path, events[i].ts, cool_paths, cool_tss, &cool_cnt);
-            }
+        /* 预取项不再要求同目录，保留扩展过滤避免配置/图片类（已折进 wbytes 列） */
+        if (score[i].cnt >= MIN_WINDOW_READS && score[i].bytes >= MIN_WINDOW_BYTES) {
+            cand = grow(cand, &cand_cap, cand_cnt + 1, sizeof(Cand));
+            cand[cand_cnt] = (Cand){ .idx = i, .end = score[i].end, .bsum = score[i].bytes, .rcnt = score[i].cnt,
+                                     .id = id, .off = ev_off[i], .len = ev_len[i], .ts = ev_ts[i] };
+            cand_cnt++;
+            cool_ts[id] = ev_ts[i];
         }
     }
-    for (int a = 0; a < cand_cnt; a++) { for (int b = a + 1; b < cand_cnt; b++) { if (cand[b].bsum > cand[a].bsum) { Cand t = cand[a]; cand[a] = cand[b]; cand[b] = t; } } }
-    int segments_out = 0; const int MAX_TRIGGERS = get_env_int("IFETCHER_MAX_TRIGGERS", 3);
-    for (int k = 0; k < cand_cnt && segments_out < MAX_TRIGGERS; k++) {
-        int i = cand[k].idx; const char* path = cand[k].path; int offset = cand[k].off; int len = cand[k].len; if (len > MAX_LEN_PER_ITEM) len = MAX_LEN_PER_ITEM; char cpath[512]; canonical_path(path, cpath, sizeof(cpath));
-        fprintf(ft, "%s,%d,%d\n", cpath, offset, len);
+    free(score);
+    job.cand = cand; job.ncand = cand_cnt;
+    if (rank_by_stall) parallel_for((cand_cnt + CAND_CHUNK - 1) / CAND_CHUNK, score_stall, &job);
+    qsort(cand, (size_t)cand_cnt, sizeof(Cand), cmp_cand);
+
+    /* 排在前面的触发器各自挑选预取项（并行），再按名次顺序输出并做跨触发器去重 */
+    const int MAX_TRIGGERS = get_env_int("IFETCHER_MAX_TRIGGERS", 3);
+    int segments_out = cand_cnt < MAX_TRIGGERS ? cand_cnt : (MAX_TRIGGERS > 0 ? MAX_TRIGGERS : 0);
+    job.ncand = segments_out;
+    job.items = malloc(sizeof(Item*) * (size_t)(segments_out + 1));
+    job.item_cnt = malloc(sizeof(int) * (size_t)(segments_out + 1));
+    if (!job.items || !job.item_cnt) { perror("malloc"); return 1; }
+    parallel_for(segments_out, pick_items, &job);
+    for (int k = 0; k < segments_out; k++) {
+        long long len = cand[k].len; if (len > MAX_LEN_PER_ITEM) len = MAX_LEN_PER_ITEM;
+        const char* cpath = path_str(path_canonical(cand[k].id));
+        fprintf(ft, "%s,%lld,%lld\n", cpath, cand[k].off, len);
         fprintf(fp, "===TRIGGER===\n");
-        fprintf(fp, "%s,%d,%d\n", cpath, offset, len);
-        double t_end = cand[k].ts + PREFETCH_WINDOW_SEC;
-        int out_items = 0; long out_bytes = 0;
-        for (int j = i + 1; j < ec && events[j].ts <= t_end; j++) {
-            if (out_items >= MAX_PREFETCH_PER_TRIGGER) break;
-            if (out_bytes >= MAX_PREFETCH_BYTES) break;
-            const char *p2 = NULL; int o2 = 0; int l2 = 0;
-            if (events[j].is_read) { p2 = reads[events[j].idx].file_path; o2 = reads[events[j].idx].offset; l2 = reads[events[j].idx].req_len; }
-            else { p2 = mmaps[events[j].idx].file_path; o2 = mmaps[events[j].idx].file_offset; l2 = mmaps[events[j].idx].size; }
-            if (!is_legal_path(p2)) continue;
-            if (skip_ext_path(p2)) continue;
-            if (strcmp(p2, path) == 0 && o2 == offset) continue;
-            if (l2 <= 0) continue;
-            if (l2 > MAX_LEN_PER_ITEM) l2 = MAX_LEN_PER_ITEM;
-            {
-                char cp[512];
-                canonical_path(p2, cp, sizeof(cp));
-                if (!assigned_has(cp, o2, l2)) {
-                    fprintf(fp, "%s,%d,%d\n", cp, o2, l2);
-                    assigned_add(cp, o2, l2);
-                    assigned_path_add(cp);
-                }
+        fprintf(fp, "%s,%lld,%lld\n", cpath, cand[k].off, len);
+        for (int n = 0; n < job.item_cnt[k]; n++) {
+            const Item *it = &job.items[k][n];
+            long long o2 = ev_off[it->j], l2 = it->len;
+            int cid = path_canonical(ev_id[it->j]);
+            if (range_set_add(&assigned, cid, o2, l2)) {
+                fprintf(fp, "%s,%lld,%lld\n", path_str(cid), o2, l2);
+                assigned_path_add(cid);
             }
-            out_items++; out_bytes += l2;
         }
-        segments_out++;
+        free(job.items[k]);
     }
+    free(job.items); free(job.item_cnt);
 
     fprintf(stderr, "[Analyzer] Events processed: %d\n", ec);
     fprintf(stderr, "[Analyzer] Rejected by TS: %d\n", rejected_ts);
@@ -262,6 +387,9 @@ int main() {
 
     fclose(ft);
     fclose(fp);
-    free(reads); free(mmaps); free(events);
+    timeline_free(&tl);
+    free(cand); free(cool_ts); free(assigned_paths); range_set_free(&assigned);
+    free(in_reads); free(in_pages); free(in_faults); free(legal); free(item_ok);
+    path_table_free();
     return 0;
 }
@@ -0,0 +1,237 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "path_table.h"
+
+typedef struct {
+    char *str;
+    size_t len;
+    uint64_t hash;
+    int canonical;          // 规范化路径的 ID；-1 表示尚未解析
+} PathEntry;
+
+// 条目分段存放、段一旦分配不再移动：其他线程持有的 ID 与字符串指针在插入时保持有效
+#define SEG_BITS 12
+#define SEG_SIZE (1 << SEG_BITS)
+#define MAX_SEGS 65536
+static PathEntry *segs[MAX_SEGS];
+static int entry_count = 0;         // 发布新条目时 release 写、path_str 等 acquire 读
+static int *slots = NULL;           // 散列槽：条目 ID，-1 为空
+static size_t slot_cap = 0;
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;   // 保护插入、散列槽与 canonical
+
+#define ENTRY(id) (&segs[(id) >> SEG_BITS][(id) & (SEG_SIZE - 1)])
+
+// FNV-1a
+static uint64_t hash_bytes(const char *s, size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) { h ^= (unsigned char)s[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+static int rehash(size_t ncap) {
+    int *ns = malloc(ncap * sizeof(int));
+    if (!ns) return -1;
+    memset(ns, 0xff, ncap * sizeof(int));
+    for (int i = 0; i < entry_count; i++) {
+        size_t k = (size_t)ENTRY(i)->hash & (ncap - 1);
+        while (ns[k] >= 0) k = (k + 1) & (ncap - 1);
+        ns[k] = i;
+    }
+    free(slots);
+    slots = ns; slot_cap = ncap;
+    return 0;
+}
+
+static int find_slot(const char *path, size_t len, uint64_t h, size_t *slot) {
+    size_t k = (size_t)h & (slot_cap - 1);
+    while (slots[k] >= 0) {
+        const PathEntry *e = ENTRY(slots[k]);
+        if (e->hash == h && e->len == len && memcmp(e->str, path, len) == 0) return slots[k];
+        k = (k + 1) & (slot_cap - 1);
+    }
+    *slot = k;
+    return -1;
+}
+
+// 调用方持有 table_mutex
+static int intern_locked(const char *path, size_t len, uint64_t h) {
+    if (slot_cap == 0 && rehash(1024) != 0) return -1;
+    size_t slot;
+    int id = find_slot(path, len, h, &slot);
+    if (id >= 0) return id;
+    // 装载因子保持在 1/2 以下
+    if ((size_t)(entry_count + 1) * 2 > slot_cap) {
+        if (rehash(slot_cap * 2) != 0) return -1;
+        find_slot(path, len, h, &slot);
+    }
+    id = entry_count;
+    if ((id >> SEG_BITS) >= MAX_SEGS) return -1;
+    PathEntry **seg = &segs[id >> SEG_BITS];
+    if (!*seg && !(*seg = malloc(SEG_SIZE * sizeof(PathEntry)))) return -1;
+    char *s = malloc(len + 1);
+    if (!s) return -1;
+    memcpy(s, path, len);
+    s[len] = '\0';
+    *ENTRY(id) = (PathEntry){ s, len, h, -1 };
+    slots[slot] = id;
+    __atomic_store_n(&entry_count, id + 1, __ATOMIC_RELEASE);
+    return id;
+}
+
+static int intern_hashed(const char *path, size_t len, uint64_t h) {
+    pthread_mutex_lock(&table_mutex);
+    int id = intern_locked(path, len, h);
+    pthread_mutex_unlock(&table_mutex);
+    return id;
+}
+
+int path_intern_n(const char *path, size_t len) {
+    return intern_hashed(path, len, hash_bytes(path, len));
+}
+
+int path_intern(const char *path) {
+    return path_intern_n(path, strlen(path));
+}
+
+int path_lookup(const char *path) {
+    size_t len = strlen(path), slot;
+    pthread_mutex_lock(&table_mutex);
+    int id = slot_cap ? find_slot(path, len, hash_bytes(path, len), &slot) : -1;
+    pthread_mutex_unlock(&table_mutex);
+    return id;
+}
+
+const char *path_str(int id) {
+    return (id >= 0 && id < path_count()) ? ENTRY(id)->str : "";
+}
+
+int path_count(void) {
+    return __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE);
+}
+
+int path_canonical(int id) {
+    if (id < 0 || id >= path_count()) return id;
+    pthread_mutex_lock(&table_mutex);
+    int cid = ENTRY(id)->canonical;
+    pthread_mutex_unlock(&table_mutex);
+    if (cid >= 0) return cid;
+    // realpath 不持锁；并发解析同一路径时结果相同
+    char buf[PATH_MAX];
+    const char *rp = realpath(ENTRY(id)->str, buf);
+    uint64_t h = rp ? hash_bytes(rp, strlen(rp)) : 0;
+    pthread_mutex_lock(&table_mutex);
+    cid = rp ? intern_locked(rp, strlen(rp), h) : id;
+    if (cid < 0) cid = id;
+    ENTRY(id)->canonical = cid;
+    ENTRY(cid)->canonical = cid;
+    pthread_mutex_unlock(&table_mutex);
+    return cid;
+}
+
+void path_table_free(void) {
+    for (int i = 0; i < entry_count; i++) free(ENTRY(i)->str);
+    for (int k = 0; k < MAX_SEGS && segs[k]; k++) { free(segs[k]); segs[k] = NULL; }
+    free(slots);
+    slots = NULL;
+    entry_count = 0; slot_cap = 0;
+}
+
+/* ---------------- 线程私有缓存 ---------------- */
+
+static long cache_find(const PathCache *c, const char *path, size_t len, uint64_t h, size_t *slot) {
+    size_t k = (size_t)h & (c->cap - 1);
+    while (c->slots[k].str) {
+        const struct PathCacheSlot *e = &c->slots[k];
+        if (e->hash == h && e->len == len && memcmp(e->str, path, len) == 0) return (long)k;
+        k = (k + 1) & (c->cap - 1);
+    }
+    *slot = k;
+    return -1;
+}
+
+int path_cache_intern(PathCache *c, const char *path, size_t len, const char **str) {
+    uint64_t h = hash_bytes(path, len);
+    size_t slot;
+    long k = c->cap ? cache_find(c, path, len, h, &slot) : -1;
+    if (k >= 0) { *str = c->slots[k].str; return c->slots[k].id; }
+    int id = intern_hashed(path, len, h);
+    if (id < 0) return -1;
+    *str = ENTRY(id)->str;
+    if ((c->n + 1) * 2 > c->cap) {
+        PathCache g = { NULL, c->cap ? c->cap * 2 : 256, 0 };
+        if (!(g.slots = calloc(g.cap, sizeof(*g.slots)))) return id;   // 不缓存，结果仍正确
+        for (size_t i = 0; i < c->cap; i++) {
+            if (!c->slots[i].str) continue;
+            cache_find(&g, c->slots[i].str, c->slots[i].len, c->slots[i].hash, &slot);
+            g.slots[slot] = c->slots[i]; g.n++;
+        }
+        path_cache_free(c);
+        *c = g;
+    }
+    cache_find(c, path, len, h, &slot);
+    c->slots[slot] = (struct PathCacheSlot){ h, *str, len, id };
+    c->n++;
+    return id;
+}
+
+void path_cache_free(PathCache *c) {
+    free(c->slots);
+    memset(c, 0, sizeof(*c));
+}
+
+/* ---------------- (ID, 偏移, 长度) 集合 ---------------- */
+
+static size_t range_hash(int id, long long off, long long len) {
+    uint64_t h = (uint64_t)(uint32_t)id * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)off + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)len + 0x85EBCA77C2B2AE63ULL + (h << 6) + (h >> 2);
+    return (size_t)(h ^ (h >> 29));
+}
+
+static long range_find(const RangeSet *s, int id, long long off, long long len, size_t *slot) {
+    size_t k = range_hash(id, off, len) & (s->cap - 1);
+    while (s->used[k]) {
+        const struct RangeKey *r = &s->slots[k];
+        if (r->id == id && r->off == off && r->len == len) return (long)k;
+        k = (k + 1) & (s->cap - 1);
+    }
+    *slot = k;
+    return -1;
+}
+
+int range_set_has(const RangeSet *s, int id, long long off, long long len) {
+    size_t slot;
+    return s->cap ? range_find(s, id, off, len, &slot) >= 0 : 0;
+}
+
+int range_set_add(RangeSet *s, int id, long long off, long long len) {
+    size_t slot;
+    if (s->cap && range_find(s, id, off, len, &slot) >= 0) return 0;
+    if ((s->n + 1) * 2 > s->cap) {
+        RangeSet g = { NULL, NULL, s->cap ? s->cap * 2 : 256, 0 };
+        g.slots = malloc(g.cap * sizeof(*g.slots));
+        g.used = calloc(g.cap, 1);
+        if (!g.slots || !g.used) { free(g.slots); free(g.used); return 0; }
+        for (size_t i = 0; i < s->cap; i++) {
+            if (!s->used[i]) continue;
+            range_find(&g, s->slots[i].id, s->slots[i].off, s->slots[i].len, &slot);
+            g.slots[slot] = s->slots[i]; g.used[slot] = 1; g.n++;
+        }
+        range_set_free(s);
+        *s = g;
+    }
+    range_find(s, id, off, len, &slot);
+    s->slots[slot] = (struct RangeKey){ id, off, len };
+    s->used[slot] = 1;
+    s->n++;
+    return 1;
+}
+
+void range_set_free(RangeSet *s) {
+    free(s->slots); free(s->used);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,49 @@
+#ifndef PATH_TABLE_H
+#define PATH_TABLE_H
+#include <stddef.h>
+#include <stdint.h>
+
+// 路径驻留表：每个不同的路径只保存一份，分配从 0 开始的稠密整数 ID。
+// reader 载入记录时驻留路径，记录中保存 ID 与指向表内字符串的指针（不截断、不复制），
+// analyzer 的去重/冷却/首访等判断都以 ID 为键，按 ID 下标的数组或下面的散列集合完成。
+// 表为进程级全局，字符串在 path_table_free 之前一直有效。
+// 驻留、查找与规范化可在多个线程中并发调用；path_table_free 须在没有其他线程使用时调用。
+
+// 驻留 path 的前 len 个字节，返回其 ID；内存不足返回 -1
+int path_intern_n(const char *path, size_t len);
+// 驻留以 '\0' 结尾的 path
+int path_intern(const char *path);
+// 已存在时返回 ID，否则返回 -1（不插入）
+int path_lookup(const char *path);
+// ID 对应的字符串
+const char *path_str(int id);
+// 当前驻留的路径数（所有 ID 都小于它）
+int path_count(void);
+// 规范化路径（realpath，失败时为原路径）的 ID；每个 ID 只解析一次
+int path_canonical(int id);
+// 释放整张表
+void path_table_free(void);
+
+// 线程私有的驻留缓存：已见过的路径直接命中，不取全局锁；每个解析线程/任务各用一个
+typedef struct {
+    struct PathCacheSlot { uint64_t hash; const char *str; size_t len; int id; } *slots;   // str 为 NULL 表示空槽
+    size_t cap, n;
+} PathCache;
+
+// 经缓存驻留 path 的前 len 个字节，返回 ID 并在 *str 给出驻留字符串；内存不足返回 -1
+int path_cache_intern(PathCache *c, const char *path, size_t len, const char **str);
+void path_cache_free(PathCache *c);
+
+// (路径 ID, 偏移, 长度) 三元组的散列集合（开放寻址）
+typedef struct {
+    struct RangeKey { int id; long long off, len; } *slots;
+    unsigned char *used;
+    size_t cap, n;
+} RangeSet;
+
+// 已存在返回 0，新加入返回 1
+int range_set_add(RangeSet *s, int id, long long off, long long len);
+int range_set_has(const RangeSet *s, int id, long long off, long long len);
+void range_set_free(RangeSet *s);
+
+#endif
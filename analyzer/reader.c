@@ -1,146 +1,1466 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "reader.h"
-#define LINE_MAX 256
-
-// 解析方括号时间戳为 epoch 秒，例如 "[2025-11-12 21:54:13]"
-static double parse_bracket_ts(const char *line) {
-    const char *start = strchr(line, '[');
-    if (!start) return 0.0;
-    const char *end = strchr(start, ']');
-    if (!end) return 0.0;
-    char buf[32];
-    size_t n = (size_t)(end - start - 1);
-    if (n >= sizeof(buf)) n = sizeof(buf) - 1;
-    memcpy(buf, start + 1, n);
-    buf[n] = '\0';
-    int year, mon, day, hour, min, sec;
-    if (sscanf(buf, "%d-%d-%d %d:%d:%d", &year, &mon, &day, &hour, &min, &sec) != 6) return 0.0;
-    struct tm tmv;
-    memset(&tmv, 0, sizeof(tmv));
-    tmv.tm_year = year - 1900;
-    tmv.tm_mon = mon - 1;
-    tmv.tm_mday = day;
-    tmv.tm_hour = hour;
-    tmv.tm_min = min;
-    tmv.tm_sec = sec;
-    time_t t = mktime(&tmv);
-    return (double)t;
-}
-
-// 读取 stat_log 文件内容到 StatRecord 数组（解析 io_time_ms，并累计 total_io）
-int load_stat_log(const char *filename, StatRecord *records) {
-    FILE *fp = fopen(filename, "r");
+#include "path_table.h"
+#include "thread_pool.h"
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "profiler_common.h"   // OpType 编号
+#include "trace_format.h"
+
+/* ---------------- 二进制 trace 解码 ---------------- */
+
+// 会话：(pid, session) 唯一确定；路径 id 在会话内有效
+typedef struct {
+    uint32_t pid;
+    uint64_t session;
+    char **paths;
+    size_t path_cap;
+    char app[512];
+    char user[64];
+    char host[64];
+    uint64_t anchor_wall;   // 墙钟锚点（v3 SESSION 记录）；0 表示时间戳本身就是墙钟
+    uint64_t anchor_mono;
+} TraceSession;
+
+typedef struct {
+    TraceSession *v;
+    size_t n, cap;
+} SessionSet;
+
+static TraceSession *session_get(SessionSet *ss, uint32_t pid, uint64_t session) {
+    for (size_t i = 0; i < ss->n; i++)
+        if (ss->v[i].pid == pid && ss->v[i].session == session) return &ss->v[i];
+    if (ss->n == ss->cap) {
+        size_t ncap = ss->cap ? ss->cap * 2 : 8;
+        TraceSession *nv = realloc(ss->v, ncap * sizeof(TraceSession));
+        if (!nv) return NULL;
+        ss->v = nv; ss->cap = ncap;
+    }
+    TraceSession *t = &ss->v[ss->n++];
+    memset(t, 0, sizeof(*t));
+    t->pid = pid; t->session = session;
+    return t;
+}
+
+static void session_free(SessionSet *ss) {
+    for (size_t i = 0; i < ss->n; i++) {
+        for (size_t k = 0; k < ss->v[i].path_cap; k++) free(ss->v[i].paths[k]);
+        free(ss->v[i].paths);
+    }
+    free(ss->v);
+}
+
+// 深拷贝会话集合（分段解码时各段的起始状态）；内存不足返回 -1，dst 由调用方 session_free
+static int session_copy(SessionSet *dst, const SessionSet *src) {
+    memset(dst, 0, sizeof(*dst));
+    if (src->n == 0) return 0;
+    dst->v = malloc(src->n * sizeof(TraceSession));
+    if (!dst->v) return -1;
+    dst->cap = src->n;
+    for (size_t i = 0; i < src->n; i++) {
+        const TraceSession *s = &src->v[i];
+        TraceSession *t = &dst->v[dst->n++];
+        *t = *s;
+        t->paths = NULL;
+        t->path_cap = 0;
+        if (!s->path_cap) continue;
+        t->paths = calloc(s->path_cap, sizeof(char *));
+        if (!t->paths) return -1;
+        t->path_cap = s->path_cap;
+        for (size_t k = 0; k < s->path_cap; k++)
+            if (s->paths[k] && !(t->paths[k] = strdup(s->paths[k]))) return -1;
+    }
+    return 0;
+}
+
+// id 来自日志中的 varint，超出 IFT_PATH_ID_MAX 视为损坏（否则扩容循环会溢出）
+static int session_set_path(TraceSession *t, uint64_t id, const unsigned char *s, size_t n) {
+    if (id >= IFT_PATH_ID_MAX) return -1;
+    if (id >= t->path_cap) {
+        size_t ncap = t->path_cap ? t->path_cap : 64;
+        while (ncap <= id) ncap *= 2;
+        char **np = realloc(t->paths, ncap * sizeof(char *));
+        if (!np) return -1;
+        memset(np + t->path_cap, 0, (ncap - t->path_cap) * sizeof(char *));
+        t->paths = np; t->path_cap = ncap;
+    }
+    free(t->paths[id]);
+    t->paths[id] = malloc(n + 1);
+    if (!t->paths[id]) return -1;
+    memcpy(t->paths[id], s, n);
+    t->paths[id][n] = '\0';
+    return 0;
+}
+
+static const char *session_path(const TraceSession *t, uint64_t id) {
+    if (id < t->path_cap && t->paths[id]) return t->paths[id];
+    return "unknown";
+}
+
+// 读取整个文件到内存
+static unsigned char *slurp(const char *filename, size_t *len) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    long sz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (sz < 0) { fclose(fp); return NULL; }
+    unsigned char *buf = malloc((size_t)sz + 1);
+    if (!buf) { fclose(fp); return NULL; }
+    size_t got = fread(buf, 1, (size_t)sz, fp);
+    fclose(fp);
+    *len = got;
+    return buf;
+}
+
+#define GET(v) do { size_t _n = ift_get_varint(p, end, &(v)); if (!_n) return -1; p += _n; } while (0)
+
+static int get_string(const unsigned char **pp, const unsigned char *end, const unsigned char **s, size_t *n) {
+    uint64_t len = 0;
+    size_t k = ift_get_varint(*pp, end, &len);
+    if (!k || len > (uint64_t)(end - *pp - k)) return -1;
+    *s = *pp + k; *n = (size_t)len;
+    *pp += k + len;
+    return 0;
+}
+
+// 公共时钟：各进程/各流的会话都以 CLOCK_MONOTONIC 采集，统一用首个会话的锚点换算为墙钟，
+// 合并后的先后顺序与采集时刻一致，不受各会话锚点采样误差影响。
+// 锚点偏差超过 1 秒（跨开机、调过时钟）的会话仍用自己的锚点。
+static int ref_anchor_set = 0;
+static long long ref_anchor_offset = 0;     // wall - mono
+
+// 单调时间换算为墙钟纳秒；v1/v2 的时间戳本身是墙钟
+static long long session_wall_ns(const TraceSession *t, uint64_t ts) {
+    if (t->anchor_wall == 0) return (long long)ts;
+    long long offset = (long long)t->anchor_wall - (long long)t->anchor_mono;
+    if (!ref_anchor_set) { ref_anchor_offset = offset; ref_anchor_set = 1; }
+    long long diff = offset - ref_anchor_offset;
+    if (diff > -1000000000LL && diff < 1000000000LL) offset = ref_anchor_offset;
+    return offset + (long long)ts;
+}
+
+// 解码一个块的 payload；返回访问的事件数，格式错误返回 -1
+static int decode_block(TraceSession *t, const IftBlockHeader *h, const unsigned char *p, const unsigned char *end,
+                        trace_visit_fn fn, void *ctx, int *stop) {
+    uint64_t ts = h->base_ts_ns;
+    int64_t prev_end = 0;
+    int visited = 0;
+    while (p < end && !*stop) {
+        unsigned char tag = *p++;
+        if (tag == IFT_REC_SESSION) {
+            uint64_t sess; GET(sess);
+            const unsigned char *str; size_t n;
+            char *dst[3] = { t->app, t->user, t->host };
+            size_t cap[3] = { sizeof(t->app), sizeof(t->user), sizeof(t->host) };
+            for (int i = 0; i < 3; i++) {
+                if (get_string(&p, end, &str, &n) != 0) return -1;
+                if (n >= cap[i]) n = cap[i] - 1;
+                memcpy(dst[i], str, n); dst[i][n] = '\0';
+            }
+            if (h->version >= 3) { GET(t->anchor_wall); GET(t->anchor_mono); }
+        } else if (tag == IFT_REC_PATH) {
+            uint64_t id; GET(id);
+            const unsigned char *str; size_t n;
+            if (get_string(&p, end, &str, &n) != 0) return -1;
+            if (session_set_path(t, id, str, n) != 0) return -1;
+        } else if (tag == IFT_REC_EVENT || tag == IFT_REC_MMAP) {
+            uint64_t op, dts, pid, pid_id, fd, doff, size, st;
+            GET(op); GET(dts); GET(pid); GET(pid_id); GET(fd); GET(doff); GET(size); GET(st);
+            ts += (uint64_t)ift_unzigzag(dts);
+            TraceRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.rec_type = tag;
+            rec.op_type = (int)op;
+            rec.pid = (int)pid;
+            rec.ts_ns = session_wall_ns(t, ts);
+            rec.timestamp = (double)rec.ts_ns / 1e9;
+            rec.path = session_path(t, pid_id);
+            rec.fd = (int)ift_unzigzag(fd);
+            rec.offset = prev_end + ift_unzigzag(doff);
+            rec.size = (long long)size;
+            rec.status = (int)(st & 1);
+            rec.err_no = (int)(st >> 1);
+            if (h->version >= 2) { uint64_t fl; GET(fl); rec.flags = (int)fl; }
+            if (tag == IFT_REC_EVENT && h->version >= 4) {
+                uint64_t rq, io;
+                GET(rq); GET(io);
+                rec.req_size = (long long)rq;
+                rec.io_ns = io;
+            }
+            if (tag == IFT_REC_EVENT && h->version >= 5) { uint64_t tid; GET(tid); rec.tid = (int)tid; }
+            prev_end = rec.offset + rec.size;
+            if (tag == IFT_REC_MMAP) {
+                uint64_t a, l, fo;
+                GET(a); GET(l); GET(fo);
+                rec.addr_start = (long long)a;
+                rec.addr_end = (long long)(a + l);
+                rec.file_offset = (long long)fo;
+            }
+            visited++;
+            if (fn(&rec, ctx)) *stop = 1;
+        } else if (tag == IFT_REC_DISKSTAT || tag == IFT_REC_DEVINFO) {
+            uint64_t dts, dev;
+            GET(dts); GET(dev);
+            ts += (uint64_t)ift_unzigzag(dts);
+            TraceRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.rec_type = tag;
+            rec.ts_ns = session_wall_ns(t, ts);
+            rec.timestamp = (double)rec.ts_ns / 1e9;
+            rec.path = session_path(t, dev);
+            rec.fd = -1;
+            for (int i = 0; i < (tag == IFT_REC_DISKSTAT ? 8 : 3); i++) { uint64_t v; GET(v); rec.stat[i] = v; }
+            visited++;
+            if (fn(&rec, ctx)) *stop = 1;
+        } else if (tag == IFT_REC_PROCIO) {
+            uint64_t dts, pid;
+            GET(dts); GET(pid);
+            ts += (uint64_t)ift_unzigzag(dts);
+            TraceRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.rec_type = tag;
+            rec.pid = (int)pid;
+            rec.ts_ns = session_wall_ns(t, ts);
+            rec.timestamp = (double)rec.ts_ns / 1e9;
+            rec.path = "";
+            rec.fd = -1;
+            for (int i = 0; i < 5; i++) { uint64_t v; GET(v); rec.stat[i] = v; }
+            visited++;
+            if (fn(&rec, ctx)) *stop = 1;
+        } else if (tag == IFT_REC_DROP) {
+            uint64_t dts, pid, cnt;
+            GET(dts); GET(pid); GET(cnt);
+            ts += (uint64_t)ift_unzigzag(dts);
+            TraceRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.rec_type = tag;
+            rec.pid = (int)pid;
+            rec.ts_ns = session_wall_ns(t, ts);
+            rec.timestamp = (double)rec.ts_ns / 1e9;
+            rec.path = "";
+            rec.fd = -1;
+            rec.stat[0] = cnt;
+            visited++;
+            if (fn(&rec, ctx)) *stop = 1;
+        } else {
+            return -1;
+        }
+    }
+    return visited;
+}
+#undef GET
+
+int trace_is_binary(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
     if (!fp) return 0;
-    int count = 0;
-    char line[LINE_MAX];
-    double cum_io_ms = 0.0;
-    while (fgets(line, LINE_MAX, fp)) {
-        if (strstr(line, "Device:") == NULL) continue;
-        double ts = parse_bracket_ts(line);
-        const char *p = strstr(line, "io_time_ms:");
-        if (!p) continue;
-        long long io_ms = 0;
-        if (sscanf(p, "io_time_ms:%lld", &io_ms) != 1) continue;
-        records[count].timestamp = ts;
-        records[count].delta_io = (double)io_ms;  // 该周期的 I/O 活动强度
-        cum_io_ms += (double)io_ms;
-        records[count].total_io = cum_io_ms;      // 累计总和，供参考
-        count++;
-        if (count >= MAX_RECORDS) break;
+    uint32_t magic = 0;
+    size_t n = fread(&magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return n == sizeof(magic) && magic == IFT_BLOCK_MAGIC;
+}
+
+// 遍历 buf 中 [off, len) 的块（off 为块头；偏移均相对文件开头，用于报错）；sessions 由调用方提供
+static int decode_blocks(const char *filename, const unsigned char *buf, size_t off, size_t len,
+                         SessionSet *ss, trace_visit_fn fn, void *ctx) {
+    int total = 0, stop = 0;
+    while (off + sizeof(IftBlockHeader) <= len && !stop) {
+        IftBlockHeader h;
+        memcpy(&h, buf + off, sizeof(h));
+        uint32_t magic = IFT_BLOCK_MAGIC;
+        size_t end = off + sizeof(h) + h.payload_len;
+        if (h.magic != IFT_BLOCK_MAGIC || h.payload_len > len - off - sizeof(h)) {
+            // 写入失败可能留下半个块：向后找下一个块头继续解码
+            const unsigned char *next = memmem(buf + off + 1, len - off - 1, &magic, sizeof(magic));
+            if (!next) {
+                fprintf(stderr, "[Reader] %s: corrupt block at offset %zu, stop decoding\n", filename, off);
+                break;
+            }
+            fprintf(stderr, "[Reader] %s: corrupt block at offset %zu, resync at %zu\n", filename, off, (size_t)(next - buf));
+            off = (size_t)(next - buf);
+            continue;
+        }
+        const unsigned char *p = buf + off + sizeof(h);
+        TraceSession *t = session_get(ss, h.pid, h.session);
+        int n = t ? decode_block(t, &h, p, p + h.payload_len, fn, ctx, &stop) : -1;
+        if (n < 0) {
+            fprintf(stderr, "[Reader] %s: malformed block at offset %zu, skipped\n", filename, off);
+            // 半个块后紧跟下一个块时，payload_len 会越过真正的块头
+            if (end + sizeof(magic) <= len && memcmp(buf + end, &magic, sizeof(magic)) != 0) {
+                const unsigned char *next = memmem(buf + off + 1, end - off - 1, &magic, sizeof(magic));
+                if (next) end = (size_t)(next - buf);
+            }
+        } else {
+            total += n;
+        }
+        off = end;
+    }
+    return total;
+}
+
+// 遍历所有块；sessions 由调用方提供（可用于读取会话信息）
+static int foreach_blocks(const char *filename, SessionSet *ss, trace_visit_fn fn, void *ctx) {
+    size_t len = 0;
+    unsigned char *buf = slurp(filename, &len);
+    if (!buf) return -1;
+    int total = decode_blocks(filename, buf, 0, len, ss, fn, ctx);
+    free(buf);
+    return total;
+}
+
+int trace_foreach(const char *filename, trace_visit_fn fn, void *ctx) {
+    SessionSet ss = {0};
+    int n = foreach_blocks(filename, &ss, fn, ctx);
+    session_free(&ss);
+    return n;
+}
+
+static int visit_until_anchor(const TraceRecord *rec, void *ctx) { (void)rec; (void)ctx; return ref_anchor_set; }
+
+// 并发解码前先确定公共锚点：按顺序载入时的次序逐块解码，到第一条带锚点的记录为止，
+// 之后各线程只读 ref_anchor_offset，换算结果与顺序载入一致
+static void prime_ref_anchor(const char *filename) {
+    if (ref_anchor_set || !trace_is_binary(filename)) return;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return;
+    SessionSet ss = {0};
+    IftBlockHeader h;
+    unsigned char *buf = NULL;
+    size_t cap = 0;
+    while (!ref_anchor_set && fread(&h, sizeof(h), 1, fp) == 1 && h.magic == IFT_BLOCK_MAGIC) {
+        if (h.payload_len > cap) {
+            unsigned char *nb = realloc(buf, h.payload_len);
+            if (!nb) break;
+            buf = nb; cap = h.payload_len;
+        }
+        if (fread(buf, 1, h.payload_len, fp) != h.payload_len) break;
+        TraceSession *t = session_get(&ss, h.pid, h.session);
+        int stop = 0;
+        if (t) decode_block(t, &h, buf, buf + h.payload_len, visit_until_anchor, NULL, &stop);
     }
+    free(buf);
+    session_free(&ss);
     fclose(fp);
-    return count;
 }
 
-// 读取 read_log 文件内容到 ReadRecord 数组（过滤非磁盘路径）
-int load_read_log(const char *filename, ReadRecord *records) {
+static int visit_nothing(const TraceRecord *rec, void *ctx) { (void)rec; (void)ctx; return 0; }
+
+static int load_file_app(const char *filename, char *out, size_t outsz) {
+    out[0] = '\0';
+    if (trace_is_binary(filename)) {
+        SessionSet ss = {0};
+        foreach_blocks(filename, &ss, visit_nothing, NULL);
+        int found = 0;
+        for (size_t i = 0; i < ss.n && !found; i++) {
+            if (ss.v[i].app[0] == '\0') continue;
+            snprintf(out, outsz, "APP=%s | USER=%s | HOST=%s\n", ss.v[i].app, ss.v[i].user, ss.v[i].host);
+            found = 1;
+        }
+        session_free(&ss);
+        return found;
+    }
     FILE *fp = fopen(filename, "r");
     if (!fp) return 0;
-    int count = 0;
-    char line[LINE_MAX];
-    while (fgets(line, LINE_MAX, fp)) {
-        if (!strstr(line, "Type:READ") && !strstr(line, "Type:FREAD")) continue;
-        double ts = parse_bracket_ts(line);
-
-        // File 路径
-        const char *pf = strstr(line, "File:");
-        if (!pf) continue;
-        pf += strlen("File:");
-        const char *pf_end = strstr(pf, " | ");
-        int lfile = pf_end ? (int)(pf_end - pf) : (int)strcspn(pf, "\n");
-        if (lfile <= 0) continue;
-        char file_path[128];
-        if (lfile > 127) lfile = 127;
-        memcpy(file_path, pf, lfile);
-        file_path[lfile] = '\0';
+    char line[512];
+    int found = 0;
+    for (int k = 0; k < 32 && fgets(line, sizeof(line), fp); k++) {
+        if (strncmp(line, "APP=", 4) == 0) { snprintf(out, outsz, "%s", line); found = 1; break; }
+    }
+    fclose(fp);
+    return found;
+}
+
+// 多个进程的块交错写入，解码后按纳秒时间戳稳定排序
+typedef struct { long long ts; int idx; } TsIdx;
+
+static int cmp_ts_idx(const void *a, const void *b) {
+    const TsIdx *x = a, *y = b;
+    if (x->ts < y->ts) return -1;
+    if (x->ts > y->ts) return 1;
+    return x->idx - y->idx;
+}
+
+static void sort_by_timestamp(void *base, int n, size_t elem, size_t ts_off) {
+    if (n < 2) return;
+    TsIdx *keys = malloc(sizeof(TsIdx) * (size_t)n);
+    unsigned char *copy = malloc(elem * (size_t)n);
+    if (!keys || !copy) { free(keys); free(copy); return; }
+    memcpy(copy, base, elem * (size_t)n);
+    for (int i = 0; i < n; i++) {
+        memcpy(&keys[i].ts, copy + (size_t)i * elem + ts_off, sizeof(long long));
+        keys[i].idx = i;
+    }
+    qsort(keys, (size_t)n, sizeof(TsIdx), cmp_ts_idx);
+    for (int i = 0; i < n; i++)
+        memcpy((unsigned char *)base + (size_t)i * elem, copy + (size_t)keys[i].idx * elem, elem);
+    free(keys); free(copy);
+}
+
+// O_DIRECT 打开过的路径集合：这些文件绕过页缓存，预取无意义
+typedef struct { char **v; size_t n, cap; } PathSet;
+
+static void path_set_add(PathSet *s, const char *path) {
+    for (size_t i = 0; i < s->n; i++) if (strcmp(s->v[i], path) == 0) return;
+    if (s->n == s->cap) {
+        size_t ncap = s->cap ? s->cap * 2 : 16;
+        char **nv = realloc(s->v, ncap * sizeof(char *));
+        if (!nv) return;
+        s->v = nv; s->cap = ncap;
+    }
+    char *dup = strdup(path);
+    if (dup) s->v[s->n++] = dup;
+}
+
+static void path_set_free(PathSet *s) {
+    for (size_t i = 0; i < s->n; i++) free(s->v[i]);
+    free(s->v);
+    memset(s, 0, sizeof(*s));
+}
+
+/* ---------------- 按进程分流的日志 ---------------- */
+
+static int cmp_cstr(const void *a, const void *b) { return strcmp(*(char *const *)a, *(char *const *)b); }
+
+// 日志的全部流：filename 本身，以及 IFETCHER_PER_PROCESS_LOGS=1 时各进程写出的 filename.<pid>
+static void list_streams(const char *filename, PathSet *out) {
+    FILE *fp = fopen(filename, "rb");
+    size_t first = 0;
+    if (fp) { fclose(fp); path_set_add(out, filename); first = 1; }
+    const char *slash = strrchr(filename, '/');
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - filename) : 1, slash ? filename : ".");
+    const char *base = slash ? slash + 1 : filename;
+    size_t blen = strlen(base);
+    DIR *d = opendir(dir[0] ? dir : "/");
+    if (!d) return;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *n = de->d_name;
+        if (strncmp(n, base, blen) != 0 || n[blen] != '.' || n[blen + 1] == '\0') continue;
+        if (strspn(n + blen + 1, "0123456789") != strlen(n + blen + 1)) continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, n);
+        path_set_add(out, path);
+    }
+    closedir(d);
+    // 主文件之后按文件名排序，时间戳相同的记录合并顺序稳定
+    if (out->n > first + 1) qsort(out->v + first, out->n - first, sizeof(char *), cmp_cstr);
+}
+
+int load_log_app(const char *filename, char *out, size_t outsz) {
+    if (!out || outsz == 0) return 0;
+    out[0] = '\0';
+    PathSet streams = {0};
+    list_streams(filename, &streams);
+    int found = 0;
+    for (size_t i = 0; i < streams.n && !found; i++) found = load_file_app(streams.v[i], out, outsz);
+    path_set_free(&streams);
+    return found;
+}
+
+// IFETCHER_EXCLUDE_DIRECT=0 时保留 O_DIRECT 文件的读记录（默认剔除）
+static int exclude_direct(void) {
+    const char *e = getenv("IFETCHER_EXCLUDE_DIRECT");
+    return !(e && strcmp(e, "0") == 0);
+}
+
+// 剔除 O_DIRECT 路径上的读记录，返回剩余条数。load_trace_logs 中其它日志仍在并发登记路径，
+// 路径数只取一次快照，快照之后登记的 ID 不会是本日志的路径，直接跳过
+static int drop_direct_reads(ReadRecord *records, int count, const PathSet *direct) {
+    if (direct->n == 0 || !exclude_direct()) return count;
+    int n = path_count();
+    unsigned char *is_direct = calloc((size_t)n + 1, 1);
+    if (!is_direct) return count;
+    for (size_t i = 0; i < direct->n; i++) {
+        int id = path_lookup(direct->v[i]);
+        if (id >= 0 && id < n) is_direct[id] = 1;
+    }
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (records[i].path_id >= 0 && records[i].path_id < n && is_direct[records[i].path_id]) continue;
+        if (kept != i) records[kept] = records[i];
+        kept++;
+    }
+    free(is_direct);
+    if (kept < count)
+        fprintf(stderr, "[Reader] dropped %d reads on %zu O_DIRECT file(s)\n", count - kept, direct->n);
+    return kept;
+}
+
+// 读类操作：read/fread/pread/readv/preadv/sendfile/copy_file_range
+static int is_read_op(int op) {
+    return op == OP_READ || op == OP_FREAD || op == OP_PREAD || op == OP_READV ||
+           op == OP_PREADV || op == OP_SENDFILE || op == OP_COPY_RANGE;
+}
+
+typedef struct {
+    void *records;
+    int count;
+    size_t cap, elem, ts_off;   // 记录大小与其中 ts_ns 的偏移
+    PathSet direct;
+    int signal;
+    const char *device;
+    PathCache paths;            // 本解析任务的路径驻留缓存
+    unsigned long long dropped; // DROP 记录累计：profiler 未能写入日志的事件数
+} LoadCtx;
+
+// 追加一条记录并返回其槽位（已清零）；数组按倍增扩容，内存不足返回 NULL
+static void *ctx_slot(LoadCtx *c) {
+    if ((size_t)c->count == c->cap) {
+        size_t ncap = c->cap ? c->cap * 2 : 1024;
+        void *nv = realloc(c->records, ncap * c->elem);
+        if (!nv) return NULL;
+        c->records = nv; c->cap = ncap;
+    }
+    void *slot = (unsigned char *)c->records + (size_t)c->count++ * c->elem;
+    memset(slot, 0, c->elem);
+    return slot;
+}
+
+// stat_log 中作为 I/O 密度的信号（IFETCHER_IO_SIGNAL）
+enum { SIG_DEVICE, SIG_BLKIO, SIG_READ_BYTES, SIG_MAJFLT, SIG_AUTO };
+
+static int io_signal(void) {
+    const char *s = getenv("IFETCHER_IO_SIGNAL");
+    if (!s || !*s || strcmp(s, "auto") == 0) return SIG_AUTO;
+    if (strcmp(s, "device") == 0) return SIG_DEVICE;
+    if (strcmp(s, "blkio") == 0) return SIG_BLKIO;
+    if (strcmp(s, "read_bytes") == 0) return SIG_READ_BYTES;
+    if (strcmp(s, "majflt") == 0) return SIG_MAJFLT;
+    fprintf(stderr, "[analyzer] unknown IFETCHER_IO_SIGNAL=%s, using auto\n", s);
+    return SIG_AUTO;
+}
+
+// PROCIO 记录的 5 个增量：rchar, read_bytes, syscr, majflt, blkio_ms；read_bytes 折算为 KiB
+static double procio_value(int signal, const unsigned long long *v) {
+    if (signal == SIG_BLKIO) return (double)v[4];
+    if (signal == SIG_READ_BYTES) return (double)v[1] / 1024.0;
+    return (double)v[3];
+}
+
+static int visit_stat(const TraceRecord *rec, void *ctx) {
+    LoadCtx *c = ctx;
+    if (rec->rec_type == IFT_REC_DROP) { c->dropped += rec->stat[0]; return 0; }
+    if (rec->rec_type != (c->signal == SIG_DEVICE ? IFT_REC_DISKSTAT : IFT_REC_PROCIO)) return 0;
+    if (c->signal == SIG_DEVICE && c->device && strcmp(rec->path, c->device) != 0) return 0;
+    StatRecord *r = ctx_slot(c);
+    if (!r) return 1;
+    r->timestamp = rec->timestamp;
+    r->ts_ns = rec->ts_ns;
+    snprintf(r->device, sizeof(r->device), "%s", c->signal == SIG_DEVICE ? rec->path : "");
+    r->delta_io = c->signal == SIG_DEVICE ? (double)rec->stat[6] : procio_value(c->signal, rec->stat);
+    return 0;
+}
+
+static int visit_read(const TraceRecord *rec, void *ctx) {
+    LoadCtx *c = ctx;
+    if (rec->rec_type == IFT_REC_DROP) { c->dropped += rec->stat[0]; return 0; }
+    if (rec->rec_type != IFT_REC_EVENT) return 0;
+    if (!rec->path || rec->path[0] != '/') return 0;
+    if (rec->op_type == OP_OPEN || rec->op_type == OP_FOPEN) {
+        if (rec->status == 0 && (rec->flags & O_DIRECT)) path_set_add(&c->direct, rec->path);
+        return 0;
+    }
+    if (!is_read_op(rec->op_type)) return 0;
+    const char *str;
+    int path_id = path_cache_intern(&c->paths, rec->path, strlen(rec->path), &str);
+    if (path_id < 0) return 0;
+    ReadRecord *r = ctx_slot(c);
+    if (!r) return 1;
+    r->timestamp = rec->timestamp;
+    r->ts_ns = rec->ts_ns;
+    r->path_id = path_id;
+    r->file_path = str;
+    r->offset = rec->offset;
+    r->req_len = rec->req_size ? rec->req_size : rec->size;
+    r->read_len = rec->size;
+    r->io_time = (double)rec->io_ns / 1e9;
+    return 0;
+}
+
+static int visit_mmap(const TraceRecord *rec, void *ctx) {
+    LoadCtx *c = ctx;
+    if (rec->rec_type == IFT_REC_DROP) { c->dropped += rec->stat[0]; return 0; }
+    if (rec->rec_type != IFT_REC_MMAP || rec->op_type != OP_MMAP) return 0;
+    const char *str;
+    int path_id = path_cache_intern(&c->paths, rec->path, strlen(rec->path), &str);
+    if (path_id < 0) return 0;
+    MmapRecord *r = ctx_slot(c);
+    if (!r) return 1;
+    r->timestamp = rec->timestamp;
+    r->ts_ns = rec->ts_ns;
+    snprintf(r->start_addr, sizeof(r->start_addr), "%lld", rec->addr_start);
+    snprintf(r->end_addr, sizeof(r->end_addr), "%lld", rec->addr_end);
+    r->path_id = path_id;
+    r->file_path = str;
+    r->file_offset = rec->file_offset;
+    r->size = rec->size;
+    return 0;
+}
+
+static int visit_page(const TraceRecord *rec, void *ctx) {
+    LoadCtx *c = ctx;
+    if (rec->rec_type == IFT_REC_DROP) { c->dropped += rec->stat[0]; return 0; }
+    if (rec->rec_type != IFT_REC_EVENT || (rec->op_type != OP_CACHE && rec->op_type != OP_FAULT)) return 0;
+    if (!rec->path || rec->path[0] != '/') return 0;
+    const char *str;
+    int path_id = path_cache_intern(&c->paths, rec->path, strlen(rec->path), &str);
+    if (path_id < 0) return 0;
+    PageRecord *r = ctx_slot(c);
+    if (!r) return 1;
+    r->timestamp = rec->timestamp;
+    r->ts_ns = rec->ts_ns;
+    r->op = rec->op_type;
+    r->path_id = path_id;
+    r->file_path = str;
+    r->offset = rec->offset;
+    r->length = rec->size;
+    r->pid = rec->pid;
+    return 0;
+}
+
+/* ---------------- 文本日志解析 ---------------- */
+
+// 文本日志整体只读映射后原地切分：每行形如 "[时间戳] Key:Value | Key:Value | ..."，
+// 字段值直接指向映射内存（路径由 path_intern_n 驻留），不复制、不截断行。
+// 行尾与分隔符 '|' 的查找每次比较 32/16 字节（AVX2 / SSE2，运行时按 CPU 选择），尾部逐字节；
+// IFETCHER_TEXT_SIMD=0 强制逐字节，便于对照。
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+typedef const char *(*find_sep_fn)(const char *p, const char *end);
+
+// [p, end) 中第一个 '\n' 或 '|' 的位置，没有则为 end
+static const char *find_sep_scalar(const char *p, const char *end) {
+    for (; p < end; p++) if (*p == '\n' || *p == '|') return p;
+    return end;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static const char *find_sep_sse2(const char *p, const char *end) {
+    const __m128i nl = _mm_set1_epi8('\n'), bar = _mm_set1_epi8('|');
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, bar)));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return find_sep_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *find_sep_avx2(const char *p, const char *end) {
+    const __m256i nl = _mm256_set1_epi8('\n'), bar = _mm256_set1_epi8('|');
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, bar)));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return find_sep_scalar(p, end);
+}
+#endif
+
+static find_sep_fn pick_find_sep(void) {
+    const char *e = getenv("IFETCHER_TEXT_SIMD");
+    if (e && strcmp(e, "0") == 0) return find_sep_scalar;
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return find_sep_avx2;
+    if (__builtin_cpu_supports("sse2")) return find_sep_sse2;
+#endif
+    return find_sep_scalar;
+}
+
+#define TEXT_MAX_FIELDS 24
+
+typedef struct { const char *key, *val; int klen, vlen; } TextField;
+
+typedef struct {
+    long long ts_ns;                    // 行首方括号时间戳，缺失或无法解析为 0
+    int nf;
+    TextField f[TEXT_MAX_FIELDS];       // 超出部分忽略
+} TextLine;
+
+typedef struct {
+    const char *base, *p, *end;         // 映射区与当前行首
+    size_t len;
+    find_sep_fn find_sep;
+    long long minute_key;               // 上一次 mktime 的 年-月-日 时:分，及其 epoch 秒
+    long long minute_epoch;
+} TextScan;
+
+static int text_open(TextScan *s, const char *filename) {
+    memset(s, 0, sizeof(*s));
+    s->minute_key = -1;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return 0;
+    madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+    s->base = s->p = m;
+    s->len = (size_t)st.st_size;
+    s->end = s->base + s->len;
+    s->find_sep = pick_find_sep();
+    return 1;
+}
+
+static void text_close(TextScan *s) {
+    if (s->base) munmap((void *)s->base, s->len);
+    s->base = s->p = s->end = NULL;
+}
+
+// 映射区 [begin, end) 的独立游标（不拥有映射，无需 text_close）
+static TextScan text_slice(const TextScan *s, size_t begin, size_t end) {
+    TextScan c = *s;
+    c.p = s->base + begin;
+    c.end = s->base + end;
+    c.minute_key = -1;
+    return c;
+}
+
+// 读无符号十进制数，至少一位；失败返回 NULL
+static const char *scan_uint(const char *p, const char *end, long long *v) {
+    const char *q = p;
+    long long x = 0;
+    for (; q < end && *q >= '0' && *q <= '9'; q++) x = x * 10 + (*q - '0');
+    if (q == p) return NULL;
+    *v = x;
+    return q;
+}
+
+static const char *expect_char(const char *p, const char *end, char c) {
+    return (p && p < end && *p == c) ? p + 1 : NULL;
+}
+
+// 解析 "YYYY-MM-DD HH:MM:SS[.fffffffff]" 为 epoch 纳秒。时区偏移只在整分钟变化，
+// 同一分钟的行复用上次 mktime 的结果再加秒数，mktime 每分钟只调用一次
+static const char *parse_ts(TextScan *s, const char *p, const char *end, long long *ts_ns) {
+    long long year = 0, mon = 0, day = 0, hour = 0, min = 0, sec = 0;
+    p = scan_uint(p, end, &year);
+    p = expect_char(p, end, '-'); if (p) p = scan_uint(p, end, &mon);
+    p = expect_char(p, end, '-'); if (p) p = scan_uint(p, end, &day);
+    p = expect_char(p, end, ' '); if (p) p = scan_uint(p, end, &hour);
+    p = expect_char(p, end, ':'); if (p) p = scan_uint(p, end, &min);
+    p = expect_char(p, end, ':'); if (p) p = scan_uint(p, end, &sec);
+    if (!p) return NULL;
+    long long key = (((year * 13 + mon) * 32 + day) * 24 + hour) * 60 + min;
+    if (key != s->minute_key) {
+        struct tm tmv;
+        memset(&tmv, 0, sizeof(tmv));
+        tmv.tm_year = (int)year - 1900;
+        tmv.tm_mon = (int)mon - 1;
+        tmv.tm_mday = (int)day;
+        tmv.tm_hour = (int)hour;
+        tmv.tm_min = (int)min;
+        tmv.tm_isdst = -1;
+        s->minute_epoch = (long long)mktime(&tmv);
+        s->minute_key = key;
+    }
+    long long frac = 0;
+    if (p < end && *p == '.') {
+        int digits = 0;
+        for (p++; p < end && *p >= '0' && *p <= '9' && digits < 9; p++, digits++) frac = frac * 10 + (*p - '0');
+        for (; digits < 9; digits++) frac *= 10;
+    }
+    *ts_ns = (s->minute_epoch + sec) * 1000000000LL + frac;
+    return p;
+}
+
+// 切出下一行；到文件末尾返回 0。字段以 " | " 分隔（路径中单独的 '|' 仍属于字段值），
+// "Key:Value" 在第一个 ':' 处拆分，没有 ':' 的字段 key 为整段、值为空
+static int text_next(TextScan *s, TextLine *ln) {
+    const char *p = s->p, *end = s->end;
+    if (p >= end) return 0;
+    ln->ts_ns = 0;
+    ln->nf = 0;
+    if (*p == '[') {
+        long long ts = 0;
+        const char *q = parse_ts(s, p + 1, end, &ts);
+        if (q) {
+            while (q < end && *q != ']' && *q != '\n') q++;
+            if (q < end && *q == ']') {
+                ln->ts_ns = ts;
+                p = q + 1;
+                if (p < end && *p == ' ') p++;
+            }
+        }
+    }
+    const char *field = p;
+    for (;;) {
+        const char *sep = s->find_sep(p, end);
+        if (sep < end && *sep == '|' && !(sep > field && sep[-1] == ' ' && sep + 1 < end && sep[1] == ' ')) {
+            p = sep + 1;
+            continue;
+        }
+        int last = (sep >= end || *sep == '\n');
+        const char *fend = last ? sep : sep - 1;
+        if (ln->nf < TEXT_MAX_FIELDS && fend > field) {
+            TextField *f = &ln->f[ln->nf++];
+            const char *colon = memchr(field, ':', (size_t)(fend - field));
+            f->key = field;
+            f->klen = (int)((colon ? colon : fend) - field);
+            f->val = colon ? colon + 1 : fend;
+            f->vlen = (int)(fend - f->val);
+        }
+        if (last) { s->p = sep < end ? sep + 1 : end; return 1; }
+        p = field = sep + 2;
+    }
+}
+
+static const TextField *line_field(const TextLine *ln, const char *key) {
+    int klen = (int)strlen(key);
+    for (int i = 0; i < ln->nf; i++)
+        if (ln->f[i].klen == klen && memcmp(ln->f[i].key, key, (size_t)klen) == 0) return &ln->f[i];
+    return NULL;
+}
+
+// 字段的十进制整数值（可带符号）；字段缺失或没有数字返回 0，*v 不变
+static int field_ll(const TextLine *ln, const char *key, long long *v) {
+    const TextField *f = line_field(ln, key);
+    if (!f) return 0;
+    const char *p = f->val, *end = f->val + f->vlen;
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    long long x;
+    if (!scan_uint(p, end, &x)) return 0;
+    *v = neg ? -x : x;
+    return 1;
+}
+
+static unsigned long long field_ull(const TextLine *ln, const char *key) {
+    long long v = 0;
+    return field_ll(ln, key, &v) ? (unsigned long long)v : 0;
+}
+
+// "PID:<pid> | Dropped:<n>" 行（与二进制 DROP 记录对应）：累计到 c 并返回 1
+static int line_dropped(const TextLine *ln, LoadCtx *c) {
+    if (!line_field(ln, "Dropped")) return 0;
+    c->dropped += field_ull(ln, "Dropped");
+    return 1;
+}
+
+// profiler 报告过丢弃时提示日志不完整
+static void report_dropped(const char *filename, unsigned long long dropped) {
+    if (dropped > 0)
+        fprintf(stderr, "[Reader] %s: profiler dropped %llu events during capture, the log is incomplete\n", filename, dropped);
+}
+
+// 十六进制字段（可带 0x 前缀）
+static int field_hex(const TextLine *ln, const char *key, unsigned long long *v) {
+    const TextField *f = line_field(ln, key);
+    if (!f) return 0;
+    const char *p = f->val, *end = f->val + f->vlen;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+    unsigned long long x = 0;
+    const char *q = p;
+    for (; q < end; q++) {
+        int d = (*q >= '0' && *q <= '9') ? *q - '0' : (*q >= 'a' && *q <= 'f') ? *q - 'a' + 10 :
+                (*q >= 'A' && *q <= 'F') ? *q - 'A' + 10 : -1;
+        if (d < 0) break;
+        x = x * 16 + (unsigned long long)d;
+    }
+    if (q == p) return 0;
+    *v = x;
+    return 1;
+}
+
+static int field_is(const TextLine *ln, const char *key, const char *val) {
+    const TextField *f = line_field(ln, key);
+    return f && f->vlen == (int)strlen(val) && memcmp(f->val, val, (size_t)f->vlen) == 0;
+}
+
+// 字段值的第一个词（到空白为止）复制到 out，如 Device:/DeviceInfo: 的设备名；字段缺失或为空返回 0
+static int field_word(const TextLine *ln, const char *key, char *out, size_t outsz) {
+    const TextField *f = line_field(ln, key);
+    if (!f) return 0;
+    const char *p = f->val, *end = f->val + f->vlen;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    size_t n = 0;
+    while (p + n < end && p[n] != ' ' && p[n] != '\t' && p[n] != '\r' && n + 1 < outsz) n++;
+    if (n == 0) return 0;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return 1;
+}
+
+// "Type:<NAME>" 的 OpType 编号，未知返回 -1
+static int line_op_type(const TextLine *ln) {
+    const TextField *f = line_field(ln, "Type");
+    if (!f) return -1;
+    for (int op = 0; strcmp(ift_op_name((uint64_t)op), "UNKNOWN") != 0; op++) {
+        const char *name = ift_op_name((uint64_t)op);
+        if ((int)strlen(name) == f->vlen && memcmp(f->val, name, (size_t)f->vlen) == 0) return op;
+    }
+    return -1;
+}
+
+// 经 c 的缓存驻留 File 字段的路径，*str 为驻留字符串；require_abs 时只接受绝对路径（忽略 pipe:/anon_inode: 等）；失败返回 -1
+static int line_path_id(const TextLine *ln, int require_abs, LoadCtx *c, const char **str) {
+    const TextField *f = line_field(ln, "File");
+    if (!f || f->vlen <= 0) return -1;
+    if (require_abs && f->val[0] != '/') return -1;
+    return path_cache_intern(&c->paths, f->val, (size_t)f->vlen, str);
+}
+
+/* ---------------- 并行载入 ---------------- */
+
+// 一类日志的解析方式：二进制流逐条回调，文本流逐行解析
+typedef struct {
+    trace_visit_fn visit;
+    void (*parse_text)(TextScan *s, LoadCtx *c);
+} LogKind;
+
+// 解析任务：流中的一段，文本流按行对齐，二进制流按块对齐。各任务写自己的 LoadCtx，完成后按时间排好序
+typedef struct {
+    const char *file;
+    int binary;
+    TextScan scan;              // 段在映射区中的范围
+    SessionSet ss;              // 二进制段：段首的会话状态（会话信息与路径表）
+    LoadCtx ctx;
+} LoadTask;
+
+typedef struct { const LogKind *kind; LoadTask *tasks; } LoadJob;
+
+#define LOAD_CHUNK_BYTES (4u << 20)
+
+static void run_load_task(int i, void *arg) {
+    const LoadJob *job = arg;
+    LoadTask *t = &job->tasks[i];
+    if (t->binary) {
+        const unsigned char *base = (const unsigned char *)t->scan.base;
+        decode_blocks(t->file, base, (size_t)(t->scan.p - t->scan.base), (size_t)(t->scan.end - t->scan.base),
+                      &t->ss, job->kind->visit, &t->ctx);
+        session_free(&t->ss);
+    } else {
+        job->kind->parse_text(&t->scan, &t->ctx);
+    }
+    sort_by_timestamp(t->ctx.records, t->ctx.count, t->ctx.elem, t->ctx.ts_off);
+}
+
+static long long run_ts(const LoadTask *t, int k) {
+    long long ts;
+    memcpy(&ts, (const unsigned char *)t->ctx.records + (size_t)k * t->ctx.elem + t->ctx.ts_off, sizeof(ts));
+    return ts;
+}
+
+// 各任务的有序结果按 (时间戳, 任务序号) 多路归并到 c；任务按流、段的先后编号，
+// 因此与把所有记录拼接后做稳定排序的结果相同。记录数超出 int 或内存不足时返回 -1
+static int merge_runs(const char *filename, LoadTask *tasks, int n, LoadCtx *c) {
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += (size_t)tasks[i].ctx.count;
+    if (total == 0) return 0;
+    if (total > INT32_MAX) {
+        fprintf(stderr, "[Reader] %s: %zu records exceed the per-log limit of %d\n", filename, total, INT32_MAX);
+        return -1;
+    }
+    if (n == 1) {
+        c->records = tasks[0].ctx.records;
+        c->count = tasks[0].ctx.count;
+        c->cap = tasks[0].ctx.cap;
+        tasks[0].ctx.records = NULL;
+        return 0;
+    }
+    unsigned char *out = malloc(total * c->elem);
+    int *heap = malloc(sizeof(int) * (size_t)n), *pos = calloc((size_t)n, sizeof(int));
+    if (!out || !heap || !pos) {
+        fprintf(stderr, "[Reader] %s: out of memory merging %zu records\n", filename, total);
+        free(out); free(heap); free(pos);
+        return -1;
+    }
+    #define RUN_LESS(a, b) (run_ts(&tasks[a], pos[a]) < run_ts(&tasks[b], pos[b]) || \
+                            (run_ts(&tasks[a], pos[a]) == run_ts(&tasks[b], pos[b]) && (a) < (b)))
+    int hn = 0;
+    for (int i = 0; i < n; i++) {
+        if (tasks[i].ctx.count == 0) continue;
+        int k = hn++;
+        for (; k > 0 && RUN_LESS(i, heap[(k - 1) / 2]); k = (k - 1) / 2) heap[k] = heap[(k - 1) / 2];
+        heap[k] = i;
+    }
+    for (size_t w = 0; w < total; w++) {
+        int r = heap[0];
+        memcpy(out + w * c->elem, (unsigned char *)tasks[r].ctx.records + (size_t)pos[r] * c->elem, c->elem);
+        if (++pos[r] == tasks[r].ctx.count) r = heap[--hn];
+        // r 从堆顶下沉
+        int k = 0;
+        for (;;) {
+            int m = 2 * k + 1;
+            if (m >= hn) break;
+            if (m + 1 < hn && RUN_LESS(heap[m + 1], heap[m])) m++;
+            if (!RUN_LESS(heap[m], r)) break;
+            heap[k] = heap[m];
+            k = m;
+        }
+        if (hn > 0) heap[k] = r;
+    }
+    #undef RUN_LESS
+    free(heap); free(pos);
+    c->records = out;
+    c->count = (int)total;
+    c->cap = total;
+    return 0;
+}
+
+typedef struct { LoadTask *v; int n, cap; } TaskList;
+
+// 追加一个解析 map[begin, end) 的任务；内存不足返回 NULL
+static LoadTask *add_task(TaskList *l, const TextScan *map, size_t begin, size_t end, const char *file, const LoadCtx *c) {
+    if (l->n == l->cap) {
+        int ncap = l->cap ? l->cap * 2 : 16;
+        LoadTask *nt = realloc(l->v, sizeof(LoadTask) * (size_t)ncap);
+        if (!nt) return NULL;
+        l->v = nt; l->cap = ncap;
+    }
+    LoadTask *t = &l->v[l->n++];
+    memset(t, 0, sizeof(*t));
+    t->file = file;
+    t->scan = text_slice(map, begin, end);
+    t->ctx.elem = c->elem;
+    t->ctx.ts_off = c->ts_off;
+    t->ctx.signal = c->signal;
+    t->ctx.device = c->device;
+    return t;
+}
+
+// 文本流按约 LOAD_CHUNK_BYTES 切成以换行结尾的段
+static void split_text(TaskList *l, const TextScan *map, const char *file, const LoadCtx *c) {
+    size_t len = map->len, begin = 0;
+    while (begin < len) {
+        size_t end = len;
+        if (len - begin > LOAD_CHUNK_BYTES) {
+            const char *nl = memchr(map->base + begin + LOAD_CHUNK_BYTES, '\n', len - begin - LOAD_CHUNK_BYTES);
+            end = nl ? (size_t)(nl - map->base) + 1 : len;
+        }
+        if (!add_task(l, map, begin, end, file, c)) return;
+        begin = end;
+    }
+}
+
+// 二进制流按约 LOAD_CHUNK_BYTES 切成以块头为界的段。路径 id 在会话内跨块有效，各段需要段首的会话状态：
+// 顺序扫一遍块头，只解码带 IFT_BLOCK_F_DEFS 的块（v9 之前的块没有标记，全部解码），在每个切点拷贝一份。
+// 块头的跳转与 decode_blocks 相同，切点都落在顺序解码时的块头上
+static void split_binary(TaskList *l, const TextScan *map, const char *file, const LoadCtx *c) {
+    const unsigned char *buf = (const unsigned char *)map->base;
+    size_t len = map->len, off = 0, begin = 0;
+    uint32_t magic = IFT_BLOCK_MAGIC;
+    SessionSet ss = {0}, start = {0};      // 当前状态；当前段段首的状态
+    while (off + sizeof(IftBlockHeader) <= len) {
+        IftBlockHeader h;
+        memcpy(&h, buf + off, sizeof(h));
+        if (h.magic != IFT_BLOCK_MAGIC || h.payload_len > len - off - sizeof(h)) {
+            const unsigned char *next = memmem(buf + off + 1, len - off - 1, &magic, sizeof(magic));
+            if (!next) break;
+            off = (size_t)(next - buf);
+            continue;
+        }
+        SessionSet snap;
+        if (off - begin >= LOAD_CHUNK_BYTES) {
+            LoadTask *t = NULL;
+            if (session_copy(&snap, &ss) == 0 && (t = add_task(l, map, begin, off, file, c)) != NULL) {
+                t->binary = 1;
+                t->ss = start;
+                start = snap;
+                begin = off;
+            } else {
+                session_free(&snap);    // 内存不足：不切分，并入下一段
+            }
+        }
+        if (h.version < 9 || (h.flags & IFT_BLOCK_F_DEFS)) {
+            const unsigned char *p = buf + off + sizeof(h);
+            TraceSession *t = session_get(&ss, h.pid, h.session);
+            int stop = 0;
+            if (t) decode_block(t, &h, p, p + h.payload_len, visit_nothing, NULL, &stop);
+        }
+        off += sizeof(h) + h.payload_len;
+    }
+    session_free(&ss);
+    LoadTask *t = add_task(l, map, begin, len, file, c);
+    if (t) { t->binary = 1; t->ss = start; }
+    else session_free(&start);
+}
+
+// 载入日志的全部流（见 list_streams）：各流切成约 4 MiB 的段（文本按行、二进制按块），
+// 所有段在线程池上并行解析，再按时间归并为一个有序数组写入 c；归并失败返回 -1（c 中无记录）
+static int load_streams(const char *filename, const LogKind *kind, LoadCtx *c) {
+    PathSet streams = {0};
+    list_streams(filename, &streams);
+    for (size_t i = 0; i < streams.n; i++) prime_ref_anchor(streams.v[i]);
+
+    TextScan *maps = calloc(streams.n + 1, sizeof(TextScan));
+    TaskList l = {0};
+    for (size_t i = 0; maps && i < streams.n; i++) {
+        int binary = trace_is_binary(streams.v[i]);
+        if (!text_open(&maps[i], streams.v[i])) continue;
+        if (binary) split_binary(&l, &maps[i], streams.v[i], c);
+        else split_text(&l, &maps[i], streams.v[i], c);
+    }
+    LoadTask *tasks = l.v;
+    int n = l.n;
+
+    LoadJob job = { kind, tasks };
+    tzset();    // 时区在分发前初始化一次，各线程的 mktime 只读
+    parallel_for(n, run_load_task, &job);
+    int rc = merge_runs(filename, tasks, n, c);
+    for (int i = 0; i < n; i++) {
+        c->dropped += tasks[i].ctx.dropped;
+        for (size_t k = 0; k < tasks[i].ctx.direct.n; k++) path_set_add(&c->direct, tasks[i].ctx.direct.v[k]);
+        path_set_free(&tasks[i].ctx.direct);
+        path_cache_free(&tasks[i].ctx.paths);
+        free(tasks[i].ctx.records);
+    }
+    for (size_t i = 0; maps && i < streams.n; i++) text_close(&maps[i]);
+    free(maps);
+    free(tasks);
+    path_set_free(&streams);
+    return rc;
+}
+
+static void parse_stat_text(TextScan *s, LoadCtx *c) {
+    TextLine ln;
+    while (text_next(s, &ln)) {
+        if (line_dropped(&ln, c)) continue;
+        double v;
+        char device[32] = "";
+        if (c->signal == SIG_DEVICE) {
+            if (!field_word(&ln, "Device", device, sizeof(device))) continue;
+            if (c->device && strcmp(device, c->device) != 0) continue;
+            long long io_ms = 0;
+            if (!field_ll(&ln, "io_time_ms", &io_ms)) continue;
+            v = (double)io_ms;  // 该周期的 I/O 活动强度
+        } else {
+            if (!line_field(&ln, "Process")) continue;
+            static const char *const keys[] = {"rchar", "read_bytes", "syscr", "majflt", "blkio_ms"};
+            unsigned long long f[5];
+            for (int k = 0; k < 5; k++) f[k] = field_ull(&ln, keys[k]);
+            v = procio_value(c->signal, f);
+        }
+        StatRecord *r = ctx_slot(c);
+        if (!r) break;
+        r->ts_ns = ln.ts_ns;
+        r->timestamp = (double)r->ts_ns / 1e9;
+        r->delta_io = v;
+        memcpy(r->device, device, sizeof(device));
+    }
+}
+
+// 进程信号：同一轮采样中各进程的记录时刻相同，合并为一条（整棵进程树之和）
+static int merge_same_ts(StatRecord *records, int count) {
+    int j = 0;
+    for (int i = 0; i < count; i++) {
+        if (j > 0 && records[j - 1].ts_ns == records[i].ts_ns) records[j - 1].delta_io += records[i].delta_io;
+        else records[j++] = records[i];
+    }
+    return j;
+}
+
+// 设备表：DEVINFO 给出元数据，DISKSTAT 增量累加为总量
+typedef struct { DeviceInfo *v; int n, max; } DeviceTable;
+
+static DeviceInfo *device_get(DeviceTable *t, const char *name) {
+    for (int i = 0; i < t->n; i++)
+        if (strcmp(t->v[i].name, name) == 0) return &t->v[i];
+    if (t->n == t->max) return NULL;
+    DeviceInfo *d = &t->v[t->n++];
+    memset(d, 0, sizeof(*d));
+    d->rotational = -1;
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    return d;
+}
+
+static int visit_device(const TraceRecord *rec, void *ctx) {
+    if (rec->rec_type != IFT_REC_DEVINFO && rec->rec_type != IFT_REC_DISKSTAT) return 0;
+    DeviceInfo *d = device_get(ctx, rec->path);
+    if (!d) return 0;
+    if (rec->rec_type == IFT_REC_DEVINFO) {
+        d->rotational = (int)rec->stat[0];
+        d->queue_depth = (int)rec->stat[1];
+        d->logical_block_size = (int)rec->stat[2];
+    } else {
+        d->reads += rec->stat[0];
+        d->sectors_read += rec->stat[1];
+        d->io_ms += rec->stat[6];
+    }
+    return 0;
+}
+
+static void load_device_file(const char *filename, DeviceTable *t) {
+    if (trace_is_binary(filename)) { trace_foreach(filename, visit_device, t); return; }
+    TextScan s;
+    TextLine ln;
+    char name[32];
+    if (!text_open(&s, filename)) return;
+    while (text_next(&s, &ln)) {
+        DeviceInfo *d;
+        if (field_word(&ln, "DeviceInfo", name, sizeof(name))) {
+            if (!(d = device_get(t, name))) continue;
+            d->rotational = (int)field_ull(&ln, "rotational");
+            d->queue_depth = (int)field_ull(&ln, "queue_depth");
+            d->logical_block_size = (int)field_ull(&ln, "logical_block_size");
+        } else if (field_word(&ln, "Device", name, sizeof(name))) {
+            if (!(d = device_get(t, name))) continue;
+            d->reads += field_ull(&ln, "reads");
+            d->sectors_read += field_ull(&ln, "sectors_read");
+            d->io_ms += field_ull(&ln, "io_time_ms");
+        }
+    }
+    text_close(&s);
+}
+
+// 汇总 stat_log 中各设备的元数据与读总量，返回设备数
+int load_device_info(const char *filename, DeviceInfo *out, int max) {
+    DeviceTable t = { out, 0, max };
+    PathSet streams = {0};
+    list_streams(filename, &streams);
+    for (size_t i = 0; i < streams.n; i++) load_device_file(streams.v[i], &t);
+    path_set_free(&streams);
+    return t.n;
+}
+
+// device 信号只取 IFETCHER_IO_DEVICE 指定的设备；"auto" 取读扇区最多的设备；未设置时不过滤（各盘之和）
+static const char *io_device(const char *filename, char *buf) {
+    const char *s = getenv("IFETCHER_IO_DEVICE");
+    if (!s || !*s) return NULL;
+    if (strcmp(s, "auto") != 0) { snprintf(buf, 32, "%s", s); return buf; }
+    DeviceInfo devs[64];
+    int n = load_device_info(filename, devs, 64), best = -1;
+    for (int i = 0; i < n; i++)
+        if (devs[i].sectors_read > 0 && (best < 0 || devs[i].sectors_read > devs[best].sectors_read)) best = i;
+    if (best < 0) return NULL;
+    memcpy(buf, devs[best].name, sizeof(devs[best].name));
+    return buf;
+}
+
+static const LogKind stat_kind = { visit_stat, parse_stat_text };
+
+static int load_stat_signal(const char *filename, StatRecord **records, int signal, double *sum,
+                            unsigned long long *dropped) {
+    char device[32];
+    LoadCtx c = { .elem = sizeof(StatRecord), .ts_off = offsetof(StatRecord, ts_ns), .signal = signal,
+                  .device = signal == SIG_DEVICE ? io_device(filename, device) : NULL };
+    if (load_streams(filename, &stat_kind, &c) != 0) { *records = NULL; *sum = 0.0; return -1; }
+    *dropped = c.dropped;
+    StatRecord *r = c.records;
+    if (signal != SIG_DEVICE) c.count = merge_same_ts(r, c.count);
+    *sum = 0.0;
+    for (int i = 0; i < c.count; i++) *sum += r[i].delta_io;
+    *records = r;
+    return c.count;
+}
+
+// 读取 stat_log 文件内容到 StatRecord 数组（按 IFETCHER_IO_SIGNAL 选信号，并累计 total_io）
+int load_stat_log(const char *filename, StatRecord **records) {
+    StatRecord *r = NULL;
+    double sum = 0.0, cum_io = 0.0;
+    unsigned long long dropped = 0;
+    int count, signal = io_signal();
+    if (signal == SIG_AUTO) {
+        // 优先用目标自身的阻塞时间；delayacct 未开启或滴答太粗时用其读盘量；都没有再退回整盘 io_time
+        count = load_stat_signal(filename, &r, SIG_BLKIO, &sum, &dropped);
+        if (count >= 0 && sum <= 0.0) { free(r); count = load_stat_signal(filename, &r, SIG_READ_BYTES, &sum, &dropped); }
+        if (count >= 0 && sum <= 0.0) { free(r); count = load_stat_signal(filename, &r, SIG_DEVICE, &sum, &dropped); }
+    } else {
+        count = load_stat_signal(filename, &r, signal, &sum, &dropped);
+    }
+    if (count < 0) { *records = NULL; return -1; }
+    report_dropped(filename, dropped);
+    for (int i = 0; i < count; i++) {
+        cum_io += r[i].delta_io;
+        r[i].total_io = cum_io;        // 累计总和，供参考
+    }
+    *records = r;
+    return count;
+}
+
+static void parse_read_text(TextScan *s, LoadCtx *c) {
+    TextLine ln;
+    while (text_next(s, &ln)) {
+        if (line_dropped(&ln, c)) continue;
+        int op = line_op_type(&ln);
+        if (op < 0) continue;
+        int is_open = (op == OP_OPEN || op == OP_FOPEN);
+        if (!is_open && !is_read_op(op)) continue;
+
         // 仅保留真实磁盘路径，忽略 pipe:/anon_inode: 等
-        if (file_path[0] != '/') continue;
+        const char *str;
+        int path_id = line_path_id(&ln, 1, c, &str);
+        if (path_id < 0) continue;
+
+        if (is_open) {
+            unsigned long long flags = 0;
+            if (field_hex(&ln, "Flags", &flags) && (flags & O_DIRECT) && field_is(&ln, "Status", "OK"))
+                path_set_add(&c->direct, str);
+            continue;
+        }
 
         // 偏移与大小
-        int offset = 0, size = 0;
-        const char *po = strstr(line, "Offset:");
-        const char *ps = strstr(line, "Size:");
-        if (!po || !ps) continue;
-        if (sscanf(po, "Offset:%d", &offset) != 1) continue;
-        if (sscanf(ps, "Size:%d", &size) != 1) continue;
-
-        records[count].timestamp = ts;
-        strcpy(records[count].file_path, file_path);
-        records[count].offset = offset;
-        records[count].req_len = size;
-        records[count].read_len = size;   // 未提供实际读长度，默认等同请求长度
-        records[count].io_time = 0.0;     // 未提供 I/O 耗时，设为 0
-        count++;
-        if (count >= MAX_RECORDS) break;
+        long long offset = 0, size = 0;
+        if (!field_ll(&ln, "Offset", &offset) || !field_ll(&ln, "Size", &size)) continue;
+
+        // 请求长度与耗时（旧日志没有这两列）
+        long long req = size, io_ns = 0;
+        field_ll(&ln, "Req", &req);
+        field_ll(&ln, "IoNs", &io_ns);
+
+        ReadRecord *r = ctx_slot(c);
+        if (!r) break;
+        r->ts_ns = ln.ts_ns;
+        r->timestamp = (double)ln.ts_ns / 1e9;
+        r->path_id = path_id;
+        r->file_path = str;
+        r->offset = offset;
+        r->req_len = req;
+        r->read_len = size;
+        r->io_time = (double)io_ns / 1e9;
     }
-    fclose(fp);
-    return count;
 }
 
-// 读取 mmap_log 文件内容到 MmapRecord 数组
-int load_mmap_log(const char *filename, MmapRecord *records) {
-    FILE *fp = fopen(filename, "r");
-    if (!fp) return 0;
-    int count = 0;
-    char line[LINE_MAX];
-    while (fgets(line, LINE_MAX, fp)) {
-        if (!strstr(line, "Type:MMAP")) continue;
-        double ts = parse_bracket_ts(line);
-
-        const char *pf = strstr(line, "File:");
-        const char *ps = strstr(line, "AddrStart:");
-        const char *pe = strstr(line, "AddrEnd:");
-        const char *po = strstr(line, "FileOffset:");
-        const char *pz = strstr(line, "Size:");
-        if (!pf || !ps || !pe || !po || !pz) continue;
-
-        pf += strlen("File:");
-        const char *pf_end = strstr(pf, " | ");
-        int lfile = pf_end ? (int)(pf_end - pf) : (int)strcspn(pf, "\n");
-        if (lfile <= 0) continue;
-        char file_path[128];
-        if (lfile > 127) lfile = 127;
-        memcpy(file_path, pf, lfile);
-        file_path[lfile] = '\0';
+static const LogKind read_kind = { visit_read, parse_read_text };
+
+// 读取 read_log 文件内容到 ReadRecord 数组（过滤非磁盘路径）
+int load_read_log(const char *filename, ReadRecord **records) {
+    LoadCtx c = { .elem = sizeof(ReadRecord), .ts_off = offsetof(ReadRecord, ts_ns) };
+    if (load_streams(filename, &read_kind, &c) != 0) { path_set_free(&c.direct); *records = NULL; return -1; }
+    report_dropped(filename, c.dropped);
+    c.count = drop_direct_reads(c.records, c.count, &c.direct);
+    path_set_free(&c.direct);
+    *records = c.records;
+    return c.count;
+}
+
+// 同一映射（起始地址 + 路径相同）可能被 libwrapper 同步记录一次、proc_monitor 轮询再记录一次，
+// 只保留最早的一条（records 已按时间排序）
+static int cmp_mmap_key(const void *a, const void *b, void *base) {
+    const MmapRecord *x = (const MmapRecord *)base + *(const int *)a, *y = (const MmapRecord *)base + *(const int *)b;
+    int c = strcmp(x->start_addr, y->start_addr);
+    if (c == 0) c = x->path_id - y->path_id;
+    return c ? c : (*(const int *)a - *(const int *)b);
+}
 
+static int dedup_mmaps(MmapRecord *records, int count) {
+    if (count < 2) return count;
+    int *idx = malloc(sizeof(int) * count);
+    char *drop = calloc(count, 1);
+    if (!idx || !drop) { free(idx); free(drop); return count; }
+    for (int i = 0; i < count; i++) idx[i] = i;
+    qsort_r(idx, count, sizeof(int), cmp_mmap_key, records);
+    for (int i = 1; i < count; i++) {
+        const MmapRecord *p = &records[idx[i - 1]], *q = &records[idx[i]];
+        if (strcmp(p->start_addr, q->start_addr) == 0 && p->path_id == q->path_id) drop[idx[i]] = 1;
+    }
+    int w = 0;
+    for (int i = 0; i < count; i++) if (!drop[i]) records[w++] = records[i];
+    free(idx);
+    free(drop);
+    return w;
+}
+
+static void parse_mmap_text(TextScan *s, LoadCtx *c) {
+    TextLine ln;
+    while (text_next(s, &ln)) {
+        if (line_dropped(&ln, c)) continue;
+        if (line_op_type(&ln) != OP_MMAP) continue;
         long long addr_start = 0, addr_end = 0, file_off = 0, sz = 0;
-        if (sscanf(ps, "AddrStart:%lld", &addr_start) != 1) continue;
-        if (sscanf(pe, "AddrEnd:%lld", &addr_end) != 1) continue;
-        if (sscanf(po, "FileOffset:%lld", &file_off) != 1) continue;
-        if (sscanf(pz, "Size:%lld", &sz) != 1) continue;
-
-        records[count].timestamp = ts;
-        snprintf(records[count].start_addr, sizeof(records[count].start_addr), "%lld", addr_start);
-        snprintf(records[count].end_addr, sizeof(records[count].end_addr), "%lld", addr_end);
-        strcpy(records[count].file_path, file_path);
-        records[count].file_offset = (int)file_off;
-        records[count].size = (int)sz;
-        count++;
-        if (count >= MAX_RECORDS) break;
+        if (!field_ll(&ln, "AddrStart", &addr_start) || !field_ll(&ln, "AddrEnd", &addr_end) ||
+            !field_ll(&ln, "FileOffset", &file_off) || !field_ll(&ln, "Size", &sz)) continue;
+        const char *str;
+        int path_id = line_path_id(&ln, 0, c, &str);
+        if (path_id < 0) continue;
+
+        MmapRecord *r = ctx_slot(c);
+        if (!r) break;
+        r->ts_ns = ln.ts_ns;
+        r->timestamp = (double)ln.ts_ns / 1e9;
+        snprintf(r->start_addr, sizeof(r->start_addr), "%lld", addr_start);
+        snprintf(r->end_addr, sizeof(r->end_addr), "%lld", addr_end);
+        r->path_id = path_id;
+        r->file_path = str;
+        r->file_offset = file_off;
+        r->size = sz;
     }
-    fclose(fp);
-    return count;
-}
\ No newline at end of file
+}
+
+static const LogKind mmap_kind = { visit_mmap, parse_mmap_text };
+
+// 读取 mmap_log 文件内容到 MmapRecord 数组
+int load_mmap_log(const char *filename, MmapRecord **records) {
+    LoadCtx c = { .elem = sizeof(MmapRecord), .ts_off = offsetof(MmapRecord, ts_ns) };
+    if (load_streams(filename, &mmap_kind, &c) != 0) { *records = NULL; return -1; }
+    report_dropped(filename, c.dropped);
+    *records = c.records;
+    return dedup_mmaps(c.records, c.count);
+}
+
+static void parse_page_text(TextScan *s, LoadCtx *c) {
+    TextLine ln;
+    while (text_next(s, &ln)) {
+        if (line_dropped(&ln, c)) continue;
+        int op = line_op_type(&ln);
+        if (op != OP_CACHE && op != OP_FAULT) continue;
+        long long off = 0, sz = 0, pid = 0;
+        if (!field_ll(&ln, "Offset", &off) || !field_ll(&ln, "Size", &sz)) continue;
+        field_ll(&ln, "PID", &pid);
+        const char *str;
+        int path_id = line_path_id(&ln, 1, c, &str);
+        if (path_id < 0) continue;
+
+        PageRecord *r = ctx_slot(c);
+        if (!r) break;
+        r->ts_ns = ln.ts_ns;
+        r->timestamp = (double)ln.ts_ns / 1e9;
+        r->op = op;
+        r->path_id = path_id;
+        r->file_path = str;
+        r->offset = off;
+        r->length = sz;
+        r->pid = (int)pid;
+    }
+}
+
+static const LogKind page_kind = { visit_page, parse_page_text };
+
+// 读取 page_log 文件内容到 PageRecord 数组
+int load_page_log(const char *filename, PageRecord **records) {
+    LoadCtx c = { .elem = sizeof(PageRecord), .ts_off = offsetof(PageRecord, ts_ns) };
+    if (load_streams(filename, &page_kind, &c) != 0) { *records = NULL; return -1; }
+    report_dropped(filename, c.dropped);
+    *records = c.records;
+    return c.count;
+}
+
+// load_trace_logs 的一项：按下标对应 stat/read/mmap/page
+static void load_one_log(int i, void *arg) {
+    TraceLogs *l = arg;
+    if (i == 0 && l->stat_path) l->stat_count = load_stat_log(l->stat_path, &l->stats);
+    if (i == 1 && l->read_path) l->read_count = load_read_log(l->read_path, &l->reads);
+    if (i == 2 && l->mmap_path) l->mmap_count = load_mmap_log(l->mmap_path, &l->mmaps);
+    if (i == 3 && l->page_path) l->page_count = load_page_log(l->page_path, &l->pages);
+}
+
+void load_trace_logs(TraceLogs *logs) {
+    const char *paths[4] = { logs->stat_path, logs->read_path, logs->mmap_path, logs->page_path };
+    for (int i = 0; i < 4; i++) {
+        if (!paths[i]) continue;
+        PathSet streams = {0};
+        list_streams(paths[i], &streams);
+        for (size_t k = 0; k < streams.n; k++) prime_ref_anchor(streams.v[k]);
+        path_set_free(&streams);
+    }
+    logs->stats = NULL; logs->reads = NULL; logs->mmaps = NULL; logs->pages = NULL;
+    logs->stat_count = logs->read_count = logs->mmap_count = logs->page_count = 0;
+    parallel_for(4, load_one_log, logs);
+}
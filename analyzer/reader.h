@@ -1,37 +1,121 @@
 #ifndef READER_H
 #define READER_H
-#define MAX_RECORDS 10000
+#include <stddef.h>
 
 // StatRecord：用于存储 stat_log 的每条磁盘状态记录
 typedef struct {
-    double timestamp;   // 时间戳
-    double delta_io;    // 本周期 I/O 时间
+    double timestamp;   // 时间戳（epoch 秒，含小数部分）
+    long long ts_ns;    // 时间戳（epoch 纳秒，由单调时钟 + 会话锚点换算；排序以此为准）
+    double delta_io;    // 本周期 I/O 信号（默认 I/O 时间 ms，见 load_stat_log）
     double total_io;    // 总 I/O 时间
+    char device[32];    // device 信号的设备名；进程信号为空
 } StatRecord;
 
+// DeviceInfo：stat_log 中单个块设备的元数据（DEVINFO）与整个会话的读总量（DISKSTAT 增量之和）
+typedef struct {
+    char name[32];
+    int rotational;             // 1 为旋转介质；-1 表示日志中没有元数据（旧日志）
+    int queue_depth;            // queue/nr_requests
+    int logical_block_size;     // 字节
+    unsigned long long reads, sectors_read, io_ms;
+} DeviceInfo;
+
 // ReadRecord：用于存储 read_log 的每条读操作记录
 typedef struct {
-    double timestamp;       // 时间戳
-    char file_path[128];    // 文件路径
-    int offset, req_len, read_len; // 偏移量、请求长度、实际读取长度
-    double io_time;         // I/O 操作耗时
+    double timestamp;       // 时间戳（epoch 秒，含小数部分）
+    long long ts_ns;        // 时间戳（epoch 纳秒）
+    int path_id;            // 路径 ID（见 path_table.h）
+    const char *file_path;  // 文件路径（路径表中的驻留字符串，不截断）
+    long long offset, req_len, read_len; // 偏移量、请求长度、实际读取长度（旧日志无请求长度，取实际长度）
+    double io_time;         // 读调用耗时（秒，profiler 用单调时钟测得；旧日志为 0）
 } ReadRecord;
 
 // MmapRecord：用于存储 mmap_log 的每条映射记录
 typedef struct {
     double timestamp;
+    long long ts_ns;
     char start_addr[32];
     char end_addr[32];
-    char file_path[128];
-    int file_offset;
-    int size;
+    int path_id;
+    const char *file_path;
+    long long file_offset;
+    long long size;
 } MmapRecord;
 
-// 读取 stat_log 文件，返回记录数
-int load_stat_log(const char *filename, StatRecord *records);
-// 读取 read_log 文件，返回记录数
-int load_read_log(const char *filename, ReadRecord *records);
-// 读取 mmap_log 文件，返回记录数
-int load_mmap_log(const char *filename, MmapRecord *records);
+// PageRecord：用于存储 page_log 的记录（新进入页缓存的页区间 / 主缺页所在页）
+typedef struct {
+    double timestamp;
+    long long ts_ns;
+    int op;                 // OP_CACHE 或 OP_FAULT
+    int path_id;
+    const char *file_path;
+    long long offset;       // 区间起始（字节，页对齐）
+    long long length;       // 区间长度（字节）
+    int pid;
+} PageRecord;
+
+// TraceRecord：二进制 trace 解码出的单条记录（load_* 与 trace_dump 共用）
+typedef struct {
+    int rec_type;               // IFT_REC_EVENT / IFT_REC_MMAP / IFT_REC_DISKSTAT / IFT_REC_PROCIO / IFT_REC_DEVINFO / IFT_REC_DROP
+    int op_type;                // 与 profiler 的 OpType 编号一致
+    int pid;
+    double timestamp;           // epoch 秒
+    long long ts_ns;            // epoch 纳秒：v3 由单调时钟经会话墙钟锚点换算
+    const char *path;           // 文件路径或设备名（回调返回后失效）
+    int fd;
+    long long offset, size;
+    int status, err_no;
+    int flags;                  // open/fopen 的打开标志（v2 起）
+    long long req_size;         // 读的请求长度（v4 起，0 表示未知）
+    unsigned long long io_ns;   // 读调用耗时（v4 起，0 表示未测量）
+    int tid;                    // 线程 ID（v5 起，0 表示未知）
+    long long addr_start, addr_end, file_offset;
+    unsigned long long stat[8]; // diskstat 的 8 个增量字段；PROCIO 为前 5 个（rchar, read_bytes, syscr, majflt, blkio_ms）；
+                                // DEVINFO 为前 3 个（rotational, queue_depth, logical_block_size）；DROP 为丢弃数
+} TraceRecord;
+
+// 遍历回调：返回非 0 时停止遍历
+typedef int (*trace_visit_fn)(const TraceRecord *rec, void *ctx);
+
+// 文件是否为二进制 trace（按块魔数判断）
+int trace_is_binary(const char *filename);
+// 逐条解码二进制 trace，返回访问的记录数；失败返回 -1
+int trace_foreach(const char *filename, trace_visit_fn fn, void *ctx);
+// 读取日志首部的 APP 行（文本/二进制均可），写成 "APP=... | USER=... | HOST=...\n"；找到返回 1
+int load_log_app(const char *filename, char *out, size_t outsz);
+
+// load_*_log：记录数组由 malloc 分配、按需增长（至多 INT32_MAX 条），写入 *records，由调用方 free；返回记录数，
+// 超出上限或内存不足时打印错误并返回 -1（*records 为 NULL）。日志含 DROP 记录（profiler 丢弃过事件）时打印提示。
+// 读取 stat_log 文件。delta_io 取自 IFETCHER_IO_SIGNAL 选定的信号：
+//   device      整盘 io_time_ms（/sys/block/<dev>/stat，含其他进程的后台 I/O）；默认各盘之和，
+//               IFETCHER_IO_DEVICE=<名称> 只取该设备，=auto 取会话内读扇区最多的设备
+//   blkio       目标进程树的块 I/O 阻塞时间（ms，delayacct）
+//   read_bytes  目标进程树从存储层读取的数据量（KiB）
+//   majflt      目标进程树的主缺页数
+//   auto        默认：依次取 blkio、read_bytes 中第一个非零的信号，都为零时用 device
+// 进程信号按采样轮次把进程树内各进程的增量合并为一条记录
+int load_stat_log(const char *filename, StatRecord **records);
+// 汇总 stat_log 中各设备的元数据与读总量，最多写入 max 项，返回设备数
+int load_device_info(const char *filename, DeviceInfo *out, int max);
+// 读取 read_log 文件（按时间排序，已剔除 O_DIRECT 文件），返回记录数
+int load_read_log(const char *filename, ReadRecord **records);
+// 读取 mmap_log 文件（按时间排序并去重），返回记录数
+int load_mmap_log(const char *filename, MmapRecord **records);
+// 读取 page_log 文件（按时间排序），返回记录数
+int load_page_log(const char *filename, PageRecord **records);
+// 以上 load_* 都在线程池上并行解析（见 thread_pool.h）：各个流按约 4 MiB 切段（文本按行、二进制按块）同时解析，再按时间归并，
+// 结果与顺序解析相同
+
+// 同时载入一组日志：路径为 NULL 的跳过，其余各自调用对应的 load_*_log 并发执行；
+// 返回的数组与计数写回结构体，由调用方 free
+typedef struct {
+    const char *stat_path, *read_path, *mmap_path, *page_path;
+    StatRecord *stats;
+    ReadRecord *reads;
+    MmapRecord *mmaps;
+    PageRecord *pages;
+    int stat_count, read_count, mmap_count, page_count;
+} TraceLogs;
+void load_trace_logs(TraceLogs *logs);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+// 一次 parallel_for 调用：任务下标按序领取，done 记完成数；排队期间挂在 pending 链表上
+typedef struct Batch {
+    pool_task_fn fn;
+    void *arg;
+    int n, next, done;
+    pthread_cond_t finished;
+    struct Batch *link;
+} Batch;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;   // 保护 pending 及各 Batch 的计数
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static Batch *pending = NULL;        // 仍有未领取任务的批次（先进先出）
+static int nthreads = 1;
+
+// 从队首批次领取一个任务；批次领完即出队。调用方持有 pool_mutex
+static int claim(Batch *b) {
+    int i = b->next++;
+    if (b->next == b->n) {
+        Batch **pp = &pending;
+        while (*pp && *pp != b) pp = &(*pp)->link;
+        if (*pp) *pp = b->link;
+    }
+    return i;
+}
+
+// 执行任务并计数；调用方持有 pool_mutex，执行期间释放
+static void run_one(Batch *b, int i) {
+    pthread_mutex_unlock(&pool_mutex);
+    b->fn(i, b->arg);
+    pthread_mutex_lock(&pool_mutex);
+    if (++b->done == b->n) pthread_cond_broadcast(&b->finished);
+}
+
+static void *worker(void *unused) {
+    (void)unused;
+    pthread_mutex_lock(&pool_mutex);
+    for (;;) {
+        while (!pending) pthread_cond_wait(&pool_cond, &pool_mutex);
+        Batch *b = pending;
+        run_one(b, claim(b));
+    }
+    return NULL;
+}
+
+static void pool_start(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *s = getenv("IFETCHER_ANALYZER_THREADS");
+    if (s && *s) n = strtol(s, NULL, 10);
+    if (n < 1) n = 1;
+    if (n > 256) n = 256;
+    nthreads = 1;
+    for (long k = 1; k < n; k++) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, worker, NULL) != 0) {
+            fprintf(stderr, "[Analyzer] Warning: only %d worker thread(s) started\n", nthreads);
+            break;
+        }
+        pthread_detach(t);
+        nthreads++;
+    }
+}
+
+int pool_threads(void) {
+    pthread_once(&pool_once, pool_start);
+    return nthreads;
+}
+
+void parallel_for(int n, pool_task_fn fn, void *arg) {
+    if (n <= 0) return;
+    if (n == 1 || pool_threads() == 1) {
+        for (int i = 0; i < n; i++) fn(i, arg);
+        return;
+    }
+    Batch b = { fn, arg, n, 0, 0, PTHREAD_COND_INITIALIZER, NULL };
+    pthread_mutex_lock(&pool_mutex);
+    Batch **pp = &pending;
+    while (*pp) pp = &(*pp)->link;
+    *pp = &b;
+    pthread_cond_broadcast(&pool_cond);
+    while (b.next < b.n) run_one(&b, claim(&b));
+    while (b.done < b.n) pthread_cond_wait(&b.finished, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+    pthread_cond_destroy(&b.finished);
+}
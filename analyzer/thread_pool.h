@@ -0,0 +1,16 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// analyzer 的共享工作线程池（首次使用时创建，进程退出前常驻）。
+// 线程数取 IFETCHER_ANALYZER_THREADS，默认为在线 CPU 数；=1 时所有任务在调用线程内顺序执行。
+
+typedef void (*pool_task_fn)(int i, void *arg);
+
+// 对 i = 0..n-1 各调用一次 fn(i, arg)，全部完成后返回。调用线程自己也领取任务执行，
+// 因此可以在任务内部再次调用（嵌套），不会因工作线程占满而死锁。任务之间不保证执行顺序。
+void parallel_for(int n, pool_task_fn fn, void *arg);
+
+// 参与执行的线程数（含调用线程）
+int pool_threads(void);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * trace_dump.c
+ * 将 profiler 写出的二进制 trace 导出为原有的文本日志格式，
+ * 便于人工查看或交给依赖文本格式的脚本（awk/grep）处理。
+ * 用法：trace_dump <log> [more logs...]，结果写到 stdout。
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "reader.h"
+#include "trace_format.h"
+
+static const char *format_ts(long long ts_ns) {
+    static char buf[80];
+    char sec_buf[64];
+    time_t sec = (time_t)(ts_ns / 1000000000LL);
+    struct tm tm_info;
+    localtime_r(&sec, &tm_info);
+    strftime(sec_buf, sizeof(sec_buf), "%Y-%m-%d %H:%M:%S", &tm_info);
+    snprintf(buf, sizeof(buf), "%s.%09lld", sec_buf, ts_ns % 1000000000LL);
+    return buf;
+}
+
+static int dump_record(const TraceRecord *r, void *ctx) {
+    (void)ctx;
+    if (r->rec_type == IFT_REC_DISKSTAT) {
+        printf("[%s] Device:%s | reads:%llu | sectors_read:%llu | read_time_ms:%llu | "
+               "writes:%llu | sectors_written:%llu | write_time_ms:%llu | "
+               "io_time_ms:%llu | in_flight:%llu\n",
+               format_ts(r->ts_ns), r->path,
+               r->stat[0], r->stat[1], r->stat[2], r->stat[3],
+               r->stat[4], r->stat[5], r->stat[6], r->stat[7]);
+        return 0;
+    }
+    if (r->rec_type == IFT_REC_DEVINFO) {
+        printf("[%s] DeviceInfo:%s | rotational:%llu | queue_depth:%llu | logical_block_size:%llu\n",
+               format_ts(r->ts_ns), r->path, r->stat[0], r->stat[1], r->stat[2]);
+        return 0;
+    }
+    if (r->rec_type == IFT_REC_PROCIO) {
+        printf("[%s] Process:%d | rchar:%llu | read_bytes:%llu | syscr:%llu | majflt:%llu | blkio_ms:%llu\n",
+               format_ts(r->ts_ns), r->pid, r->stat[0], r->stat[1], r->stat[2], r->stat[3], r->stat[4]);
+        return 0;
+    }
+    if (r->rec_type == IFT_REC_DROP) {
+        printf("[%s] PID:%d | Dropped:%llu\n", format_ts(r->ts_ns), r->pid, r->stat[0]);
+        return 0;
+    }
+    printf("[%s] PID:%d | Type:%s | Status:%s | Errno:%d | ",
+           format_ts(r->ts_ns), r->pid, ift_op_name((uint64_t)r->op_type),
+           r->status == 0 ? "OK" : "ERR", r->err_no);
+    if (r->rec_type == IFT_REC_MMAP) {
+        printf("File:%s | AddrStart:%lld | AddrEnd:%lld | FileOffset:%lld | Size:%lld\n",
+               r->path, r->addr_start, r->addr_end, r->file_offset, r->size);
+    } else {
+        printf("FD:%d | File:%s | Offset:%lld | Size:%lld", r->fd, r->path, r->offset, r->size);
+        if (r->flags) printf(" | Flags:0x%x", (unsigned)r->flags);
+        if (r->req_size || r->io_ns) printf(" | Req:%lld | IoNs:%llu", r->req_size, r->io_ns);
+        if (r->tid) printf(" | Tid:%d", r->tid);
+        putchar('\n');
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace_log> [trace_log...]\n", argv[0]);
+        return 1;
+    }
+    int rc = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!trace_is_binary(argv[i])) {
+            fprintf(stderr, "[trace_dump] %s: not a binary trace, skipped\n", argv[i]);
+            rc = 1;
+            continue;
+        }
+        char app[1024];
+        if (load_log_app(argv[i], app, sizeof(app))) fputs(app, stdout);
+        if (trace_foreach(argv[i], dump_record, NULL) < 0) {
+            fprintf(stderr, "[trace_dump] %s: read failed\n", argv[i]);
+            rc = 1;
+        }
+    }
+    return rc;
+}
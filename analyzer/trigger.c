@@ -3,20 +3,17 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include "reader.h"
+#include "path_table.h"
 #include "density.h"
-#define MAX_RECORDS 10000
+#include "thread_pool.h"
     
 // 预取请求结构体，用于合并和去重
 typedef struct {
-    char file_path[128];
-    int offset;
-    int length;
+    int path_id;
+    const char *file_path;   // 指向路径驻留表
+    long long offset;
+    long long length;
 } PrefetchReq;
-    
-static int seen_prefetch(const PrefetchReq* a,int n,const char* path,int off,int len){
-    for(int i=0;i<n;i++){ if(a[i].offset==off && a[i].length==len && strcmp(a[i].file_path,path)==0) return 1; }
-    return 0;
-}
 
 static int skip_trigger_path(const char* path){
     if(!path) return 1;
@@ -31,8 +28,9 @@ static int skip_trigger_path(const char* path){
     const char* env = getenv("ANALYZER_SKIP_PREFIXES");
     if (env && env[0] != '\0') {
         char buf[512]; strncpy(buf, env, sizeof(buf)-1); buf[sizeof(buf)-1] = '\0';
-        char* tok = strtok(buf, ",");
-        while (tok) { size_t n = strlen(tok); if (n>0 && strncmp(path, tok, n)==0) return 1; tok = strtok(NULL, ","); }
+        char* save = NULL;
+        char* tok = strtok_r(buf, ",", &save);
+        while (tok) { size_t n = strlen(tok); if (n>0 && strncmp(path, tok, n)==0) return 1; tok = strtok_r(NULL, ",", &save); }
     }
     return 0;
 }
@@ -47,53 +45,256 @@ static int path_monitorable(const char* p){
 }
 
 static int get_env_int(const char* name,int def){ const char* s=getenv(name); if(!s||s[0]=='\0') return def; char* e=NULL; long v=strtol(s,&e,10); return (e==s)?def:(int)v; }
+static double get_env_double(const char* name,double def){ const char* s=getenv(name); if(!s||s[0]=='\0') return def; char* e=NULL; double v=strtod(s,&e); return (e==s)?def:v; }
 static long get_env_long(const char* name,long def){ const char* s=getenv(name); if(!s||s[0]=='\0') return def; char* e=NULL; long v=strtol(s,&e,10); return (e==s)?def:v; }
 static int has_suffix(const char* p,const char* ext){ size_t lp=strlen(p), le=strlen(ext); if(lp<le) return 0; return strcmp(p+lp-le, ext)==0; }
 static int skip_ext_path(const char* path){
     const char* env=getenv("ANALYZER_SKIP_EXTS");
     if(env && env[0]){
         char buf[512]; strncpy(buf,env,sizeof(buf)-1); buf[sizeof(buf)-1]='\0';
-        char* tok=strtok(buf,",");
-        while(tok){ if(has_suffix(path,tok)) return 1; tok=strtok(NULL,","); }
+        char* save=NULL;
+        char* tok=strtok_r(buf,",",&save);
+        while(tok){ if(has_suffix(path,tok)) return 1; tok=strtok_r(NULL,",",&save); }
     }
     if (has_suffix(path, ".vlpset")) return 1;
     return 0;
 }
-static int read_count_in_window(const ReadRecord* rr,int rc,const char* path,double t_min,double t_max){ if(!path) return 0; int cnt=0; for(int r=0;r<rc;r++){ double ts=rr[r].timestamp; if(ts<t_min||ts>t_max) continue; if(rr[r].file_path && strcmp(rr[r].file_path,path)==0) cnt++; } return cnt; }
-static long bytes_in_window(const ReadRecord* rr,int rc,const char* path,double t_min,double t_max){ if(!path) return 0; long sum=0; for(int r=0;r<rc;r++){ double ts=rr[r].timestamp; if(ts<t_min||ts>t_max) continue; if(rr[r].file_path && strcmp(rr[r].file_path,path)==0) sum+=rr[r].req_len; } return sum; }
-static int has_subseq_read(const ReadRecord* rr,int rc,const char* path,double t_start,double t_end){ if(!path) return 0; for(int r=0;r<rc;r++){ double ts=rr[r].timestamp; if(ts<=t_start||ts>t_end) continue; if(rr[r].file_path && strcmp(rr[r].file_path,path)==0) return 1; } return 0; }
+// 按路径分组的 read 索引：同一路径的读按时间顺序连续存放（CSR），每个文件的窗口统计用二分查找完成
+typedef struct {
+    int npaths;
+    int *start;     // 路径 ID → 在下面各数组中的区段 [start[id], start[id+1])
+    double *ts;     // 各读的时间戳
+    int *rec;       // 对应的 read_records 下标
+    long *bytes;    // read_len 的前缀和：bytes[k] 为位置 k 之前所有读的字节数（共 n+1 项）
+} ReadIndex;
+// 有序数组 a[lo,hi) 中首个 >= t（strict 时为 > t）的位置
+static int ts_bound(const double* a,int lo,int hi,double t,int strict){ while(lo<hi){ int m=lo+(hi-lo)/2; if(a[m]<t||(strict&&a[m]==t)) lo=m+1; else hi=m; } return lo; }
+static int read_index_build(ReadIndex* ix,const ReadRecord* rr,int rc,int npaths){
+    memset(ix,0,sizeof(*ix)); ix->npaths=npaths;
+    ix->start=calloc((size_t)npaths+1,sizeof(int)); ix->ts=malloc(sizeof(double)*(size_t)(rc>0?rc:1));
+    ix->rec=malloc(sizeof(int)*(size_t)(rc>0?rc:1)); ix->bytes=malloc(sizeof(long)*(size_t)(rc+1));
+    int *fill=malloc(sizeof(int)*(size_t)(npaths+1));
+    if(!ix->start||!ix->ts||!ix->rec||!ix->bytes||!fill){ free(fill); return -1; }
+    for(int r=0;r<rc;r++) ix->start[rr[r].path_id+1]++;
+    for(int id=0;id<npaths;id++) ix->start[id+1]+=ix->start[id];
+    memcpy(fill,ix->start,sizeof(int)*(size_t)npaths);
+    // 按时间顺序计数填充，各区段内保持 read_records 的先后
+    for(int r=0;r<rc;r++){ int k=fill[rr[r].path_id]++; ix->ts[k]=rr[r].timestamp; ix->rec[k]=r; }
+    ix->bytes[0]=0;
+    for(int k=0;k<rc;k++) ix->bytes[k+1]=ix->bytes[k]+rr[ix->rec[k]].read_len;
+    free(fill);
+    return 0;
+}
+static void read_index_free(ReadIndex* ix){ free(ix->start); free(ix->ts); free(ix->rec); free(ix->bytes); memset(ix,0,sizeof(*ix)); }
+// 路径 id 在 [t_min, t_max] 内的读：写出区段位置 [*lo, *hi)
+static void read_window(const ReadIndex* ix,int id,double t_min,double t_max,int* lo,int* hi){ if(id<0||id>=ix->npaths){ *lo=*hi=0; return; } int b=ix->start[id], e=ix->start[id+1]; *lo=ts_bound(ix->ts,b,e,t_min,0); *hi=ts_bound(ix->ts,*lo,e,t_max,1); }
+static int read_count_in_window(const ReadIndex* ix,int id,double t_min,double t_max){ int lo,hi; read_window(ix,id,t_min,t_max,&lo,&hi); return hi-lo; }
+static long bytes_in_window(const ReadIndex* ix,int id,double t_min,double t_max){ int lo,hi; read_window(ix,id,t_min,t_max,&lo,&hi); return ix->bytes[hi]-ix->bytes[lo]; }
+static int has_subseq_read(const ReadIndex* ix,int id,double t_start,double t_end){ if(id<0||id>=ix->npaths) return 0; int e=ix->start[id+1]; int k=ts_bound(ix->ts,ix->start[id],e,t_start,1); return k<e && ix->ts[k]<=t_end; }
+// 按时间排序的记录数组中首个时间戳 >= t（strict 时为 > t）的下标
+static int first_read_at(const ReadRecord* rr,int n,double t,int strict){ int lo=0,hi=n; while(lo<hi){ int m=lo+(hi-lo)/2; if(rr[m].timestamp<t||(strict&&rr[m].timestamp==t)) lo=m+1; else hi=m; } return lo; }
+static int first_mmap_at(const MmapRecord* mr,int n,double t){ int lo=0,hi=n; while(lo<hi){ int m=lo+(hi-lo)/2; if(mr[m].timestamp<t) lo=m+1; else hi=m; } return lo; }
 static int same_dir(const char* a,const char* b){ if(!a||!b) return 0; const char* pa=strrchr(a,'/'); const char* pb=strrchr(b,'/'); if(!pa||!pb) return 0; size_t la=(size_t)(pa-a); size_t lb=(size_t)(pb-b); if(la!=lb) return 0; return strncmp(a,b,la)==0; }
 /* removed unused path_monitorable_ext to silence warnings */
 
-// 合并和去重预取请求（先按文件+偏移排序，再合并连续区间）
+static int cmp_prefetch_req(const void* a,const void* b){ const PrefetchReq* x=a; const PrefetchReq* y=b; int c=strcmp(x->file_path,y->file_path); if(c) return c; if(x->offset!=y->offset) return x->offset<y->offset?-1:1; return (x->length>y->length)-(x->length<y->length); }
+
+// 合并和去重预取请求（先按文件+偏移排序，再合并连续区间）；out 至少容纳 in_count 项
 int merge_prefetch_requests(const PrefetchReq *in, int in_count, PrefetchReq *out, int *out_count) {
-    PrefetchReq tmp[MAX_RECORDS];
     int n = in_count;
-    for (int i = 0; i < n; i++) tmp[i] = in[i];
-    for (int i = 0; i < n; i++) {
-        for (int j = i + 1; j < n; j++) {
-            int cmp = strcmp(tmp[i].file_path, tmp[j].file_path);
-            if (cmp > 0 || (cmp == 0 && tmp[i].offset > tmp[j].offset)) {
-                PrefetchReq t = tmp[i]; tmp[i] = tmp[j]; tmp[j] = t;
-            }
-        }
-    }
+    PrefetchReq *tmp = malloc(sizeof(PrefetchReq) * (size_t)(n > 0 ? n : 1));
+    if (!tmp) { *out_count = 0; return 0; }
+    memcpy(tmp, in, sizeof(PrefetchReq) * (size_t)n);
+    qsort(tmp, (size_t)n, sizeof(PrefetchReq), cmp_prefetch_req);
     int cnt = 0;
     for (int i = 0; i < n; i++) {
-        if (cnt > 0 && strcmp(out[cnt-1].file_path, tmp[i].file_path) == 0 &&
+        if (cnt > 0 && out[cnt-1].path_id == tmp[i].path_id &&
             tmp[i].offset == out[cnt-1].offset + out[cnt-1].length) {
             out[cnt-1].length += tmp[i].length;
             continue;
         }
-        strcpy(out[cnt].file_path, tmp[i].file_path);
-        out[cnt].offset = tmp[i].offset;
-        out[cnt].length = tmp[i].length;
-        cnt++;
+        out[cnt++] = tmp[i];
     }
+    free(tmp);
     *out_count = cnt;
     return cnt;
 }
 
+// 密度上升区间候选：局部最小 → 局部最大
+typedef struct { int min_i; int max_i; double sum_delta; } Candidate;
+static int cmp_candidate(const void* a,const void* b){ const Candidate* x=a; const Candidate* y=b; if(x->sum_delta!=y->sum_delta) return x->sum_delta<y->sum_delta?1:-1; return x->min_i-y->min_i; }
+
+// 触发点与预取目标的求解：各候选区间只读记录与索引，互不依赖，在线程池上按区间并行；
+// 区间内按 tau 顺序求触发点、选中即停，输出按区间名次顺序进行，结果与顺序执行相同
+typedef struct { int set; const char *path; int id; long long off, len; double ts; } TrigPick;
+typedef struct {
+    const StatRecord *stat_records;
+    const ReadRecord *read_records; int read_count;
+    const MmapRecord *mmap_records; int mmap_count;
+    const ReadIndex *rix; int npaths;
+    const Candidate *cand;
+    const double *tau_list; int tau_n;
+    double extend; int min_reads; long min_bytes;
+    long max_items, max_bytes; int dir_group, no_merge;
+    TrigPick *trig;             // 各区间最终的触发点；set 表示有预取目标、需要输出
+    PrefetchReq **prefetches;   // 各区间待输出的预取请求（已按需合并）
+    int *prefetch_cnt;
+} TrigJob;
+
+// Algorithm 2：在第 c 个区间的触发窗口 [t_min - tau, t_min] 内按“首个文件访问”选触发点。
+// first_pos 为路径 ID → firsts[] 下标（-1 为未出现），调用前后全为 -1，只复位本次用到的项
+static void pick_trigger(const TrigJob *job, int c, double tau, int *first_pos, TrigPick *out) {
+    const ReadRecord *read_records = job->read_records; const MmapRecord *mmap_records = job->mmap_records;
+    int read_count = job->read_count, mmap_count = job->mmap_count;
+    const Candidate *cd = &job->cand[c];
+    double t_min = job->stat_records[cd->min_i].timestamp;
+    double t_max = job->stat_records[cd->max_i].timestamp;
+    double t_max2 = t_max + job->extend;
+    double t0 = t_min - tau;
+    double t1 = t_min;
+
+    typedef struct { int id; const char *path; double ts; int from_read; int read_idx; int mmap_idx; } FirstAccess;
+    FirstAccess firsts[256];
+    int fc = 0;
+
+    // 合并 mmap 首访（记录按时间排序，从 t0 处开始）
+    for (int m = first_mmap_at(mmap_records, mmap_count, t0); m < mmap_count && fc < 256; m++) {
+        double ts = mmap_records[m].timestamp;
+        if (ts > t1) break;
+        const char *path = mmap_records[m].file_path;
+        if (!path || path[0] != '/') continue;
+        if (skip_trigger_path(path)) continue;
+        int id = mmap_records[m].path_id;
+        if (first_pos[id] < 0) { first_pos[id] = fc; firsts[fc].id = id; firsts[fc].path = path; firsts[fc].ts = ts; firsts[fc].from_read = 0; firsts[fc].read_idx = -1; firsts[fc].mmap_idx = m; fc++; }
+    }
+    // 合并 read 首访（并可能更新更早时间）
+    for (int r = first_read_at(read_records, read_count, t0, 0); r < read_count && fc < 256; r++) {
+        double ts = read_records[r].timestamp;
+        if (ts > t1) break;
+        const char *path = read_records[r].file_path;
+        if (!path || path[0] != '/') continue;
+        if (skip_trigger_path(path)) continue;
+        int id = read_records[r].path_id, pos = first_pos[id];
+        if (pos < 0) { first_pos[id] = fc; firsts[fc].id = id; firsts[fc].path = path; firsts[fc].ts = ts; firsts[fc].from_read = 1; firsts[fc].read_idx = r; fc++; }
+        else if (ts < firsts[pos].ts) { firsts[pos].ts = ts; firsts[pos].from_read = 1; firsts[pos].read_idx = r; }
+    }
+    for (int x = 0; x < fc; x++) first_pos[firsts[x].id] = -1;
+    int candidate = -1;
+    long best_bsum = -1;
+    for (int x = 0; x < fc; x++) {
+        if (skip_trigger_path(firsts[x].path)) continue;
+        int cnt = read_count_in_window(job->rix, firsts[x].id, t_min, t_max2);
+        long bsum = bytes_in_window(job->rix, firsts[x].id, t_min, t_max2);
+        if (cnt >= job->min_reads && bsum >= job->min_bytes && has_subseq_read(job->rix, firsts[x].id, firsts[x].ts, t_max)) {
+            if (bsum > best_bsum || (bsum == best_bsum && (candidate < 0 || firsts[x].ts < firsts[candidate].ts))) { candidate = x; best_bsum = bsum; }
+        }
+    }
+    if (candidate < 0) return;
+
+    if (firsts[candidate].from_read && firsts[candidate].read_idx >= 0) {
+        const ReadRecord *r = &read_records[firsts[candidate].read_idx];
+        *out = (TrigPick){ 1, r->file_path, r->path_id, r->offset, r->read_len, r->timestamp };
+        return;
+    }
+    // mmap 首访：取窗口内该文件的第一次读，没有则用 mmap 本身
+    int lo, hi;
+    read_window(job->rix, firsts[candidate].id, t0, t1, &lo, &hi);
+    if (lo < hi) {
+        const ReadRecord *r = &read_records[job->rix->rec[lo]];
+        *out = (TrigPick){ 1, r->file_path, firsts[candidate].id, r->offset, r->read_len, r->timestamp };
+    } else {
+        const MmapRecord *m = &mmap_records[firsts[candidate].mmap_idx];
+        *out = (TrigPick){ 1, firsts[candidate].path, firsts[candidate].id, m->file_offset, m->size, m->timestamp };
+    }
+}
+
+// 追加一条预取请求；内存不足返回 -1
+static int push_prefetch(PrefetchReq **v, int *cnt, int *cap, int id, const char *p, long long off, long long len) {
+    if (*cnt == *cap) {
+        int ncap = *cap ? *cap * 2 : 64;
+        PrefetchReq *np = realloc(*v, sizeof(PrefetchReq) * (size_t)ncap);
+        if (!np) return -1;
+        *v = np; *cap = ncap;
+    }
+    (*v)[(*cnt)++] = (PrefetchReq){ id, p, off, len };
+    return 0;
+}
+
+// 第 c 个区间：确定触发点并收集其后 t_max + extend 内的 read/mmap 作为预取目标
+static void collect_prefetch(int c, void *arg) {
+    const TrigJob *job = arg;
+    const ReadRecord *read_records = job->read_records; const MmapRecord *mmap_records = job->mmap_records;
+    int read_count = job->read_count, mmap_count = job->mmap_count;
+    TrigPick tp = { 0 };
+    int *first_pos = malloc(sizeof(int) * (size_t)(job->npaths + 1));
+    if (!first_pos) return;
+    for (int i = 0; i < job->npaths; i++) first_pos[i] = -1;
+    for (int ti = 0; ti < job->tau_n && !tp.set; ti++) pick_trigger(job, c, job->tau_list[ti], first_pos, &tp);
+    free(first_pos);
+    if (tp.set && !path_monitorable(tp.path)) tp.set = 0;
+    if (!tp.set) return;
+    const char *trig_path = tp.path; int trig_id = tp.id; long long trig_off = tp.off, trig_len = tp.len; double trig_ts = tp.ts;
+    double t_max2 = job->stat_records[job->cand[c].max_i].timestamp + job->extend;
+    long max_items = job->max_items, max_bytes = job->max_bytes;
+    int dir_group = job->dir_group;
+
+    PrefetchReq *prefetches = NULL;
+    int prefetch_cnt = 0, prefetch_cap = 0;
+    RangeSet seen = { 0 };
+    size_t out_bytes = 0;
+    int out_items = 0;
+    for (int r = first_read_at(read_records, read_count, trig_ts, 1); r < read_count; r++) {
+        double ts = read_records[r].timestamp;
+        if (ts > t_max2) break;
+        const char* p = read_records[r].file_path; int id = read_records[r].path_id;
+        if (!p || p[0] != '/' || !path_monitorable(p)) continue;
+        if (dir_group && !same_dir(p, trig_path)) continue;
+        if (strncmp(p, "/proc/", 6) == 0 || strncmp(p, "/sys/", 5) == 0 || strncmp(p, "/dev/", 5) == 0) continue;
+        long long off = read_records[r].offset, len = read_records[r].read_len;
+        if (id == trig_id && off == trig_off && len == trig_len) continue;
+        if (max_items > 0 && out_items >= (int)max_items) break;
+        if (max_bytes > 0 && out_bytes + len > (size_t)max_bytes) break;
+        if (range_set_has(&seen, id, off, len)) continue;
+        if (push_prefetch(&prefetches, &prefetch_cnt, &prefetch_cap, id, p, off, len) != 0) break;
+        range_set_add(&seen, id, off, len);
+        out_items++;
+        out_bytes += len;
+    }
+    for (int m = first_mmap_at(mmap_records, mmap_count, trig_ts); m < mmap_count; m++) {
+        double ts = mmap_records[m].timestamp;
+        if (ts > t_max2) break;
+        const char* p = mmap_records[m].file_path; int id = mmap_records[m].path_id;
+        if (!p || p[0] != '/' || !path_monitorable(p)) continue;
+        if (dir_group && !same_dir(p, trig_path)) continue;
+        if (strncmp(p, "/proc/", 6) == 0 || strncmp(p, "/sys/", 5) == 0 || strncmp(p, "/dev/", 5) == 0) continue;
+        long long off = mmap_records[m].file_offset;
+        long long len = mmap_records[m].size;
+        if (len <= 0) continue;
+        if (id == trig_id && off == trig_off && len == trig_len) continue;
+        if (max_items > 0 && out_items >= (int)max_items) break;
+        if (max_bytes > 0 && out_bytes + len > (size_t)max_bytes) break;
+        if (range_set_has(&seen, id, off, len)) continue;
+        if (push_prefetch(&prefetches, &prefetch_cnt, &prefetch_cap, id, p, off, len) != 0) break;
+        range_set_add(&seen, id, off, len);
+        out_items++;
+        out_bytes += len;
+    }
+    range_set_free(&seen);
+    if (prefetch_cnt == 0) { free(prefetches); return; }
+
+    tp.set = 1;
+    job->trig[c] = tp;
+    if (job->no_merge) {
+        job->prefetches[c] = prefetches; job->prefetch_cnt[c] = prefetch_cnt;
+        return;
+    }
+    PrefetchReq *merged = malloc(sizeof(PrefetchReq) * (size_t)prefetch_cnt);
+    int merged_cnt = 0;
+    if (merged) merge_prefetch_requests(prefetches, prefetch_cnt, merged, &merged_cnt);
+    free(prefetches);
+    job->prefetches[c] = merged; job->prefetch_cnt[c] = merged_cnt;
+}
+
 // 分析主流程：区间识别、触发器选择、预取目标输出
 void analyzer_main(const StatRecord *stat_records, int stat_count,
                    const ReadRecord *read_records, int read_count,
@@ -109,17 +310,23 @@ void analyzer_main(const StatRecord *stat_records, int stat_count,
     double weight[11];
     estimate_weight(weight, window_size);
 
-    double ts_density[MAX_RECORDS] = {0.0};
+    int n_alloc = stat_count > 0 ? stat_count : 1;
+    double *ts_density = calloc((size_t)n_alloc, sizeof(double));
+    double *delta_ts_density = calloc((size_t)n_alloc, sizeof(double));
+    Candidate *cand = malloc(sizeof(Candidate) * (size_t)n_alloc);   // 每个局部最大值至多一个候选
+    if (!ts_density || !delta_ts_density || !cand) { free(ts_density); free(delta_ts_density); free(cand); return; }
     get_IO_density(stat_records, stat_count, ts_density, window_size, weight);
+    int npaths = path_count();
+    ReadIndex rix = { 0 };
+    if (read_index_build(&rix, read_records, read_count, npaths) != 0) {
+        read_index_free(&rix); free(ts_density); free(delta_ts_density); free(cand); return;
+    }
 
-    double delta_ts_density[MAX_RECORDS] = {0.0};
     for (int t = 1; t < stat_count; t++) {
         delta_ts_density[t] = ts_density[t] - ts_density[t - 1];
     }
 
     // 构造“局部最小→局部最大”候选区间并累计 sum_delta
-    typedef struct { int min_i; int max_i; double sum_delta; } Candidate;
-    Candidate cand[MAX_RECORDS];
     int cand_cnt = 0;
     int in_range = 0, cur_min = -1;
     double sum_delta = 0.0;
@@ -141,14 +348,8 @@ void analyzer_main(const StatRecord *stat_records, int stat_count,
         }
     }
 
-    // 按 sum_delta 降序排序（越大表示空闲后增长越剧烈）
-    for (int i = 0; i < cand_cnt; i++) {
-        for (int j = i + 1; j < cand_cnt; j++) {
-            if (cand[j].sum_delta > cand[i].sum_delta) {
-                Candidate tmp = cand[i]; cand[i] = cand[j]; cand[j] = tmp;
-            }
-        }
-    }
+    // 按 sum_delta 降序排序（越大表示空闲后增长越剧烈；相同时区间在前者优先）
+    qsort(cand, (size_t)cand_cnt, sizeof(Candidate), cmp_candidate);
 
     if (cand_cnt == 0 && stat_count > 1) {
         int min_i = -1, max_i = -1;
@@ -173,6 +374,7 @@ void analyzer_main(const StatRecord *stat_records, int stat_count,
     if (!trigger_fp || !prefetch_fp) {
         if (trigger_fp) fclose(trigger_fp);
         if (prefetch_fp) fclose(prefetch_fp);
+        free(ts_density); free(delta_ts_density); free(cand); read_index_free(&rix);
         return;
     }
     /* 输出日志首行复制 APP=...，prefetch_log 用 ===TRIGGER=== 分段；简化实现，避免不必要的文件检查与重复输出 */
@@ -186,14 +388,10 @@ void analyzer_main(const StatRecord *stat_records, int stat_count,
             snprintf(rp, sizeof(rp), "%s", "/tmp/read_log");
             snprintf(mp, sizeof(mp), "%s", "/tmp/mmap_log");
         }
-        FILE* r = fopen(rp, "r");
-        if (r) {
-            char line[512]; int ok = 0; for (int k = 0; k < 32 && fgets(line, sizeof(line), r); k++) { if (strncmp(line, "APP=", 4) == 0) { fprintf(trigger_fp, "%s", line); fprintf(prefetch_fp, "%s", line); ok = 1; break; } }
-            fclose(r);
-            if (!ok) {
-                FILE* m = fopen(mp, "r");
-                if (m) { for (int k = 0; k < 32 && fgets(line, sizeof(line), m); k++) { if (strncmp(line, "APP=", 4) == 0) { fprintf(trigger_fp, "%s", line); fprintf(prefetch_fp, "%s", line); break; } } fclose(m); }
-            }
+        char line[1024];
+        if (load_log_app(rp, line, sizeof(line)) || load_log_app(mp, line, sizeof(line))) {
+            fprintf(trigger_fp, "%s", line);
+            fprintf(prefetch_fp, "%s", line);
         }
     }
 
@@ -202,162 +400,42 @@ void analyzer_main(const StatRecord *stat_records, int stat_count,
     int K = 5;
     double tau_list[] = {4.0, 2.0, 1.0, 0.5};
     int tau_n = 4;
+    int nc = cand_cnt < K ? cand_cnt : K;
 
-    for (int c = 0; c < cand_cnt && c < K; c++) {
-        double t_min = stat_records[cand[c].min_i].timestamp;
-        double t_max = stat_records[cand[c].max_i].timestamp;
-        int extend = get_env_int("ANALYZER_TMAX_EXTEND_SEC", 3);
-        double t_max2 = t_max + (double)extend;
-
-        // Algorithm 2：在触发窗口内按“首个文件访问”选触发点
-        int trigger_idx = -1;
-        char trig_path[128]; int trig_off = 0; int trig_len = 0; double trig_ts = 0.0; int trig_set = 0;
-        for (int ti = 0; ti < tau_n && !trig_set; ti++) {
-            double t0 = t_min - tau_list[ti];
-            double t1 = t_min;
-
-            typedef struct { char path[128]; double ts; int from_read; int read_idx; int mmap_idx; } FirstAccess;
-            FirstAccess firsts[256];
-            int fc = 0;
-
-            // 合并 mmap 首访
-            for (int m = 0; m < mmap_count && fc < 256; m++) {
-                double ts = mmap_records[m].timestamp;
-                if (ts < t0 || ts > t1) continue;
-                const char *path = mmap_records[m].file_path;
-                if (!path || path[0] != '/') continue;
-                if (skip_trigger_path(path)) continue;
-                int exists = 0;
-                for (int q = 0; q < fc; q++) if (strcmp(firsts[q].path, path) == 0) { exists = 1; break; }
-                if (!exists) { strcpy(firsts[fc].path, path); firsts[fc].ts = ts; firsts[fc].from_read = 0; firsts[fc].read_idx = -1; firsts[fc].mmap_idx = m; fc++; }
-            }
-            // 合并 read 首访（并可能更新更早时间）
-            for (int r = 0; r < read_count && fc < 256; r++) {
-                double ts = read_records[r].timestamp;
-                if (ts < t0 || ts > t1) continue;
-                const char *path = read_records[r].file_path;
-                if (!path || path[0] != '/') continue;
-                if (skip_trigger_path(path)) continue;
-                int pos = -1;
-                for (int q = 0; q < fc; q++) if (strcmp(firsts[q].path, path) == 0) { pos = q; break; }
-                if (pos < 0) { strcpy(firsts[fc].path, path); firsts[fc].ts = ts; firsts[fc].from_read = 1; firsts[fc].read_idx = r; fc++; }
-                else if (ts < firsts[pos].ts) { firsts[pos].ts = ts; firsts[pos].from_read = 1; firsts[pos].read_idx = r; }
-            }
-            int earliest = -1;
-            for (int x = 0; x < fc; x++) {
-                if (skip_trigger_path(firsts[x].path)) continue;
-                if (earliest < 0 || firsts[x].ts < firsts[earliest].ts) earliest = x;
-            }
-            int candidate = -1;
-            int min_reads = get_env_int("ANALYZER_MIN_READS_IN_WINDOW", 2);
-            long min_bytes = get_env_long("ANALYZER_MIN_BYTES_IN_WINDOW", 32768);
-            long best_bsum = -1;
-            for (int x = 0; x < fc; x++) {
-                if (skip_trigger_path(firsts[x].path)) continue;
-                int cnt = read_count_in_window(read_records, read_count, firsts[x].path, t_min, t_max2);
-                long bsum = bytes_in_window(read_records, read_count, firsts[x].path, t_min, t_max2);
-                if (cnt >= min_reads && bsum >= min_bytes && has_subseq_read(read_records, read_count, firsts[x].path, firsts[x].ts, t_max)) {
-                    if (bsum > best_bsum || (bsum == best_bsum && (candidate < 0 || firsts[x].ts < firsts[candidate].ts))) { candidate = x; best_bsum = bsum; }
-                }
-            }
-            if (candidate < 0) continue;
-
-            if (candidate >= 0) {
-                if (firsts[candidate].from_read && firsts[candidate].read_idx >= 0) {
-                    trigger_idx = firsts[candidate].read_idx;
-                    strcpy(trig_path, read_records[trigger_idx].file_path);
-                    trig_off = read_records[trigger_idx].offset;
-                    trig_len = read_records[trigger_idx].req_len;
-                    trig_ts = read_records[trigger_idx].timestamp;
-                    trig_set = 1;
-                } else {
-                    for (int r = 0; r < read_count; r++) {
-                        double ts = read_records[r].timestamp;
-                        if (ts < t0 || ts > t1) continue;
-                        if (strcmp(read_records[r].file_path, firsts[candidate].path) == 0) { trigger_idx = r; strcpy(trig_path, read_records[r].file_path); trig_off = read_records[r].offset; trig_len = read_records[r].req_len; trig_ts = read_records[r].timestamp; trig_set = 1; break; }
-                    }
-                    if (!trig_set) { strcpy(trig_path, firsts[candidate].path); int mi = firsts[candidate].mmap_idx; trig_off = mmap_records[mi].file_offset; trig_len = mmap_records[mi].size; trig_ts = mmap_records[mi].timestamp; trig_set = 1; }
-                }
-            }
-        }
-
-        if (trig_set && !path_monitorable(trig_path)) trig_set = 0;
-        if (!trig_set) continue;
-
-        PrefetchReq prefetches[MAX_RECORDS];
-        int prefetch_cnt = 0;
-        size_t out_bytes = 0;
-        int out_items = 0;
-        long max_items = 12, max_bytes = 262144;
-        { const char* s = getenv("ANALYZER_PREFETCH_MAX_ITEMS"); if (s && s[0] != '\0') { char* e = NULL; long v = strtol(s, &e, 10); if (e != s) max_items = v; } }
-        { const char* s = getenv("ANALYZER_PREFETCH_MAX_BYTES"); if (s && s[0] != '\0') { char* e = NULL; long v = strtol(s, &e, 10); if (e != s) max_bytes = v; } }
-        int dir_group = get_env_int("ANALYZER_DIR_GROUPING", 0);
-
-        
-        for (int r = 0; r < read_count && prefetch_cnt < MAX_RECORDS; r++) {
-            double ts = read_records[r].timestamp;
-            if (ts <= trig_ts) continue;
-            if (ts > t_max2) break;
-            const char* p = read_records[r].file_path;
-            if (!p || p[0] != '/' || !path_monitorable(p)) continue;
-            if (dir_group && !same_dir(p, trig_path)) continue;
-            if (strncmp(p, "/proc/", 6) == 0 || strncmp(p, "/sys/", 5) == 0 || strncmp(p, "/dev/", 5) == 0) continue;
-            int off = read_records[r].offset, len = read_records[r].req_len;
-            if (strcmp(p, trig_path) == 0 && off == trig_off && len == trig_len) continue;
-            if (max_items > 0 && out_items >= (int)max_items) break;
-            if (max_bytes > 0 && out_bytes + len > (size_t)max_bytes) break;
-            if (seen_prefetch(prefetches, prefetch_cnt, p, off, len)) continue;
-            strcpy(prefetches[prefetch_cnt].file_path, p);
-            prefetches[prefetch_cnt].offset = off;
-            prefetches[prefetch_cnt].length = len;
-            prefetch_cnt++;
-            out_items++;
-            out_bytes += len;
-        }
-        for (int m = 0; m < mmap_count && prefetch_cnt < MAX_RECORDS; m++) {
-            double ts = mmap_records[m].timestamp;
-            if (ts < trig_ts || ts > t_max2) continue;
-            const char* p = mmap_records[m].file_path;
-            if (!p || p[0] != '/' || !path_monitorable(p)) continue;
-            if (dir_group && !same_dir(p, trig_path)) continue;
-            if (strncmp(p, "/proc/", 6) == 0 || strncmp(p, "/sys/", 5) == 0 || strncmp(p, "/dev/", 5) == 0) continue;
-            int off = mmap_records[m].file_offset;
-            int len = mmap_records[m].size;
-            if (len <= 0) continue;
-            if (strcmp(p, trig_path) == 0 && off == trig_off && len == trig_len) continue;
-            if (max_items > 0 && out_items >= (int)max_items) break;
-            if (max_bytes > 0 && out_bytes + len > (size_t)max_bytes) break;
-            if (seen_prefetch(prefetches, prefetch_cnt, p, off, len)) continue;
-            strcpy(prefetches[prefetch_cnt].file_path, p);
-            prefetches[prefetch_cnt].offset = off;
-            prefetches[prefetch_cnt].length = len;
-            prefetch_cnt++;
-            out_items++;
-            out_bytes += len;
-        }
-
-        if (prefetch_cnt > 0) {
-            fprintf(trigger_fp, "%s,%d,%d\n", trig_path, trig_off, trig_len);
+    TrigJob job = { .stat_records = stat_records, .read_records = read_records, .read_count = read_count,
+                    .mmap_records = mmap_records, .mmap_count = mmap_count, .rix = &rix, .npaths = npaths,
+                    .cand = cand, .tau_list = tau_list, .tau_n = tau_n,
+                    .extend = get_env_double("ANALYZER_TMAX_EXTEND_SEC", 3.0),   // 支持小数（毫秒级窗口）
+                    .min_reads = get_env_int("ANALYZER_MIN_READS_IN_WINDOW", 2),
+                    .min_bytes = get_env_long("ANALYZER_MIN_BYTES_IN_WINDOW", 32768),
+                    .max_items = 12, .max_bytes = 262144,
+                    .dir_group = get_env_int("ANALYZER_DIR_GROUPING", 0) };
+    { const char* s = getenv("ANALYZER_PREFETCH_MAX_ITEMS"); if (s && s[0] != '\0') { char* e = NULL; long v = strtol(s, &e, 10); if (e != s) job.max_items = v; } }
+    { const char* s = getenv("ANALYZER_PREFETCH_MAX_BYTES"); if (s && s[0] != '\0') { char* e = NULL; long v = strtol(s, &e, 10); if (e != s) job.max_bytes = v; } }
+    { const char* no_merge = getenv("IFETCHER_NO_MERGE"); job.no_merge = no_merge && no_merge[0] && strcmp(no_merge, "0") != 0; }
+    job.trig = calloc((size_t)(nc + 1), sizeof(TrigPick));
+    job.prefetches = calloc((size_t)(nc + 1), sizeof(PrefetchReq*));
+    job.prefetch_cnt = calloc((size_t)(nc + 1), sizeof(int));
+    if (job.trig && job.prefetches && job.prefetch_cnt) {
+        // 各区间互不依赖：并行求触发点并收集预取目标
+        parallel_for(nc, collect_prefetch, &job);
+        // 按区间名次顺序输出
+        for (int c = 0; c < nc; c++) {
+            const TrigPick *tp = &job.trig[c];
+            if (!tp->set) continue;
+            fprintf(trigger_fp, "%s,%lld,%lld\n", tp->path, tp->off, tp->len);
             fprintf(prefetch_fp, "===TRIGGER===\n");
-            fprintf(prefetch_fp, "%s,%d,%d\n", trig_path, trig_off, trig_len);
-            const char* no_merge = getenv("IFETCHER_NO_MERGE");
-            if (no_merge && no_merge[0] && strcmp(no_merge, "0") != 0) {
-                for (int m = 0; m < prefetch_cnt; m++) {
-                    fprintf(prefetch_fp, "%s,%d,%d\n", prefetches[m].file_path, prefetches[m].offset, prefetches[m].length);
-                }
-            } else {
-                PrefetchReq merged[MAX_RECORDS];
-                int merged_cnt = 0;
-                merge_prefetch_requests(prefetches, prefetch_cnt, merged, &merged_cnt);
-                for (int m = 0; m < merged_cnt; m++) {
-                    fprintf(prefetch_fp, "%s,%d,%d\n", merged[m].file_path, merged[m].offset, merged[m].length);
-                }
+            fprintf(prefetch_fp, "%s,%lld,%lld\n", tp->path, tp->off, tp->len);
+            for (int m = 0; m < job.prefetch_cnt[c]; m++) {
+                const PrefetchReq *q = &job.prefetches[c][m];
+                fprintf(prefetch_fp, "%s,%lld,%lld\n", q->file_path, q->offset, q->length);
             }
         }
     }
-
-    
+    for (int c = 0; job.prefetches && c < nc; c++) free(job.prefetches[c]);
+    free(job.trig); free(job.prefetches); free(job.prefetch_cnt);
 
     fclose(trigger_fp);
     fclose(prefetch_fp);
+    free(ts_density); free(delta_ts_density); free(cand); read_index_free(&rix);
 }
\ No newline at end of file
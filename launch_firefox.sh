@@ -12,7 +12,7 @@ kill_firefox() { pkill -f firefox 2>/dev/null || true; }
 
 echo "== Step00: Build & Global Clean =="
 cd "$ROOT"
-rm -f /tmp/read_log /tmp/mmap_log /tmp/stat_log
+rm -f /tmp/read_log /tmp/mmap_log /tmp/stat_log /tmp/page_log /tmp/read_log.* /tmp/mmap_log.* /tmp/stat_log.* /tmp/page_log.*
 rm -f analyzer/trigger_log.txt analyzer/prefetch_log.txt
 sudo sh -c 'sync; echo 3 > /proc/sys/vm/drop_caches' 2>/dev/null || true
 cd profiler && make basic && cd ../analyzer && make analyzer_tight && cd ../prefetcher && make
@@ -24,7 +24,8 @@ echo "== Step01: Profile (Training, cold cache, 10s) =="
 cd "$ROOT/profiler"
 sudo sh -c 'sync; echo 3 > /proc/sys/vm/drop_caches' 2>/dev/null || true
 # 修改为弹窗训练：使用图形模式而不是headless模式
-(sleep 10; printf '\n') | ./proc_monitor --spawn /usr/bin/firefox --no-remote --profile "$PROFILE" "$URL"
+# firefox 为包装脚本，启动 I/O 主要发生在 content/GPU/socket 子进程：跟踪整棵进程树，每个进程写各自的日志流
+(sleep 10; printf '\n') | IFETCHER_PER_PROCESS_LOGS=1 ./proc_monitor --spawn /usr/bin/firefox --no-remote --profile "$PROFILE" "$URL"
 
 kill_firefox
 clean_profile
@@ -95,14 +95,14 @@ sudo sh -c 'sync; echo 3 > /proc/sys/vm/drop_caches' 2>/dev/null || true
 
 # Build
 (cd profiler && make basic >/dev/null)
-(cd analyzer && make analyzer_tight >/dev/null)
+(cd analyzer && make analyzer_tight trace_dump >/dev/null)
 (cd prefetcher && make >/dev/null)
 cleanup_env
 
 echo "== Step 1: Profiling (Training Phase) =="
 cd "$ROOT/profiler"
 sudo sh -c 'sync; echo 3 > /proc/sys/vm/drop_caches' 2>/dev/null || true
-(sleep "$TRAIN_SEC"; printf '\n') | ./proc_monitor --spawn "$APP" >/dev/null 2>&1 || true
+(sleep "$TRAIN_SEC"; printf '\n') | IFETCHER_RESIDENCY=${IFETCHER_RESIDENCY:-1} IFETCHER_MAJFAULT=${IFETCHER_MAJFAULT:-1} ./proc_monitor --spawn "$APP" >/dev/null 2>&1 || true
 cleanup_env
 
 echo "== Step 2: Analyzing Logs =="
@@ -126,7 +126,10 @@ if [ -n "$SINGLE_TRIGGER_PATH" ]; then
 fi
 # Fallback: synthesize single trigger when analyzer produced none
 if [ $(grep -cv '^APP=' trigger_log.txt 2>/dev/null || echo 0) -eq 0 ]; then
-  awk 'BEGIN{found=0}
+  # mmap_log 默认为二进制格式（以块魔数 IFTB 开头），先导出为文本再匹配；文本日志直接读取。
+  # 事先选定一种读法，避免 trace_dump 中途失败后再 cat 一遍造成重复输出
+  if [ -x ./trace_dump ] && [ "$(head -c 4 /tmp/mmap_log 2>/dev/null)" = "IFTB" ]; then MMAP_DUMP=./trace_dump; else MMAP_DUMP=cat; fi
+  "$MMAP_DUMP" /tmp/mmap_log 2>/dev/null | awk 'BEGIN{found=0}
        /Type:MMAP/ {
          if(found) next;
          if (match($0, /File:[^|]*/)) {
@@ -138,7 +141,7 @@ if [ $(grep -cv '^APP=' trigger_log.txt 2>/dev/null || echo 0) -eq 0 ]; then
              found=1;
            }
          }
-       }' /tmp/mmap_log
+       }'
 fi
 
 echo "== Step 3: Measuring BASELINE =="
@@ -0,0 +1,45 @@
+#ifndef BPF_EVENTS_H
+#define BPF_EVENTS_H
+// ifetcher.bpf.c 与 bpf_monitor.c 共用的环形缓冲事件布局。
+// 只用 __u32/__u64 等内核类型：BPF 侧由 vmlinux.h 提供，用户态由 <linux/types.h> 提供。
+
+#define IFB_PATH_MAX 256
+
+// 事件类型
+enum {
+    IFB_CACHE = 1,      // filemap:mm_filemap_add_to_page_cache：index 为页号，size 为页数
+    IFB_READ  = 2,      // read 系列系统调用返回：index 为文件偏移，size 为返回字节数
+    IFB_BLOCK = 3,      // block_rq_issue → block_rq_complete：index 为扇区，size 为扇区数
+    IFB_OPEN  = 4       // openat 成功返回：附带用户传入的路径（struct ifb_open_event）
+};
+
+// IFB_READ 的系统调用（用户态换算为 OpType）
+enum {
+    IFB_SYS_READ,
+    IFB_SYS_PREAD,
+    IFB_SYS_READV,
+    IFB_SYS_PREADV
+};
+
+struct ifb_event {
+    __u64 ts_ns;        // bpf_ktime_get_ns()，即 CLOCK_MONOTONIC
+    __u64 ino;
+    __u64 index;
+    __u64 size;
+    __u64 req;          // READ：请求长度
+    __u64 lat_ns;       // READ：系统调用耗时；BLOCK：下发到完成的耗时
+    __u32 dev;          // 内核 dev_t 编码（MAJOR << 20 | MINOR）
+    __u32 tgid;
+    __u32 tid;
+    __s32 fd;           // READ/OPEN：文件描述符
+    __u16 kind;
+    __u16 sys;          // READ：IFB_SYS_*
+    __u32 pad;
+};
+
+struct ifb_open_event {
+    struct ifb_event e;
+    char path[IFB_PATH_MAX];
+};
+
+#endif // BPF_EVENTS_H
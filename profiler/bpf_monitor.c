@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+#include "bpf_monitor.h"
+#include "profiler_common.h"
+
+static int env_requested(void) {
+    const char* s = getenv("IFETCHER_BPF");
+    return s && strcmp(s, "1") == 0;
+}
+
+#ifdef IFETCHER_HAVE_BPF
+
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/sysmacros.h>
+#include <linux/types.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "bpf_events.h"
+#include "ifetcher.skel.h"
+
+#define INODE_SLOTS 16384       // (dev, inode) -> 路径缓存（开放寻址，满时清空重建）
+#define SCAN_SLOTS  256         // 每进程最近一次 /proc 扫描时刻
+#define SCAN_MIN_NS 20000000ULL // 同一进程两次扫描的最小间隔
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    char* path;                 // NULL 表示空槽
+} InodeSlot;
+
+typedef struct { pid_t pid; uint64_t ts; } ScanSlot;
+
+// 待发的页缓存区间：同一线程对同一文件连续新增的页合并为一条 OP_CACHE
+typedef struct {
+    int active;
+    pid_t pid, tid;
+    dev_t dev;
+    ino_t ino;
+    uint64_t first, end;        // 页号 [first, end)
+    uint64_t ts;
+} CacheRun;
+
+static struct ifetcher_bpf* skel = NULL;
+static struct ring_buffer* rb = NULL;
+static pthread_t poll_thread;
+static volatile int poll_running = 0;
+static int cgroup_fd = -1;
+static long page_size = 4096;
+
+static InodeSlot inode_slots[INODE_SLOTS];
+static size_t inode_used = 0;
+static ScanSlot scan_slots[SCAN_SLOTS];
+static CacheRun run;
+
+static unsigned long long cache_pages = 0, read_events = 0, open_events = 0, unresolved = 0;
+static unsigned long long block_reads = 0, block_sectors = 0, block_lat_ns = 0, block_lat_max = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+int bpf_monitor_enabled(void) {
+    return env_requested();
+}
+
+static int env_int(const char* name, int defv) {
+    const char* s = getenv(name);
+    return (s && *s) ? atoi(s) : defv;
+}
+
+// 内核 dev_t（MAJOR << 20 | MINOR）换算为用户态 st_dev
+static dev_t kdev(__u32 d) {
+    return makedev(d >> 20, d & 0xfffff);
+}
+
+/* ---------------- (dev, inode) -> 路径 ---------------- */
+
+static InodeSlot* inode_slot(dev_t dev, ino_t ino) {
+    size_t j = ((uint64_t)ino * 0x9e3779b97f4a7c15ULL ^ (uint64_t)dev) & (INODE_SLOTS - 1);
+    while (inode_slots[j].path && (inode_slots[j].dev != dev || inode_slots[j].ino != ino)) j = (j + 1) & (INODE_SLOTS - 1);
+    return &inode_slots[j];
+}
+
+static const char* inode_path(dev_t dev, ino_t ino) {
+    InodeSlot* s = inode_slot(dev, ino);
+    return s->path;
+}
+
+static void inode_set(dev_t dev, ino_t ino, const char* path) {
+    if (inode_used * 2 >= INODE_SLOTS) {
+        for (size_t i = 0; i < INODE_SLOTS; i++) free(inode_slots[i].path);
+        memset(inode_slots, 0, sizeof(inode_slots));
+        inode_used = 0;
+    }
+    InodeSlot* s = inode_slot(dev, ino);
+    if (s->path && strcmp(s->path, path) == 0) return;
+    char* dup = strdup(path);
+    if (!dup) return;
+    if (s->path) free(s->path);
+    else inode_used++;
+    s->dev = dev;
+    s->ino = ino;
+    s->path = dup;
+}
+
+// 扫描进程当前打开的文件与文件映射，登记其中的普通文件
+static void scan_process(pid_t pid) {
+    char dir[64], link[96], target[4096];
+    snprintf(dir, sizeof(dir), "/proc/%d/fd", pid);
+    DIR* d = opendir(dir);
+    if (d) {
+        struct dirent* de;
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(link, sizeof(link), "%s/%s", dir, de->d_name);
+            struct stat st;
+            if (stat(link, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+            ssize_t n = readlink(link, target, sizeof(target) - 1);
+            if (n <= 0 || target[0] != '/') continue;
+            target[n] = '\0';
+            inode_set(st.st_dev, st.st_ino, target);
+        }
+        closedir(d);
+    }
+    snprintf(dir, sizeof(dir), "/proc/%d/maps", pid);
+    FILE* fp = fopen(dir, "r");
+    if (!fp) return;
+    char line[4096 + 128];
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned maj, min;
+        unsigned long long ino;
+        int pos = 0;
+        if (sscanf(line, "%*s %*s %*s %x:%x %llu %n", &maj, &min, &ino, &pos) < 3 || ino == 0 || pos == 0) continue;
+        char* path = line + pos;
+        if (path[0] != '/') continue;
+        path[strcspn(path, "\n")] = '\0';
+        if (strstr(path, " (deleted)")) continue;
+        inode_set(makedev(maj, min), (ino_t)ino, path);
+    }
+    fclose(fp);
+}
+
+// 查找路径；未命中时（限频）扫描事件所属进程后再查一次
+static const char* resolve(pid_t pid, dev_t dev, ino_t ino) {
+    const char* p = inode_path(dev, ino);
+    if (p) return p;
+    ScanSlot* s = &scan_slots[(unsigned)pid % SCAN_SLOTS];
+    uint64_t now = profiler_now_ns();
+    if (s->pid == pid && now - s->ts < SCAN_MIN_NS) return NULL;
+    s->pid = pid;
+    s->ts = now;
+    scan_process(pid);
+    return inode_path(dev, ino);
+}
+
+/* ---------------- 事件 ---------------- */
+
+static void flush_run(void) {
+    if (!run.active) return;
+    run.active = 0;
+    const char* path = resolve(run.pid, run.dev, run.ino);
+    if (!path) { unresolved++; return; }
+    ProfilerLogEntry entry = {
+        .pid = run.pid,
+        .tid = run.tid,
+        .op_type = OP_CACHE,
+        .filename = path,
+        .offset = (off_t)(run.first * (uint64_t)page_size),
+        .size = (size_t)((run.end - run.first) * (uint64_t)page_size),
+        .fd = -1,
+        .ts_ns = run.ts
+    };
+    profiler_log(&entry);
+}
+
+static void on_cache(const struct ifb_event* e) {
+    dev_t dev = kdev(e->dev);
+    cache_pages += e->size;
+    if (run.active && run.tid == (pid_t)e->tid && run.dev == dev && run.ino == (ino_t)e->ino && run.end == e->index) {
+        run.end += e->size;
+        return;
+    }
+    flush_run();
+    run.active = 1;
+    run.pid = (pid_t)e->tgid;
+    run.tid = (pid_t)e->tid;
+    run.dev = dev;
+    run.ino = (ino_t)e->ino;
+    run.first = e->index;
+    run.end = e->index + e->size;
+    run.ts = e->ts_ns;
+}
+
+static void on_read(const struct ifb_event* e) {
+    static const OpType ops[] = { OP_READ, OP_PREAD, OP_READV, OP_PREADV };
+    read_events++;
+    const char* path = resolve((pid_t)e->tgid, kdev(e->dev), (ino_t)e->ino);
+    if (!path) { unresolved++; return; }
+    ProfilerLogEntry entry = {
+        .pid = (pid_t)e->tgid,
+        .tid = (pid_t)e->tid,
+        .op_type = e->sys < 4 ? ops[e->sys] : OP_READ,
+        .filename = path,
+        .offset = (off_t)e->index,
+        .size = (size_t)e->size,
+        .fd = e->fd,
+        .ts_ns = e->ts_ns,
+        .req_size = (size_t)e->req,
+        .io_ns = e->lat_ns
+    };
+    profiler_log(&entry);
+}
+
+// openat 给出的是调用方传入的路径：相对路径优先取 /proc/<pid>/fd/<fd> 的规范路径，否则拼接 cwd（忽略 dirfd）
+static void on_open(const struct ifb_open_event* o) {
+    char buf[4096], link[64];
+    const char* path = o->path;
+    open_events++;
+    if (path[0] != '/') {
+        snprintf(link, sizeof(link), "/proc/%u/fd/%d", o->e.tgid, o->e.fd);
+        ssize_t n = readlink(link, buf, sizeof(buf) - 1);
+        if (n <= 0 || buf[0] != '/') {
+            snprintf(link, sizeof(link), "/proc/%u/cwd", o->e.tgid);
+            n = readlink(link, buf, sizeof(buf) - 1);
+            if (n <= 0) return;
+            buf[n] = '\0';
+            size_t len = strlen(buf);
+            snprintf(buf + len, sizeof(buf) - len, "/%s", o->path);
+        } else {
+            buf[n] = '\0';
+        }
+        path = buf;
+    }
+    inode_set(kdev(o->e.dev), (ino_t)o->e.ino, path);
+    ProfilerLogEntry entry = {
+        .pid = (pid_t)o->e.tgid,
+        .tid = (pid_t)o->e.tid,
+        .op_type = OP_OPEN,
+        .filename = path,
+        .fd = o->e.fd,
+        .ts_ns = o->e.ts_ns
+    };
+    profiler_log(&entry);
+}
+
+static void on_block(const struct ifb_event* e) {
+    block_reads++;
+    block_sectors += e->size;
+    block_lat_ns += e->lat_ns;
+    if (e->lat_ns > block_lat_max) block_lat_max = e->lat_ns;
+}
+
+static int handle_event(void* ctx, void* data, size_t len) {
+    (void)ctx;
+    const struct ifb_event* e = data;
+    if (len < sizeof(*e)) return 0;
+    if (e->kind != IFB_CACHE) flush_run();
+    switch (e->kind) {
+    case IFB_CACHE: on_cache(e); break;
+    case IFB_READ:  on_read(e); break;
+    case IFB_OPEN:  if (len >= sizeof(struct ifb_open_event)) on_open(data); break;
+    case IFB_BLOCK: on_block(e); break;
+    }
+    return 0;
+}
+
+static void* poll_loop(void* arg) {
+    (void)arg;
+    profiler_log_init();
+    while (poll_running) {
+        int n = ring_buffer__poll(rb, 100);
+        if (n < 0 && n != -EINTR) break;
+        if (n == 0) flush_run();    // 空闲时发出待发区间
+    }
+    return NULL;
+}
+
+/* ---------------- 加载 ---------------- */
+
+// tracefs 中不存在的 tracepoint（如未开启 CONFIG_FTRACE_SYSCALLS、旧内核无 openat2）不加载，其余照常挂载
+static void disable_missing(int syscalls) {
+    struct bpf_program* prog;
+    bpf_object__for_each_program(prog, skel->obj) {
+        const char* sec = bpf_program__section_name(prog);
+        if (strncmp(sec, "tp/", 3) != 0) continue;
+        int keep = syscalls || strncmp(sec, "tp/syscalls/", 12) != 0;
+        if (keep) {
+            char path[256];
+            snprintf(path, sizeof(path), "/sys/kernel/tracing/events/%s", sec + 3);
+            if (access(path, F_OK) != 0) {
+                snprintf(path, sizeof(path), "/sys/kernel/debug/tracing/events/%s", sec + 3);
+                keep = access(path, F_OK) == 0;
+                if (!keep && verbose()) fprintf(stderr, "[ProcMonitor] Warning: eBPF: tracepoint %s not available\n", sec + 3);
+            }
+        }
+        if (!keep) bpf_program__set_autoload(prog, false);
+    }
+}
+
+static int libbpf_print(enum libbpf_print_level level, const char* fmt, va_list args) {
+    if (level == LIBBPF_DEBUG || !verbose()) return 0;
+    return vfprintf(stderr, fmt, args);
+}
+
+int bpf_monitor_start(pid_t pid) {
+    if (skel) return 0;
+    page_size = sysconf(_SC_PAGESIZE);
+    libbpf_set_print(libbpf_print);
+    const char* cg = getenv("IFETCHER_BPF_CGROUP");
+    int syscalls = env_int("IFETCHER_BPF_SYSCALLS", 1) != 0;
+    unsigned long ring = (unsigned long)env_int("IFETCHER_BPF_RING_KB", 16384) * 1024;
+    unsigned long ring_size = (unsigned long)page_size;
+    while (ring_size < ring) ring_size <<= 1;
+
+    skel = ifetcher_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "[ProcMonitor] Warning: eBPF: failed to open program: %s\n", strerror(errno));
+        return -1;
+    }
+    if (cg && *cg) {
+        cgroup_fd = open(cg, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (cgroup_fd < 0) {
+            fprintf(stderr, "[ProcMonitor] Warning: eBPF: cannot open cgroup %s: %s\n", cg, strerror(errno));
+            goto fail;
+        }
+        skel->rodata->filter_cgroup = 1;
+    }
+    skel->rodata->trace_syscalls = syscalls;
+    bpf_map__set_max_entries(skel->maps.events, (__u32)ring_size);
+    disable_missing(syscalls);
+
+    int err = ifetcher_bpf__load(skel);
+    if (err) {
+        fprintf(stderr, "[ProcMonitor] Warning: eBPF: failed to load program (%d); needs root and kernel BTF\n", err);
+        goto fail;
+    }
+    __u32 key = 0;
+    if (cgroup_fd >= 0) {
+        __u32 v = (__u32)cgroup_fd;
+        err = bpf_map__update_elem(skel->maps.cgroups, &key, sizeof(key), &v, sizeof(v), BPF_ANY);
+    } else {
+        __u32 k = (__u32)pid;
+        __u8 one = 1;
+        err = bpf_map__update_elem(skel->maps.tracked, &k, sizeof(k), &one, sizeof(one), BPF_ANY);
+    }
+    if (err) {
+        fprintf(stderr, "[ProcMonitor] Warning: eBPF: failed to set filter (%d)\n", err);
+        goto fail;
+    }
+    err = ifetcher_bpf__attach(skel);
+    if (err) {
+        fprintf(stderr, "[ProcMonitor] Warning: eBPF: failed to attach tracepoints (%d)\n", err);
+        goto fail;
+    }
+    rb = ring_buffer__new(bpf_map__fd(skel->maps.events), handle_event, NULL, NULL);
+    if (!rb) {
+        fprintf(stderr, "[ProcMonitor] Warning: eBPF: failed to create ring buffer\n");
+        goto fail;
+    }
+    poll_running = 1;
+    if (pthread_create(&poll_thread, NULL, poll_loop, NULL) != 0) {
+        poll_running = 0;
+        goto fail;
+    }
+    if (verbose()) {
+        if (cgroup_fd >= 0) printf("[ProcMonitor] eBPF tracing cgroup %s", cg);
+        else printf("[ProcMonitor] eBPF tracing process tree of %d", pid);
+        printf(" (ring %lu KiB%s)\n", ring_size / 1024, syscalls ? "" : ", no syscalls");
+    }
+    return 0;
+
+fail:
+    if (rb) { ring_buffer__free(rb); rb = NULL; }
+    ifetcher_bpf__destroy(skel);
+    skel = NULL;
+    if (cgroup_fd >= 0) { close(cgroup_fd); cgroup_fd = -1; }
+    return -1;
+}
+
+void bpf_monitor_add_process(pid_t pid) {
+    if (!skel || cgroup_fd >= 0) return;
+    __u32 k = (__u32)pid;
+    __u8 one = 1;
+    bpf_map__update_elem(skel->maps.tracked, &k, sizeof(k), &one, sizeof(one), BPF_ANY);
+}
+
+void bpf_monitor_stop(void) {
+    if (!skel) return;
+    // 先卸载程序，再取尽环中已提交的事件
+    ifetcher_bpf__detach(skel);
+    poll_running = 0;
+    pthread_join(poll_thread, NULL);
+    ring_buffer__consume(rb);
+    flush_run();
+    unsigned long long dropped = skel->bss->dropped;
+    if (verbose()) {
+        printf("[ProcMonitor] eBPF: %llu page-cache pages, %llu reads, %llu opens, %llu unresolved, %llu dropped\n",
+               cache_pages, read_events, open_events, unresolved, dropped);
+        if (block_reads)
+            printf("[ProcMonitor] eBPF: %llu block reads, %llu KiB, avg %.1f us, max %.1f us\n",
+                   block_reads, block_sectors / 2, block_lat_ns / 1e3 / block_reads, block_lat_max / 1e3);
+    }
+    if (dropped) fprintf(stderr, "[ProcMonitor] Warning: eBPF ring buffer overflowed, %llu events lost (raise IFETCHER_BPF_RING_KB)\n", dropped);
+    ring_buffer__free(rb);
+    rb = NULL;
+    ifetcher_bpf__destroy(skel);
+    skel = NULL;
+    if (cgroup_fd >= 0) { close(cgroup_fd); cgroup_fd = -1; }
+    for (size_t i = 0; i < INODE_SLOTS; i++) { free(inode_slots[i].path); inode_slots[i].path = NULL; }
+    inode_used = 0;
+}
+
+#else // !IFETCHER_HAVE_BPF
+
+int bpf_monitor_enabled(void) {
+    static int warned = 0;
+    if (!env_requested()) return 0;
+    if (!warned) {
+        fprintf(stderr, "[ProcMonitor] Warning: built without eBPF support (make bpf), IFETCHER_BPF ignored\n");
+        warned = 1;
+    }
+    return 0;
+}
+
+int bpf_monitor_start(pid_t pid) {
+    (void)pid;
+    return -1;
+}
+
+void bpf_monitor_add_process(pid_t pid) {
+    (void)pid;
+}
+
+void bpf_monitor_stop(void) {
+}
+
+#endif // IFETCHER_HAVE_BPF
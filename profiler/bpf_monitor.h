@@ -0,0 +1,38 @@
+#ifndef BPF_MONITOR_H
+#define BPF_MONITOR_H
+#include <sys/types.h>
+
+// eBPF 采集后端（ifetcher.bpf.c，libbpf CO-RE）：在内核中按进程树（或 cgroup）过滤，
+// 经 BPF ringbuf 把 (inode, 页号, 时刻, tid) 送到用户态，统一覆盖 read 系统调用、
+// io_uring、缺页与预读引起的磁盘读，不依赖 LD_PRELOAD。
+//   filemap:mm_filemap_add_to_page_cache   新进入页缓存的页 → page_log（OP_CACHE，连续页合并为区间）
+//   syscalls:sys_{enter,exit}_*read*       read/pread64/readv/preadv/preadv2 → read_log（含请求长度与耗时）
+//   syscalls:sys_{enter,exit}_openat{,2}   打开的普通文件 → read_log（OP_OPEN），同时建立 (dev, inode) → 路径
+//   block:block_rq_{issue,complete}        进程树在自身上下文中下发的块读请求，退出时汇总次数与延迟
+// 进程树由 sched_process_fork/exit 在内核内维护；inode 首次出现而 openat 未给出路径时，
+// 扫描该进程的 /proc/<pid>/fd 与 /proc/<pid>/maps 解析，仍解析不到的事件计数后丢弃。
+//
+// 构建：默认 make 只编入桩实现；make bpf 需要 clang、bpftool 与 libbpf 开发文件，
+// 由 /sys/kernel/btf/vmlinux 生成 vmlinux.h 与 skeleton 并以 -DIFETCHER_HAVE_BPF 链接 -lbpf。
+//
+// 环境变量：
+//   IFETCHER_BPF=1                  启用（--spawn 时不再预加载 libwrapper.so）
+//   IFETCHER_BPF_CGROUP=<dir>       改为按 cgroup v2 目录（含子 cgroup）过滤，而非进程树
+//   IFETCHER_BPF_SYSCALLS=0         不挂读/打开系统调用，只采集页缓存与块层事件
+//   IFETCHER_BPF_RING_KB            ringbuf 大小（KiB，向上取 2 的幂），默认 16384
+//
+// 需要 root（CAP_BPF + CAP_PERFMON）与内核 BTF。
+
+// 是否通过环境变量启用且本构建包含 eBPF 支持（不含时打印一次警告并返回 0）
+int bpf_monitor_enabled(void);
+
+// 加载并挂载程序、启动 ringbuf 读取线程；pid 为进程树的根。成功返回 0
+int bpf_monitor_start(pid_t pid);
+
+// 把进程树中新发现的进程加入内核过滤表（attach 模式下 fork 早于挂载的后代）
+void bpf_monitor_add_process(pid_t pid);
+
+// 卸载程序，取尽 ringbuf 中剩余事件并释放资源
+void bpf_monitor_stop(void);
+
+#endif // BPF_MONITOR_H
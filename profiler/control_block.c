@@ -0,0 +1,57 @@
+#define _GNU_SOURCE
+#include "control_block.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+IfetcherControl* control_create(const char* path) {
+    // 默认路径在所有人可写的 /dev/shm 下且可预测：先删掉残留文件，再以 O_EXCL|O_NOFOLLOW 新建，
+    // 被抢先放置的文件或符号链接只会让创建失败，不会截断/写入别处的文件
+    if (unlink(path) != 0 && errno != ENOENT) return NULL;
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid()) {
+        close(fd);
+        errno = EPERM;
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(IfetcherControl)) != 0) { close(fd); unlink(path); return NULL; }
+    void* p = mmap(NULL, sizeof(IfetcherControl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { unlink(path); return NULL; }
+    IfetcherControl* c = (IfetcherControl*)p;
+    memset(c, 0, sizeof(*c));
+    c->version = IFETCHER_CTL_VERSION;
+    c->size = (uint16_t)sizeof(IfetcherControl);
+    c->owner_pid = (uint32_t)getpid();
+    // magic 最后写入：映射方看到 magic 时其余字段已就绪
+    atomic_thread_fence(memory_order_release);
+    c->magic = IFETCHER_CTL_MAGIC;
+    return c;
+}
+
+IfetcherControl* control_attach(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(IfetcherControl)) { close(fd); return NULL; }
+    void* p = mmap(NULL, sizeof(IfetcherControl), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    IfetcherControl* c = (IfetcherControl*)p;
+    if (c->magic != IFETCHER_CTL_MAGIC || c->version != IFETCHER_CTL_VERSION || c->size != sizeof(IfetcherControl)) {
+        munmap(p, sizeof(IfetcherControl));
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return c;
+}
+
+void control_destroy(IfetcherControl* c, const char* path) {
+    if (c) munmap(c, sizeof(IfetcherControl));
+    if (path) unlink(path);
+}
@@ -0,0 +1,66 @@
+#ifndef CONTROL_BLOCK_H
+#define CONTROL_BLOCK_H
+/*
+ * proc_monitor 与 libwrapper 之间的共享内存控制块
+ *
+ * proc_monitor 启动时在 /dev/shm 下创建一个小文件并映射（路径经 IFETCHER_CONTROL
+ * 传给被 spawn 的应用），libwrapper 在 init 时只读映射。采集开关、启动时刻、读过滤
+ * 设置与采样率都以原子变量存放：读热路径判断是否记录只需一次内存读，不再对网关文件
+ * 逐次 access()；proc_monitor 可随时暂停/恢复采集而无需重启应用。
+ *
+ * 映射经 fork 继承，exec 后由新映像的 libwrapper 按 IFETCHER_CONTROL 重新映射；
+ * proc_monitor 退出时删除文件，已映射的进程不受影响。
+ *
+ * 环境变量：
+ *   IFETCHER_CONTROL=<path>     控制块文件（默认 /dev/shm/ifetcher.<proc_monitor pid>；0 关闭，
+ *                               回退到逐次检查 IFETCHER_GATE_FILE）
+ *   IFETCHER_SAMPLE_RATE=<n>    每 n 次读记录 1 次（按线程计数，先于读过滤；默认 1 = 全部）
+ */
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define IFETCHER_CTL_MAGIC    0x4c544346u   /* "FCTL" 小端 */
+#define IFETCHER_CTL_VERSION  1
+
+// filter_flags
+enum {
+    CTL_FILTER = 1u << 0,   // 读过滤（read_filter）
+    CTL_DEDUP  = 1u << 1    // 页位图去重
+};
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                      // sizeof(IfetcherControl)，校验布局
+    uint32_t owner_pid;                 // 创建者（proc_monitor）
+    _Atomic uint32_t gate;              // 1=采集，0=暂停
+    _Atomic uint64_t start_wall_ns;     // 非 0 时墙钟到达此刻即视为开启（IFETCHER_START_TS）
+    _Atomic uint32_t generation;        // 以下设置每次修改后递增，libwrapper 据此重新加载
+    _Atomic uint32_t filter_flags;
+    _Atomic uint32_t coalesce_ms;
+    _Atomic uint32_t coalesce_max_kb;
+    _Atomic uint32_t sample_rate;       // 每 N 次读记录 1 次（0/1 = 全部）
+} IfetcherControl;
+
+// 采集是否开启：gate 打开时一次内存读；否则若设置了启动时刻再读一次墙钟（vDSO，无系统调用）
+static inline int control_capture_on(IfetcherControl* c) {
+    if (atomic_load_explicit(&c->gate, memory_order_relaxed)) return 1;
+    uint64_t start = atomic_load_explicit(&c->start_wall_ns, memory_order_relaxed);
+    if (start == 0) return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec >= start;
+}
+
+// proc_monitor：删除同名残留文件后独占新建控制块（0600，不跟随符号链接，须为调用者所有的普通文件）
+// 并可写映射，字段清零；失败返回 NULL
+IfetcherControl* control_create(const char* path);
+
+// libwrapper：只读映射已有控制块；文件不存在或布局不符时返回 NULL
+IfetcherControl* control_attach(const char* path);
+
+// proc_monitor：解除映射并删除文件
+void control_destroy(IfetcherControl* c, const char* path);
+
+#endif // CONTROL_BLOCK_H
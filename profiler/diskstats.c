@@ -1,87 +1,207 @@
+#define _GNU_SOURCE
 #include "diskstats.h"
 #include "profiler_common.h"
-#include <stdio.h>
-#include <string.h>
-#include <ctype.h>
-
-void monitor_disk_stats(void) {
-    static unsigned long long last_reads[256] = {0};
-    static unsigned long long last_sectors[256] = {0};
-    static unsigned long long last_read_time_ms[256] = {0};
-    static unsigned long long last_writes[256] = {0};
-    static unsigned long long last_sectors_written[256] = {0};
-    static unsigned long long last_write_time_ms[256] = {0};
-    static unsigned long long last_io_time_ms[256] = {0};
-
-    char line[1024];
-    FILE* fp = fopen("/proc/diskstats", "r");
-    if (fp == NULL) {
-        perror("Failed to open /proc/diskstats");
-        return;
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+
+#define MAX_DEVICES    64
+#define RESCAN_NS      1000000000ULL    // 重新扫描 /sys/block 的间隔
+#define STAT_FIELDS    11               // /sys/block/<dev>/stat 前 11 列（见 Documentation/block/stat.rst）
+
+// stat 列序号
+enum { F_READS, F_READ_MERGES, F_SECTORS_READ, F_READ_TICKS, F_WRITES, F_WRITE_MERGES,
+       F_SECTORS_WRITTEN, F_WRITE_TICKS, F_IN_FLIGHT, F_IO_TICKS, F_TIME_IN_QUEUE };
+
+typedef struct {
+    char name[32];
+    int fd;                                 // 常开的 stat 文件，每次 pread 偏移 0
+    unsigned long long last[STAT_FIELDS];
+    int seen;                               // 本轮扫描 /sys/block 时仍存在
+} Device;
+
+static Device devices[MAX_DEVICES];
+static int device_count = 0;
+static int include_all = 0;
+static long interval_us = 2000;
+static int timer_fd = -1;
+static pthread_t sampler_thread;
+static volatile int sampler_running = 0;
+static unsigned long long samples = 0, overruns = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+int diskstats_enabled(void) {
+    const char* s = getenv("IFETCHER_DISKSTATS");
+    return !(s && strcmp(s, "0") == 0);
+}
+
+// 空白分隔的十进制整数序列，返回解析出的列数（不做 locale/errno 处理，也不分配）
+static int parse_fields(const char* p, unsigned long long* v, int max) {
+    int n = 0;
+    while (n < max) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p < '0' || *p > '9') break;
+        unsigned long long x = 0;
+        while (*p >= '0' && *p <= '9') x = x * 10 + (unsigned long long)(*p++ - '0');
+        v[n++] = x;
+    }
+    return n;
+}
+
+static long read_sysfs_long(const char* dev, const char* attr, long defv) {
+    char path[128], buf[32];
+    snprintf(path, sizeof(path), "/sys/block/%s/%s", dev, attr);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return defv;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return defv;
+    buf[n] = '\0';
+    unsigned long long v;
+    return parse_fields(buf, &v, 1) == 1 ? (long)v : defv;
+}
+
+// 堆叠设备（dm/md 等，slaves 非空）与 loop/ram/zram 的 I/O 会在底层磁盘上重复计数或不落盘
+static int skip_device(const char* name) {
+    if (include_all) return 0;
+    if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0 || strncmp(name, "zram", 4) == 0) return 1;
+    char path[300];
+    snprintf(path, sizeof(path), "/sys/block/%s/slaves", name);
+    DIR* d = opendir(path);
+    if (!d) return 0;
+    int stacked = 0;
+    struct dirent* de;
+    while (!stacked && (de = readdir(d)) != NULL) stacked = de->d_name[0] != '.';
+    closedir(d);
+    return stacked;
+}
+
+static int read_stat(int fd, unsigned long long* v) {
+    char buf[256];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    return parse_fields(buf, v, STAT_FIELDS) == STAT_FIELDS ? 0 : -1;
+}
+
+// 扫描 /sys/block：新设备打开 stat 并写一条 DEVINFO，以当前读数为基线；消失的设备关闭
+static void scan_devices(void) {
+    DIR* d = opendir("/sys/block");
+    if (!d) return;
+    for (int i = 0; i < device_count; i++) devices[i].seen = 0;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (de->d_name[0] == '.' || len >= sizeof(devices[0].name)) continue;
+        int i;
+        for (i = 0; i < device_count && strcmp(devices[i].name, de->d_name) != 0; i++) {}
+        if (i < device_count) { devices[i].seen = 1; continue; }
+        if (device_count == MAX_DEVICES || skip_device(de->d_name)) continue;
+        char path[300];
+        snprintf(path, sizeof(path), "/sys/block/%s/stat", de->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        Device* dev = &devices[device_count];
+        if (read_stat(fd, dev->last) != 0) { close(fd); continue; }
+        memcpy(dev->name, de->d_name, len + 1);
+        dev->fd = fd;
+        dev->seen = 1;
+        device_count++;
+        profiler_log_devinfo(dev->name, (int)read_sysfs_long(dev->name, "queue/rotational", 0),
+                             (unsigned)read_sysfs_long(dev->name, "queue/nr_requests", 0),
+                             (unsigned)read_sysfs_long(dev->name, "queue/logical_block_size", 512));
+    }
+    closedir(d);
+    int j = 0;
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].seen) devices[j++] = devices[i];
+        else close(devices[i].fd);
+    }
+    device_count = j;
+}
+
+static unsigned long long delta(unsigned long long cur, unsigned long long last) {
+    return cur >= last ? cur - last : 0;
+}
+
+static void sample_devices(void) {
+    samples++;
+    for (int i = 0; i < device_count; i++) {
+        Device* dev = &devices[i];
+        unsigned long long v[STAT_FIELDS];
+        if (read_stat(dev->fd, v) != 0) continue;
+        unsigned long long* l = dev->last;
+        unsigned long long reads = delta(v[F_READS], l[F_READS]);
+        unsigned long long sectors_read = delta(v[F_SECTORS_READ], l[F_SECTORS_READ]);
+        unsigned long long read_ms = delta(v[F_READ_TICKS], l[F_READ_TICKS]);
+        unsigned long long writes = delta(v[F_WRITES], l[F_WRITES]);
+        unsigned long long sectors_written = delta(v[F_SECTORS_WRITTEN], l[F_SECTORS_WRITTEN]);
+        unsigned long long write_ms = delta(v[F_WRITE_TICKS], l[F_WRITE_TICKS]);
+        unsigned long long io_ms = delta(v[F_IO_TICKS], l[F_IO_TICKS]);
+        if (reads || sectors_read || read_ms || writes || sectors_written || write_ms || io_ms)
+            profiler_log_diskstat(dev->name, reads, sectors_read, read_ms, writes, sectors_written, write_ms,
+                                  io_ms, v[F_IN_FLIGHT]);
+        memcpy(l, v, sizeof(v));
+    }
+}
+
+static void* sampler_thread_func(void* arg) {
+    (void)arg;
+    uint64_t last_scan = profiler_now_ns();
+    struct pollfd pfd = { .fd = timer_fd, .events = POLLIN };
+    while (sampler_running) {
+        // 带超时等待，停止时不必等满一个周期
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        uint64_t expirations = 0;
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+        if (expirations > 1) overruns += expirations - 1;
+        sample_devices();
+        uint64_t now = profiler_now_ns();
+        if (now - last_scan >= RESCAN_NS) { scan_devices(); last_scan = now; }
     }
+    return NULL;
+}
+
+int diskstats_start(void) {
+    const char* s = getenv("IFETCHER_DISKSTATS_INTERVAL_US");
+    if (s && *s) interval_us = atol(s);
+    if (interval_us < 100) interval_us = 100;
+    s = getenv("IFETCHER_DISKSTATS_ALL");
+    include_all = s && strcmp(s, "1") == 0;
+    profiler_log_init();
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0) return -1;
+    struct itimerspec its;
+    its.it_interval.tv_sec = interval_us / 1000000;
+    its.it_interval.tv_nsec = (interval_us % 1000000) * 1000L;
+    its.it_value = its.it_interval;
+    if (timerfd_settime(timer_fd, 0, &its, NULL) != 0) { close(timer_fd); timer_fd = -1; return -1; }
 
-    int disk_idx = 0;
-    while (fgets(line, sizeof(line), fp) != NULL && disk_idx < 256) {
-        unsigned int major, minor;
-        char dev_name[64];
-        unsigned long long reads, rmerge, sectors_read, read_time_ms;
-        unsigned long long writes, wmerge, sectors_written, write_time_ms;
-        unsigned long long in_flight, io_time_ms, weighted_io_time_ms;
-
-        int parsed = sscanf(line,
-                            "%u %u %63s "
-                            "%llu %llu %llu %llu "
-                            "%llu %llu %llu %llu "
-                            "%llu %llu %llu",
-                            &major, &minor, dev_name,
-                            &reads, &rmerge, &sectors_read, &read_time_ms,
-                            &writes, &wmerge, &sectors_written, &write_time_ms,
-                            &in_flight, &io_time_ms, &weighted_io_time_ms);
-        if (parsed >= 14) {
-            int is_nvme = strncmp(dev_name, "nvme", 4) == 0;
-            int has_partition_suffix = strstr(dev_name, "p") != NULL;
-            int ends_with_digit = isdigit((unsigned char)dev_name[strlen(dev_name) - 1]);
-            int whole_device = is_nvme ? (has_partition_suffix == 0) : (ends_with_digit == 0);
-
-            if (whole_device) {
-                unsigned long long reads_delta = 0, sectors_read_delta = 0, read_time_delta = 0;
-                unsigned long long writes_delta = 0, sectors_written_delta = 0, write_time_delta = 0;
-                unsigned long long io_time_delta = 0;
-
-                if (last_reads[disk_idx] > 0) {
-                    reads_delta            = (reads            >= last_reads[disk_idx])            ? (reads            - last_reads[disk_idx])            : 0;
-                    sectors_read_delta     = (sectors_read     >= last_sectors[disk_idx])         ? (sectors_read     - last_sectors[disk_idx])         : 0;
-                    read_time_delta        = (read_time_ms     >= last_read_time_ms[disk_idx])    ? (read_time_ms     - last_read_time_ms[disk_idx])    : 0;
-
-                    writes_delta           = (writes           >= last_writes[disk_idx])          ? (writes           - last_writes[disk_idx])          : 0;
-                    sectors_written_delta  = (sectors_written  >= last_sectors_written[disk_idx]) ? (sectors_written  - last_sectors_written[disk_idx]) : 0;
-                    write_time_delta       = (write_time_ms    >= last_write_time_ms[disk_idx])   ? (write_time_ms    - last_write_time_ms[disk_idx])   : 0;
-
-                    io_time_delta          = (io_time_ms       >= last_io_time_ms[disk_idx])      ? (io_time_ms       - last_io_time_ms[disk_idx])      : 0;
-
-                    if (reads_delta > 0 || sectors_read_delta > 0 || read_time_delta > 0 ||
-                        writes_delta > 0 || sectors_written_delta > 0 || write_time_delta > 0 ||
-                        io_time_delta > 0) {
-                        profiler_log_diskstat(dev_name,
-                                              reads_delta, sectors_read_delta, read_time_delta,
-                                              writes_delta, sectors_written_delta, write_time_delta,
-                                              io_time_delta, in_flight);
-                    }
-                }
-
-                last_reads[disk_idx]            = reads;
-                last_sectors[disk_idx]          = sectors_read;
-                last_read_time_ms[disk_idx]     = read_time_ms;
-
-                last_writes[disk_idx]           = writes;
-                last_sectors_written[disk_idx]  = sectors_written;
-                last_write_time_ms[disk_idx]    = write_time_ms;
-                last_io_time_ms[disk_idx]       = io_time_ms;
-
-                disk_idx++;
-            }
-        }
+    scan_devices();
+    sampler_running = 1;
+    if (pthread_create(&sampler_thread, NULL, sampler_thread_func, NULL) != 0) {
+        sampler_running = 0;
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
     }
+    if (verbose()) printf("[ProcMonitor] disk sampler: %d devices, period %ld us\n", device_count, interval_us);
+    return 0;
+}
 
-    fclose(fp);
-}
\ No newline at end of file
+void diskstats_stop(void) {
+    if (!sampler_running) return;
+    sampler_running = 0;
+    pthread_join(sampler_thread, NULL);
+    sample_devices();
+    for (int i = 0; i < device_count; i++) close(devices[i].fd);
+    device_count = 0;
+    close(timer_fd);
+    timer_fd = -1;
+    if (verbose()) printf("Disk sampler: %llu samples, %llu missed periods\n", samples, overruns);
+}
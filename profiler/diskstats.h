@@ -1,7 +1,24 @@
 #ifndef DISKSTATS_H
 #define DISKSTATS_H
 
-// 每次调用采样一次 /proc/diskstats 并写入增量日志
-void monitor_disk_stats(void);
+// 磁盘采样：独立线程按 timerfd 周期（可低至 1ms）读取每个整盘设备的 /sys/block/<dev>/stat，
+// 把相邻采样的增量写入 stat_log（DISKSTAT 记录，按设备名区分各自的序列）。
+// 设备首次出现时写一条 DEVINFO：是否旋转介质、队列深度（nr_requests）、逻辑块大小。
+// /sys/block 下只有整盘设备；其中堆叠设备（slaves 非空的 dm/md）与 loop、ram、zram 默认跳过，
+// 它们的 I/O 已计入底层磁盘或不落盘。每秒重新扫描一次 /sys/block 以发现热插拔设备。
+//
+// 环境变量：
+//   IFETCHER_DISKSTATS=0                 关闭
+//   IFETCHER_DISKSTATS_INTERVAL_US       采样周期（微秒），默认 2000
+//   IFETCHER_DISKSTATS_ALL=1             包含堆叠与虚拟设备
 
-#endif
\ No newline at end of file
+// 是否启用
+int diskstats_enabled(void);
+
+// 启动采样线程；成功返回 0
+int diskstats_start(void);
+
+// 停止采样线程并释放资源
+void diskstats_stop(void);
+
+#endif
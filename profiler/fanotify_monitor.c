@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include "fanotify_monitor.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/fanotify.h>
+
+#define PID_SLOTS   65536       // 进程树判定缓存（开放寻址，半满时清空）
+#define FILE_SLOTS  16384       // 每 (pid, 文件) 的读位置状态
+
+enum { TREE_UNKNOWN = 0, TREE_IN, TREE_OUT };
+
+typedef struct { pid_t pid; int state; } PidSlot;
+
+typedef struct {
+    pid_t pid;                  // 0 表示空槽
+    dev_t dev;
+    ino_t ino;
+    long long last_pos;         // 上次观察到的文件位置（区间起点）
+    int app_fd;                 // 目标进程中对应的 fd，-1 未知
+    int whole_done;             // 已按整文件记录过
+} FileSlot;
+
+static PidSlot pid_slots[PID_SLOTS];
+static size_t pid_used = 0;
+static FileSlot file_slots[FILE_SLOTS];
+static size_t file_used = 0;
+
+static int fan_fd = -1;
+static pthread_t reader_thread;
+static volatile int reader_running = 0;
+static pid_t root_pid = 0;
+static unsigned long long opens = 0, reads = 0, overflows = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+int fanotify_enabled(void) {
+    const char* s = getenv("IFETCHER_FANOTIFY");
+    return s && strcmp(s, "1") == 0;
+}
+
+/* ---------------- 进程树过滤 ---------------- */
+
+static PidSlot* pid_slot(pid_t pid) {
+    size_t j = ((size_t)pid * 2654435761u) & (PID_SLOTS - 1);
+    while (pid_slots[j].pid && pid_slots[j].pid != pid) j = (j + 1) & (PID_SLOTS - 1);
+    return &pid_slots[j];
+}
+
+static int pid_cached(pid_t pid) {
+    PidSlot* s = pid_slot(pid);
+    return s->pid == pid ? s->state : TREE_UNKNOWN;
+}
+
+static void pid_cache(pid_t pid, int state) {
+    if (pid_used * 2 >= PID_SLOTS) { memset(pid_slots, 0, sizeof(pid_slots)); pid_used = 0; }
+    PidSlot* s = pid_slot(pid);
+    if (!s->pid) { s->pid = pid; pid_used++; }
+    s->state = state;
+}
+
+// /proc/<pid>/stat 第 4 字段；进程已退出返回 -1
+static pid_t read_ppid(pid_t pid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    char* p = strrchr(buf, ')');   // comm 可能含空格或括号
+    int ppid;
+    if (!p || sscanf(p + 1, " %*c %d", &ppid) != 1) return -1;
+    return (pid_t)ppid;
+}
+
+// 沿父进程链向上判断是否属于目标进程树，结果按 pid 缓存
+static int in_tree(pid_t pid) {
+    if (pid == root_pid) return 1;
+    int st = pid_cached(pid);
+    if (st != TREE_UNKNOWN) return st == TREE_IN;
+    pid_t cur = pid;
+    st = TREE_OUT;
+    for (int depth = 0; depth < 64; depth++) {
+        pid_t ppid = read_ppid(cur);
+        if (ppid < 0) return 0;         // 已退出：无法判定，不缓存
+        if (ppid == root_pid) { st = TREE_IN; break; }
+        if (ppid <= 1) break;
+        int cached = pid_cached(ppid);
+        if (cached != TREE_UNKNOWN) { st = cached; break; }
+        cur = ppid;
+    }
+    pid_cache(pid, st);
+    return st == TREE_IN;
+}
+
+/* ---------------- 读区间推算 ---------------- */
+
+static FileSlot* file_slot(pid_t pid, dev_t dev, ino_t ino) {
+    size_t h = ((size_t)pid * 2654435761u) ^ ((size_t)ino * 40503u) ^ (size_t)dev;
+    size_t j = h & (FILE_SLOTS - 1);
+    while (file_slots[j].pid && !(file_slots[j].pid == pid && file_slots[j].dev == dev && file_slots[j].ino == ino))
+        j = (j + 1) & (FILE_SLOTS - 1);
+    if (!file_slots[j].pid) {
+        if (file_used * 2 >= FILE_SLOTS) {
+            memset(file_slots, 0, sizeof(file_slots));
+            file_used = 0;
+            return file_slot(pid, dev, ino);
+        }
+        file_slots[j].pid = pid;
+        file_slots[j].dev = dev;
+        file_slots[j].ino = ino;
+        file_slots[j].app_fd = -1;
+        file_used++;
+    }
+    return &file_slots[j];
+}
+
+static int same_file(pid_t pid, int fd, dev_t dev, ino_t ino) {
+    char path[64];
+    struct stat st;
+    snprintf(path, sizeof(path), "/proc/%d/fd/%d", pid, fd);
+    return stat(path, &st) == 0 && st.st_dev == dev && st.st_ino == ino;
+}
+
+// 在目标进程的 fd 表中找到指向该 inode 的 fd
+static int find_app_fd(pid_t pid, dev_t dev, ino_t ino) {
+    char dir_path[64];
+    snprintf(dir_path, sizeof(dir_path), "/proc/%d/fd", pid);
+    DIR* d = opendir(dir_path);
+    if (!d) return -1;
+    int found = -1;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+        int fd = atoi(de->d_name);
+        if (same_file(pid, fd, dev, ino)) { found = fd; break; }
+    }
+    closedir(d);
+    return found;
+}
+
+static int read_fd_pos(pid_t pid, int fd, long long* pos) {
+    char path[64], buf[256];
+    snprintf(path, sizeof(path), "/proc/%d/fdinfo/%d", pid, fd);
+    int f = open(path, O_RDONLY | O_CLOEXEC);
+    if (f < 0) return -1;
+    ssize_t n = read(f, buf, sizeof(buf) - 1);
+    close(f);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    return sscanf(buf, "pos:%lld", pos) == 1 ? 0 : -1;
+}
+
+static void emit(pid_t pid, OpType op, const char* path, int fd, long long offset, long long size) {
+    ProfilerLogEntry entry = {
+        .pid = pid,
+        .op_type = op,
+        .filename = path,
+        .offset = (off_t)offset,
+        .size = (size_t)size,
+        .fd = fd,
+        .status = 0,
+        .err_no = 0
+    };
+    profiler_log(&entry);
+}
+
+static void handle_access(pid_t pid, const struct stat* st, const char* path) {
+    FileSlot* fs = file_slot(pid, st->st_dev, st->st_ino);
+    if (fs->app_fd < 0 || !same_file(pid, fs->app_fd, st->st_dev, st->st_ino))
+        fs->app_fd = find_app_fd(pid, st->st_dev, st->st_ino);
+    long long pos;
+    if (fs->app_fd >= 0 && read_fd_pos(pid, fs->app_fd, &pos) == 0 && pos != fs->last_pos) {
+        // 位置前移：[last_pos, pos) 即合并后的连续读区间；后移说明中间有 seek，只更新起点
+        if (pos > fs->last_pos) { emit(pid, OP_READ, path, fs->app_fd, fs->last_pos, pos - fs->last_pos); reads++; }
+        fs->last_pos = pos;
+        return;
+    }
+    if (!fs->whole_done) {
+        emit(pid, OP_READ, path, fs->app_fd, 0, (long long)st->st_size);
+        fs->whole_done = 1;
+        reads++;
+    }
+}
+
+static void handle_event(const struct fanotify_event_metadata* md) {
+    if (md->mask & FAN_Q_OVERFLOW) { overflows++; return; }
+    if (md->fd < 0) return;
+    pid_t pid = (pid_t)md->pid;
+    struct stat st;
+    char link[64], path[256];
+    if (!in_tree(pid) || fstat(md->fd, &st) != 0 || !S_ISREG(st.st_mode)) return;
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", md->fd);
+    ssize_t n = readlink(link, path, sizeof(path) - 1);
+    if (n <= 0) return;
+    path[n] = '\0';
+    if (md->mask & (FAN_OPEN | FAN_OPEN_EXEC)) {
+        FileSlot* fs = file_slot(pid, st.st_dev, st.st_ino);
+        fs->last_pos = 0;
+        fs->app_fd = -1;
+        fs->whole_done = 0;
+        emit(pid, OP_OPEN, path, -1, 0, 0);
+        opens++;
+    }
+    if (md->mask & FAN_ACCESS) handle_access(pid, &st, path);
+}
+
+// 读取并处理一批事件；队列为空返回 0
+static int drain_events(void) {
+    char buf[65536] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    ssize_t len = read(fan_fd, buf, sizeof(buf));
+    if (len <= 0) return 0;
+    struct fanotify_event_metadata* md = (struct fanotify_event_metadata*)buf;
+    for (; FAN_EVENT_OK(md, len); md = FAN_EVENT_NEXT(md, len)) {
+        if (md->vers != FANOTIFY_METADATA_VERSION) break;
+        handle_event(md);
+        if (md->fd >= 0) close(md->fd);
+    }
+    return 1;
+}
+
+static void* reader_thread_func(void* arg) {
+    (void)arg;
+    struct pollfd pfd = { .fd = fan_fd, .events = POLLIN };
+    while (reader_running) {
+        if (poll(&pfd, 1, 100) > 0) while (drain_events()) {}
+    }
+    return NULL;
+}
+
+// 标记 path 所在文件系统；内核不支持 FAN_MARK_FILESYSTEM（< 4.20）时退回挂载点
+static int mark_path(const char* path) {
+    uint64_t mask = FAN_OPEN | FAN_ACCESS;
+#ifdef FAN_OPEN_EXEC
+    mask |= FAN_OPEN_EXEC;
+#endif
+    if (fanotify_mark(fan_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, mask, AT_FDCWD, path) == 0) return 0;
+    if (errno == EINVAL && fanotify_mark(fan_fd, FAN_MARK_ADD | FAN_MARK_MOUNT, mask, AT_FDCWD, path) == 0) return 0;
+    fprintf(stderr, "[ProcMonitor] Warning: fanotify_mark(%s) failed: %s\n", path, strerror(errno));
+    return -1;
+}
+
+int fanotify_start(pid_t pid) {
+    root_pid = pid;
+    fan_fd = fanotify_init(FAN_CLOEXEC | FAN_NONBLOCK | FAN_CLASS_NOTIF, O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (fan_fd < 0) {
+        fprintf(stderr, "[ProcMonitor] Warning: fanotify_init failed: %s\n", strerror(errno));
+        return -1;
+    }
+    int marked = 0;
+    const char* paths = getenv("IFETCHER_FANOTIFY_PATHS");
+    char list[1024];
+    snprintf(list, sizeof(list), "%s", (paths && *paths) ? paths : "/");
+    char* save = NULL;
+    for (char* p = strtok_r(list, ":", &save); p; p = strtok_r(NULL, ":", &save))
+        if (mark_path(p) == 0) marked++;
+    char cwd_link[64], cwd[1024];
+    snprintf(cwd_link, sizeof(cwd_link), "/proc/%d/cwd", pid);
+    ssize_t n = readlink(cwd_link, cwd, sizeof(cwd) - 1);
+    if (n > 0) { cwd[n] = '\0'; if (mark_path(cwd) == 0) marked++; }
+    if (!marked) { close(fan_fd); fan_fd = -1; return -1; }
+
+    profiler_log_init();
+    reader_running = 1;
+    if (pthread_create(&reader_thread, NULL, reader_thread_func, NULL) != 0) {
+        reader_running = 0;
+        close(fan_fd);
+        fan_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void fanotify_stop(void) {
+    if (!reader_running) return;
+    reader_running = 0;
+    pthread_join(reader_thread, NULL);
+    while (drain_events()) {}
+    close(fan_fd);
+    fan_fd = -1;
+    if (verbose())
+        printf("Fanotify capture: %llu opens, %llu read ranges, %llu overflows\n", opens, reads, overflows);
+}
@@ -0,0 +1,28 @@
+#ifndef FANOTIFY_MONITOR_H
+#define FANOTIFY_MONITOR_H
+#include <sys/types.h>
+
+// fanotify 全局采集：在文件系统（或挂载点）上监听 FAN_OPEN|FAN_OPEN_EXEC|FAN_ACCESS，
+// 只保留目标进程树内的事件，写入与 libwrapper 相同的 read_log（OPEN/READ）。
+// 不依赖 LD_PRELOAD，可覆盖静态链接、setuid、直接发系统调用或清空环境变量的子进程。
+//
+// fanotify 不提供读偏移：READ 事件的区间由 /proc/<pid>/fdinfo 中的文件位置增量推得
+// （连续读会被内核合并为一个事件，恰好对应一段区间）；位置未变化（pread/mmap）或
+// 找不到对应 fd 时按整文件记录一次。
+//
+// 环境变量：
+//   IFETCHER_FANOTIFY=1                  启用（--spawn 时不再预加载 libwrapper.so）
+//   IFETCHER_FANOTIFY_PATHS              要标记的路径，冒号分隔，默认 "/"；目标的 cwd 总会加入
+//
+// 需要 CAP_SYS_ADMIN。
+
+// 是否通过环境变量启用
+int fanotify_enabled(void);
+
+// 初始化 fanotify 并启动读取线程；pid 为进程树的根。成功返回 0
+int fanotify_start(pid_t pid);
+
+// 停止读取线程，处理队列中剩余事件并释放资源
+void fanotify_stop(void);
+
+#endif // FANOTIFY_MONITOR_H
@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include "fd_table.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <sched.h>
+
+// 表按块懒分配：每块 FD_CHUNK 项，最多 FD_CHUNKS 块（覆盖 fd < 1M）
+#define FD_CHUNK  1024
+#define FD_CHUNKS 1024
+#define FD_PATH_MAX 256
+
+// 偏移的获取方式
+enum {
+    FD_EMPTY = 0,   // 未登记
+    FD_TRACK,       // 影子位置：只读打开的普通文件，读热路径零系统调用
+    FD_SEEK,        // 可写/追加打开或 dup 共享位置：每次读 lseek 一次（路径仍走缓存）
+    FD_STREAM       // 不可 seek（管道/套接字/字符设备）：偏移恒为 0
+};
+
+// 单项：路径/状态由持锁的写者修改，读者用 seq 做 seqlock 校验；pos 独立原子更新
+typedef struct {
+    atomic_uint seq;            // 偶数=稳定，奇数=写入中
+    atomic_int state;
+    atomic_llong pos;
+    char path[FD_PATH_MAX];
+} FdEntry;
+
+static _Atomic(FdEntry*) chunks[FD_CHUNKS];
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void entry_write(FdEntry* e, int state, const char* path, long long pos);
+
+// fork 之后父子进程共享全部打开文件描述，任一方的读都会移动对方的文件位置：
+// 两侧都把影子位置跟踪的 fd 降为每次读 lseek。调用方持有 table_mutex（子进程中只有一个线程）
+static void demote_tracked(void) {
+    for (int k = 0; k < FD_CHUNKS; k++) {
+        FdEntry* c = atomic_load_explicit(&chunks[k], memory_order_acquire);
+        if (!c) continue;
+        for (int i = 0; i < FD_CHUNK; i++)
+            if (atomic_load_explicit(&c[i].state, memory_order_relaxed) == FD_TRACK) entry_write(&c[i], FD_SEEK, NULL, 0);
+    }
+}
+static void atfork_prepare(void) { pthread_mutex_lock(&table_mutex); }
+static void atfork_parent(void) { demote_tracked(); pthread_mutex_unlock(&table_mutex); }
+static void atfork_child(void) { pthread_mutex_init(&table_mutex, NULL); demote_tracked(); }
+static void register_atfork(void) { pthread_atfork(atfork_prepare, atfork_parent, atfork_child); }
+
+static FdEntry* get_entry(int fd, int create) {
+    if (fd < 0 || fd >= FD_CHUNK * FD_CHUNKS) return NULL;
+    _Atomic(FdEntry*)* slot = &chunks[fd / FD_CHUNK];
+    FdEntry* c = atomic_load_explicit(slot, memory_order_acquire);
+    if (!c && create) {
+        FdEntry* fresh = (FdEntry*)calloc(FD_CHUNK, sizeof(FdEntry));
+        if (!fresh) return NULL;
+        if (atomic_compare_exchange_strong(slot, &c, fresh)) c = fresh;
+        else free(fresh);   // 其它线程已分配
+    }
+    return c ? &c[fd % FD_CHUNK] : NULL;
+}
+
+// 写者：调用方持有 table_mutex
+static void entry_write(FdEntry* e, int state, const char* path, long long pos) {
+    atomic_fetch_add_explicit(&e->seq, 1, memory_order_acq_rel);
+    if (path) snprintf(e->path, sizeof(e->path), "%s", path);
+    atomic_store_explicit(&e->pos, pos, memory_order_relaxed);
+    atomic_store_explicit(&e->state, state, memory_order_relaxed);
+    atomic_fetch_add_explicit(&e->seq, 1, memory_order_release);
+}
+
+// 按打开标志决定偏移跟踪方式：写入会移动文件位置而写调用不经过这里，故只跟踪只读打开
+static int state_for_flags(int flags) {
+    if ((flags & O_ACCMODE) != O_RDONLY || (flags & O_APPEND)) return FD_SEEK;
+    return FD_TRACK;
+}
+
+void fd_table_open(int fd, const char* path, int flags) {
+    pthread_once(&atfork_once, register_atfork);
+    FdEntry* e = get_entry(fd, 1);
+    if (!e) return;
+    // 规范化路径（与 /proc/<pid>/maps 一致）；失败时退回调用参数
+    const char* resolved = get_filename_from_fd(fd);
+    if (!resolved || resolved[0] != '/') resolved = path ? path : resolved;
+    pthread_mutex_lock(&table_mutex);
+    entry_write(e, state_for_flags(flags), resolved, 0);
+    pthread_mutex_unlock(&table_mutex);
+}
+
+void fd_table_close(int fd) {
+    FdEntry* e = get_entry(fd, 0);
+    if (!e || atomic_load_explicit(&e->state, memory_order_relaxed) == FD_EMPTY) return;
+    pthread_mutex_lock(&table_mutex);
+    entry_write(e, FD_EMPTY, NULL, 0);
+    pthread_mutex_unlock(&table_mutex);
+}
+
+void fd_table_dup(int oldfd, int newfd) {
+    if (oldfd == newfd) return;
+    FdEntry* o = get_entry(oldfd, 0);
+    FdEntry* n = get_entry(newfd, 1);
+    if (!n) return;
+    pthread_mutex_lock(&table_mutex);
+    int st = o ? atomic_load_explicit(&o->state, memory_order_relaxed) : FD_EMPTY;
+    if (st == FD_EMPTY) {
+        // 源 fd 未登记：新 fd 留待首次读时解析
+        entry_write(n, FD_EMPTY, NULL, 0);
+    } else {
+        int shared = (st == FD_STREAM) ? FD_STREAM : FD_SEEK;
+        entry_write(n, shared, o->path, 0);
+        if (st != shared) entry_write(o, shared, NULL, 0);
+    }
+    pthread_mutex_unlock(&table_mutex);
+}
+
+void fd_table_seek(int fd, off_t pos) {
+    FdEntry* e = get_entry(fd, 0);
+    if (e) atomic_store_explicit(&e->pos, (long long)pos, memory_order_relaxed);
+}
+
+void fd_table_advance(int fd, ssize_t n) {
+    if (n <= 0) return;
+    FdEntry* e = get_entry(fd, 0);
+    if (e) atomic_fetch_add_explicit(&e->pos, (long long)n, memory_order_relaxed);
+}
+
+// 登记一个未经 open 拦截的 fd：一次 fcntl + lseek 确定跟踪方式与当前位置。
+// fd 无效时不登记，返回 0
+static int adopt(FdEntry* e, int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) return 0;
+    const char* path = get_filename_from_fd(fd);
+    off_t cur = lseek(fd, 0, SEEK_CUR);
+    int st = (cur < 0) ? FD_STREAM : state_for_flags(flags);
+    pthread_mutex_lock(&table_mutex);
+    if (atomic_load_explicit(&e->state, memory_order_relaxed) == FD_EMPTY)
+        entry_write(e, st, path, cur < 0 ? 0 : (long long)cur);
+    pthread_mutex_unlock(&table_mutex);
+    return 1;
+}
+
+int fd_table_lookup(int fd, char* path, size_t n, off_t* pos) {
+    pthread_once(&atfork_once, register_atfork);
+    FdEntry* e = get_entry(fd, 1);
+    if (!e) return -1;
+    if (atomic_load_explicit(&e->state, memory_order_acquire) == FD_EMPTY && !adopt(e, fd)) return -1;
+    int st;
+    for (;;) {
+        unsigned s1 = atomic_load_explicit(&e->seq, memory_order_acquire);
+        if (s1 & 1) { sched_yield(); continue; }
+        st = atomic_load_explicit(&e->state, memory_order_relaxed);
+        if (n) snprintf(path, n, "%s", e->path);
+        if (pos) *pos = (off_t)atomic_load_explicit(&e->pos, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&e->seq, memory_order_relaxed) == s1) break;
+    }
+    if (st == FD_EMPTY) return -1;     // 读取期间被并发关闭
+    if (!pos) return 0;
+    if (st == FD_STREAM) *pos = 0;
+    else if (st == FD_SEEK) {
+        off_t cur = lseek(fd, 0, SEEK_CUR);
+        *pos = cur < 0 ? 0 : cur;
+    }
+    return 0;
+}
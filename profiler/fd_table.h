@@ -0,0 +1,29 @@
+#ifndef FD_TABLE_H
+#define FD_TABLE_H
+#include <sys/types.h>
+
+// 进程内影子 fd 表：由 open/dup/close 等拦截函数维护，
+// 读热路径直接取路径与文件位置，不再每次 lseek + readlink。
+
+// 登记新打开的 fd（路径在此解析一次）；flags 为打开标志，决定能否只靠影子位置跟踪偏移
+void fd_table_open(int fd, const char* path, int flags);
+
+// fd 即将关闭
+void fd_table_close(int fd);
+
+// dup/dup2/dup3/fcntl(F_DUPFD*)：newfd 与 oldfd 共享文件位置，两者改为每次读时 lseek 取偏移。
+// fork 后父子进程共享全部文件描述，两侧的影子位置跟踪同样降为 lseek（pthread_atfork）
+void fd_table_dup(int oldfd, int newfd);
+
+// lseek 成功后同步影子位置
+void fd_table_seek(int fd, off_t pos);
+
+// 读成功 n 字节后推进影子位置（原子加，不加锁）
+void fd_table_advance(int fd, ssize_t n);
+
+// 取 fd 的路径与当前偏移（pos 为 NULL 时不取偏移）。
+// 未登记的 fd（继承自父进程、经未拦截路径创建）在此解析一次并登记。
+// 返回 0 成功；fd 无效或超出表范围时返回 -1，调用方回退到 get_filename_from_fd。
+int fd_table_lookup(int fd, char* path, size_t n, off_t* pos);
+
+#endif // FD_TABLE_H
@@ -0,0 +1,331 @@
+// eBPF 采集程序（libbpf CO-RE），由 bpf_monitor.c 经 skeleton 加载。
+// 构建：make bpf（需要 clang、bpftool 与 libbpf 开发文件），见 bpf_monitor.h。
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+#include <bpf/bpf_core_read.h>
+#include "bpf_events.h"
+
+#define S_IFMT  00170000
+#define S_IFREG 0100000
+
+char LICENSE[] SEC("license") = "GPL";
+
+// 加载前由用户态设置
+const volatile int filter_cgroup = 0;       // 1：按 cgroups[0] 及其子 cgroup 过滤；0：按 tracked 进程表过滤
+const volatile int trace_syscalls = 1;      // 0：不挂 read/openat 系统调用（只看页缓存与块层）
+
+// 进程树：tgid -> 1；根进程由用户态写入，之后由 fork/exit 跟踪维护
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 16384);
+    __type(key, __u32);
+    __type(value, __u8);
+} tracked SEC(".maps");
+
+struct {
+    __uint(type, BPF_MAP_TYPE_CGROUP_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u32);
+} cgroups SEC(".maps");
+
+// 大小由用户态按 IFETCHER_BPF_RING_KB 设置
+struct {
+    __uint(type, BPF_MAP_TYPE_RINGBUF);
+    __uint(max_entries, 16 << 20);
+} events SEC(".maps");
+
+// 进行中的读系统调用（tid -> 入口时的文件与位置）
+struct pending_read {
+    __u64 ts_ns, ino, pos, req;
+    __u32 dev;
+    __s32 fd;
+    __u32 sys;
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 16384);
+    __type(key, __u32);
+    __type(value, struct pending_read);
+} reads SEC(".maps");
+
+// 进行中的 openat（tid -> 用户态路径指针）
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 16384);
+    __type(key, __u32);
+    __type(value, __u64);
+} opens SEC(".maps");
+
+// 已下发的块读请求：(dev, sector) -> 下发时刻与发起线程
+struct rq_key {
+    __u32 dev;
+    __u32 pad;
+    __u64 sector;
+};
+
+struct rq_val {
+    __u64 ts_ns;
+    __u32 tgid, tid;
+};
+
+struct {
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, 16384);
+    __type(key, struct rq_key);
+    __type(value, struct rq_val);
+} inflight SEC(".maps");
+
+__u64 dropped = 0;      // 环满丢弃的事件数
+
+static __always_inline int tracked_task(void) {
+    if (filter_cgroup) return bpf_current_task_under_cgroup(&cgroups, 0) == 1;
+    __u32 tgid = bpf_get_current_pid_tgid() >> 32;
+    return bpf_map_lookup_elem(&tracked, &tgid) != NULL;
+}
+
+static __always_inline struct ifb_event* reserve(__u64 size, __u16 kind) {
+    struct ifb_event* e = bpf_ringbuf_reserve(&events, size, 0);
+    if (!e) { __sync_fetch_and_add(&dropped, 1); return NULL; }
+    __u64 id = bpf_get_current_pid_tgid();
+    __builtin_memset(e, 0, sizeof(*e));
+    e->ts_ns = bpf_ktime_get_ns();
+    e->tgid = id >> 32;
+    e->tid = (__u32)id;
+    e->kind = kind;
+    return e;
+}
+
+/* ---------------- 进程树 ---------------- */
+
+SEC("tp_btf/sched_process_fork")
+int BPF_PROG(on_task_fork, struct task_struct* parent, struct task_struct* child) {
+    if (filter_cgroup) return 0;
+    __u32 ptgid = BPF_CORE_READ(parent, tgid);
+    __u32 ctgid = BPF_CORE_READ(child, tgid);
+    // 新线程与父进程同 tgid，无需登记
+    if (ctgid == ptgid || !bpf_map_lookup_elem(&tracked, &ptgid)) return 0;
+    __u8 one = 1;
+    bpf_map_update_elem(&tracked, &ctgid, &one, BPF_ANY);
+    return 0;
+}
+
+SEC("tp_btf/sched_process_exit")
+int BPF_PROG(on_task_exit, struct task_struct* p) {
+    __u32 tid = BPF_CORE_READ(p, pid);
+    bpf_map_delete_elem(&reads, &tid);
+    bpf_map_delete_elem(&opens, &tid);
+    // 整个线程组退出（signal->live 在此之前已减为 0）时移出进程树
+    if (!filter_cgroup && BPF_CORE_READ(p, signal, live.counter) == 0) {
+        __u32 tgid = BPF_CORE_READ(p, tgid);
+        bpf_map_delete_elem(&tracked, &tgid);
+    }
+    return 0;
+}
+
+/* ---------------- 页缓存 ---------------- */
+
+SEC("tp/filemap/mm_filemap_add_to_page_cache")
+int on_add_to_page_cache(struct trace_event_raw_mm_filemap_op_page_cache* ctx) {
+    if (!tracked_task()) return 0;
+    struct ifb_event* e = reserve(sizeof(*e), IFB_CACHE);
+    if (!e) return 0;
+    e->ino = ctx->i_ino;
+    e->index = ctx->index;
+    e->dev = ctx->s_dev;
+    e->size = 1;
+    // 大 folio（6.x 起 tracepoint 带 order）
+    if (bpf_core_field_exists(ctx->order)) e->size = 1ULL << BPF_CORE_READ(ctx, order);
+    bpf_ringbuf_submit(e, 0);
+    return 0;
+}
+
+/* ---------------- 块层 ---------------- */
+
+static __always_inline int rwbs_is_read(const char* rwbs) {
+    for (int i = 0; i < 4; i++) {
+        if (rwbs[i] == 'R') return 1;
+        if (rwbs[i] == 0) break;
+    }
+    return 0;
+}
+
+SEC("tp/block/block_rq_issue")
+int on_rq_issue(struct trace_event_raw_block_rq* ctx) {
+    char rwbs[8];
+    // 只有在发起进程上下文中下发（plug 刷出）的请求可以归属；由 kworker 下发的不计
+    if (!tracked_task()) return 0;
+    bpf_probe_read_kernel(rwbs, sizeof(rwbs), ctx->rwbs);
+    if (!rwbs_is_read(rwbs)) return 0;
+    struct rq_key k = { .dev = ctx->dev, .pad = 0, .sector = ctx->sector };
+    __u64 id = bpf_get_current_pid_tgid();
+    struct rq_val v = { .ts_ns = bpf_ktime_get_ns(), .tgid = id >> 32, .tid = (__u32)id };
+    bpf_map_update_elem(&inflight, &k, &v, BPF_ANY);
+    return 0;
+}
+
+SEC("tp/block/block_rq_complete")
+int on_rq_complete(struct trace_event_raw_block_rq_completion* ctx) {
+    struct rq_key k = { .dev = ctx->dev, .pad = 0, .sector = ctx->sector };
+    struct rq_val* v = bpf_map_lookup_elem(&inflight, &k);
+    if (!v) return 0;
+    struct ifb_event* e = bpf_ringbuf_reserve(&events, sizeof(*e), 0);
+    if (e) {
+        __builtin_memset(e, 0, sizeof(*e));
+        e->kind = IFB_BLOCK;
+        e->ts_ns = v->ts_ns;
+        e->tgid = v->tgid;
+        e->tid = v->tid;
+        e->dev = k.dev;
+        e->index = k.sector;
+        e->size = ctx->nr_sector;
+        e->lat_ns = bpf_ktime_get_ns() - v->ts_ns;
+        bpf_ringbuf_submit(e, 0);
+    } else {
+        __sync_fetch_and_add(&dropped, 1);
+    }
+    bpf_map_delete_elem(&inflight, &k);
+    return 0;
+}
+
+/* ---------------- 读系统调用 ---------------- */
+
+static __always_inline struct file* fd_file(int fd) {
+    struct task_struct* task = (struct task_struct*)bpf_get_current_task();
+    struct fdtable* fdt = BPF_CORE_READ(task, files, fdt);
+    struct file** fds;
+    struct file* f = NULL;
+    if (!fdt || fd < 0 || (unsigned)fd >= BPF_CORE_READ(fdt, max_fds)) return NULL;
+    fds = BPF_CORE_READ(fdt, fd);
+    bpf_probe_read_kernel(&f, sizeof(f), &fds[fd]);
+    return f;
+}
+
+// 入口：只登记普通文件；pos < 0 表示取文件当前位置（read/readv/preadv2 的 -1）
+static __always_inline int read_enter(int fd, __u64 req, __s64 pos, __u32 sys) {
+    if (!trace_syscalls || !tracked_task()) return 0;
+    struct file* f = fd_file(fd);
+    if (!f) return 0;
+    struct inode* inode = BPF_CORE_READ(f, f_inode);
+    if ((BPF_CORE_READ(inode, i_mode) & S_IFMT) != S_IFREG) return 0;
+    struct pending_read r = {
+        .ts_ns = bpf_ktime_get_ns(),
+        .ino = BPF_CORE_READ(inode, i_ino),
+        .pos = pos < 0 ? (__u64)BPF_CORE_READ(f, f_pos) : (__u64)pos,
+        .req = req,
+        .dev = BPF_CORE_READ(inode, i_sb, s_dev),
+        .fd = fd,
+        .sys = sys
+    };
+    __u32 tid = (__u32)bpf_get_current_pid_tgid();
+    bpf_map_update_elem(&reads, &tid, &r, BPF_ANY);
+    return 0;
+}
+
+static __always_inline int read_exit(long ret) {
+    __u32 tid = (__u32)bpf_get_current_pid_tgid();
+    struct pending_read* r = bpf_map_lookup_elem(&reads, &tid);
+    if (!r) return 0;
+    if (ret > 0) {
+        struct ifb_event* e = reserve(sizeof(*e), IFB_READ);
+        if (e) {
+            e->ts_ns = r->ts_ns;
+            e->ino = r->ino;
+            e->dev = r->dev;
+            e->index = r->pos;
+            e->size = (__u64)ret;
+            e->req = r->req;
+            e->lat_ns = bpf_ktime_get_ns() - r->ts_ns;
+            e->fd = r->fd;
+            e->sys = (__u16)r->sys;
+            bpf_ringbuf_submit(e, 0);
+        }
+    }
+    bpf_map_delete_elem(&reads, &tid);
+    return 0;
+}
+
+SEC("tp/syscalls/sys_enter_read")
+int on_read_enter(struct trace_event_raw_sys_enter* ctx) {
+    return read_enter((int)ctx->args[0], ctx->args[2], -1, IFB_SYS_READ);
+}
+
+SEC("tp/syscalls/sys_enter_pread64")
+int on_pread_enter(struct trace_event_raw_sys_enter* ctx) {
+    return read_enter((int)ctx->args[0], ctx->args[2], (__s64)ctx->args[3], IFB_SYS_PREAD);
+}
+
+// 向量读的请求长度需要读用户态 iovec，这里记 0（用户态以返回长度代替）
+SEC("tp/syscalls/sys_enter_readv")
+int on_readv_enter(struct trace_event_raw_sys_enter* ctx) {
+    return read_enter((int)ctx->args[0], 0, -1, IFB_SYS_READV);
+}
+
+SEC("tp/syscalls/sys_enter_preadv")
+int on_preadv_enter(struct trace_event_raw_sys_enter* ctx) {
+    return read_enter((int)ctx->args[0], 0, (__s64)ctx->args[3], IFB_SYS_PREADV);
+}
+
+SEC("tp/syscalls/sys_enter_preadv2")
+int on_preadv2_enter(struct trace_event_raw_sys_enter* ctx) {
+    return read_enter((int)ctx->args[0], 0, (__s64)ctx->args[3], IFB_SYS_PREADV);
+}
+
+SEC("tp/syscalls/sys_exit_read")
+int on_read_exit(struct trace_event_raw_sys_exit* ctx) { return read_exit(ctx->ret); }
+
+SEC("tp/syscalls/sys_exit_pread64")
+int on_pread_exit(struct trace_event_raw_sys_exit* ctx) { return read_exit(ctx->ret); }
+
+SEC("tp/syscalls/sys_exit_readv")
+int on_readv_exit(struct trace_event_raw_sys_exit* ctx) { return read_exit(ctx->ret); }
+
+SEC("tp/syscalls/sys_exit_preadv")
+int on_preadv_exit(struct trace_event_raw_sys_exit* ctx) { return read_exit(ctx->ret); }
+
+SEC("tp/syscalls/sys_exit_preadv2")
+int on_preadv2_exit(struct trace_event_raw_sys_exit* ctx) { return read_exit(ctx->ret); }
+
+/* ---------------- openat：为 (dev, ino) 提供路径 ---------------- */
+
+static __always_inline int open_enter(__u64 filename) {
+    if (!trace_syscalls || !tracked_task()) return 0;
+    __u32 tid = (__u32)bpf_get_current_pid_tgid();
+    bpf_map_update_elem(&opens, &tid, &filename, BPF_ANY);
+    return 0;
+}
+
+static __always_inline int open_exit(long ret) {
+    __u32 tid = (__u32)bpf_get_current_pid_tgid();
+    __u64* name = bpf_map_lookup_elem(&opens, &tid);
+    if (!name) return 0;
+    __u64 uptr = *name;
+    bpf_map_delete_elem(&opens, &tid);
+    if (ret < 0) return 0;
+    struct file* f = fd_file((int)ret);
+    if (!f) return 0;
+    struct inode* inode = BPF_CORE_READ(f, f_inode);
+    if ((BPF_CORE_READ(inode, i_mode) & S_IFMT) != S_IFREG) return 0;
+    struct ifb_open_event* o = (struct ifb_open_event*)reserve(sizeof(*o), IFB_OPEN);
+    if (!o) return 0;
+    o->e.ino = BPF_CORE_READ(inode, i_ino);
+    o->e.dev = BPF_CORE_READ(inode, i_sb, s_dev);
+    o->e.fd = (int)ret;
+    if (bpf_probe_read_user_str(o->path, sizeof(o->path), (const void*)uptr) < 0) o->path[0] = 0;
+    bpf_ringbuf_submit(o, 0);
+    return 0;
+}
+
+SEC("tp/syscalls/sys_enter_openat")
+int on_openat_enter(struct trace_event_raw_sys_enter* ctx) { return open_enter(ctx->args[1]); }
+
+SEC("tp/syscalls/sys_exit_openat")
+int on_openat_exit(struct trace_event_raw_sys_exit* ctx) { return open_exit(ctx->ret); }
+
+SEC("tp/syscalls/sys_enter_openat2")
+int on_openat2_enter(struct trace_event_raw_sys_enter* ctx) { return open_enter(ctx->args[1]); }
+
+SEC("tp/syscalls/sys_exit_openat2")
+int on_openat2_exit(struct trace_event_raw_sys_exit* ctx) { return open_exit(ctx->ret); }
@@ -3,21 +3,128 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <errno.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include "profiler_common.h"
+#include "fd_table.h"
+#include "map_table.h"
+#include "read_filter.h"
+#include "control_block.h"
 
-// 函数指针：指向 libc 原始的 read() 和 fread()
+// 函数指针：指向 libc 原始的读/打开类函数
 typedef ssize_t (*read_func_t)(int fd, void* buf, size_t count);
 typedef size_t (*fread_func_t)(void* ptr, size_t size, size_t nmemb, FILE* stream);
+typedef ssize_t (*pread_func_t)(int fd, void* buf, size_t count, off_t offset);
+typedef ssize_t (*readv_func_t)(int fd, const struct iovec* iov, int iovcnt);
+typedef ssize_t (*preadv_func_t)(int fd, const struct iovec* iov, int iovcnt, off_t offset);
+typedef ssize_t (*preadv2_func_t)(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags);
+typedef ssize_t (*sendfile_func_t)(int out_fd, int in_fd, off_t* offset, size_t count);
+typedef ssize_t (*copy_file_range_func_t)(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags);
+typedef int (*open_func_t)(const char* path, int flags, ...);
+typedef int (*openat_func_t)(int dirfd, const char* path, int flags, ...);
+typedef int (*open_2_func_t)(const char* path, int flags);
+typedef FILE* (*fopen_func_t)(const char* path, const char* mode);
+typedef ssize_t (*read_chk_func_t)(int fd, void* buf, size_t count, size_t buflen);
+typedef ssize_t (*pread_chk_func_t)(int fd, void* buf, size_t count, off_t offset, size_t buflen);
+typedef size_t (*fread_chk_func_t)(void* ptr, size_t ptrlen, size_t size, size_t nmemb, FILE* stream);
+typedef int (*close_func_t)(int fd);
+typedef int (*fclose_func_t)(FILE* stream);
+typedef int (*dup_func_t)(int oldfd);
+typedef int (*dup2_func_t)(int oldfd, int newfd);
+typedef int (*dup3_func_t)(int oldfd, int newfd, int flags);
+typedef int (*fcntl_func_t)(int fd, int cmd, ...);
+typedef off_t (*lseek_func_t)(int fd, off_t offset, int whence);
+typedef int (*execve_func_t)(const char* path, char* const argv[], char* const envp[]);
+typedef int (*execvp_func_t)(const char* file, char* const argv[]);
+typedef int (*execvpe_func_t)(const char* file, char* const argv[], char* const envp[]);
+typedef void (*exit_func_t)(int status);
 
 static read_func_t original_read = NULL;
 static fread_func_t original_fread = NULL;
+static pread_func_t original_pread = NULL;
+static pread_func_t original_pread64 = NULL;
+static readv_func_t original_readv = NULL;
+static preadv_func_t original_preadv = NULL;
+static preadv_func_t original_preadv64 = NULL;
+static preadv2_func_t original_preadv2 = NULL;
+static preadv2_func_t original_preadv64v2 = NULL;
+static sendfile_func_t original_sendfile = NULL;
+static sendfile_func_t original_sendfile64 = NULL;
+static copy_file_range_func_t original_copy_file_range = NULL;
+static open_func_t original_open = NULL;
+static open_func_t original_open64 = NULL;
+static openat_func_t original_openat = NULL;
+static openat_func_t original_openat64 = NULL;
+static open_2_func_t original___open_2 = NULL;
+static open_2_func_t original___open64_2 = NULL;
+static fopen_func_t original_fopen = NULL;
+static fopen_func_t original_fopen64 = NULL;
+static read_chk_func_t original___read_chk = NULL;
+static pread_chk_func_t original___pread_chk = NULL;
+static pread_chk_func_t original___pread64_chk = NULL;
+static fread_chk_func_t original___fread_chk = NULL;
+static close_func_t original_close = NULL;
+static fclose_func_t original_fclose = NULL;
+static dup_func_t original_dup = NULL;
+static dup2_func_t original_dup2 = NULL;
+static dup3_func_t original_dup3 = NULL;
+static fcntl_func_t original_fcntl = NULL;
+static fcntl_func_t original_fcntl64 = NULL;
+static lseek_func_t original_lseek = NULL;
+static lseek_func_t original_lseek64 = NULL;
+static execve_func_t original_execve = NULL;
+static execvp_func_t original_execv = NULL;
+static execvp_func_t original_execvp = NULL;
+static execvpe_func_t original_execvpe = NULL;
+static exit_func_t original__exit = NULL;
 static pthread_once_t init_once = PTHREAD_ONCE_INIT;
 static const char* gate_file = NULL;
 static int gate_on = 0;
+static int init_done = 0;
+static IfetcherControl* ctl = NULL;     // proc_monitor 的共享控制块（IFETCHER_CONTROL）
+static uint32_t ctl_generation = 0;     // 已加载的控制块设置版本
+static unsigned sample_rate = 1;        // 每 sample_rate 次读记录 1 次
+
+// 线程内重入标记：init 与日志路径内部触发的打开/读取直接透传，避免递归进入 pthread_once
+static __thread int in_wrapper = 0;
+static __thread unsigned sample_tick = 0;
+
+// 取原始函数；init 尚未完成（重入路径）时按需解析
+static void* resolve(void** slot, const char* name) {
+    if (*slot == NULL) *slot = dlsym(RTLD_NEXT, name);
+    return *slot;
+}
+#define REAL(name, type) ((type)resolve((void**)&original_##name, #name))
+
+// 发出读过滤中全部待发区间（exec/_exit/退出前，随后的 profiler_log_flush 才能写出它们）
+static void flush_pending_all(void) {
+    if (in_wrapper) return;
+    in_wrapper = 1;
+    read_filter_flush_all();
+    in_wrapper = 0;
+}
+
+// 控制块设置有变化时重新加载（generation 未变时只有一次内存读）
+static void control_sync(void) {
+    uint32_t gen = atomic_load_explicit(&ctl->generation, memory_order_acquire);
+    if (gen == ctl_generation) return;
+    uint32_t flags = atomic_load_explicit(&ctl->filter_flags, memory_order_relaxed);
+    read_filter_configure((flags & CTL_FILTER) != 0, (flags & CTL_DEDUP) != 0,
+                          atomic_load_explicit(&ctl->coalesce_ms, memory_order_relaxed),
+                          atomic_load_explicit(&ctl->coalesce_max_kb, memory_order_relaxed));
+    uint32_t rate = atomic_load_explicit(&ctl->sample_rate, memory_order_relaxed);
+    sample_rate = rate > 1 ? rate : 1;
+    ctl_generation = gen;
+}
 
 // 初始化：获取原始函数地址
 static void init() {
+    in_wrapper = 1;
     // 获取 libc 中的原始 read()
     original_read = (read_func_t)dlsym(RTLD_NEXT, "read");
     if (original_read == NULL) {
@@ -32,95 +139,653 @@ static void init() {
         exit(EXIT_FAILURE);
     }
 
-    // 初始化日志
+    // 其余读/打开入口：个别符号在旧 libc 中可能不存在，调用时再做空检查
+    (void)REAL(pread, pread_func_t);
+    (void)REAL(pread64, pread_func_t);
+    (void)REAL(readv, readv_func_t);
+    (void)REAL(preadv, preadv_func_t);
+    (void)REAL(preadv64, preadv_func_t);
+    (void)REAL(preadv2, preadv2_func_t);
+    (void)REAL(preadv64v2, preadv2_func_t);
+    (void)REAL(sendfile, sendfile_func_t);
+    (void)REAL(sendfile64, sendfile_func_t);
+    (void)REAL(copy_file_range, copy_file_range_func_t);
+    (void)REAL(open, open_func_t);
+    (void)REAL(open64, open_func_t);
+    (void)REAL(openat, openat_func_t);
+    (void)REAL(openat64, openat_func_t);
+    (void)REAL(__open_2, open_2_func_t);
+    (void)REAL(__open64_2, open_2_func_t);
+    (void)REAL(fopen, fopen_func_t);
+    (void)REAL(fopen64, fopen_func_t);
+    (void)REAL(__read_chk, read_chk_func_t);
+    (void)REAL(__pread_chk, pread_chk_func_t);
+    (void)REAL(__pread64_chk, pread_chk_func_t);
+    (void)REAL(__fread_chk, fread_chk_func_t);
+    (void)REAL(close, close_func_t);
+    (void)REAL(fclose, fclose_func_t);
+    (void)REAL(dup, dup_func_t);
+    (void)REAL(dup2, dup2_func_t);
+    (void)REAL(dup3, dup3_func_t);
+    (void)REAL(fcntl, fcntl_func_t);
+    (void)REAL(fcntl64, fcntl_func_t);
+    (void)REAL(lseek, lseek_func_t);
+    (void)REAL(lseek64, lseek_func_t);
+
+    // exec 系列：替换进程映像前写出缓冲中的事件
+    original_execve = (execve_func_t)dlsym(RTLD_NEXT, "execve");
+    original_execv = (execvp_func_t)dlsym(RTLD_NEXT, "execv");
+    original_execvp = (execvp_func_t)dlsym(RTLD_NEXT, "execvp");
+    original_execvpe = (execvpe_func_t)dlsym(RTLD_NEXT, "execvpe");
+    original__exit = (exit_func_t)dlsym(RTLD_NEXT, "_exit");
+
+    // 初始化日志；正常退出时先发出读过滤中待发的区间（atexit 先于各库的析构函数运行）
     profiler_log_init();
+    read_filter_init();
+    atexit(flush_pending_all);
+    const char* sr = getenv("IFETCHER_SAMPLE_RATE");
+    if (sr && atoi(sr) > 1) sample_rate = (unsigned)atoi(sr);
     gate_file = getenv("IFETCHER_GATE_FILE");
     if (!gate_file) {
         gate_on = 1; // Default to ON if no gate file specified
     }
+    // 有控制块时采集开关与过滤设置以控制块为准
+    const char* cp = getenv("IFETCHER_CONTROL");
+    if (cp && *cp && strcmp(cp, "0") != 0) ctl = control_attach(cp);
+    if (ctl) control_sync();
+    __atomic_store_n(&init_done, 1, __ATOMIC_RELEASE);
+    in_wrapper = 0;
 }
 
 static inline int logging_enabled() {
+    if (ctl) return control_capture_on(ctl);
     if (gate_on) return 1;
     if (gate_file && access(gate_file, F_OK) == 0) { gate_on = 1; }
     return gate_on;
 }
 
-// 拦截 read() 系统调用
-ssize_t read(int fd, void* buf, size_t count) {
+// 进入拦截函数：重入时返回 0，调用方应直接透传
+static inline int wrapper_enter() {
+    if (in_wrapper) return 0;
     pthread_once(&init_once, init);
+    return 1;
+}
 
-    // 获取当前文件偏移量
+static inline off_t current_offset(int fd) {
     off_t offset = lseek(fd, 0, SEEK_CUR);
-    if (offset == -1) {
-        offset = 0; // 无法获取时设为 0
+    return offset == -1 ? 0 : offset;
+}
+
+// 线程本地路径缓冲：fd_lookup 的结果在下一次查询前有效
+static __thread char fd_path[256];
+
+// 从影子 fd 表取路径与偏移（pos 为 NULL 时只取路径）；
+// fd 不在表中时回退到 lseek + readlink
+static const char* fd_lookup(int fd, off_t* pos) {
+    in_wrapper = 1;
+    const char* path = fd_path;
+    if (fd_table_lookup(fd, fd_path, sizeof(fd_path), pos) != 0) {
+        if (pos) *pos = current_offset(fd);
+        path = get_filename_from_fd(fd);
     }
+    in_wrapper = 0;
+    return path;
+}
 
-    // 调用原始 read()
-    ssize_t ret = original_read(fd, buf, count);
+// 记录一次读类操作（调用方已确认日志开启）；保留调用方的 errno。
+// req 为请求长度，t0 为调用开始时刻（作为事件时间），io_ns 为调用耗时
+static void log_read_op(OpType op, int fd, const char* path, off_t offset, size_t req, ssize_t ret,
+                        uint64_t t0, uint64_t io_ns, int err) {
+    if (ctl) control_sync();
+    if (sample_rate > 1 && ++sample_tick % sample_rate != 0) { errno = err; return; }
+    in_wrapper = 1;
+    if (read_filter_enabled()) {
+        read_filter_submit(op, fd, path, offset, req, ret, t0, io_ns);
+        in_wrapper = 0;
+        errno = err;
+        return;
+    }
+    ProfilerLogEntry entry = {
+        .pid = profiler_getpid(),
+        .op_type = op,
+        .filename = path,
+        .offset = offset < 0 ? 0 : offset,
+        .size = ret > 0 ? (size_t)ret : 0,
+        .fd = fd,
+        .ts_ns = t0,
+        .status = (ret < 0) ? 1 : 0,
+        .err_no = (ret < 0) ? err : 0,
+        .req_size = req,
+        .io_ns = io_ns
+    };
+    profiler_log(&entry);
+    in_wrapper = 0;
+    errno = err;
+}
 
-    // 记录日志（仅当读取成功且读取大小 > 0 且已开启网关）
+// 打开成功后登记到影子 fd 表（不受日志网关影响：网关打开前的 fd 也要跟踪位置），
+// 日志开启时再记录：成功时路径取表中的规范路径，失败时取调用参数。
+// 开启读过滤时，失败的打开与非普通文件路径不记录（分析器只用成功打开的 O_DIRECT 标志）
+static void on_open(OpType op, const char* path, int fd, int flags, int table_flags, int err) {
+    in_wrapper = 1;
+    if (fd >= 0) fd_table_open(fd, path, table_flags);
     if (logging_enabled()) {
+        const char* name = path;
+        if (fd >= 0 && fd_table_lookup(fd, fd_path, sizeof(fd_path), NULL) == 0) name = fd_path;
+        if (read_filter_enabled() && (fd < 0 || !read_filter_path_ok(name))) { in_wrapper = 0; errno = err; return; }
         ProfilerLogEntry entry = {
-            .pid = getpid(),
-            .op_type = OP_READ,
-            .filename = get_filename_from_fd(fd),
-            .offset = offset,
-            .size = ret>0?ret:0,
+            .pid = profiler_getpid(),
+            .op_type = op,
+            .filename = name,
             .fd = fd,
-            .timestamp = time(NULL),
-            .addr_start = 0,
-            .addr_end = 0,
-            .file_offset = 0,
-            .status = (ret<0)?1:0,
-            .err_no = (ret<0)?errno:0
+            .status = (fd < 0) ? 1 : 0,
+            .err_no = (fd < 0) ? err : 0,
+            .flags = flags
         };
         profiler_log(&entry);
     }
+    in_wrapper = 0;
+    errno = err;
+}
+
+// 向量读的请求长度
+static size_t iov_total(const struct iovec* iov, int iovcnt) {
+    size_t n = 0;
+    for (int i = 0; iov && i < iovcnt; i++) n += iov[i].iov_len;
+    return n;
+}
+
+// 按当前文件位置读的调用（read/readv 等）：偏移取影子位置，成功后推进。
+// 日志开启时用单调时钟（vDSO，无系统调用）夹住原始调用，得到该次读的阻塞时间
+#define POSITIONAL_READ(op, fd, req, call)                                  \
+    do {                                                                    \
+        int logging_ = logging_enabled();                                   \
+        off_t offset_ = 0;                                                  \
+        const char* path_ = logging_ ? fd_lookup(fd, &offset_) : NULL;      \
+        uint64_t t0_ = logging_ ? profiler_now_ns() : 0;                    \
+        ssize_t ret_ = (call);                                              \
+        int err_ = errno;                                                   \
+        uint64_t io_ = logging_ ? profiler_now_ns() - t0_ : 0;              \
+        fd_table_advance(fd, ret_);                                         \
+        if (logging_) log_read_op(op, fd, path_, offset_, (req), ret_, t0_, io_, err_); \
+        errno = err_;                                                       \
+        return ret_;                                                        \
+    } while (0)
+
+// 显式给出偏移的调用（pread 等）：不改变文件位置，只需路径
+#define OFFSET_READ(op, fd, offset, req, call)                              \
+    do {                                                                    \
+        int logging_ = logging_enabled();                                   \
+        uint64_t t0_ = logging_ ? profiler_now_ns() : 0;                    \
+        ssize_t ret_ = (call);                                              \
+        int err_ = errno;                                                   \
+        uint64_t io_ = logging_ ? profiler_now_ns() - t0_ : 0;              \
+        if (logging_)                                                       \
+            log_read_op(op, fd, fd_lookup(fd, NULL), offset, (req), ret_, t0_, io_, err_); \
+        errno = err_;                                                       \
+        return ret_;                                                        \
+    } while (0)
 
+// 拦截 read() 系统调用
+ssize_t read(int fd, void* buf, size_t count) {
+    if (!wrapper_enter()) return REAL(read, read_func_t)(fd, buf, count);
+    POSITIONAL_READ(OP_READ, fd, count, original_read(fd, buf, count));
+}
+
+ssize_t __read_chk(int fd, void* buf, size_t count, size_t buflen) {
+    if (!wrapper_enter() || !original___read_chk) return REAL(__read_chk, read_chk_func_t)(fd, buf, count, buflen);
+    POSITIONAL_READ(OP_READ, fd, count, original___read_chk(fd, buf, count, buflen));
+}
+
+// fread 的偏移取流的逻辑位置（stdio 有用户态缓冲，与 fd 的影子位置不同）；
+// glibc 在流读过一次后缓存底层偏移，此后 ftell 不再发起系统调用
+static size_t log_fread(int fd, FILE* stream, size_t size, size_t nmemb, size_t ret, off_t offset,
+                        uint64_t t0, int err) {
+    uint64_t io_ns = profiler_now_ns() - t0;
+    ssize_t total_size = (ssize_t)(ret * size);
+    if (ret == 0 && ferror(stream)) total_size = -1;
+    log_read_op(OP_FREAD, fd, fd_lookup(fd, NULL), offset, size * nmemb, total_size, t0, io_ns, err);
     return ret;
 }
 
 // 拦截 fread() 库函数
 size_t fread(void* ptr, size_t size, size_t nmemb, FILE* stream) {
-    pthread_once(&init_once, init);
+    if (!wrapper_enter()) return REAL(fread, fread_func_t)(ptr, size, nmemb, stream);
 
-    // 从 FILE* 获取文件描述符
+    // 从 FILE* 获取文件描述符；无法获取或日志未开启时直接调用原始函数
     int fd = fileno(stream);
-    if (fd == -1) {
-        // 无法获取 FD 时直接调用原始函数
+    if (fd == -1 || !logging_enabled()) {
         return original_fread(ptr, size, nmemb, stream);
     }
 
-    // 获取当前文件偏移量
+    // 获取当前流偏移量
     off_t offset = ftell(stream);
     if (offset == -1) {
         offset = 0;
     }
 
-    // 调用原始 fread()
+    // 调用原始 fread()（计时包含 stdio 缓冲命中的情形，此时耗时很小）
+    uint64_t t0 = profiler_now_ns();
     size_t ret = original_fread(ptr, size, nmemb, stream);
-    size_t total_size = ret * size;
+    return log_fread(fd, stream, size, nmemb, ret, offset, t0, errno);
+}
 
-    // 记录日志（仅当读取成功且读取大小 > 0 且已开启网关）
-    if (logging_enabled()) {
-        ProfilerLogEntry entry = {
-            .pid = getpid(),
-            .op_type = OP_FREAD,
-            .filename = get_filename_from_fd(fd),
-            .offset = offset,
-            .size = total_size,
-            .fd = fd,
-            .timestamp = time(NULL),
-            .addr_start = 0,
-            .addr_end = 0,
-            .file_offset = 0,
-            .status = 0,
-            .err_no = 0
-        };
-        if (ret==0 && ferror(stream)) { entry.status=1; entry.err_no=errno; }
-        profiler_log(&entry);
+size_t __fread_chk(void* ptr, size_t ptrlen, size_t size, size_t nmemb, FILE* stream) {
+    if (!wrapper_enter() || !original___fread_chk) return REAL(__fread_chk, fread_chk_func_t)(ptr, ptrlen, size, nmemb, stream);
+    int fd = fileno(stream);
+    if (fd == -1 || !logging_enabled()) return original___fread_chk(ptr, ptrlen, size, nmemb, stream);
+    off_t offset = ftell(stream);
+    if (offset == -1) offset = 0;
+    uint64_t t0 = profiler_now_ns();
+    size_t ret = original___fread_chk(ptr, ptrlen, size, nmemb, stream);
+    return log_fread(fd, stream, size, nmemb, ret, offset, t0, errno);
+}
+
+// 拦截定位读：偏移由参数给出，无需 lseek
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    if (!wrapper_enter()) return REAL(pread, pread_func_t)(fd, buf, count, offset);
+    OFFSET_READ(OP_PREAD, fd, offset, count, original_pread(fd, buf, count, offset));
+}
+
+ssize_t pread64(int fd, void* buf, size_t count, off_t offset) {
+    if (!wrapper_enter()) return REAL(pread64, pread_func_t)(fd, buf, count, offset);
+    OFFSET_READ(OP_PREAD, fd, offset, count, original_pread64(fd, buf, count, offset));
+}
+
+ssize_t __pread_chk(int fd, void* buf, size_t count, off_t offset, size_t buflen) {
+    if (!wrapper_enter() || !original___pread_chk) return REAL(__pread_chk, pread_chk_func_t)(fd, buf, count, offset, buflen);
+    OFFSET_READ(OP_PREAD, fd, offset, count, original___pread_chk(fd, buf, count, offset, buflen));
+}
+
+ssize_t __pread64_chk(int fd, void* buf, size_t count, off_t offset, size_t buflen) {
+    if (!wrapper_enter() || !original___pread64_chk) return REAL(__pread64_chk, pread_chk_func_t)(fd, buf, count, offset, buflen);
+    OFFSET_READ(OP_PREAD, fd, offset, count, original___pread64_chk(fd, buf, count, offset, buflen));
+}
+
+// 拦截向量读
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+    if (!wrapper_enter()) return REAL(readv, readv_func_t)(fd, iov, iovcnt);
+    POSITIONAL_READ(OP_READV, fd, iov_total(iov, iovcnt), original_readv(fd, iov, iovcnt));
+}
+
+ssize_t preadv(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+    if (!wrapper_enter()) return REAL(preadv, preadv_func_t)(fd, iov, iovcnt, offset);
+    OFFSET_READ(OP_PREADV, fd, offset, iov_total(iov, iovcnt), original_preadv(fd, iov, iovcnt, offset));
+}
+
+ssize_t preadv64(int fd, const struct iovec* iov, int iovcnt, off_t offset) {
+    if (!wrapper_enter()) return REAL(preadv64, preadv_func_t)(fd, iov, iovcnt, offset);
+    OFFSET_READ(OP_PREADV, fd, offset, iov_total(iov, iovcnt), original_preadv64(fd, iov, iovcnt, offset));
+}
+
+// preadv2：offset 为 -1 时使用并推进当前文件位置
+ssize_t preadv2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags) {
+    if (!wrapper_enter()) return REAL(preadv2, preadv2_func_t)(fd, iov, iovcnt, offset, flags);
+    if (offset == -1) POSITIONAL_READ(OP_PREADV, fd, iov_total(iov, iovcnt), original_preadv2(fd, iov, iovcnt, offset, flags));
+    OFFSET_READ(OP_PREADV, fd, offset, iov_total(iov, iovcnt), original_preadv2(fd, iov, iovcnt, offset, flags));
+}
+
+ssize_t preadv64v2(int fd, const struct iovec* iov, int iovcnt, off_t offset, int flags) {
+    if (!wrapper_enter()) return REAL(preadv64v2, preadv2_func_t)(fd, iov, iovcnt, offset, flags);
+    if (offset == -1) POSITIONAL_READ(OP_PREADV, fd, iov_total(iov, iovcnt), original_preadv64v2(fd, iov, iovcnt, offset, flags));
+    OFFSET_READ(OP_PREADV, fd, offset, iov_total(iov, iovcnt), original_preadv64v2(fd, iov, iovcnt, offset, flags));
+}
+
+// 拦截 sendfile()/copy_file_range()：记录为对源文件的读取；偏移指针为 NULL 时使用并推进文件位置
+ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    if (!wrapper_enter()) return REAL(sendfile, sendfile_func_t)(out_fd, in_fd, offset, count);
+    if (!offset) POSITIONAL_READ(OP_SENDFILE, in_fd, count, original_sendfile(out_fd, in_fd, offset, count));
+    off_t at = *offset;
+    OFFSET_READ(OP_SENDFILE, in_fd, at, count, original_sendfile(out_fd, in_fd, offset, count));
+}
+
+ssize_t sendfile64(int out_fd, int in_fd, off_t* offset, size_t count) {
+    if (!wrapper_enter()) return REAL(sendfile64, sendfile_func_t)(out_fd, in_fd, offset, count);
+    if (!offset) POSITIONAL_READ(OP_SENDFILE, in_fd, count, original_sendfile64(out_fd, in_fd, offset, count));
+    off_t at = *offset;
+    OFFSET_READ(OP_SENDFILE, in_fd, at, count, original_sendfile64(out_fd, in_fd, offset, count));
+}
+
+ssize_t copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len, unsigned int flags) {
+    if (!wrapper_enter()) return REAL(copy_file_range, copy_file_range_func_t)(fd_in, off_in, fd_out, off_out, len, flags);
+    if (!off_in) POSITIONAL_READ(OP_COPY_RANGE, fd_in, len, original_copy_file_range(fd_in, off_in, fd_out, off_out, len, flags));
+    off_t at = *off_in;
+    OFFSET_READ(OP_COPY_RANGE, fd_in, at, len, original_copy_file_range(fd_in, off_in, fd_out, off_out, len, flags));
+}
+
+// 拦截打开类调用：登记影子 fd 表，记录文件生命周期起点与打开标志（O_DIRECT 等）
+// 与 glibc 的 __OPEN_NEEDS_MODE 一致：O_TMPFILE 含 O_DIRECTORY 位，须整体匹配，普通目录打开没有第三个参数
+static inline mode_t open_mode(int flags, va_list ap) {
+    return ((flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE) ? (mode_t)va_arg(ap, int) : 0;
+}
+
+int open(const char* path, int flags, ...) {
+    va_list ap; va_start(ap, flags); mode_t mode = open_mode(flags, ap); va_end(ap);
+    if (!wrapper_enter()) return REAL(open, open_func_t)(path, flags, mode);
+    int fd = original_open(path, flags, mode);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+int open64(const char* path, int flags, ...) {
+    va_list ap; va_start(ap, flags); mode_t mode = open_mode(flags, ap); va_end(ap);
+    if (!wrapper_enter()) return REAL(open64, open_func_t)(path, flags, mode);
+    int fd = original_open64(path, flags, mode);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+int openat(int dirfd, const char* path, int flags, ...) {
+    va_list ap; va_start(ap, flags); mode_t mode = open_mode(flags, ap); va_end(ap);
+    if (!wrapper_enter()) return REAL(openat, openat_func_t)(dirfd, path, flags, mode);
+    int fd = original_openat(dirfd, path, flags, mode);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+int openat64(int dirfd, const char* path, int flags, ...) {
+    va_list ap; va_start(ap, flags); mode_t mode = open_mode(flags, ap); va_end(ap);
+    if (!wrapper_enter()) return REAL(openat64, openat_func_t)(dirfd, path, flags, mode);
+    int fd = original_openat64(dirfd, path, flags, mode);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+// _FORTIFY_SOURCE 编译的程序走 __open_2/__open64_2
+int __open_2(const char* path, int flags) {
+    if (!wrapper_enter() || !original___open_2) return REAL(__open_2, open_2_func_t)(path, flags);
+    int fd = original___open_2(path, flags);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+int __open64_2(const char* path, int flags) {
+    if (!wrapper_enter() || !original___open64_2) return REAL(__open64_2, open_2_func_t)(path, flags);
+    int fd = original___open64_2(path, flags);
+    on_open(OP_OPEN, path, fd, flags, flags, errno);
+    return fd;
+}
+
+// fopen 的模式串换算为打开标志，省去 fcntl(F_GETFL)
+static int fopen_flags(const char* mode) {
+    int flags;
+    switch (mode ? mode[0] : 'r') {
+    case 'w': flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+    case 'a': flags = O_WRONLY | O_CREAT | O_APPEND; break;
+    default:  flags = O_RDONLY; break;
+    }
+    for (const char* m = mode ? mode + 1 : ""; *m && *m != ','; m++) {
+        if (*m == '+') flags = (flags & ~O_ACCMODE) | O_RDWR;
+        else if (*m == 'x') flags |= O_EXCL;
+        else if (*m == 'e') flags |= O_CLOEXEC;
     }
+    return flags;
+}
+
+// stdio 内部的 read/lseek 不经过拦截，流的 fd 在表中按可写 fd 登记（读时 lseek 取偏移）
+static FILE* fopen_common(fopen_func_t fn, const char* path, const char* mode) {
+    FILE* f = fn(path, mode);
+    int err = errno;
+    int flags = fopen_flags(mode);
+    on_open(OP_FOPEN, path, f ? fileno(f) : -1, flags, (flags & ~O_ACCMODE) | O_RDWR, err);
+    return f;
+}
+
+FILE* fopen(const char* path, const char* mode) {
+    if (!wrapper_enter()) return REAL(fopen, fopen_func_t)(path, mode);
+    return fopen_common(original_fopen, path, mode);
+}
+
+FILE* fopen64(const char* path, const char* mode) {
+    if (!wrapper_enter()) return REAL(fopen64, fopen_func_t)(path, mode);
+    return fopen_common(original_fopen64, path, mode);
+}
+
+// fd 关闭或被 dup2/dup3 覆盖前发出其上的待发区间（重入路径只会关闭内部 fd，没有待发区间）
+static inline void flush_pending(int fd) {
+    if (in_wrapper) return;
+    int err = errno;
+    in_wrapper = 1;
+    read_filter_flush_fd(fd);
+    in_wrapper = 0;
+    errno = err;
+}
+
+// 维护影子 fd 表：关闭/复制/定位。不依赖 init，重入路径同样要更新表
+int close(int fd) {
+    flush_pending(fd);
+    fd_table_close(fd);
+    return REAL(close, close_func_t)(fd);
+}
+
+// glibc 的 fclose 内部直接关闭 fd，不经过 close()
+int fclose(FILE* stream) {
+    if (stream) { flush_pending(fileno(stream)); fd_table_close(fileno(stream)); }
+    return REAL(fclose, fclose_func_t)(stream);
+}
+
+int dup(int oldfd) {
+    int fd = REAL(dup, dup_func_t)(oldfd);
+    if (fd >= 0) { int err = errno; fd_table_dup(oldfd, fd); errno = err; }
+    return fd;
+}
+
+int dup2(int oldfd, int newfd) {
+    if (oldfd != newfd) flush_pending(newfd);
+    int fd = REAL(dup2, dup2_func_t)(oldfd, newfd);
+    if (fd >= 0) { int err = errno; fd_table_dup(oldfd, fd); errno = err; }
+    return fd;
+}
+
+int dup3(int oldfd, int newfd, int flags) {
+    flush_pending(newfd);
+    int fd = REAL(dup3, dup3_func_t)(oldfd, newfd, flags);
+    if (fd >= 0) { int err = errno; fd_table_dup(oldfd, fd); errno = err; }
+    return fd;
+}
 
+// fcntl(F_DUPFD/F_DUPFD_CLOEXEC) 与 dup 一样共享文件位置（Rust 的 try_clone 等经此复制 fd）。
+// 第三个参数按 glibc 的做法统一以指针宽度取出转交
+static int fcntl_common(fcntl_func_t real, int fd, int cmd, void* arg) {
+    if (!real) { errno = ENOSYS; return -1; }
+    int ret = real(fd, cmd, arg);
+    if (ret >= 0 && (cmd == F_DUPFD || cmd == F_DUPFD_CLOEXEC)) { int err = errno; fd_table_dup(fd, ret); errno = err; }
     return ret;
 }
+
+int fcntl(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void* arg = va_arg(ap, void*);
+    va_end(ap);
+    return fcntl_common(REAL(fcntl, fcntl_func_t), fd, cmd, arg);
+}
+
+int fcntl64(int fd, int cmd, ...) {
+    va_list ap;
+    va_start(ap, cmd);
+    void* arg = va_arg(ap, void*);
+    va_end(ap);
+    fcntl_func_t real = REAL(fcntl64, fcntl_func_t);
+    return fcntl_common(real ? real : REAL(fcntl, fcntl_func_t), fd, cmd, arg);
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    off_t ret = REAL(lseek, lseek_func_t)(fd, offset, whence);
+    if (ret >= 0) fd_table_seek(fd, ret);
+    return ret;
+}
+
+off_t lseek64(int fd, off_t offset, int whence) {
+    off_t ret = REAL(lseek64, lseek_func_t)(fd, offset, whence);
+    if (ret >= 0) fd_table_seek(fd, ret);
+    return ret;
+}
+
+// 拦截映射类调用：文件映射在调用返回时同步记录（精确的地址、文件偏移、长度与 prot），
+// 不再依赖 proc_monitor 轮询 /proc/<pid>/maps。原始调用直接走系统调用：
+// mmap 常在 malloc/dlsym 内部被调用，不能经 dlsym 解析，也不能在此触发 init
+static void* raw_mmap(void* addr, size_t len, int prot, int flags, int fd, off_t off) {
+#ifdef SYS_mmap2
+    if (off & 4095) { errno = EINVAL; return MAP_FAILED; }
+    return (void*)syscall(SYS_mmap2, addr, len, prot, flags, fd, (long)(off >> 12));
+#else
+    return (void*)syscall(SYS_mmap, addr, len, prot, flags, fd, off);
+#endif
+}
+
+// init 完成前（以及重入路径）只维护映射表，不记录日志
+static inline int map_logging_ready() {
+    return !in_wrapper && __atomic_load_n(&init_done, __ATOMIC_ACQUIRE) && logging_enabled();
+}
+
+static void log_map_op(OpType op, const char* path, uintptr_t start, size_t len, off_t file_off,
+                       off_t offset, int fd, int flags) {
+    ProfilerLogEntry entry = {
+        .pid = profiler_getpid(),
+        .op_type = op,
+        .filename = path,
+        .offset = offset,
+        .size = len,
+        .fd = fd,
+        .addr_start = (off_t)start,
+        .addr_end = (off_t)(start + len),
+        .file_offset = file_off,
+        .flags = flags
+    };
+    profiler_log(&entry);
+}
+
+static void* mmap_common(void* addr, size_t len, int prot, int flags, int fd, off_t off) {
+    void* ret = raw_mmap(addr, len, prot, flags, fd, off);
+    if (ret == MAP_FAILED || in_wrapper) return ret;
+    int err = errno;
+    in_wrapper = 1;
+    struct stat st;
+    if (fd >= 0 && !(flags & MAP_ANONYMOUS)) {
+        // 只跟踪普通文件（GPU 驱动等对设备 fd 的映射很频繁，与预取无关）
+        const char* path = NULL;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+            fd_table_lookup(fd, fd_path, sizeof(fd_path), NULL) == 0) path = fd_path;
+        if (path && path[0] == '/') {
+            map_table_add((uintptr_t)ret, len, off, path);
+            in_wrapper = 0;
+            if (map_logging_ready()) {
+                in_wrapper = 1;
+                log_map_op(OP_MMAP, path, (uintptr_t)ret, len, off, 0, fd, prot);
+            }
+        } else {
+            map_table_remove((uintptr_t)ret, len);
+        }
+    } else if (flags & MAP_FIXED) {
+        // 匿名映射覆盖了原有区间
+        map_table_remove((uintptr_t)ret, len);
+    }
+    in_wrapper = 0;
+    errno = err;
+    return ret;
+}
+
+void* mmap(void* addr, size_t len, int prot, int flags, int fd, off_t off) {
+    return mmap_common(addr, len, prot, flags, fd, off);
+}
+
+void* mmap64(void* addr, size_t len, int prot, int flags, int fd, off_t off) {
+    return mmap_common(addr, len, prot, flags, fd, off);
+}
+
+int munmap(void* addr, size_t len) {
+    char path[256];
+    off_t file_off = 0;
+    int is_file = !in_wrapper && map_table_find((uintptr_t)addr, len, path, sizeof(path), &file_off) == 0;
+    int ret = (int)syscall(SYS_munmap, addr, len);
+    if (ret != 0 || !is_file) return ret;
+    in_wrapper = 1;
+    map_table_remove((uintptr_t)addr, len);
+    in_wrapper = 0;
+    if (map_logging_ready()) {
+        in_wrapper = 1;
+        log_map_op(OP_MUNMAP, path, (uintptr_t)addr, len, file_off, 0, -1, 0);
+        in_wrapper = 0;
+    }
+    return ret;
+}
+
+// mremap：新区间沿用原映射的文件偏移；offset 字段记录原地址，便于关联原 MMAP 事件
+void* mremap(void* old_addr, size_t old_len, size_t new_len, int flags, ...) {
+    void* new_addr = NULL;
+    if (flags & MREMAP_FIXED) {
+        va_list ap;
+        va_start(ap, flags);
+        new_addr = va_arg(ap, void*);
+        va_end(ap);
+    }
+    char path[256];
+    off_t file_off = 0;
+    int is_file = !in_wrapper && map_table_find((uintptr_t)old_addr, old_len, path, sizeof(path), &file_off) == 0;
+    void* ret = (void*)syscall(SYS_mremap, old_addr, old_len, new_len, flags, new_addr);
+    if (ret == MAP_FAILED || !is_file) return ret;
+    int err = errno;
+    in_wrapper = 1;
+    map_table_remove((uintptr_t)old_addr, old_len);
+    map_table_add((uintptr_t)ret, new_len, file_off, path);
+    in_wrapper = 0;
+    if (map_logging_ready()) {
+        in_wrapper = 1;
+        log_map_op(OP_MREMAP, path, (uintptr_t)ret, new_len, file_off, (off_t)(uintptr_t)old_addr, -1, 0);
+        in_wrapper = 0;
+    }
+    errno = err;
+    return ret;
+}
+
+// madvise：只记录作用于文件映射的建议（WILLNEED/DONTNEED/SEQUENTIAL 等），flags 为 advice
+int madvise(void* addr, size_t len, int advice) {
+    int ret = (int)syscall(SYS_madvise, addr, len, advice);
+    if (ret != 0 || in_wrapper || !map_logging_ready()) return ret;
+    char path[256];
+    off_t file_off = 0;
+    in_wrapper = 1;
+    if (map_table_find((uintptr_t)addr, len, path, sizeof(path), &file_off) == 0)
+        log_map_op(OP_MADVISE, path, (uintptr_t)addr, len, file_off, 0, -1, advice);
+    in_wrapper = 0;
+    return ret;
+}
+
+// 拦截 _exit()：fork 出的子进程常以 _exit 结束，不会运行析构函数
+void _exit(int status) {
+    pthread_once(&init_once, init);
+    flush_pending_all();
+    profiler_log_flush();
+    original__exit(status);
+    __builtin_unreachable();
+}
+
+// 拦截 exec 系列：日志由后台线程异步写盘，exec 会直接丢弃进程内缓冲，必须先同步写出
+int execve(const char* path, char* const argv[], char* const envp[]) {
+    pthread_once(&init_once, init);
+    flush_pending_all();
+    profiler_log_flush();
+    return original_execve(path, argv, envp);
+}
+
+int execv(const char* path, char* const argv[]) {
+    pthread_once(&init_once, init);
+    flush_pending_all();
+    profiler_log_flush();
+    return original_execv(path, argv);
+}
+
+int execvp(const char* file, char* const argv[]) {
+    pthread_once(&init_once, init);
+    flush_pending_all();
+    profiler_log_flush();
+    return original_execvp(file, argv);
+}
+
+int execvpe(const char* file, char* const argv[], char* const envp[]) {
+    pthread_once(&init_once, init);
+    flush_pending_all();
+    profiler_log_flush();
+    return original_execvpe(file, argv, envp);
+}
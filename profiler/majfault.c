@@ -0,0 +1,451 @@
+#define _GNU_SOURCE
+#include "majfault.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+// 单线程的 perf 事件与其 mmap 环
+typedef struct {
+    pid_t pid;          // 所属进程
+    pid_t tid;
+    int fd;
+    void* ring;         // 1 页控制页 + ring_pages 页数据
+    int seen;           // 本轮扫描 /proc/<pid>/task 时仍存在
+} FaultThread;
+
+// 映射表项：[start, end) 映射到文件 path 的 pgoff 处；path 为 NULL 表示匿名映射
+typedef struct {
+    uint64_t start, end, pgoff;
+    char* path;
+} MapRange;
+
+// 每个进程一张映射表（地址空间各自独立）
+typedef struct {
+    pid_t pid;
+    MapRange* ranges;
+    size_t range_count, range_cap;
+    uint64_t last_maps_reload;
+} FaultProc;
+
+static FaultThread* threads = NULL;
+static size_t thread_count = 0, thread_cap = 0;
+static FaultProc* procs = NULL;
+static size_t proc_count = 0, proc_cap = 0;
+
+// 其他线程通过 majfault_add_process 提交的新进程，由采样线程取走
+static pid_t* pending = NULL;
+static size_t pending_count = 0, pending_cap = 0;
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t sampler_thread;
+static volatile int sampler_running = 0;
+static long page_size = 4096;
+static size_t ring_pages = 16;
+static int use_perf_clock = 0;      // 内核不支持 use_clockid 时为 1，改用读取时刻
+static unsigned long long samples = 0, unattributed = 0, lost = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+int majfault_enabled(void) {
+    const char* s = getenv("IFETCHER_MAJFAULT");
+    return s && strcmp(s, "1") == 0;
+}
+
+/* ---------------- 映射表 ---------------- */
+
+static int cmp_range(const void* a, const void* b) {
+    const MapRange* x = a;
+    const MapRange* y = b;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+static int range_push(FaultProc* fp, uint64_t start, uint64_t end, uint64_t pgoff, const char* path) {
+    if (fp->range_count == fp->range_cap) {
+        size_t ncap = fp->range_cap ? fp->range_cap * 2 : 256;
+        MapRange* nr = (MapRange*)realloc(fp->ranges, ncap * sizeof(MapRange));
+        if (!nr) return -1;
+        fp->ranges = nr;
+        fp->range_cap = ncap;
+    }
+    MapRange* r = &fp->ranges[fp->range_count];
+    r->start = start;
+    r->end = end;
+    r->pgoff = pgoff;
+    r->path = path ? strdup(path) : NULL;
+    fp->range_count++;
+    return 0;
+}
+
+static void ranges_clear(FaultProc* fp) {
+    for (size_t i = 0; i < fp->range_count; i++) free(fp->ranges[i].path);
+    fp->range_count = 0;
+}
+
+static int is_file_path(const char* p) {
+    return p && p[0] == '/' && strncmp(p, "//anon", 6) != 0 &&
+           strncmp(p, "/memfd:", 7) != 0 && strncmp(p, "/SYSV", 5) != 0;
+}
+
+// 新映射覆盖 [start, end)：裁剪/拆分/移除重叠的旧项后插入（与内核 mmap 语义一致）
+static void map_insert(FaultProc* fp, uint64_t start, uint64_t end, uint64_t pgoff, const char* path) {
+    size_t n = fp->range_count;
+    for (size_t i = 0; i < n; i++) {
+        MapRange* e = &fp->ranges[i];
+        if (e->end <= start || e->start >= end) continue;
+        if (e->start < start && e->end > end) {
+            // 拆分：右半部分作为新项追加
+            uint64_t rs = end, re = e->end, rp = e->pgoff + (end - e->start);
+            char* rpath = e->path;
+            e->end = start;
+            range_push(fp, rs, re, rp, rpath);
+        } else if (e->start < start) {
+            e->end = start;
+        } else if (e->end > end) {
+            e->pgoff += end - e->start;
+            e->start = end;
+        } else {
+            e->start = e->end = 0;    // 标记删除
+        }
+    }
+    size_t w = 0;
+    for (size_t i = 0; i < fp->range_count; i++) {
+        if (fp->ranges[i].start == 0 && fp->ranges[i].end == 0) { free(fp->ranges[i].path); continue; }
+        fp->ranges[w++] = fp->ranges[i];
+    }
+    fp->range_count = w;
+    range_push(fp, start, end, pgoff, is_file_path(path) ? path : NULL);
+    qsort(fp->ranges, fp->range_count, sizeof(MapRange), cmp_range);
+}
+
+static const MapRange* map_lookup(const FaultProc* fp, uint64_t addr) {
+    size_t lo = 0, hi = fp->range_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (fp->ranges[mid].end <= addr) lo = mid + 1;
+        else if (fp->ranges[mid].start > addr) hi = mid;
+        else return &fp->ranges[mid];
+    }
+    return NULL;
+}
+
+// 以 /proc/<pid>/maps 重建映射表
+static void maps_reload(FaultProc* fp) {
+    char maps_path[64];
+    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", fp->pid);
+    FILE* f = fopen(maps_path, "r");
+    if (!f) return;
+    ranges_clear(fp);
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long long start, end, off;
+        if (sscanf(line, "%llx-%llx %*s %llx", &start, &end, &off) != 3) continue;
+        char* p = strchr(line, '/');
+        if (p) p[strcspn(p, "\n")] = '\0';
+        if (p && strstr(p, " (deleted)")) p = NULL;
+        range_push(fp, start, end, off, is_file_path(p) ? p : NULL);
+    }
+    fclose(f);
+    qsort(fp->ranges, fp->range_count, sizeof(MapRange), cmp_range);
+    fp->last_maps_reload = profiler_now_ns();
+}
+
+static FaultProc* find_proc(pid_t pid) {
+    for (size_t i = 0; i < proc_count; i++) if (procs[i].pid == pid) return &procs[i];
+    return NULL;
+}
+
+/* ---------------- perf 事件 ---------------- */
+
+static int open_thread_event(pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_PAGE_FAULTS_MAJ;
+    attr.sample_period = 1;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_ADDR;
+    attr.mmap = 1;
+    attr.mmap2 = 1;
+    attr.mmap_data = 1;
+    attr.exclude_hv = 1;
+    attr.watermark = 1;
+    attr.wakeup_watermark = (uint32_t)(ring_pages * page_size / 4);
+    if (!use_perf_clock) {
+        attr.use_clockid = 1;
+        attr.clockid = CLOCK_MONOTONIC;
+    }
+    int fd = (int)syscall(__NR_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0 && errno == EINVAL && !use_perf_clock) {
+        use_perf_clock = 1;
+        return open_thread_event(tid);
+    }
+    return fd;
+}
+
+static FaultThread* find_thread(pid_t tid) {
+    for (size_t i = 0; i < thread_count; i++) if (threads[i].tid == tid) return &threads[i];
+    return NULL;
+}
+
+static int attach_thread(pid_t pid, pid_t tid) {
+    int fd = open_thread_event(tid);
+    if (fd < 0) return -1;
+    void* ring = mmap(NULL, (ring_pages + 1) * (size_t)page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) { close(fd); return -1; }
+    if (thread_count == thread_cap) {
+        size_t ncap = thread_cap ? thread_cap * 2 : 64;
+        FaultThread* nt = (FaultThread*)realloc(threads, ncap * sizeof(FaultThread));
+        if (!nt) { munmap(ring, (ring_pages + 1) * (size_t)page_size); close(fd); return -1; }
+        threads = nt;
+        thread_cap = ncap;
+    }
+    threads[thread_count].pid = pid;
+    threads[thread_count].tid = tid;
+    threads[thread_count].fd = fd;
+    threads[thread_count].ring = ring;
+    threads[thread_count].seen = 1;
+    thread_count++;
+    return 0;
+}
+
+static void detach_thread(FaultThread* t) {
+    munmap(t->ring, (ring_pages + 1) * (size_t)page_size);
+    close(t->fd);
+}
+
+static void emit_fault(uint32_t pid, uint64_t time_ns, uint64_t addr) {
+    samples++;
+    FaultProc* fp = find_proc((pid_t)pid);
+    if (!fp) { unattributed++; return; }
+    const MapRange* r = map_lookup(fp, addr);
+    if (!r && profiler_now_ns() - fp->last_maps_reload > 100000000ULL) {
+        // 未命中：可能是 perf 启动前的映射变化，限频重读 maps
+        maps_reload(fp);
+        r = map_lookup(fp, addr);
+    }
+    if (!r || !r->path) { unattributed++; return; }
+    uint64_t off = (r->pgoff + (addr - r->start)) & ~((uint64_t)page_size - 1);
+    ProfilerLogEntry entry = {
+        .pid = (pid_t)pid,
+        .op_type = OP_FAULT,
+        .filename = r->path,
+        .offset = (off_t)off,
+        .size = (size_t)page_size,
+        .fd = -1,
+        .addr_start = (off_t)addr,
+        .status = 0,
+        .err_no = 0,
+        .ts_ns = use_perf_clock ? 0 : time_ns
+    };
+    profiler_log(&entry);
+}
+
+static void handle_record(const struct perf_event_header* h) {
+    const unsigned char* p = (const unsigned char*)(h + 1);
+    if (h->type == PERF_RECORD_SAMPLE) {
+        // 布局按 sample_type 位序：TID(pid,tid) TIME ADDR
+        uint32_t pid;
+        uint64_t time_ns, addr;
+        memcpy(&pid, p, 4);
+        memcpy(&time_ns, p + 8, 8);
+        memcpy(&addr, p + 16, 8);
+        emit_fault(pid, time_ns, addr);
+    } else if (h->type == PERF_RECORD_MMAP2) {
+        // pid tid addr len pgoff maj min ino ino_gen prot flags filename
+        uint32_t pid;
+        uint64_t addr, len, pgoff;
+        memcpy(&pid, p, 4);
+        memcpy(&addr, p + 8, 8);
+        memcpy(&len, p + 16, 8);
+        memcpy(&pgoff, p + 24, 8);
+        FaultProc* fp = find_proc((pid_t)pid);
+        if (fp) map_insert(fp, addr, addr + len, pgoff, (const char*)(p + 64));
+    } else if (h->type == PERF_RECORD_MMAP) {
+        uint32_t pid;
+        uint64_t addr, len, pgoff;
+        memcpy(&pid, p, 4);
+        memcpy(&addr, p + 8, 8);
+        memcpy(&len, p + 16, 8);
+        memcpy(&pgoff, p + 24, 8);
+        FaultProc* fp = find_proc((pid_t)pid);
+        if (fp) map_insert(fp, addr, addr + len, pgoff, (const char*)(p + 32));
+    } else if (h->type == PERF_RECORD_LOST) {
+        uint64_t n;
+        memcpy(&n, p + 8, 8);
+        lost += n;
+    }
+}
+
+// 取尽一个线程环中的记录；跨越环尾的记录先拷贝成连续内存
+static void drain_ring(FaultThread* t) {
+    struct perf_event_mmap_page* mp = (struct perf_event_mmap_page*)t->ring;
+    unsigned char* data = (unsigned char*)t->ring + page_size;
+    uint64_t size = ring_pages * (uint64_t)page_size;
+    uint64_t head = __atomic_load_n(&mp->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = mp->data_tail;
+    unsigned char buf[4096 + sizeof(struct perf_event_header)];
+    while (tail < head) {
+        struct perf_event_header hdr;
+        uint64_t pos = tail % size;
+        for (size_t i = 0; i < sizeof(hdr); i++) ((unsigned char*)&hdr)[i] = data[(pos + i) % size];
+        if (hdr.size < sizeof(hdr)) { tail = head; break; }
+        if (hdr.size <= sizeof(buf)) {
+            if (pos + hdr.size <= size) {
+                handle_record((const struct perf_event_header*)(data + pos));
+            } else {
+                size_t first = (size_t)(size - pos);
+                memcpy(buf, data + pos, first);
+                memcpy(buf + first, data, hdr.size - first);
+                handle_record((const struct perf_event_header*)buf);
+            }
+        }
+        tail += hdr.size;
+    }
+    __atomic_store_n(&mp->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+// 为新线程打开事件，回收已退出线程（先取尽其环）；进程已退出返回 -1
+static int scan_threads(pid_t pid) {
+    char task_path[64];
+    snprintf(task_path, sizeof(task_path), "/proc/%d/task", pid);
+    DIR* d = opendir(task_path);
+    for (size_t i = 0; i < thread_count; i++) if (threads[i].pid == pid) threads[i].seen = 0;
+    struct dirent* de;
+    while (d && (de = readdir(d)) != NULL) {
+        if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+        pid_t tid = (pid_t)atoi(de->d_name);
+        FaultThread* t = find_thread(tid);
+        if (t) t->seen = 1;
+        else attach_thread(pid, tid);
+    }
+    if (d) closedir(d);
+    size_t w = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        if (threads[i].pid == pid && !threads[i].seen) { drain_ring(&threads[i]); detach_thread(&threads[i]); continue; }
+        threads[w++] = threads[i];
+    }
+    thread_count = w;
+    return d ? 0 : -1;
+}
+
+static void drain_all(void) {
+    for (size_t i = 0; i < thread_count; i++) drain_ring(&threads[i]);
+}
+
+// 建映射表并挂上该进程现有线程的事件（先建表再挂事件：之后的 MMAP2 记录按序覆盖）
+static int add_proc(pid_t pid) {
+    if (find_proc(pid)) return 0;
+    if (proc_count == proc_cap) {
+        size_t ncap = proc_cap ? proc_cap * 2 : 16;
+        FaultProc* np = (FaultProc*)realloc(procs, ncap * sizeof(FaultProc));
+        if (!np) return -1;
+        procs = np;
+        proc_cap = ncap;
+    }
+    FaultProc* fp = &procs[proc_count++];
+    memset(fp, 0, sizeof(*fp));
+    fp->pid = pid;
+    maps_reload(fp);
+    if (attach_thread(pid, pid) != 0) {
+        int err = errno;
+        ranges_clear(fp);
+        free(fp->ranges);
+        proc_count--;
+        errno = err;
+        return -1;
+    }
+    scan_threads(pid);
+    return 0;
+}
+
+static void remove_proc(size_t i) {
+    ranges_clear(&procs[i]);
+    free(procs[i].ranges);
+    procs[i] = procs[--proc_count];
+}
+
+static void take_pending(void) {
+    pthread_mutex_lock(&pending_mutex);
+    for (size_t i = 0; i < pending_count; i++) add_proc(pending[i]);
+    pending_count = 0;
+    pthread_mutex_unlock(&pending_mutex);
+}
+
+static void* sampler_thread_func(void* arg) {
+    (void)arg;
+    struct pollfd* pfds = NULL;
+    size_t pfd_cap = 0;
+    while (sampler_running) {
+        take_pending();
+        // 新线程在下次扫描前的缺页会漏采，故每轮都扫描；进程退出后释放其映射表
+        for (size_t i = 0; i < proc_count;) {
+            if (scan_threads(procs[i].pid) != 0) remove_proc(i);
+            else i++;
+        }
+        if (thread_count > pfd_cap) {
+            struct pollfd* np = (struct pollfd*)realloc(pfds, thread_count * sizeof(struct pollfd));
+            if (!np) break;
+            pfds = np;
+            pfd_cap = thread_count;
+        }
+        for (size_t i = 0; i < thread_count; i++) { pfds[i].fd = threads[i].fd; pfds[i].events = POLLIN; pfds[i].revents = 0; }
+        poll(pfds, thread_count, 20);
+        drain_all();
+    }
+    free(pfds);
+    return NULL;
+}
+
+int majfault_start(pid_t pid) {
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+    const char* rp = getenv("IFETCHER_MAJFAULT_RING_PAGES");
+    if (rp && *rp) {
+        long v = strtol(rp, NULL, 10);
+        if (v > 0 && (v & (v - 1)) == 0) ring_pages = (size_t)v;
+    }
+    profiler_log_init();
+    if (add_proc(pid) != 0) {
+        fprintf(stderr, "[ProcMonitor] Warning: perf_event_open(PAGE_FAULTS_MAJ) failed: %s\n", strerror(errno));
+        return -1;
+    }
+    sampler_running = 1;
+    if (pthread_create(&sampler_thread, NULL, sampler_thread_func, NULL) != 0) {
+        sampler_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void majfault_add_process(pid_t pid) {
+    if (!sampler_running) return;
+    pthread_mutex_lock(&pending_mutex);
+    if (pending_count == pending_cap) {
+        size_t ncap = pending_cap ? pending_cap * 2 : 16;
+        pid_t* np = (pid_t*)realloc(pending, ncap * sizeof(pid_t));
+        if (np) { pending = np; pending_cap = ncap; }
+    }
+    if (pending_count < pending_cap) pending[pending_count++] = pid;
+    pthread_mutex_unlock(&pending_mutex);
+}
+
+void majfault_stop(void) {
+    if (!sampler_running) return;
+    sampler_running = 0;
+    pthread_join(sampler_thread, NULL);
+    drain_all();
+    for (size_t i = 0; i < thread_count; i++) detach_thread(&threads[i]);
+    if (verbose())
+        printf("Major-fault sampler: %llu faults, %llu unattributed, %llu lost\n", samples, unattributed, lost);
+    free(threads); threads = NULL; thread_count = thread_cap = 0;
+    while (proc_count) remove_proc(proc_count - 1);
+    free(procs); procs = NULL; proc_cap = 0;
+    free(pending); pending = NULL; pending_count = pending_cap = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef MAJFAULT_H
+#define MAJFAULT_H
+#include <sys/types.h>
+
+// 主缺页采样：对目标进程的每个线程打开 PERF_COUNT_SW_PAGE_FAULTS_MAJ 软件事件
+// （sample_period=1，PERF_SAMPLE_TID|TIME|ADDR，CLOCK_MONOTONIC），读取 perf mmap 环，
+// 用映射表把缺页地址换算为 (文件, 文件内偏移)，按页写入 page_log（OP_FAULT）。
+// 映射表按进程维护，由 /proc/<pid>/maps 初始化，之后由环中的 PERF_RECORD_MMAP2 增量更新。
+//
+// 环境变量：
+//   IFETCHER_MAJFAULT=1                  启用（proc_monitor 中默认关闭）
+//   IFETCHER_MAJFAULT_RING_PAGES         每线程环大小（页，2 的幂），默认 16
+//
+// 需要 root 或 perf_event_paranoid <= 1；打开失败时打印警告并跳过。
+
+// 是否通过环境变量启用
+int majfault_enabled(void);
+
+// 启动采样线程；成功返回 0
+int majfault_start(pid_t pid);
+
+// 把进程树中新发现的进程加入采样（由采样线程在下一轮挂上事件）
+void majfault_add_process(pid_t pid);
+
+// 停止采样线程，取尽环中剩余样本并释放资源
+void majfault_stop(void);
+
+#endif // MAJFAULT_H
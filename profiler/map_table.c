@@ -0,0 +1,116 @@
+#define _GNU_SOURCE
+#include "map_table.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define MAP_PATH_MAX 232
+
+// 按 start 升序、互不重叠
+typedef struct {
+    uintptr_t start, end;
+    off_t off;
+    char path[MAP_PATH_MAX];
+} MapEnt;
+
+static MapEnt* ents = NULL;
+static size_t ent_count = 0, ent_cap = 0;
+static pthread_mutex_t map_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void atfork_prepare(void) { pthread_mutex_lock(&map_mutex); }
+static void atfork_parent(void) { pthread_mutex_unlock(&map_mutex); }
+static void atfork_child(void) { pthread_mutex_init(&map_mutex, NULL); }
+static void register_atfork(void) { pthread_atfork(atfork_prepare, atfork_parent, atfork_child); }
+
+// 扩容：直接走系统调用，避免经过被拦截的 mmap/munmap 与 malloc
+static int grow(void) {
+    size_t ncap = ent_cap ? ent_cap * 2 : 256;
+    void* m = (void*)syscall(SYS_mmap, NULL, ncap * sizeof(MapEnt), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) return -1;
+    if (ents) {
+        memcpy(m, ents, ent_count * sizeof(MapEnt));
+        syscall(SYS_munmap, ents, ent_cap * sizeof(MapEnt));
+    }
+    ents = (MapEnt*)m;
+    ent_cap = ncap;
+    return 0;
+}
+
+// 第一个 end > addr 的下标（各项不重叠，end 同样有序）
+static size_t lower_bound(uintptr_t addr) {
+    size_t lo = 0, hi = ent_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ents[mid].end <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int insert_at(size_t i, const MapEnt* e) {
+    if (ent_count == ent_cap && grow() != 0) return -1;
+    memmove(&ents[i + 1], &ents[i], (ent_count - i) * sizeof(MapEnt));
+    ents[i] = *e;
+    ent_count++;
+    return 0;
+}
+
+// 调用方持有 map_mutex
+static void remove_locked(uintptr_t start, uintptr_t end) {
+    size_t i = lower_bound(start);
+    while (i < ent_count && ents[i].start < end) {
+        MapEnt* e = &ents[i];
+        if (e->start < start && e->end > end) {
+            // 从中间解除：拆成两段
+            MapEnt right = *e;
+            right.off += (off_t)(end - e->start);
+            right.start = end;
+            e->end = start;
+            insert_at(i + 1, &right);
+            return;
+        }
+        if (e->start < start) { e->end = start; i++; continue; }
+        if (e->end > end) { e->off += (off_t)(end - e->start); e->start = end; return; }
+        memmove(&ents[i], &ents[i + 1], (ent_count - i - 1) * sizeof(MapEnt));
+        ent_count--;
+    }
+}
+
+void map_table_add(uintptr_t start, size_t len, off_t off, const char* path) {
+    if (!len || !path) return;
+    pthread_once(&atfork_once, register_atfork);
+    MapEnt e;
+    e.start = start;
+    e.end = start + len;
+    e.off = off;
+    snprintf(e.path, sizeof(e.path), "%s", path);
+    pthread_mutex_lock(&map_mutex);
+    remove_locked(e.start, e.end);
+    insert_at(lower_bound(e.start), &e);
+    pthread_mutex_unlock(&map_mutex);
+}
+
+void map_table_remove(uintptr_t start, size_t len) {
+    if (!len || !ent_count) return;
+    pthread_mutex_lock(&map_mutex);
+    remove_locked(start, start + len);
+    pthread_mutex_unlock(&map_mutex);
+}
+
+int map_table_find(uintptr_t start, size_t len, char* path, size_t n, off_t* off) {
+    if (!ent_count) return -1;
+    int found = -1;
+    pthread_mutex_lock(&map_mutex);
+    size_t i = lower_bound(start);
+    if (i < ent_count && ents[i].start < start + (len ? len : 1)) {
+        const MapEnt* e = &ents[i];
+        if (n) snprintf(path, n, "%s", e->path);
+        if (off) *off = e->off + (start > e->start ? (off_t)(start - e->start) : 0);
+        found = 0;
+    }
+    pthread_mutex_unlock(&map_mutex);
+    return found;
+}
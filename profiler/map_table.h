@@ -0,0 +1,21 @@
+#ifndef MAP_TABLE_H
+#define MAP_TABLE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// 进程内文件映射表：由 mmap/munmap/mremap 拦截函数维护，
+// 供 munmap/mremap/madvise 把地址区间换算回 (文件, 文件偏移)。
+// 存储直接用 mmap 系统调用分配，不经 malloc（拦截函数可能在 malloc 内部被调用）。
+
+// 登记文件映射 [start, start+len) -> path 的 off 处（先移除与之重叠的旧项）
+void map_table_add(uintptr_t start, size_t len, off_t off, const char* path);
+
+// 移除 [start, start+len) 内的映射（部分重叠的项被裁剪）
+void map_table_remove(uintptr_t start, size_t len);
+
+// 查找与 [start, start+len) 重叠的第一个文件映射：返回 0 并给出路径与 start 处对应的文件偏移
+// （start 在映射之前时取映射起点的偏移）；不是文件映射返回 -1
+int map_table_find(uintptr_t start, size_t len, char* path, size_t n, off_t* off);
+
+#endif // MAP_TABLE_H
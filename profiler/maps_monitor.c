@@ -1,153 +1,391 @@
 #include "maps_monitor.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 
-static MmapEntry last_mmap_entries[MAPS_MAX_ENTRY];
-static int last_mmap_count = 0;
+// PROCMAP_QUERY（Linux 6.11+）：按地址逐个查询 VMA，免去 maps 文本的格式化与解析。
+// 旧头文件没有定义时按内核 UAPI 自带一份
+#ifndef PROCMAP_QUERY
+struct procmap_query {
+    uint64_t size;
+    uint64_t query_flags;
+    uint64_t query_addr;
+    uint64_t vma_start;
+    uint64_t vma_end;
+    uint64_t vma_flags;
+    uint64_t vma_page_size;
+    uint64_t vma_offset;
+    uint64_t inode;
+    uint32_t dev_major;
+    uint32_t dev_minor;
+    uint32_t vma_name_size;
+    uint32_t build_id_size;
+    uint64_t vma_name_addr;
+    uint64_t build_id_addr;
+};
+#define PROCMAP_QUERY _IOWR('f', 17, struct procmap_query)
+#define PROCMAP_QUERY_COVERING_OR_NEXT_VMA 0x10
+#define PROCMAP_QUERY_FILE_BACKED_VMA 0x20
+#endif
 
+// 映射的身份：(start, end, inode) 相同视为同一映射
 typedef struct {
-    char filename[256];
+    uint64_t start, end, inode;
+} MapKey;
+
+// 当前快照（动态数组，无条目上限）
+static MmapEntry* cur_entries = NULL;
+static uint64_t* cur_inodes = NULL;
+static size_t cur_count = 0, cur_cap = 0;
+
+// 每个被监控进程的状态：maps fd 与上一次快照的键集合（开放寻址；start == 0 为空槽）
+typedef struct {
+    pid_t pid;
+    int fd;
+    MapKey* prev_set;
+    size_t prev_cap;
+} MapsProc;
+
+static MapsProc* procs = NULL;
+static size_t proc_count = 0, proc_cap = 0;
+
+typedef struct {
+    pid_t pid;
+    const char* filename;
     off_t start;
     off_t end;
     size_t file_size;
 } StartupMmapEntry;
 
-static StartupMmapEntry startup_mmap_entries[MAPS_MAX_ENTRY];
-static int startup_mmap_count = 0;
+static StartupMmapEntry* startup_mmap_entries = NULL;
+static size_t startup_mmap_count = 0, startup_mmap_cap = 0;
 static time_t monitor_start_time = 0;
 
-static int parse_proc_maps(pid_t pid, MmapEntry* entries, int max_entries) {
+// maps 读取方式：-1 未探测，1 PROCMAP_QUERY，0 文本解析
+static int use_query = -1;
+static char* text_buf = NULL;
+static size_t text_cap = 0;
+
+/* ---------------- 路径驻留 ---------------- */
+
+// 路径只保存一份，快照与日志条目都指向驻留字符串（进程生命周期内不释放）
+static char** intern_slots = NULL;
+static size_t intern_cap = 0, intern_count = 0;
+
+static uint64_t hash_bytes(const char* s, size_t n) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++) { h ^= (unsigned char)s[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+static const char* intern_path(const char* s, size_t n) {
+    if ((intern_count + 1) * 2 > intern_cap) {
+        size_t ncap = intern_cap ? intern_cap * 2 : 1024;
+        char** ns = (char**)calloc(ncap, sizeof(char*));
+        if (!ns) return NULL;
+        for (size_t i = 0; i < intern_cap; i++) {
+            if (!intern_slots[i]) continue;
+            size_t j = hash_bytes(intern_slots[i], strlen(intern_slots[i])) & (ncap - 1);
+            while (ns[j]) j = (j + 1) & (ncap - 1);
+            ns[j] = intern_slots[i];
+        }
+        free(intern_slots);
+        intern_slots = ns;
+        intern_cap = ncap;
+    }
+    size_t j = hash_bytes(s, n) & (intern_cap - 1);
+    while (intern_slots[j]) {
+        if (strncmp(intern_slots[j], s, n) == 0 && intern_slots[j][n] == '\0') return intern_slots[j];
+        j = (j + 1) & (intern_cap - 1);
+    }
+    char* copy = (char*)malloc(n + 1);
+    if (!copy) return NULL;
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    intern_slots[j] = copy;
+    intern_count++;
+    return copy;
+}
+
+/* ---------------- 快照采集 ---------------- */
+
+static int keep_path(const char* p, size_t n) {
+    if (n == 0 || p[0] != '/') return 0;
+    if (n >= 7 && strncmp(p, "/memfd:", 7) == 0) return 0;
+    if (n >= 5 && strncmp(p, "/SYSV", 5) == 0) return 0;
+    return 1;
+}
+
+static int push_entry(uint64_t start, uint64_t end, uint64_t off, uint64_t inode, const char* path, size_t n) {
+    if (!keep_path(path, n)) return 0;
+    if (n > 10 && memcmp(path + n - 10, " (deleted)", 10) == 0) n -= 10;
+    if (cur_count == cur_cap) {
+        size_t ncap = cur_cap ? cur_cap * 2 : 1024;
+        MmapEntry* ne = (MmapEntry*)realloc(cur_entries, ncap * sizeof(MmapEntry));
+        if (!ne) return -1;
+        cur_entries = ne;
+        uint64_t* ni = (uint64_t*)realloc(cur_inodes, ncap * sizeof(uint64_t));
+        if (!ni) return -1;
+        cur_inodes = ni;
+        cur_cap = ncap;
+    }
+    const char* name = intern_path(path, n);
+    if (!name) return -1;
+    MmapEntry* e = &cur_entries[cur_count];
+    e->filename = name;
+    e->start = (off_t)start;
+    e->end = (off_t)end;
+    e->file_offset = off;
+    cur_inodes[cur_count] = inode;
+    cur_count++;
+    return 0;
+}
+
+static MapsProc* find_proc(pid_t pid, int create) {
+    for (size_t i = 0; i < proc_count; i++) if (procs[i].pid == pid) return &procs[i];
+    if (!create) return NULL;
+    if (proc_count == proc_cap) {
+        size_t ncap = proc_cap ? proc_cap * 2 : 16;
+        MapsProc* np = (MapsProc*)realloc(procs, ncap * sizeof(MapsProc));
+        if (!np) return NULL;
+        procs = np;
+        proc_cap = ncap;
+    }
+    MapsProc* mp = &procs[proc_count++];
+    memset(mp, 0, sizeof(*mp));
+    mp->pid = pid;
+    mp->fd = -1;
+    return mp;
+}
+
+// /proc/<pid>/maps 保持打开：PROCMAP_QUERY 每轮复用同一 fd，文本方式每轮 pread 从头读
+static int open_maps(MapsProc* mp) {
+    if (mp->fd >= 0) return mp->fd;
     char maps_path[64];
-    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", pid);
+    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", mp->pid);
+    mp->fd = open(maps_path, O_RDONLY | O_CLOEXEC);
+    if (mp->fd < 0) fprintf(stderr, "Failed to open %s: %s\n", maps_path, strerror(errno));
+    return mp->fd;
+}
 
-    FILE* fp = fopen(maps_path, "r");
-    if (fp == NULL) {
-        fprintf(stderr, "Failed to open %s: %s\n", maps_path, strerror(errno));
-        return -1;
+// 只取文件映射，逐个 VMA 查询；返回 1 表示内核不支持（由调用方退回文本解析），
+// -1 表示中途失败（快照不完整，调用方保留上一轮的 prev_set）
+static int collect_query(int fd) {
+    char name[4096];
+    uint64_t addr = 0;
+    for (;;) {
+        struct procmap_query q;
+        memset(&q, 0, sizeof(q));
+        q.size = sizeof(q);
+        q.query_flags = PROCMAP_QUERY_COVERING_OR_NEXT_VMA | PROCMAP_QUERY_FILE_BACKED_VMA;
+        q.query_addr = addr;
+        q.vma_name_addr = (uint64_t)(uintptr_t)name;
+        q.vma_name_size = sizeof(name);
+        if (ioctl(fd, PROCMAP_QUERY, &q) != 0) {
+            if (errno == ENOENT) return 0;        // 没有更多 VMA
+            if (addr == 0 && (errno == ENOTTY || errno == EINVAL || errno == EOPNOTSUPP)) return 1;
+            return -1;
+        }
+        size_t n = q.vma_name_size ? q.vma_name_size - 1 : 0;   // 含结尾 '\0'
+        if (push_entry(q.vma_start, q.vma_end, q.vma_offset, q.inode, name, n) != 0) return -1;
+        addr = q.vma_end;
     }
+}
 
-    char line[1024];
-    int count = 0;
-    while (fgets(line, sizeof(line), fp) != NULL && count < max_entries) {
-        unsigned long long start_addr, end_addr;
-        unsigned long long offset;
-        char pathname[256] = "unknown";
-
-        int parsed = sscanf(line, "%llx-%llx %*s %llx %*s %*d %255s",
-                            &start_addr, &end_addr, &offset, pathname);
-        if (parsed >= 3) {
-            if (pathname[0] == '/' &&
-                strncmp(pathname, "/memfd:", 7) != 0 &&
-                strncmp(pathname, "/SYSV", 5) != 0) {
-                entries[count].start = (off_t)start_addr;
-                entries[count].end   = (off_t)end_addr;
-                entries[count].file_offset = offset;
-                strncpy(entries[count].filename, pathname, sizeof(entries[count].filename) - 1);
-                entries[count].filename[sizeof(entries[count].filename) - 1] = '\0';
-                count++;
-            }
+// 文本回退：一次读入整个 maps，手工解析字段（不用 fgets/sscanf）
+static int collect_text(int fd) {
+    size_t len = 0;
+    for (;;) {
+        if (len + 65536 > text_cap) {
+            size_t ncap = text_cap ? text_cap * 2 : 262144;
+            char* nb = (char*)realloc(text_buf, ncap);
+            if (!nb) return -1;
+            text_buf = nb;
+            text_cap = ncap;
         }
+        ssize_t n = pread(fd, text_buf + len, text_cap - len - 1, (off_t)len);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        len += (size_t)n;
     }
+    text_buf[len] = '\0';
+    char* p = text_buf;
+    char* end = text_buf + len;
+    while (p < end) {
+        char* eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        // start-end perms offset dev inode path
+        char* q;
+        uint64_t start = strtoull(p, &q, 16);
+        uint64_t stop = (*q == '-') ? strtoull(q + 1, &q, 16) : 0;
+        while (*q == ' ') q++;
+        while (*q && *q != ' ') q++;                 // perms
+        uint64_t off = strtoull(q, &q, 16);
+        while (*q == ' ') q++;
+        while (*q && *q != ' ') q++;                 // dev
+        uint64_t inode = strtoull(q, &q, 10);
+        while (q < eol && *q == ' ') q++;
+        if (q < eol && push_entry(start, stop, off, inode, q, (size_t)(eol - q)) != 0) return -1;
+        p = eol + 1;
+    }
+    return 0;
+}
 
-    fclose(fp);
-    return count;
+// 采集当前快照到 cur_entries；失败返回 -1
+static int collect_snapshot(MapsProc* mp) {
+    cur_count = 0;
+    int fd = open_maps(mp);
+    if (fd < 0) return -1;
+    int r = 1;
+    if (use_query != 0) {
+        r = collect_query(fd);
+        if (r == 0) { use_query = 1; return 0; }
+        cur_count = 0;
+        if (r > 0) use_query = 0;
+    }
+    if (r < 0 || collect_text(fd) != 0) {
+        // 查询中途失败、目标已退出等：快照作废，下次重新打开
+        close(mp->fd);
+        mp->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------------- 键集合 ---------------- */
+
+static size_t key_hash(const MapKey* k) {
+    uint64_t h = k->start * 0x9E3779B97F4A7C15ULL;
+    h ^= k->end + 0x632BE59BD9B4E019ULL + (h << 6) + (h >> 2);
+    h ^= k->inode + 0x85EBCA77C2B2AE63ULL + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+static int key_contains(const MapKey* set, size_t cap, const MapKey* k) {
+    if (!cap) return 0;
+    size_t j = key_hash(k) & (cap - 1);
+    while (set[j].start) {
+        if (set[j].start == k->start && set[j].end == k->end && set[j].inode == k->inode) return 1;
+        j = (j + 1) & (cap - 1);
+    }
+    return 0;
+}
+
+// 用当前快照重建 prev_set（容量保持在条目数的 2 倍以上）
+static void rebuild_prev_set(MapsProc* mp) {
+    size_t need = 1024;
+    while (need < cur_count * 2) need *= 2;
+    if (need != mp->prev_cap) {
+        MapKey* ns = (MapKey*)realloc(mp->prev_set, need * sizeof(MapKey));
+        if (!ns) return;
+        mp->prev_set = ns;
+        mp->prev_cap = need;
+    }
+    memset(mp->prev_set, 0, mp->prev_cap * sizeof(MapKey));
+    for (size_t i = 0; i < cur_count; i++) {
+        MapKey k = { (uint64_t)cur_entries[i].start, (uint64_t)cur_entries[i].end, cur_inodes[i] };
+        size_t j = key_hash(&k) & (mp->prev_cap - 1);
+        while (mp->prev_set[j].start) j = (j + 1) & (mp->prev_cap - 1);
+        mp->prev_set[j] = k;
+    }
 }
 
+/* ---------------- 对外接口 ---------------- */
+
 void maps_set_start_time(time_t t) {
     monitor_start_time = t;
 }
 
-int maps_init_snapshot(pid_t pid, MmapEntry* out_entries, int max_out) {
-    int count = parse_proc_maps(pid, out_entries, max_out);
-    if (count < 0) {
-        last_mmap_count = 0;
+int maps_init_snapshot(pid_t pid, const MmapEntry** out_entries) {
+    *out_entries = NULL;
+    MapsProc* mp = find_proc(pid, 1);
+    if (!mp) return -1;
+    if (collect_snapshot(mp) != 0) {
+        if (mp->prev_cap) memset(mp->prev_set, 0, mp->prev_cap * sizeof(MapKey));
         return -1;
     }
-    last_mmap_count = count;
-    memcpy(last_mmap_entries, out_entries, count * sizeof(MmapEntry));
-    return count;
+    rebuild_prev_set(mp);
+    *out_entries = cur_entries;
+    return (int)cur_count;
+}
+
+static size_t file_size_of(const char* path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (size_t)st.st_size : 0;
 }
 
 void check_mmap_changes(pid_t pid) {
-    MmapEntry current_entries[MAPS_MAX_ENTRY];
-    int current_count = parse_proc_maps(pid, current_entries, MAPS_MAX_ENTRY);
-    if (current_count == -1) return;
-
-    for (int i = 0; i < current_count; i++) {
-        int is_new = 1;
-        for (int j = 0; j < last_mmap_count; j++) {
-            if (strcmp(current_entries[i].filename, last_mmap_entries[j].filename) == 0 &&
-                current_entries[i].start == last_mmap_entries[j].start &&
-                current_entries[i].end == last_mmap_entries[j].end) {
-                is_new = 0;
-                break;
-            }
-        }
+    MapsProc* mp = find_proc(pid, 1);
+    if (!mp || collect_snapshot(mp) != 0) return;
 
-        if (is_new) {
-            size_t file_size = 0;
-            int fd = open(current_entries[i].filename, O_RDONLY);
-            if (fd >= 0) {
-                struct stat st;
-                if (fstat(fd, &st) == 0) {
-                    file_size = (size_t)st.st_size;
-                }
-                close(fd);
-            }
+    int in_window = monitor_start_time > 0 &&
+                    difftime(time(NULL), monitor_start_time) <= STARTUP_WINDOW_SEC;
+    for (size_t i = 0; i < cur_count; i++) {
+        const MmapEntry* e = &cur_entries[i];
+        MapKey k = { (uint64_t)e->start, (uint64_t)e->end, cur_inodes[i] };
+        if (key_contains(mp->prev_set, mp->prev_cap, &k)) continue;
 
-            ProfilerLogEntry entry = {
-                .pid = pid,
-                .op_type = OP_MMAP,
-                .filename = current_entries[i].filename,
-                .offset = 0,
-                .size = file_size,
-                .fd = -1,
-                .timestamp = time(NULL),
-                .addr_start = current_entries[i].start,
-                .addr_end = current_entries[i].end,
-                .file_offset = (off_t)current_entries[i].file_offset
-            };
-            profiler_log(&entry);
-
-            if (monitor_start_time > 0 &&
-                difftime(time(NULL), monitor_start_time) <= STARTUP_WINDOW_SEC) {
-                if (startup_mmap_count < MAPS_MAX_ENTRY) {
-                    strncpy(startup_mmap_entries[startup_mmap_count].filename,
-                            current_entries[i].filename,
-                            sizeof(startup_mmap_entries[startup_mmap_count].filename) - 1);
-                    startup_mmap_entries[startup_mmap_count].filename[
-                        sizeof(startup_mmap_entries[startup_mmap_count].filename) - 1] = '\0';
-                    startup_mmap_entries[startup_mmap_count].start = current_entries[i].start;
-                    startup_mmap_entries[startup_mmap_count].end   = current_entries[i].end;
-                    startup_mmap_entries[startup_mmap_count].file_size = file_size;
-                    startup_mmap_count++;
-                }
+        size_t file_size = file_size_of(e->filename);
+        ProfilerLogEntry entry = {
+            .pid = pid,
+            .op_type = OP_MMAP,
+            .filename = e->filename,
+            .offset = 0,
+            .size = file_size,
+            .fd = -1,
+            .addr_start = e->start,
+            .addr_end = e->end,
+            .file_offset = (off_t)e->file_offset
+        };
+        profiler_log(&entry);
+
+        if (in_window) {
+            if (startup_mmap_count == startup_mmap_cap) {
+                size_t ncap = startup_mmap_cap ? startup_mmap_cap * 2 : 256;
+                StartupMmapEntry* ns = (StartupMmapEntry*)realloc(startup_mmap_entries, ncap * sizeof(StartupMmapEntry));
+                if (!ns) continue;
+                startup_mmap_entries = ns;
+                startup_mmap_cap = ncap;
             }
+            StartupMmapEntry* s = &startup_mmap_entries[startup_mmap_count++];
+            s->pid = pid;
+            s->filename = e->filename;
+            s->start = e->start;
+            s->end = e->end;
+            s->file_size = file_size;
         }
     }
 
-    last_mmap_count = current_count;
-    memcpy(last_mmap_entries, current_entries, current_count * sizeof(MmapEntry));
+    rebuild_prev_set(mp);
 }
 
-void flush_startup_mmaps(pid_t pid) {
-    for (int i = 0; i < startup_mmap_count; i++) {
+void maps_forget(pid_t pid) {
+    MapsProc* mp = find_proc(pid, 0);
+    if (!mp) return;
+    if (mp->fd >= 0) close(mp->fd);
+    free(mp->prev_set);
+    *mp = procs[--proc_count];
+}
+
+void flush_startup_mmaps(void) {
+    for (size_t i = 0; i < startup_mmap_count; i++) {
         ProfilerLogEntry entry = {
-            .pid = pid,
+            .pid = startup_mmap_entries[i].pid,
             .op_type = OP_MMAP,
             .filename = startup_mmap_entries[i].filename,
             .offset = 0,
             .size = startup_mmap_entries[i].file_size,
             .fd = -1,
-            .timestamp = time(NULL),
             .addr_start = startup_mmap_entries[i].start,
             .addr_end = startup_mmap_entries[i].end,
             .file_offset = 0
         };
         profiler_log(&entry);
     }
-}
\ No newline at end of file
+}
@@ -5,11 +5,11 @@
 #include <sys/types.h>
 #include <time.h>
 
-#define MAPS_MAX_ENTRY 1024
 #define STARTUP_WINDOW_SEC 15
 
+// filename 指向驻留字符串，在进程生命周期内有效
 typedef struct {
-    char filename[256];
+    const char* filename;
     off_t start;
     off_t end;
     unsigned long long file_offset;
@@ -18,13 +18,21 @@ typedef struct {
 // 设置监控启动时间（用于判断启动窗口）
 void maps_set_start_time(time_t t);
 
-// 初始化快照，并将当前映射填入 out_entries；返回条目数（>=0）
-int maps_init_snapshot(pid_t pid, MmapEntry* out_entries, int max_out);
+// 以下接口按 pid 各自维护状态，可同时监控进程树中的多个进程（仅限单线程调用）
 
-// 检查增量变化：发现新增映射立即写日志，并在启动窗口内暂存以便退出聚合写出
+// 初始化快照，*out_entries 指向内部快照数组（下次调用 maps_init_snapshot/check_mmap_changes 前有效）；
+// 返回条目数（>=0），失败返回 -1
+int maps_init_snapshot(pid_t pid, const MmapEntry** out_entries);
+
+// 检查增量变化：以 (start, end, inode) 为键做哈希比对，O(n) 找出新增映射立即写日志，
+// 并在启动窗口内暂存以便退出聚合写出。
+// 内核支持 PROCMAP_QUERY（6.11+）时通过 ioctl 只枚举文件映射，否则一次读入 maps 手工解析
 void check_mmap_changes(pid_t pid);
 
-// 退出前统一写出启动窗口内新增的映射
-void flush_startup_mmaps(pid_t pid);
+// 进程退出后释放其状态（maps fd 与上一次快照）
+void maps_forget(pid_t pid);
+
+// 退出前统一写出启动窗口内新增的映射（各条目记录其所属进程）
+void flush_startup_mmaps(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include "proc_io.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <signal.h>
+
+#define TASK_RESCAN_ROUNDS 10       // 每隔多少轮重新列举线程
+#define FRESH_ROOT_SEC     2.0      // 根进程启动不足此时长时从 0 起计
+
+// 单个线程：常开的 /proc/<pid>/task/<tid>/stat 与上次的 blkio 滴答数
+typedef struct {
+    pid_t tid;
+    int fd;
+    unsigned long long blkio;
+    int seen;                   // 本轮列举 task 目录时仍存在
+} IoThread;
+
+typedef struct {
+    pid_t pid;
+    int io_fd, stat_fd;
+    unsigned long long rchar, read_bytes, syscr, majflt;
+    IoThread* threads;
+    size_t thread_count, thread_cap;
+    int from_zero;              // 首轮读数整体计为增量（进程在采样开始后才出现）
+    int primed;                 // 已取得首轮读数
+} IoProc;
+
+static IoProc* procs = NULL;
+static size_t proc_count = 0, proc_cap = 0;
+
+// 其他线程通过 procio_add_process 提交的新进程，由采样线程取走
+static pid_t* pending = NULL;
+static size_t pending_count = 0, pending_cap = 0;
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t sampler_thread;
+static volatile int sampler_running = 0;
+static int interval_ms = 10;
+static long clk_tck = 100;
+static volatile sig_atomic_t delayacct_restore = 0;   // 退出时把 kernel.task_delayacct 改回 0
+static unsigned long long rounds = 0, records = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+static int env_int(const char* name, int defv) {
+    const char* s = getenv(name);
+    return (s && *s) ? atoi(s) : defv;
+}
+
+int procio_enabled(void) {
+    const char* s = getenv("IFETCHER_PROCIO");
+    return !(s && strcmp(s, "0") == 0);
+}
+
+/* ---------------- /proc 解析 ---------------- */
+
+static ssize_t read_at0(int fd, char* buf, size_t size) {
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+// /proc/<pid>/stat 第 col 列（从 1 起，按 proc(5) 编号）；comm 可能含空格，从最后一个 ')' 之后数起
+static unsigned long long stat_field(const char* buf, int col) {
+    const char* p = strrchr(buf, ')');
+    if (!p) return 0;
+    p++;
+    for (int c = 3; *p; c++) {
+        while (*p == ' ') p++;
+        if (c == col) return strtoull(p, NULL, 10);
+        while (*p && *p != ' ') p++;
+    }
+    return 0;
+}
+
+static unsigned long long io_field(const char* buf, const char* key) {
+    const char* p = strstr(buf, key);
+    return p ? strtoull(p + strlen(key), NULL, 10) : 0;
+}
+
+static int open_proc_file(pid_t pid, pid_t tid, const char* name) {
+    char path[96];
+    if (tid) snprintf(path, sizeof(path), "/proc/%d/task/%d/%s", pid, tid, name);
+    else snprintf(path, sizeof(path), "/proc/%d/%s", pid, name);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+/* ---------------- 进程与线程表 ---------------- */
+
+static IoProc* find_proc(pid_t pid) {
+    for (size_t i = 0; i < proc_count; i++)
+        if (procs[i].pid == pid) return &procs[i];
+    return NULL;
+}
+
+static void attach_proc(pid_t pid, int from_zero) {
+    if (find_proc(pid)) return;
+    if (proc_count == proc_cap) {
+        size_t ncap = proc_cap ? proc_cap * 2 : 16;
+        IoProc* np = (IoProc*)realloc(procs, ncap * sizeof(IoProc));
+        if (!np) return;
+        procs = np;
+        proc_cap = ncap;
+    }
+    IoProc* p = &procs[proc_count];
+    memset(p, 0, sizeof(*p));
+    p->pid = pid;
+    p->io_fd = open_proc_file(pid, 0, "io");
+    p->stat_fd = open_proc_file(pid, 0, "stat");
+    if (p->io_fd < 0 || p->stat_fd < 0) {
+        if (p->io_fd >= 0) close(p->io_fd);
+        if (p->stat_fd >= 0) close(p->stat_fd);
+        return;
+    }
+    p->from_zero = from_zero;
+    proc_count++;
+}
+
+static void detach_proc(IoProc* p) {
+    for (size_t i = 0; i < p->thread_count; i++) close(p->threads[i].fd);
+    free(p->threads);
+    close(p->io_fd);
+    close(p->stat_fd);
+}
+
+// 根进程刚启动（spawn 模式）时从 0 起计，否则以首轮读数为基线
+static int fresh_process(pid_t pid) {
+    char buf[1024];
+    int fd = open_proc_file(pid, 0, "stat");
+    if (fd < 0) return 0;
+    ssize_t n = read_at0(fd, buf, sizeof(buf));
+    close(fd);
+    FILE* fp = fopen("/proc/uptime", "r");
+    double uptime = 0;
+    if (fp) { if (fscanf(fp, "%lf", &uptime) != 1) uptime = 0; fclose(fp); }
+    if (n <= 0 || uptime <= 0) return 0;
+    double started = (double)stat_field(buf, 22) / (double)clk_tck;
+    return uptime - started < FRESH_ROOT_SEC;
+}
+
+// 重新列举线程：新线程加入（进程已有基线时从 0 计，否则以当前值为基线），消失的线程移除
+static void scan_threads(IoProc* p) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/task", p->pid);
+    DIR* d = opendir(path);
+    if (!d) return;
+    for (size_t i = 0; i < p->thread_count; i++) p->threads[i].seen = 0;
+    struct dirent* de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+        pid_t tid = (pid_t)atoi(de->d_name);
+        size_t i;
+        for (i = 0; i < p->thread_count && p->threads[i].tid != tid; i++) {}
+        if (i < p->thread_count) { p->threads[i].seen = 1; continue; }
+        int fd = open_proc_file(p->pid, tid, "stat");
+        if (fd < 0) continue;
+        if (p->thread_count == p->thread_cap) {
+            size_t ncap = p->thread_cap ? p->thread_cap * 2 : 8;
+            IoThread* nt = (IoThread*)realloc(p->threads, ncap * sizeof(IoThread));
+            if (!nt) { close(fd); continue; }
+            p->threads = nt;
+            p->thread_cap = ncap;
+        }
+        IoThread* t = &p->threads[p->thread_count++];
+        t->tid = tid;
+        t->fd = fd;
+        t->seen = 1;
+        t->blkio = 0;
+        if (!p->primed && !p->from_zero && read_at0(fd, buf, sizeof(buf)) > 0) t->blkio = stat_field(buf, 42);
+    }
+    closedir(d);
+    size_t j = 0;
+    for (size_t i = 0; i < p->thread_count; i++) {
+        if (p->threads[i].seen) p->threads[j++] = p->threads[i];
+        else close(p->threads[i].fd);
+    }
+    p->thread_count = j;
+}
+
+static unsigned long long delta(unsigned long long cur, unsigned long long* last) {
+    unsigned long long d = cur >= *last ? cur - *last : 0;
+    *last = cur;
+    return d;
+}
+
+// 采样一个进程；进程已退出返回 -1
+static int sample_proc(IoProc* p, uint64_t now, int rescan) {
+    char buf[1024];
+    if (read_at0(p->io_fd, buf, sizeof(buf)) <= 0) return -1;
+    unsigned long long rchar = io_field(buf, "rchar:");
+    unsigned long long syscr = io_field(buf, "syscr:");
+    unsigned long long read_bytes = io_field(buf, "read_bytes:");
+    if (read_at0(p->stat_fd, buf, sizeof(buf)) <= 0) return -1;
+    unsigned long long majflt = stat_field(buf, 12);
+    if (rescan || !p->primed) scan_threads(p);
+
+    unsigned long long blkio_ticks = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < p->thread_count; i++) {
+        IoThread* t = &p->threads[i];
+        if (read_at0(t->fd, buf, sizeof(buf)) <= 0) { close(t->fd); continue; }     // 线程已退出
+        blkio_ticks += delta(stat_field(buf, 42), &t->blkio);
+        p->threads[j++] = *t;
+    }
+    p->thread_count = j;
+
+    if (!p->primed && !p->from_zero) {
+        p->rchar = rchar; p->read_bytes = read_bytes; p->syscr = syscr; p->majflt = majflt;
+        p->primed = 1;
+        return 0;
+    }
+    p->primed = 1;
+    unsigned long long d_rchar = delta(rchar, &p->rchar);
+    unsigned long long d_bytes = delta(read_bytes, &p->read_bytes);
+    unsigned long long d_syscr = delta(syscr, &p->syscr);
+    unsigned long long d_majflt = delta(majflt, &p->majflt);
+    if (d_rchar || d_bytes || d_syscr || d_majflt || blkio_ticks) {
+        profiler_log_procio(p->pid, now, d_rchar, d_bytes, d_syscr, d_majflt, blkio_ticks * 1000ULL / (unsigned long long)clk_tck);
+        records++;
+    }
+    return 0;
+}
+
+static void sample_all(void) {
+    pthread_mutex_lock(&pending_mutex);
+    for (size_t i = 0; i < pending_count; i++) attach_proc(pending[i], 1);
+    pending_count = 0;
+    pthread_mutex_unlock(&pending_mutex);
+
+    uint64_t now = profiler_now_ns();
+    int rescan = rounds % TASK_RESCAN_ROUNDS == 0;
+    rounds++;
+    size_t j = 0;
+    for (size_t i = 0; i < proc_count; i++) {
+        if (sample_proc(&procs[i], now, rescan) != 0) { detach_proc(&procs[i]); continue; }
+        procs[j++] = procs[i];
+    }
+    proc_count = j;
+}
+
+/* ---------------- delayacct ---------------- */
+
+#define DELAYACCT_SYSCTL "/proc/sys/kernel/task_delayacct"
+
+// 改回 0；只用 open/write/close，可在信号处理函数中调用
+static void delayacct_teardown(void) {
+    if (!delayacct_restore) return;
+    delayacct_restore = 0;
+    int fd = open(DELAYACCT_SYSCTL, O_WRONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (write(fd, "0", 1) != 1) {}
+        close(fd);
+    }
+}
+
+// proc_monitor 通常由 Ctrl-C / SIGTERM 结束：先恢复 sysctl，再按默认动作重新投递信号
+static struct sigaction delayacct_old_int, delayacct_old_term;
+static void delayacct_on_signal(int sig) {
+    delayacct_teardown();
+    sigaction(sig, sig == SIGINT ? &delayacct_old_int : &delayacct_old_term, NULL);
+    raise(sig);
+}
+
+// 系统级开关，默认不改动：关闭时只给出警告；IFETCHER_PROCIO_DELAYACCT=1 时临时开启，
+// 并在 procio_stop、进程正常退出（atexit）与 SIGINT/SIGTERM 时恢复
+static void delayacct_setup(void) {
+    char c = '1';
+    int fd = open(DELAYACCT_SYSCTL, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;     // 旧内核：编译期开关，无需设置
+    if (read(fd, &c, 1) != 1) c = '1';
+    close(fd);
+    if (c != '0') return;
+    if (env_int("IFETCHER_PROCIO_DELAYACCT", 0) != 0) {
+        static int hooks_installed = 0;
+        if (!hooks_installed) {
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = delayacct_on_signal;
+            sigemptyset(&sa.sa_mask);
+            sigaction(SIGINT, &sa, &delayacct_old_int);
+            sigaction(SIGTERM, &sa, &delayacct_old_term);
+            atexit(delayacct_teardown);
+            hooks_installed = 1;
+        }
+        fd = open(DELAYACCT_SYSCTL, O_WRONLY | O_CLOEXEC);
+        if (fd >= 0 && write(fd, "1", 1) == 1) delayacct_restore = 1;
+        if (fd >= 0) close(fd);
+    }
+    if (!delayacct_restore)
+        fprintf(stderr, "[ProcMonitor] Warning: kernel.task_delayacct is off, per-process blkio stall time unavailable "
+                        "(sysctl -w kernel.task_delayacct=1, or IFETCHER_PROCIO_DELAYACCT=1 to enable it for this run)\n");
+}
+
+/* ---------------- 线程 ---------------- */
+
+static void* sampler_thread_func(void* arg) {
+    (void)arg;
+    while (sampler_running) {
+        sample_all();
+        struct timespec ts;
+        ts.tv_sec = interval_ms / 1000;
+        ts.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+int procio_start(pid_t pid) {
+    clk_tck = sysconf(_SC_CLK_TCK);
+    if (clk_tck <= 0) clk_tck = 100;
+    interval_ms = env_int("IFETCHER_PROCIO_INTERVAL_MS", 10);
+    if (interval_ms < 1) interval_ms = 1;
+    delayacct_setup();
+    profiler_log_init();
+    attach_proc(pid, fresh_process(pid));
+    if (proc_count == 0) {
+        delayacct_teardown();
+        return -1;
+    }
+    sampler_running = 1;
+    if (pthread_create(&sampler_thread, NULL, sampler_thread_func, NULL) != 0) {
+        sampler_running = 0;
+        delayacct_teardown();
+        return -1;
+    }
+    return 0;
+}
+
+void procio_add_process(pid_t pid) {
+    if (!sampler_running) return;
+    pthread_mutex_lock(&pending_mutex);
+    if (pending_count == pending_cap) {
+        size_t ncap = pending_cap ? pending_cap * 2 : 16;
+        pid_t* np = (pid_t*)realloc(pending, ncap * sizeof(pid_t));
+        if (np) { pending = np; pending_cap = ncap; }
+    }
+    if (pending_count < pending_cap) pending[pending_count++] = pid;
+    pthread_mutex_unlock(&pending_mutex);
+}
+
+void procio_stop(void) {
+    if (!sampler_running) return;
+    sampler_running = 0;
+    pthread_join(sampler_thread, NULL);
+    // 补最后一轮，捕获最后一个间隔内的变化
+    sample_all();
+    for (size_t i = 0; i < proc_count; i++) detach_proc(&procs[i]);
+    if (verbose()) printf("Process I/O sampler: %llu rounds, %llu records logged\n", rounds, records);
+    free(procs); procs = NULL; proc_count = proc_cap = 0;
+    free(pending); pending = NULL; pending_count = pending_cap = 0;
+    delayacct_teardown();
+}
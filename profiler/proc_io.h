@@ -0,0 +1,32 @@
+#ifndef PROC_IO_H
+#define PROC_IO_H
+#include <sys/types.h>
+
+// 进程级 I/O 采样：高频读取进程树中每个进程的 /proc/<pid>/io（rchar、read_bytes、syscr）
+// 与 /proc/<pid>/stat（majflt），以及各线程 /proc/<pid>/task/<tid>/stat 的 delayacct_blkio_ticks
+// （内核只在 /proc/<pid>/stat 中给出主线程的值，这里按线程求和），把增量写入 stat_log（PROCIO 记录）。
+// 与整盘计数（diskstats.h）不同，这些计数只含目标自身的 I/O 与阻塞时间，不受其他进程的后台 I/O 干扰；
+// analyzer 据此计算 I/O 密度（见 analyzer/reader.h 的 IFETCHER_IO_SIGNAL）。
+//
+// 采样开始前就已存在的进程以首轮读数为基线；之后出现的进程（及启动不足 2 秒的根进程）从 0 起计，
+// 覆盖其启动期。delayacct_blkio_ticks 以时钟滴答（通常 10ms）为单位，需开启 kernel.task_delayacct。
+//
+// 环境变量：
+//   IFETCHER_PROCIO=0                    关闭（proc_monitor 中默认开启）
+//   IFETCHER_PROCIO_INTERVAL_MS          采样间隔，默认 10ms
+//   IFETCHER_PROCIO_DELAYACCT=1          kernel.task_delayacct 关闭时临时开启，退出（含 SIGINT/SIGTERM）时恢复；
+//                                        默认不改动系统设置，只给出警告
+
+// 是否启用
+int procio_enabled(void);
+
+// 启动采样线程；成功返回 0
+int procio_start(pid_t pid);
+
+// 把进程树中新发现的进程加入采样（从 0 起计）
+void procio_add_process(pid_t pid);
+
+// 停止采样线程，做最后一次采样并释放资源
+void procio_stop(void);
+
+#endif // PROC_IO_H
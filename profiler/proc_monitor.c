@@ -2,6 +2,14 @@
 #include "profiler_common.h"
 #include "maps_monitor.h"
 #include "diskstats.h"
+#include "residency.h"
+#include "majfault.h"
+#include "fanotify_monitor.h"
+#include "bpf_monitor.h"
+#include "proc_io.h"
+#include "proc_tree.h"
+#include "control_block.h"
+#include "read_filter.h"
 #include <pthread.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -21,6 +29,12 @@ static double start_ts_env = -1.0;
 // 为 main 使用的函数提供前置声明，消除隐式声明警告
 int start_proc_monitor(pid_t target_pid);
 
+// 与 libwrapper 共享的控制块
+static IfetcherControl* ctl = NULL;
+static char ctl_path[256];
+static pthread_t ctl_thread;
+static volatile int ctl_running = 0;
+
 static int mmap_logging_allowed() {
     if (!gate_on && gate_file && access(gate_file, F_OK) == 0) gate_on = 1;
     if (gate_on) return 1;
@@ -31,6 +45,51 @@ static int mmap_logging_allowed() {
     return 0;
 }
 
+// 写出进程当前的全部文件映射（启动快照 / 新发现的后代进程）
+static void log_snapshot(pid_t pid) {
+    const MmapEntry* entries = NULL;
+    int count = maps_init_snapshot(pid, &entries);
+    for (int i = 0; i < count; i++) {
+        size_t file_size = 0;
+        int fd = open(entries[i].filename, O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                file_size = (size_t)st.st_size;
+            }
+            close(fd);
+        }
+        ProfilerLogEntry entry = {
+            .pid = pid,
+            .op_type = OP_MMAP,
+            .filename = entries[i].filename,
+            .offset = 0,
+            .size = file_size,
+            .fd = -1,
+            .addr_start = entries[i].start,
+            .addr_end = entries[i].end,
+            .file_offset = (off_t)entries[i].file_offset,
+            .status = 0,
+            .err_no = 0
+        };
+        profiler_log(&entry);
+    }
+}
+
+// 进程树回调：新后代进程加入 maps/缺页/驻留/进程 I/O/eBPF 监控；退出的进程释放 maps 状态
+static void on_new_process(pid_t pid) {
+    if (verbose()) printf("[ProcMonitor] following child process %d\n", pid);
+    log_snapshot(pid);
+    if (majfault_enabled()) majfault_add_process(pid);
+    if (residency_enabled()) residency_add_process(pid);
+    if (procio_enabled()) procio_add_process(pid);
+    bpf_monitor_add_process(pid);
+}
+
+static void on_process_exit(pid_t pid) {
+    maps_forget(pid);
+}
+
 // 监控线程主函数
 static void* monitor_thread_func(void* arg) {
     pid_t target_pid = *(pid_t*)arg;
@@ -46,57 +105,147 @@ static void* monitor_thread_func(void* arg) {
     maps_set_start_time(time(NULL));
 
     // 初始化快照，并在需要时写入当前映射（启动期）
-    MmapEntry initial_entries[MAPS_MAX_ENTRY];
-    int init_count = maps_init_snapshot(target_pid, initial_entries, MAPS_MAX_ENTRY);
-    if (init_count < 0) init_count = 0;
     const char* skip_init = getenv("IFETCHER_SKIP_INIT_SNAPSHOT");
     if (!(skip_init && strcmp(skip_init, "1") == 0)) {
-        for (int i = 0; i < init_count; i++) {
-            size_t file_size = 0;
-            int fd = open(initial_entries[i].filename, O_RDONLY);
-            if (fd >= 0) {
-                struct stat st;
-                if (fstat(fd, &st) == 0) {
-                    file_size = (size_t)st.st_size;
-                }
-                close(fd);
-            }
-            ProfilerLogEntry entry = {
-                .pid = target_pid,
-                .op_type = OP_MMAP,
-                .filename = initial_entries[i].filename,
-                .offset = 0,
-                .size = file_size,
-                .fd = -1,
-                .timestamp = time(NULL),
-                .addr_start = initial_entries[i].start,
-                .addr_end = initial_entries[i].end,
-                .file_offset = (off_t)initial_entries[i].file_offset,
-                .status = 0,
-                .err_no = 0
-            };
-            profiler_log(&entry);
-        }
+        log_snapshot(target_pid);
+    } else {
+        const MmapEntry* initial_entries = NULL;
+        maps_init_snapshot(target_pid, &initial_entries);
     }
 
+    // 磁盘采样（独立线程，timerfd 周期，与 maps 轮询间隔无关）
+    if (diskstats_enabled() && diskstats_start() != 0)
+        fprintf(stderr, "[ProcMonitor] Warning: failed to start disk sampler\n");
+    // 可选：页缓存驻留采样（独立线程，间隔通常远小于 maps 轮询）
+    if (residency_enabled() && residency_start(target_pid) != 0)
+        fprintf(stderr, "[ProcMonitor] Warning: failed to start residency sampler\n");
+    // 可选：perf 主缺页采样（失败时已打印原因，继续其余监控）
+    if (majfault_enabled()) majfault_start(target_pid);
+    // 进程级 I/O 计数（目标自身的读量与阻塞时间，供 analyzer 计算不受后台 I/O 干扰的密度）
+    if (procio_enabled() && procio_start(target_pid) != 0)
+        fprintf(stderr, "[ProcMonitor] Warning: failed to start process I/O sampler\n");
+
+    // libwrapper 已同步记录应用自身的 mmap；轮询只补 ld.so/dlopen 等未经拦截的映射，可用 IFETCHER_MAPS_POLL=0 关闭
+    const char* mpoll = getenv("IFETCHER_MAPS_POLL");
+    int maps_poll = !(mpoll && strcmp(mpoll, "0") == 0);
+
+    // 进程树：每轮发现新的后代进程（IFETCHER_FOLLOW_CHILDREN=0 时只看根进程），全部退出后结束
+    proc_tree_init(target_pid);
     while (monitor_running) {
-        if (kill(target_pid, 0) != 0 && errno != EPERM) {
+        if (proc_tree_poll(on_new_process, on_process_exit) == 0) {
             break;
         }
-        check_mmap_changes(target_pid);
-        monitor_disk_stats();
+        const pid_t* tree = NULL;
+        size_t tree_count = proc_tree_pids(&tree);
+        if (maps_poll) for (size_t i = 0; i < tree_count; i++) check_mmap_changes(tree[i]);
         if (interval_ms > 0) { struct timespec ts; ts.tv_sec = interval_ms / 1000; ts.tv_nsec = (long)((interval_ms % 1000) * 1000000L); nanosleep(&ts, NULL); } else { sleep(MONITOR_INTERVAL); }
     }
 
     // 退出前统一写入启动窗口内新增的映射（可跳过）
     if (!(skip_init && strcmp(skip_init, "1") == 0)) {
-        flush_startup_mmaps(target_pid);
+        flush_startup_mmaps();
     }
+    residency_stop();
+    majfault_stop();
+    procio_stop();
+    diskstats_stop();
+    proc_tree_free();
 
     if (verbose()) printf("Proc monitor stopped\n");
     return NULL;
 }
 
+static unsigned env_uint(const char* name, unsigned defv) {
+    const char* s = getenv(name);
+    if (!s || !*s) return defv;
+    char* e = NULL;
+    long v = strtol(s, &e, 10);
+    return (e == s || v < 0) ? defv : (unsigned)v;
+}
+
+// SIGUSR1 恢复采集，SIGUSR2 暂停采集（应用无需重启）
+static void on_capture_signal(int sig) {
+    if (ctl) atomic_store_explicit(&ctl->gate, sig == SIGUSR1 ? 1u : 0u, memory_order_relaxed);
+}
+
+// 网关文件与启动时刻改由监控侧轮询：条件满足后打开控制块的 gate，应用侧只读一次内存
+static void* control_thread_func(void* arg) {
+    (void)arg;
+    const char* gf = getenv("IFETCHER_GATE_FILE");
+    uint64_t start = atomic_load(&ctl->start_wall_ns);
+    unsigned poll_ms = env_uint("IFETCHER_CONTROL_POLL_MS", 10);
+    if (poll_ms < 1) poll_ms = 1;
+    while (ctl_running) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        if ((gf && access(gf, F_OK) == 0) ||
+            (start && (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec >= start)) {
+            atomic_store(&ctl->gate, 1u);
+            if (verbose()) printf("[ProcMonitor] capture gate opened\n");
+            break;
+        }
+        struct timespec ts = { poll_ms / 1000, (long)(poll_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+// 创建控制块并按环境变量初始化：spawn 模式默认放在 /dev/shm/ifetcher.<pid> 并经环境变量传给目标；
+// attach 模式只在显式设置 IFETCHER_CONTROL 时创建（目标须以同一路径启动）
+static void control_setup(int spawn) {
+    const char* cp = getenv("IFETCHER_CONTROL");
+    if (cp && strcmp(cp, "0") == 0) return;
+    if (cp && *cp) snprintf(ctl_path, sizeof(ctl_path), "%s", cp);
+    else if (spawn) snprintf(ctl_path, sizeof(ctl_path), "/dev/shm/ifetcher.%d", getpid());
+    else return;
+    ctl = control_create(ctl_path);
+    if (!ctl) {
+        fprintf(stderr, "[ProcMonitor] Warning: failed to create control block %s: %s\n", ctl_path, strerror(errno));
+        unsetenv("IFETCHER_CONTROL");
+        return;
+    }
+    const char* gf = getenv("IFETCHER_GATE_FILE");
+    const char* sts = getenv("IFETCHER_START_TS");
+    uint64_t start = (sts && *sts && atof(sts) > 0) ? (uint64_t)(atof(sts) * 1e9) : 0;
+    const char* f = getenv("IFETCHER_FILTER");
+    const char* d = getenv("IFETCHER_DEDUP");
+    uint32_t flags = ((f && strcmp(f, "0") == 0) ? 0 : CTL_FILTER) | ((d && strcmp(d, "0") == 0) ? 0 : CTL_DEDUP);
+    atomic_store(&ctl->filter_flags, flags);
+    atomic_store(&ctl->coalesce_ms, env_uint("IFETCHER_COALESCE_MS", READ_FILTER_COALESCE_MS));
+    atomic_store(&ctl->coalesce_max_kb, env_uint("IFETCHER_COALESCE_MAX_KB", READ_FILTER_COALESCE_MAX_KB));
+    atomic_store(&ctl->sample_rate, env_uint("IFETCHER_SAMPLE_RATE", 1));
+    atomic_store(&ctl->start_wall_ns, start);
+    atomic_store(&ctl->gate, (gf || start) ? 0u : 1u);
+    atomic_fetch_add(&ctl->generation, 1);
+    setenv("IFETCHER_CONTROL", ctl_path, 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_capture_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+    if (gf || start) {
+        ctl_running = 1;
+        if (pthread_create(&ctl_thread, NULL, control_thread_func, NULL) != 0) {
+            ctl_running = 0;
+            atomic_store(&ctl->gate, 1u);
+            fprintf(stderr, "[ProcMonitor] Warning: failed to start control thread, capture gate forced open\n");
+        }
+    }
+    if (verbose()) printf("[ProcMonitor] control block %s (kill -USR1/-USR2 %d to resume/pause capture)\n", ctl_path, getpid());
+}
+
+static void control_teardown(void) {
+    if (!ctl) return;
+    if (ctl_running) { ctl_running = 0; pthread_join(ctl_thread, NULL); }
+    signal(SIGUSR1, SIG_IGN);
+    signal(SIGUSR2, SIG_IGN);
+    control_destroy(ctl, ctl_path);
+    ctl = NULL;
+}
+
 // 停止 proc 监控线程
 void stop_proc_monitor() {
     monitor_running = 0;
@@ -107,14 +256,23 @@ void stop_proc_monitor() {
 // 删除不必要的前置声明：
 // int start_proc_monitor(pid_t target_pid);
 // 主函数（用于独立运行监控）
+static int spawn_gate_fd = -1;
+
 static pid_t spawn_target(int argc, char* argv[]) {
     /* 以子进程启动目标应用；记录完整命令行为 APP（用于日志首部）；并可通过 LD_PRELOAD 预加载 libwrapper.so 拦截读 */
     size_t len = 0; for (int i = 2; i < argc; i++) len += strlen(argv[i]) + 1; char* buf = (char*)malloc(len + 1); if (buf) { buf[0] = '\0'; for (int i = 2; i < argc; i++) { strcat(buf, argv[i]); if (i + 1 < argc) strcat(buf, " "); } profiler_log_set_app(buf); free(buf); }
+    // 子进程 exec 前阻塞在 gate 管道上，待父进程挂好 fanotify 等采集后端再放行，保证覆盖启动期
+    int gate[2] = { -1, -1 };
+    if (pipe(gate) != 0) gate[0] = gate[1] = -1;
+    int no_preload = fanotify_enabled() || bpf_monitor_enabled();
     pid_t child = fork();
     if (child == 0) {
-        // 可选：启用 read/fread 拦截，使用绝对路径防止 chdir 失效
+        if (gate[1] >= 0) { char c; close(gate[1]); while (read(gate[0], &c, 1) < 0 && errno == EINTR) {} close(gate[0]); }
+        // fanotify/eBPF 模式下不需要（也不应重复记录）LD_PRELOAD 拦截
         char cwd[1024];
-        if (getcwd(cwd, sizeof(cwd))) {
+        if (no_preload) {
+            unsetenv("LD_PRELOAD");
+        } else if (getcwd(cwd, sizeof(cwd))) {
             char libpath[1100];
             // 1. Try current directory
             snprintf(libpath, sizeof(libpath), "%s/libwrapper.so", cwd);
@@ -136,12 +294,23 @@ static pid_t spawn_target(int argc, char* argv[]) {
         perror("execvp failed");
         _exit(127);
     }
+    if (gate[0] >= 0) close(gate[0]);
+    spawn_gate_fd = gate[1];
     return child;
 }
 
+// 放行 spawn 出的子进程执行目标命令
+static void release_target(void) {
+    if (spawn_gate_fd >= 0) { close(spawn_gate_fd); spawn_gate_fd = -1; }
+}
+
 int main(int argc, char* argv[]) {
     if (argc >= 3 && strcmp(argv[1], "--spawn") == 0) {
+        control_setup(1);
         pid_t target_pid = spawn_target(argc, argv);
+        if (fanotify_enabled()) fanotify_start(target_pid);
+        if (bpf_monitor_enabled()) bpf_monitor_start(target_pid);
+        release_target();
         if (start_proc_monitor(target_pid) != 0) {
             perror("Failed to start proc monitor (spawn)");
             return EXIT_FAILURE;
@@ -149,6 +318,9 @@ int main(int argc, char* argv[]) {
         printf("Press Enter to stop monitoring...\n");
         getchar();
         stop_proc_monitor();
+        fanotify_stop();
+        bpf_monitor_stop();
+        control_teardown();
         return EXIT_SUCCESS;
     }
 
@@ -159,6 +331,9 @@ int main(int argc, char* argv[]) {
     }
 
     pid_t target_pid = atoi(argv[1]);
+    control_setup(0);
+    if (fanotify_enabled()) fanotify_start(target_pid);
+    if (bpf_monitor_enabled()) bpf_monitor_start(target_pid);
     if (start_proc_monitor(target_pid) != 0) {
         perror("Failed to start proc monitor");
         return EXIT_FAILURE;
@@ -169,6 +344,9 @@ int main(int argc, char* argv[]) {
     getchar();
 
     stop_proc_monitor();
+    fanotify_stop();
+    bpf_monitor_stop();
+    control_teardown();
     return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,147 @@
+#define _GNU_SOURCE
+#include "proc_tree.h"
+#include "profiler_common.h"
+#include <errno.h>
+#include <dirent.h>
+
+static pid_t* pids = NULL;
+static size_t pid_count = 0, pid_cap = 0;
+static int children_ok = 1;     // /proc/<pid>/task/<tid>/children 是否可用（CONFIG_PROC_CHILDREN）
+
+int proc_tree_enabled(void) {
+    const char* s = getenv("IFETCHER_FOLLOW_CHILDREN");
+    return !(s && strcmp(s, "0") == 0);
+}
+
+static int tracked(pid_t pid) {
+    for (size_t i = 0; i < pid_count; i++) if (pids[i] == pid) return 1;
+    return 0;
+}
+
+static int add_pid(pid_t pid) {
+    if (pid_count == pid_cap) {
+        size_t ncap = pid_cap ? pid_cap * 2 : 16;
+        pid_t* np = (pid_t*)realloc(pids, ncap * sizeof(pid_t));
+        if (!np) return -1;
+        pids = np;
+        pid_cap = ncap;
+    }
+    pids[pid_count++] = pid;
+    return 0;
+}
+
+// 读 /proc/<pid>/stat 的状态与 ppid；进程不存在返回 -1
+static int read_stat(pid_t pid, char* state, pid_t* ppid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    // comm 可含空格与括号，从最后一个 ')' 之后解析
+    char* p = strrchr(buf, ')');
+    if (!p || p[1] != ' ') return -1;
+    *state = p[2];
+    *ppid = (pid_t)strtol(p + 4, NULL, 10);
+    return 0;
+}
+
+// 僵尸进程的地址空间已释放，视同退出
+static int alive(pid_t pid) {
+    char state;
+    pid_t ppid;
+    if (read_stat(pid, &state, &ppid) != 0) return 0;
+    return state != 'Z' && state != 'X';
+}
+
+// 将 children 文件中的 pid 加入跟踪（线程刚退出时文件不存在，跳过即可）
+static void scan_children_file(const char* path, proc_tree_fn on_new) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return;
+    buf[n] = '\0';
+    char* p = buf;
+    while (*p) {
+        char* e;
+        long v = strtol(p, &e, 10);
+        if (e == p) break;
+        p = e;
+        pid_t child = (pid_t)v;
+        if (child > 0 && !tracked(child) && add_pid(child) == 0 && on_new) on_new(child);
+    }
+}
+
+// 从 pids[i] 开始逐个展开（新加入的也会被展开）
+static void discover_children(proc_tree_fn on_new) {
+    for (size_t i = 0; i < pid_count; i++) {
+        char task_path[64];
+        snprintf(task_path, sizeof(task_path), "/proc/%d/task", pids[i]);
+        DIR* d = opendir(task_path);
+        if (!d) continue;
+        struct dirent* de;
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+            char path[384];
+            snprintf(path, sizeof(path), "%s/%s/children", task_path, de->d_name);
+            scan_children_file(path, on_new);
+        }
+        closedir(d);
+    }
+}
+
+// 回退：扫描全部进程的 ppid，直到不再有新成员（孙进程可能排在父进程之前）
+static void discover_by_ppid(proc_tree_fn on_new) {
+    for (int changed = 1; changed;) {
+        changed = 0;
+        DIR* d = opendir("/proc");
+        if (!d) return;
+        struct dirent* de;
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] < '0' || de->d_name[0] > '9') continue;
+            pid_t pid = (pid_t)atoi(de->d_name);
+            char state;
+            pid_t ppid;
+            if (tracked(pid) || read_stat(pid, &state, &ppid) != 0 || !tracked(ppid)) continue;
+            if (add_pid(pid) == 0) {
+                changed = 1;
+                if (on_new) on_new(pid);
+            }
+        }
+        closedir(d);
+    }
+}
+
+void proc_tree_init(pid_t root) {
+    children_ok = access("/proc/thread-self/children", F_OK) == 0;
+    pid_count = 0;
+    add_pid(root);
+}
+
+int proc_tree_poll(proc_tree_fn on_new, proc_tree_fn on_exit) {
+    size_t w = 0;
+    for (size_t i = 0; i < pid_count; i++) {
+        if (!alive(pids[i])) { if (on_exit) on_exit(pids[i]); continue; }
+        pids[w++] = pids[i];
+    }
+    pid_count = w;
+    if (pid_count == 0 || !proc_tree_enabled()) return (int)pid_count;
+    if (children_ok) discover_children(on_new);
+    else discover_by_ppid(on_new);
+    return (int)pid_count;
+}
+
+size_t proc_tree_pids(const pid_t** out) {
+    *out = pids;
+    return pid_count;
+}
+
+void proc_tree_free(void) {
+    free(pids);
+    pids = NULL;
+    pid_count = pid_cap = 0;
+}
@@ -0,0 +1,30 @@
+#ifndef PROC_TREE_H
+#define PROC_TREE_H
+#include <sys/types.h>
+
+// 进程树跟踪：从根进程出发，经 /proc/<pid>/task/<tid>/children 逐层发现后代进程
+// （内核未开启 CONFIG_PROC_CHILDREN 时退回扫描 /proc/*/stat 的 ppid）。
+// 已发现的进程一直跟踪到退出为止，即使其父进程先退出、自身被 init 收养。
+// 两次扫描之间创建又退出的短命进程会漏掉（其 libwrapper 日志不受影响）。
+//
+// 环境变量：
+//   IFETCHER_FOLLOW_CHILDREN=0           只监控根进程（默认跟踪整棵进程树）
+
+typedef void (*proc_tree_fn)(pid_t pid);
+
+// 是否跟踪后代进程
+int proc_tree_enabled(void);
+
+// 以 root 为根开始跟踪（root 本身视为已发现，不触发 on_new）
+void proc_tree_init(pid_t root);
+
+// 重新扫描：对新发现的后代调用 on_new，对已退出的进程调用 on_exit；返回仍存活的进程数
+int proc_tree_poll(proc_tree_fn on_new, proc_tree_fn on_exit);
+
+// 当前跟踪中的存活进程；*out 在下次 proc_tree_poll 前有效
+size_t proc_tree_pids(const pid_t** out);
+
+// 释放资源
+void proc_tree_free(void);
+
+#endif // PROC_TREE_H
@@ -1,19 +1,75 @@
 #include "profiler_common.h"
+#include "trace_buffer.h"
+#include "trace_writer.h"
 #include <pthread.h>
+#include <errno.h>
 
 static FILE* read_log_file = NULL;
 static FILE* mmap_log_file = NULL;
 static FILE* stat_log_file = NULL;
+// 二进制格式写入器（IFETCHER_LOG_FORMAT=bin，默认）；文本格式保留为可选导出
+static TraceWriter* read_writer = NULL;
+static TraceWriter* mmap_writer = NULL;
+static TraceWriter* stat_writer = NULL;
+// 页粒度日志只有 proc_monitor 的采样线程写入，首个页事件到来时才打开
+static FILE* page_log_file = NULL;
+static TraceWriter* page_writer = NULL;
+static pthread_once_t page_log_once = PTHREAD_ONCE_INIT;
+static int binary_format = -1;
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 static char* app_cmdline = NULL;
 static char host_name[64] = {0};
 static char user_name[64] = {0};
 static int logging_disabled = 0; static int app_written_read = 0; static int app_written_mmap = 0; static int app_written_stat = 0;
+static int sync_logging = -1;   // IFETCHER_SYNC_LOG=1 时退回旧的逐条加锁写盘路径
+static int per_process_logs = 0;   // IFETCHER_PER_PROCESS_LOGS=1：二进制日志按进程分流为 <log>.<pid>
 void profiler_log_set_app(const char* cmd){ if (cmd) { app_cmdline = strdup(cmd);} }
 
+static void trace_sink(const TraceEvent* ev);
+static void trace_flush(void);
+
+// 打开文本日志（失败时回退到 /tmp 默认路径），并写入起始标记
+static FILE* open_text_log(const char* path, const char* fallback, const char* name, const char* banner) {
+    FILE* f = fopen(path, "a");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", name, strerror(errno));
+        f = fopen(fallback, "a");
+        if (f == NULL) {
+            fprintf(stderr, "[Profiler] Warning: Could not open %s (%s). Logging to it disabled.\n", name, fallback);
+        }
+    }
+    if (f) {
+        fprintf(f, "===== %s Log Started at %s =====\n", banner, get_timestamp());
+        fflush(f);
+    }
+    return f;
+}
+
+static TraceWriter* open_binary_log(const char* path, const char* fallback, const char* name) {
+    TraceWriter* (*open_fn)(const char*) = per_process_logs ? trace_writer_open_per_process : trace_writer_open;
+    TraceWriter* w = open_fn(path);
+    if (w == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", name, strerror(errno));
+        w = open_fn(fallback);
+        if (w == NULL) {
+            fprintf(stderr, "[Profiler] Warning: Could not open %s (%s). Logging to it disabled.\n", name, fallback);
+        }
+    }
+    return w;
+}
+
 // 初始化日志文件（分别打开三个）
 void profiler_log_init() {
     if (logging_disabled) return;
+    if (sync_logging < 0) {
+        const char* sl = getenv("IFETCHER_SYNC_LOG");
+        sync_logging = (sl && strcmp(sl, "1") == 0) ? 1 : 0;
+        const char* fmt = getenv("IFETCHER_LOG_FORMAT");
+        binary_format = (fmt && strcmp(fmt, "text") == 0) ? 0 : 1;
+        const char* pp = getenv("IFETCHER_PER_PROCESS_LOGS");
+        per_process_logs = (pp && strcmp(pp, "1") == 0) ? 1 : 0;   // 文本格式仍写共享文件
+        trace_buffer_init(trace_sink, trace_flush);
+    }
     const char* dir = getenv("IFETCHER_LOG_DIR");
     char rpath[128], mpath[128], spath[128];
     if (dir && *dir) {
@@ -25,52 +81,19 @@ void profiler_log_init() {
         snprintf(mpath, sizeof(mpath), "%s", MMAP_LOG_FILE);
         snprintf(spath, sizeof(spath), "%s", STAT_LOG_FILE);
     }
-    if (read_log_file == NULL) {
-        read_log_file = fopen(rpath, "a");
-        if (read_log_file == NULL) {
-            perror("Failed to open read_log");
-            // 尝试回退到 /tmp
-            read_log_file = fopen(READ_LOG_FILE, "a");
-            if (read_log_file == NULL) {
-                 fprintf(stderr, "[Profiler] Warning: Could not open read_log (%s). Read logging disabled.\n", READ_LOG_FILE);
-            }
-        }
-        if (read_log_file) {
-            fprintf(read_log_file, "===== READ/FREAD Log Started at %s =====\n", get_timestamp());
-            fflush(read_log_file);
-        }
-    }
-    if (mmap_log_file == NULL) {
-        mmap_log_file = fopen(mpath, "a");
-        if (mmap_log_file == NULL) {
-            perror("Failed to open mmap_log");
-            mmap_log_file = fopen(MMAP_LOG_FILE, "a");
-            if (mmap_log_file == NULL) {
-                 fprintf(stderr, "[Profiler] Warning: Could not open mmap_log (%s). Mmap logging disabled.\n", MMAP_LOG_FILE);
-            }
-        }
-        if (mmap_log_file) {
-            fprintf(mmap_log_file, "===== MMAP Log Started at %s =====\n", get_timestamp());
-            fflush(mmap_log_file);
-        }
-    }
-    if (stat_log_file == NULL) {
-        stat_log_file = fopen(spath, "a");
-        if (stat_log_file == NULL) {
-            perror("Failed to open stat_log");
-            stat_log_file = fopen(STAT_LOG_FILE, "a");
-            if (stat_log_file == NULL) {
-                 fprintf(stderr, "[Profiler] Warning: Could not open stat_log (%s). Disk stat logging disabled.\n", STAT_LOG_FILE);
-            }
-        }
-        if (stat_log_file) {
-            fprintf(stat_log_file, "===== Disk Stats Log Started at %s =====\n", get_timestamp());
-            fflush(stat_log_file);
-        }
+    if (binary_format) {
+        if (read_writer == NULL) read_writer = open_binary_log(rpath, READ_LOG_FILE, "read_log");
+        if (mmap_writer == NULL) mmap_writer = open_binary_log(mpath, MMAP_LOG_FILE, "mmap_log");
+        if (stat_writer == NULL) stat_writer = open_binary_log(spath, STAT_LOG_FILE, "stat_log");
+    } else {
+        if (read_log_file == NULL) read_log_file = open_text_log(rpath, READ_LOG_FILE, "read_log", "READ/FREAD");
+        if (mmap_log_file == NULL) mmap_log_file = open_text_log(mpath, MMAP_LOG_FILE, "mmap_log", "MMAP");
+        if (stat_log_file == NULL) stat_log_file = open_text_log(spath, STAT_LOG_FILE, "stat_log", "Disk Stats");
     }
-    
+
     // Only disable logging if ALL files failed
-    if (!read_log_file && !mmap_log_file && !stat_log_file) {
+    if (!read_log_file && !mmap_log_file && !stat_log_file &&
+        !read_writer && !mmap_writer && !stat_writer) {
         logging_disabled = 1;
         fprintf(stderr, "[Profiler] Error: All log files failed to open. Logging disabled.\n");
         return;
@@ -81,7 +104,15 @@ void profiler_log_init() {
         if (u && *u) { snprintf(user_name, sizeof(user_name), "%s", u); }
         else { snprintf(user_name, sizeof(user_name), "%s", "unknown"); }
     }
-    if (app_cmdline) {
+    if (binary_format) {
+        /* 二进制格式：APP/USER/HOST 写在每个会话的 SESSION 记录中 */
+        if (!app_written_read) {
+            trace_writer_set_info(read_writer, app_cmdline, user_name, host_name);
+            trace_writer_set_info(mmap_writer, app_cmdline, user_name, host_name);
+            trace_writer_set_info(stat_writer, app_cmdline, user_name, host_name);
+            app_written_read = app_written_mmap = app_written_stat = 1;
+        }
+    } else if (app_cmdline) {
         /* 将被监控应用完整命令行写入三份 /tmp 日志的首部，便于后续 analyzer/预取器自动识别 APP */
         if (read_log_file && !app_written_read) { fprintf(read_log_file, "APP=%s | USER=%s | HOST=%s\n", app_cmdline, user_name, host_name); fflush(read_log_file); app_written_read = 1; }
         if (mmap_log_file && !app_written_mmap) { fprintf(mmap_log_file, "APP=%s | USER=%s | HOST=%s\n", app_cmdline, user_name, host_name); fflush(mmap_log_file); app_written_mmap = 1; }
@@ -89,33 +120,191 @@ void profiler_log_init() {
     }
 }
 
-// 写入读取/映射日志，按类型选择文件
+static void open_page_log(void) {
+    const char* dir = getenv("IFETCHER_LOG_DIR");
+    char ppath[128];
+    if (dir && *dir) snprintf(ppath, sizeof(ppath), "%s/page_log", dir);
+    else snprintf(ppath, sizeof(ppath), "%s", PAGE_LOG_FILE);
+    if (binary_format) {
+        page_writer = open_binary_log(ppath, PAGE_LOG_FILE, "page_log");
+        trace_writer_set_info(page_writer, app_cmdline, user_name, host_name);
+    } else {
+        page_log_file = open_text_log(ppath, PAGE_LOG_FILE, "page_log", "PAGE");
+        if (page_log_file && app_cmdline) {
+            fprintf(page_log_file, "APP=%s | USER=%s | HOST=%s\n", app_cmdline, user_name, host_name);
+            fflush(page_log_file);
+        }
+    }
+}
+
+// 按操作类型选择目标日志
+static int is_page_op(OpType op) { return op == OP_CACHE || op == OP_FAULT; }
+
+uint64_t profiler_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 两次读单调时钟夹住一次墙钟读取，取中点作为对应的单调时刻
+void profiler_clock_anchor(uint64_t* wall_ns, uint64_t* mono_ns) {
+    struct timespec rt;
+    uint64_t m0 = profiler_now_ns();
+    clock_gettime(CLOCK_REALTIME, &rt);
+    uint64_t m1 = profiler_now_ns();
+    *wall_ns = (uint64_t)rt.tv_sec * 1000000000ULL + (uint64_t)rt.tv_nsec;
+    *mono_ns = m0 + (m1 - m0) / 2;
+}
+
+// 文本格式使用的进程级锚点（首次格式化时采样）
+static uint64_t text_anchor_wall = 0, text_anchor_mono = 0;
+
+// 将单调时间格式化为 "%Y-%m-%d %H:%M:%S.%09ld"（本地日历时间）；
+// 同一秒内复用上次的日期部分（仅 drain 线程或持 log_mutex 时调用）
+static const char* format_ts(const struct timespec* ts) {
+    static char buf[80];
+    static char sec_buf[64];
+    static time_t last_sec = (time_t)-1;
+    if (text_anchor_wall == 0) profiler_clock_anchor(&text_anchor_wall, &text_anchor_mono);
+    uint64_t mono = (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+    uint64_t wall = text_anchor_wall + (mono - text_anchor_mono);
+    time_t sec = (time_t)(wall / 1000000000ULL);
+    if (sec != last_sec) {
+        struct tm tm_info;
+        localtime_r(&sec, &tm_info);
+        strftime(sec_buf, sizeof(sec_buf), "%Y-%m-%d %H:%M:%S", &tm_info);
+        last_sec = sec;
+    }
+    snprintf(buf, sizeof(buf), "%s.%09llu", sec_buf, (unsigned long long)(wall % 1000000000ULL));
+    return buf;
+}
+
+static void write_entry(const struct timespec* ts, const ProfilerLogEntry* entry) {
+    FILE* target = is_map_op(entry->op_type) ? mmap_log_file :
+                   is_page_op(entry->op_type) ? page_log_file : read_log_file;
+    if (!target) return;
+
+    fprintf(target, "[%s] PID:%d | Type:%s | Status:%s | Errno:%d | ",
+            format_ts(ts), entry->pid, ift_op_name((uint64_t)entry->op_type),
+            entry->status==0?"OK":"ERR", entry->err_no);
+
+    if (is_map_op(entry->op_type)) {
+        fprintf(target, "File:%s | AddrStart:%lld | AddrEnd:%lld | FileOffset:%lld | Size:%zu",
+                entry->filename,
+                (long long)entry->addr_start,
+                (long long)entry->addr_end,
+                (long long)entry->file_offset,
+                (size_t)entry->size);
+        if (entry->flags) fprintf(target, " | Flags:0x%x", (unsigned)entry->flags);
+        fputc('\n', target);
+    } else {
+        fprintf(target, "FD:%d | File:%s | Offset:%lld | Size:%zu",
+                entry->fd, entry->filename, (long long)entry->offset, (size_t)entry->size);
+        if (entry->flags) fprintf(target, " | Flags:0x%x", (unsigned)entry->flags);
+        if (entry->req_size || entry->io_ns)
+            fprintf(target, " | Req:%zu | IoNs:%llu", entry->req_size, (unsigned long long)entry->io_ns);
+        if (entry->tid) fprintf(target, " | Tid:%d", (int)entry->tid);
+        fputc('\n', target);
+    }
+}
+
+static void write_diskstat(const struct timespec* ts, const char* dev_name, const unsigned long long* v) {
+    if (!stat_log_file) return;
+    fprintf(stat_log_file,
+            "[%s] Device:%s | reads:%llu | sectors_read:%llu | read_time_ms:%llu | "
+            "writes:%llu | sectors_written:%llu | write_time_ms:%llu | "
+            "io_time_ms:%llu | in_flight:%llu\n",
+            format_ts(ts), dev_name,
+            v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+}
+
+static void write_procio(const struct timespec* ts, pid_t pid, const unsigned long long* v) {
+    if (!stat_log_file) return;
+    fprintf(stat_log_file,
+            "[%s] Process:%d | rchar:%llu | read_bytes:%llu | syscr:%llu | majflt:%llu | blkio_ms:%llu\n",
+            format_ts(ts), (int)pid, v[0], v[1], v[2], v[3], v[4]);
+}
+
+static void write_devinfo(const struct timespec* ts, const char* dev_name, const unsigned long long* v) {
+    if (!stat_log_file) return;
+    fprintf(stat_log_file, "[%s] DeviceInfo:%s | rotational:%llu | queue_depth:%llu | logical_block_size:%llu\n",
+            format_ts(ts), dev_name, v[0], v[1], v[2]);
+}
+
+// 丢弃计数写入每个已打开的日志：各日志的事件来自同一批环，哪个日志缺了哪些事件无从区分
+static void write_drop(const struct timespec* ts, pid_t pid, unsigned long long count) {
+    FILE* files[4] = { read_log_file, mmap_log_file, stat_log_file, page_log_file };
+    for (int i = 0; i < 4; i++)
+        if (files[i]) fprintf(files[i], "[%s] PID:%d | Dropped:%llu\n", format_ts(ts), (int)pid, count);
+}
+
+// drain 线程回调：编码/格式化单个事件（不 flush，批量结束时统一 flush）
+static void trace_sink(const TraceEvent* ev) {
+    if (ev->kind == TRACE_EV_DROP) {
+        if (!binary_format) { write_drop(&ev->ts, ev->entry.pid, ev->stat[0]); return; }
+        TraceWriter* writers[4] = { read_writer, mmap_writer, stat_writer, page_writer };
+        for (int i = 0; i < 4; i++) trace_writer_drop(writers[i], &ev->ts, ev->entry.pid, ev->stat[0]);
+        return;
+    }
+    if (binary_format) {
+        if (ev->kind == TRACE_EV_DISKSTAT) trace_writer_diskstat(stat_writer, &ev->ts, ev->name, ev->stat);
+        else if (ev->kind == TRACE_EV_PROCIO) trace_writer_procio(stat_writer, &ev->ts, ev->entry.pid, ev->stat);
+        else if (ev->kind == TRACE_EV_DEVINFO) trace_writer_devinfo(stat_writer, &ev->ts, ev->name, ev->stat);
+        else trace_writer_event(is_map_op(ev->entry.op_type) ? mmap_writer :
+                                is_page_op(ev->entry.op_type) ? page_writer : read_writer, &ev->ts, &ev->entry);
+        return;
+    }
+    if (ev->kind == TRACE_EV_DISKSTAT) write_diskstat(&ev->ts, ev->name, ev->stat);
+    else if (ev->kind == TRACE_EV_PROCIO) write_procio(&ev->ts, ev->entry.pid, ev->stat);
+    else if (ev->kind == TRACE_EV_DEVINFO) write_devinfo(&ev->ts, ev->name, ev->stat);
+    else write_entry(&ev->ts, &ev->entry);
+}
+
+static void trace_flush(void) {
+    trace_writer_flush(read_writer);
+    trace_writer_flush(mmap_writer);
+    trace_writer_flush(stat_writer);
+    trace_writer_flush(page_writer);
+    if (read_log_file) fflush(read_log_file);
+    if (mmap_log_file) fflush(mmap_log_file);
+    if (stat_log_file) fflush(stat_log_file);
+    if (page_log_file) fflush(page_log_file);
+}
+
+// 进程退出时停止 drain 线程并写出剩余事件
+__attribute__((destructor)) static void profiler_log_fini(void) {
+    if (sync_logging == 0) trace_buffer_shutdown();
+}
+
+pid_t profiler_getpid(void) {
+    return trace_buffer_pid();
+}
+
+void profiler_log_flush(void) {
+    if (sync_logging == 0) trace_buffer_flush();
+}
+
+// 写入读取/映射日志：默认压入当前线程的环形缓冲，由后台线程批量格式化写盘
 void profiler_log(ProfilerLogEntry* entry) {
     profiler_log_init(); if (logging_disabled) return;
-    pthread_mutex_lock(&log_mutex);
-
-    const char* op_type_str[] = {"READ", "FREAD", "MMAP"};
-    FILE* target = (entry->op_type == OP_MMAP) ? mmap_log_file : read_log_file;
-
-    if (target) {
-        fprintf(target, "[%s] PID:%d | Type:%s | Status:%s | Errno:%d | ",
-                get_timestamp(), entry->pid, op_type_str[entry->op_type],
-                entry->status==0?"OK":"ERR", entry->err_no);
-
-        if (entry->op_type == OP_MMAP) {
-            fprintf(target, "File:%s | AddrStart:%lld | AddrEnd:%lld | FileOffset:%lld | Size:%zu\n",
-                    entry->filename,
-                    (long long)entry->addr_start,
-                    (long long)entry->addr_end,
-                    (long long)entry->file_offset,
-                    (size_t)entry->size);
-        } else {
-            fprintf(target, "FD:%d | File:%s | Offset:%lld | Size:%zu\n",
-                    entry->fd, entry->filename, (long long)entry->offset, (size_t)entry->size);
-        }
-        fflush(target);
+    if (is_page_op(entry->op_type)) pthread_once(&page_log_once, open_page_log);
+    TraceEvent ev;
+    ev.kind = TRACE_EV_ENTRY;
+    uint64_t ts_ns = entry->ts_ns ? entry->ts_ns : profiler_now_ns();
+    ev.ts.tv_sec = (time_t)(ts_ns / 1000000000ULL);
+    ev.ts.tv_nsec = (long)(ts_ns % 1000000000ULL);
+    ev.entry = *entry;
+    snprintf(ev.name, sizeof(ev.name), "%s", entry->filename ? entry->filename : "unknown");
+    ev.entry.filename = ev.name;
+
+    if (sync_logging) {
+        pthread_mutex_lock(&log_mutex);
+        trace_sink(&ev);
+        trace_flush();
+        pthread_mutex_unlock(&log_mutex);
+        return;
     }
-    pthread_mutex_unlock(&log_mutex);
+    trace_buffer_push(&ev);
 }
 
 // 新增：写入磁盘采样日志
@@ -128,30 +317,75 @@ void profiler_log_diskstat(const char* dev_name,
                            unsigned long long write_time_ms_delta,
                            unsigned long long io_time_ms_delta,
                            unsigned long long in_flight) {
-    profiler_log_init();
-    pthread_mutex_lock(&log_mutex);
+    profiler_log_init(); if (logging_disabled) return;
+    TraceEvent ev;
+    ev.kind = TRACE_EV_DISKSTAT;
+    clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    ev.stat[0] = reads_delta; ev.stat[1] = sectors_read_delta; ev.stat[2] = read_time_ms_delta;
+    ev.stat[3] = writes_delta; ev.stat[4] = sectors_written_delta; ev.stat[5] = write_time_ms_delta;
+    ev.stat[6] = io_time_ms_delta; ev.stat[7] = in_flight;
+    snprintf(ev.name, sizeof(ev.name), "%s", dev_name);
 
-    if (stat_log_file) {
-        fprintf(stat_log_file,
-                "[%s] Device:%s | reads:%llu | sectors_read:%llu | read_time_ms:%llu | "
-                "writes:%llu | sectors_written:%llu | write_time_ms:%llu | "
-                "io_time_ms:%llu | in_flight:%llu\n",
-                get_timestamp(), dev_name,
-                reads_delta, sectors_read_delta, read_time_ms_delta,
-                writes_delta, sectors_written_delta, write_time_ms_delta,
-                io_time_ms_delta, in_flight);
+    if (sync_logging) {
+        pthread_mutex_lock(&log_mutex);
+        trace_sink(&ev);
+        trace_flush();
+        pthread_mutex_unlock(&log_mutex);
+        return;
+    }
+    trace_buffer_push(&ev);
+}
+
+void profiler_log_procio(pid_t pid, uint64_t ts_ns,
+                         unsigned long long rchar_delta,
+                         unsigned long long read_bytes_delta,
+                         unsigned long long syscr_delta,
+                         unsigned long long majflt_delta,
+                         unsigned long long blkio_ms_delta) {
+    profiler_log_init(); if (logging_disabled) return;
+    TraceEvent ev;
+    ev.kind = TRACE_EV_PROCIO;
+    ev.ts.tv_sec = (time_t)(ts_ns / 1000000000ULL);
+    ev.ts.tv_nsec = (long)(ts_ns % 1000000000ULL);
+    ev.entry.pid = pid;
+    ev.stat[0] = rchar_delta; ev.stat[1] = read_bytes_delta; ev.stat[2] = syscr_delta;
+    ev.stat[3] = majflt_delta; ev.stat[4] = blkio_ms_delta;
+
+    if (sync_logging) {
+        pthread_mutex_lock(&log_mutex);
+        trace_sink(&ev);
+        trace_flush();
+        pthread_mutex_unlock(&log_mutex);
+        return;
+    }
+    trace_buffer_push(&ev);
+}
 
-        fflush(stat_log_file);
+void profiler_log_devinfo(const char* dev_name, int rotational, unsigned queue_depth, unsigned logical_block_size) {
+    profiler_log_init(); if (logging_disabled) return;
+    TraceEvent ev;
+    ev.kind = TRACE_EV_DEVINFO;
+    clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+    ev.stat[0] = (unsigned long long)rotational; ev.stat[1] = queue_depth; ev.stat[2] = logical_block_size;
+    snprintf(ev.name, sizeof(ev.name), "%s", dev_name);
+
+    if (sync_logging) {
+        pthread_mutex_lock(&log_mutex);
+        trace_sink(&ev);
+        trace_flush();
+        pthread_mutex_unlock(&log_mutex);
+        return;
     }
-    pthread_mutex_unlock(&log_mutex);
+    trace_buffer_push(&ev);
 }
 
 // 获取当前时间戳字符串
 const char* get_timestamp() {
-    static char buf[64];
+    static __thread char buf[64];
     time_t now = time(NULL);
-    struct tm* tm_info = localtime(&now);
-    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm_info);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_info);
     return buf;
 }
 
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -14,6 +15,7 @@
 #define READ_LOG_FILE "/tmp/read_log"
 #define MMAP_LOG_FILE "/tmp/mmap_log"
 #define STAT_LOG_FILE "/tmp/stat_log"
+#define PAGE_LOG_FILE "/tmp/page_log"   // 页粒度事件（页缓存驻留等），首次写入时才创建
 
 // 日志级别
 typedef enum {
@@ -23,13 +25,30 @@ typedef enum {
     LOG_ERROR
 } LogLevel;
 
-// 读取操作类型
+// 读取操作类型（数值写入二进制 trace，新增类型只能追加在末尾，并同步 trace_format.h 的 ift_op_name）
 typedef enum {
     OP_READ,    // read() 系统调用
     OP_FREAD,   // fread() 库函数
-    OP_MMAP     // mmap() 映射读取
+    OP_MMAP,    // mmap() 映射读取
+    OP_PREAD,   // pread()/pread64()
+    OP_READV,   // readv()
+    OP_PREADV,  // preadv()/preadv2()
+    OP_SENDFILE,    // sendfile()：记录对源文件的读取
+    OP_COPY_RANGE,  // copy_file_range()：记录对源文件的读取
+    OP_OPEN,    // open()/openat() 系列，flags 为打开标志
+    OP_FOPEN,   // fopen()，flags 为底层 fd 的 F_GETFL
+    OP_CACHE,   // 页缓存驻留新增：offset/size 为新进入页缓存的页区间（写入 page_log）
+    OP_FAULT,   // 主缺页（perf 采样）：offset/size 为缺页所在的文件页（写入 page_log）
+    OP_MUNMAP,  // munmap()：addr 区间为解除的范围，文件/偏移取自被解除的文件映射
+    OP_MREMAP,  // mremap()：addr 区间为新位置，offset/size 为原位置与原长度
+    OP_MADVISE  // madvise()：作用于文件映射的建议，flags 为 advice
 } OpType;
 
+// 映射类操作：写入 mmap_log（二进制为 IFT_REC_MMAP 记录）
+static inline int is_map_op(int op) {
+    return op == OP_MMAP || op == OP_MUNMAP || op == OP_MREMAP || op == OP_MADVISE;
+}
+
 // 日志结构体
 typedef struct {
     pid_t pid;             // 进程ID
@@ -38,23 +57,40 @@ typedef struct {
     off_t offset;          // 读取偏移量（read/fread）
     size_t size;           // 读取大小（字节）
     int fd;                // 文件描述符（read/fread时有效）
-    time_t timestamp;      // 时间戳
+    uint64_t ts_ns;        // 采集时刻（CLOCK_MONOTONIC 纳秒）；0 表示由 profiler_log 取当前时间
     off_t addr_start;      // mmap: 内存映射起始地址
     off_t addr_end;        // mmap: 内存映射结束地址
     off_t file_offset;     // mmap: 文件偏移（/proc/<pid>/maps 第三列）
     int status;            // 0=OK, 1=ERR
     int err_no;            // 当 status=ERR 时记录 errno
+    int flags;             // open/fopen: 打开标志（O_DIRECT 等）；mmap: prot；madvise: advice；其余为 0
+    size_t req_size;       // 读：请求长度（size 为实际返回长度）；0 表示未知
+    uint64_t io_ns;        // 读：调用耗时（单调时钟纳秒，合并的区间为各次之和）；0 表示未测量
+    pid_t tid;             // 线程 ID（eBPF 后端填写）；0 表示未知
 } ProfilerLogEntry;
 
 // 日志初始化
 void profiler_log_init();
 
-// 写入日志
+// 写入日志（压入当前线程的环形缓冲，由后台 drain 线程批量写盘；IFETCHER_SYNC_LOG=1 时同步写）
 void profiler_log(ProfilerLogEntry* entry);
 
-// 获取当前时间戳（字符串格式）
+// 同步写出所有线程缓冲中的事件（exec 前调用，避免丢失）
+void profiler_log_flush(void);
+
+// 缓存的当前进程 pid（fork 后自动刷新），替代每次调用 getpid()
+pid_t profiler_getpid(void);
+
+// 获取当前时间戳（字符串格式，线程本地缓冲）
 const char* get_timestamp();
 
+// 采集时钟：CLOCK_MONOTONIC 纳秒，不受 NTP/手工调时影响，所有进程共用
+uint64_t profiler_now_ns(void);
+
+// 墙钟锚点：采样同一时刻的 CLOCK_REALTIME 与 CLOCK_MONOTONIC（纳秒），
+// 用于把单调时间换算为日历时间：wall = wall_ns + (mono - mono_ns)
+void profiler_clock_anchor(uint64_t* wall_ns, uint64_t* mono_ns);
+
 // 从文件描述符获取文件路径（通过 /proc/[pid]/fd/[fd]）
 char* get_filename_from_fd(int fd);
 
@@ -69,6 +105,18 @@ void profiler_log_diskstat(const char* dev_name,
                            unsigned long long io_time_ms_delta,
                            unsigned long long in_flight);
 
+// 写入进程 I/O 采样日志（stat_log）：/proc/<pid>/io 的 rchar、read_bytes、syscr，/proc/<pid>/stat 的 majflt
+// 与 delayacct_blkio_ticks（换算为毫秒）在相邻采样间的增量；ts_ns 为本轮采样时刻（同一轮各进程相同）
+void profiler_log_procio(pid_t pid, uint64_t ts_ns,
+                         unsigned long long rchar_delta,
+                         unsigned long long read_bytes_delta,
+                         unsigned long long syscr_delta,
+                         unsigned long long majflt_delta,
+                         unsigned long long blkio_ms_delta);
+
+// 写入设备信息（stat_log，每个设备一次）：是否旋转介质、队列深度（nr_requests）、逻辑块大小
+void profiler_log_devinfo(const char* dev_name, int rotational, unsigned queue_depth, unsigned logical_block_size);
+
 void profiler_log_set_app(const char* cmdline);
 
 #endif // PROFILER_COMMON_H
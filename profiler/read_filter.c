@@ -0,0 +1,301 @@
+#define _GNU_SOURCE
+#include "read_filter.h"
+#include "trace_buffer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+// 待发区间表与 fd_table 一样按块懒分配（覆盖 fd < 1M）
+#define RF_CHUNK  1024
+#define RF_CHUNKS 1024
+#define RF_PATH_MAX 256
+#define RF_PAGE_SHIFT 12
+#define RF_MAX_PAGES (1u << 18)     // 每个文件的位图最多覆盖 1 GiB（32 KiB）
+
+// 每个文件一项：是否普通文件 + 已记录页位图。创建后不释放，指针可缓存在区间里
+typedef struct {
+    char* path;
+    uint64_t hash;
+    int regular;
+    size_t npages;                  // 位图覆盖的页数（首次读时的文件大小，0 表示不去重）
+    _Atomic uint64_t* bits;
+} FileBits;
+
+// 每个 fd 一个待发区间，lock 保护全部字段。fork 后子进程重新初始化各区间的锁并清空区间
+// （父进程其它线程可能正持有锁）：继承来的待发区间归父进程发出
+typedef struct {
+    pthread_mutex_t lock;
+    int active;
+    pid_t pid;
+    int fd;
+    OpType op;
+    off_t start, end;
+    uint64_t ts;
+    uint64_t req, io_ns;
+    FileBits* file;                 // path 对应的文件项，区间发出后仍保留，close/dup 时清除
+    char path[RF_PATH_MAX];
+} Extent;
+
+static int enabled = 1;
+static int dedup = 1;
+static uint64_t window_ns = READ_FILTER_COALESCE_MS * 1000000ULL;
+static off_t max_len = READ_FILTER_COALESCE_MAX_KB * 1024L;
+
+static _Atomic(Extent*) chunks[RF_CHUNKS];
+static FileBits** files = NULL;
+static size_t file_count = 0, file_cap = 0;
+static pthread_mutex_t files_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void extents_reset(void);
+
+static void atfork_prepare(void) { pthread_mutex_lock(&files_mutex); }
+static void atfork_parent(void) { pthread_mutex_unlock(&files_mutex); }
+static void atfork_child(void) { pthread_mutex_init(&files_mutex, NULL); extents_reset(); }
+
+static long env_long(const char* name, long defv) {
+    const char* s = getenv(name);
+    if (!s || !*s) return defv;
+    char* e = NULL;
+    long v = strtol(s, &e, 10);
+    return (e == s || v < 0) ? defv : v;
+}
+
+void read_filter_init(void) {
+    const char* s = getenv("IFETCHER_FILTER");
+    enabled = !(s && strcmp(s, "0") == 0);
+    s = getenv("IFETCHER_DEDUP");
+    dedup = !(s && strcmp(s, "0") == 0);
+    window_ns = (uint64_t)env_long("IFETCHER_COALESCE_MS", READ_FILTER_COALESCE_MS) * 1000000ULL;
+    max_len = (off_t)env_long("IFETCHER_COALESCE_MAX_KB", READ_FILTER_COALESCE_MAX_KB) * 1024;
+    pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+    trace_buffer_set_tick(read_filter_flush_aged);
+}
+
+// 已创建的文件项保持原样：关闭去重后其位图不再查询，重新开启只对新出现的文件生效
+void read_filter_configure(int enable, int dedup_pages, unsigned coalesce_ms, unsigned coalesce_max_kb) {
+    enabled = enable;
+    dedup = dedup_pages;
+    window_ns = (uint64_t)coalesce_ms * 1000000ULL;
+    if (coalesce_max_kb) max_len = (off_t)coalesce_max_kb * 1024;
+}
+
+int read_filter_enabled(void) {
+    return enabled;
+}
+
+int read_filter_path_ok(const char* p) {
+    if (!p || p[0] != '/') return 0;
+    if (strncmp(p, "/proc/", 6) == 0 || strncmp(p, "/sys/", 5) == 0 || strncmp(p, "/dev/", 5) == 0) return 0;
+    return strncmp(p, "/memfd:", 7) != 0;
+}
+
+static uint64_t hash_path(const char* s) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*s) { h ^= (unsigned char)*s++; h *= 1099511628211ULL; }
+    return h;
+}
+
+// 调用方持有 files_mutex
+static int files_grow(void) {
+    size_t ncap = file_cap ? file_cap * 2 : 256;
+    FileBits** nf = (FileBits**)calloc(ncap, sizeof(FileBits*));
+    if (!nf) return -1;
+    for (size_t i = 0; i < file_cap; i++) {
+        if (!files[i]) continue;
+        size_t j = files[i]->hash & (ncap - 1);
+        while (nf[j]) j = (j + 1) & (ncap - 1);
+        nf[j] = files[i];
+    }
+    free(files);
+    files = nf;
+    file_cap = ncap;
+    return 0;
+}
+
+// 按路径取文件项；首次出现时 fstat 一次判定类型并按当前大小分配位图。内存不足返回 NULL（按普通文件处理、不去重）
+static FileBits* file_get(const char* path, int fd) {
+    uint64_t h = hash_path(path);
+    pthread_mutex_lock(&files_mutex);
+    if ((file_count + 1) * 2 > file_cap && files_grow() != 0) { pthread_mutex_unlock(&files_mutex); return NULL; }
+    size_t i = h & (file_cap - 1);
+    for (; files[i]; i = (i + 1) & (file_cap - 1)) {
+        if (files[i]->hash == h && strcmp(files[i]->path, path) == 0) {
+            FileBits* f = files[i];
+            pthread_mutex_unlock(&files_mutex);
+            return f;
+        }
+    }
+    FileBits* f = (FileBits*)calloc(1, sizeof(FileBits));
+    char* dup = f ? strdup(path) : NULL;
+    if (!dup) { free(f); pthread_mutex_unlock(&files_mutex); return NULL; }
+    struct stat st;
+    f->path = dup;
+    f->hash = h;
+    f->regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (f->regular && dedup && st.st_size > 0) {
+        size_t np = (size_t)((st.st_size + (1 << RF_PAGE_SHIFT) - 1) >> RF_PAGE_SHIFT);
+        if (np > RF_MAX_PAGES) np = RF_MAX_PAGES;
+        f->bits = (_Atomic uint64_t*)calloc((np + 63) / 64, sizeof(uint64_t));
+        if (f->bits) f->npages = np;
+    }
+    files[i] = f;
+    file_count++;
+    pthread_mutex_unlock(&files_mutex);
+    return f;
+}
+
+// 对 [off, off+len) 覆盖的位图页逐字处理：mark=1 时置位并返回 0；mark=0 时返回是否全部已置位。
+// 超出位图范围的页视为未记录
+static int pages_op(FileBits* f, off_t off, size_t len, int mark) {
+    if (!f || !f->bits || len == 0) return 0;
+    uint64_t first = (uint64_t)off >> RF_PAGE_SHIFT;
+    uint64_t last = ((uint64_t)off + len - 1) >> RF_PAGE_SHIFT;
+    if (last >= f->npages) {
+        if (!mark) return 0;
+        if (first >= f->npages) return 0;
+        last = f->npages - 1;
+    }
+    for (uint64_t w = first >> 6; w <= last >> 6; w++) {
+        uint64_t lo = (w == first >> 6) ? (first & 63) : 0;
+        uint64_t hi = (w == last >> 6) ? (last & 63) : 63;
+        uint64_t mask = (hi == 63 ? ~0ULL : ((1ULL << (hi + 1)) - 1)) & ~((1ULL << lo) - 1);
+        if (mark) atomic_fetch_or_explicit(&f->bits[w], mask, memory_order_relaxed);
+        else if ((atomic_load_explicit(&f->bits[w], memory_order_relaxed) & mask) != mask) return 0;
+    }
+    return !mark;
+}
+
+static Extent* get_extent(int fd, int create) {
+    if (fd < 0 || fd >= RF_CHUNK * RF_CHUNKS) return NULL;
+    _Atomic(Extent*)* slot = &chunks[fd / RF_CHUNK];
+    Extent* c = atomic_load_explicit(slot, memory_order_acquire);
+    if (!c && create) {
+        Extent* fresh = (Extent*)calloc(RF_CHUNK, sizeof(Extent));
+        if (!fresh) return NULL;
+        for (int i = 0; i < RF_CHUNK; i++) pthread_mutex_init(&fresh[i].lock, NULL);
+        if (atomic_compare_exchange_strong(slot, &c, fresh)) c = fresh;
+        else free(fresh);
+    }
+    return c ? &c[fd % RF_CHUNK] : NULL;
+}
+
+// 子进程（atfork）：其它线程已不存在，直接重建每个区间的锁
+static void extents_reset(void) {
+    for (int c = 0; c < RF_CHUNKS; c++) {
+        Extent* chunk = atomic_load_explicit(&chunks[c], memory_order_acquire);
+        if (!chunk) continue;
+        for (int i = 0; i < RF_CHUNK; i++) {
+            pthread_mutex_init(&chunk[i].lock, NULL);
+            chunk[i].active = 0;
+            chunk[i].file = NULL;
+            chunk[i].path[0] = '\0';
+        }
+    }
+}
+
+// 调用方持锁
+static void extent_emit(Extent* x) {
+    ProfilerLogEntry entry = {
+        .pid = x->pid,
+        .op_type = x->op,
+        .filename = x->path,
+        .offset = x->start,
+        .size = (size_t)(x->end - x->start),
+        .fd = x->fd,
+        .ts_ns = x->ts,
+        .req_size = (size_t)x->req,
+        .io_ns = x->io_ns
+    };
+    profiler_log(&entry);
+    x->active = 0;
+}
+
+void read_filter_submit(OpType op, int fd, const char* path, off_t offset, size_t req, ssize_t ret,
+                        uint64_t t0, uint64_t io_ns) {
+    if (ret <= 0 || !read_filter_path_ok(path)) return;
+    pid_t me = profiler_getpid();
+    Extent* x = get_extent(fd, 1);
+    if (!x) {
+        // 超出表范围：只做类型过滤，逐次记录
+        FileBits* f = file_get(path, fd);
+        if (f && !f->regular) return;
+        Extent tmp = { .pid = me, .fd = fd, .op = op, .start = offset, .end = offset + ret, .ts = t0,
+                       .req = req, .io_ns = io_ns };
+        snprintf(tmp.path, sizeof(tmp.path), "%s", path);
+        extent_emit(&tmp);
+        return;
+    }
+    pthread_mutex_lock(&x->lock);
+    if (x->active && x->pid != me) x->active = 0;
+    int same_path = x->path[0] && strcmp(x->path, path) == 0;
+    int same_file = x->active && same_path;
+    if (same_file && x->op == op && x->end == offset && t0 - x->ts <= window_ns &&
+        x->end - x->start + ret <= max_len) {
+        x->end += ret;
+        x->req += req;
+        x->io_ns += io_ns;
+        pages_op(x->file, offset, (size_t)ret, 1);
+        pthread_mutex_unlock(&x->lock);
+        return;
+    }
+    // 文件项缓存在 fd 的区间里，同一 fd 上只有首次读需要查表（files_mutex）
+    FileBits* f = same_path && x->file ? x->file : file_get(path, fd);
+    if ((f && !f->regular) || (dedup && pages_op(f, offset, (size_t)ret, 0))) { pthread_mutex_unlock(&x->lock); return; }
+    pages_op(f, offset, (size_t)ret, 1);
+    if (x->active) extent_emit(x);
+    x->active = 1;
+    x->pid = me;
+    x->fd = fd;
+    x->op = op;
+    x->start = offset;
+    x->end = offset + ret;
+    x->ts = t0;
+    x->req = req;
+    x->io_ns = io_ns;
+    x->file = f;
+    if (!same_path) snprintf(x->path, sizeof(x->path), "%s", path);
+    if (window_ns == 0) extent_emit(x);
+    pthread_mutex_unlock(&x->lock);
+    // 待发区间由 drain 线程按时发出（read_filter_flush_aged），进程被杀时不会丢失
+    if (window_ns) trace_buffer_start();
+}
+
+// forget：fd 即将关闭或被覆盖，一并清除缓存的文件项
+static void flush_extent(Extent* x, pid_t me, int forget) {
+    pthread_mutex_lock(&x->lock);
+    if (x->active && x->pid == me) extent_emit(x);
+    x->active = 0;
+    if (forget) { x->file = NULL; x->path[0] = '\0'; }
+    pthread_mutex_unlock(&x->lock);
+}
+
+void read_filter_flush_fd(int fd) {
+    Extent* x = get_extent(fd, 0);
+    if (x) flush_extent(x, profiler_getpid(), 1);
+}
+
+void read_filter_flush_all(void) {
+    pid_t me = profiler_getpid();
+    for (int c = 0; c < RF_CHUNKS; c++) {
+        Extent* chunk = atomic_load_explicit(&chunks[c], memory_order_acquire);
+        if (!chunk) continue;
+        for (int i = 0; i < RF_CHUNK; i++) flush_extent(&chunk[i], me, 0);
+    }
+}
+
+// 只发出起始超过两个窗口的区间：t0 取在读调用之前，慢读返回时仍可能并入刚满一个窗口的区间。
+// 正在使用的区间（trylock 失败）留给持有者，下一轮再看
+void read_filter_flush_aged(uint64_t now_ns) {
+    if (!enabled || window_ns == 0) return;
+    pid_t me = profiler_getpid();
+    for (int c = 0; c < RF_CHUNKS; c++) {
+        Extent* chunk = atomic_load_explicit(&chunks[c], memory_order_acquire);
+        if (!chunk) continue;
+        for (int i = 0; i < RF_CHUNK; i++) {
+            Extent* x = &chunk[i];
+            if (pthread_mutex_trylock(&x->lock) != 0) continue;
+            if (x->active && x->pid == me && now_ns > x->ts + 2 * window_ns) extent_emit(x);
+            pthread_mutex_unlock(&x->lock);
+        }
+    }
+}
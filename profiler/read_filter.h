@@ -0,0 +1,51 @@
+#ifndef READ_FILTER_H
+#define READ_FILTER_H
+#include <sys/types.h>
+#include "profiler_common.h"
+
+// libwrapper 的进程内读事件过滤：在入环/格式化之前丢弃与预取无关的读，
+// 并把同一 fd 上的顺序读合并为一个区间（extent），压缩日志量与每事件开销。
+//   1. 非普通文件直接丢弃：管道/套接字/anon_inode（路径不以 '/' 开头）、/proc、/sys、/dev、memfd，
+//      以及 fstat 不是 S_ISREG 的文件；失败的读与返回 0 的读（EOF）同样丢弃
+//   2. 合并：与该 fd 上待发区间首尾相接的同类读并入区间，区间以首次读的时刻记录；
+//      遇到不相接的读、超时、超长、close/dup 覆盖、exec/_exit/进程退出时发出，
+//      闲置的区间由 drain 线程定时发出（进程被 SIGKILL 时至多丢失最近两个窗口内的区间）
+//   3. 去重：每个文件一张页位图，不与待发区间相接、且覆盖的页全部记录过的读直接丢弃
+// 合并后一条记录的 size 为区间总长，按读次数统计的指标随之变小。
+//
+// 环境变量：
+//   IFETCHER_FILTER=0               关闭过滤，逐次记录全部读（含失败的读）
+//   IFETCHER_COALESCE_MS=<ms>       区间最长持续时间（默认 50；0 关闭合并）
+//   IFETCHER_COALESCE_MAX_KB=<kb>   区间最大长度（默认 4096）
+//   IFETCHER_DEDUP=0                关闭页位图去重
+
+#define READ_FILTER_COALESCE_MS      50      // IFETCHER_COALESCE_MS 默认值
+#define READ_FILTER_COALESCE_MAX_KB  4096    // IFETCHER_COALESCE_MAX_KB 默认值
+
+// 读取环境变量（libwrapper init 中调用一次）
+void read_filter_init(void);
+
+// 覆盖环境变量给出的设置（libwrapper 从 proc_monitor 控制块加载）；coalesce_ms 为 0 时关闭合并
+void read_filter_configure(int enable, int dedup_pages, unsigned coalesce_ms, unsigned coalesce_max_kb);
+
+// 是否启用过滤
+int read_filter_enabled(void);
+
+// 路径是否可能是与预取相关的普通文件（只看路径，不做系统调用）
+int read_filter_path_ok(const char* path);
+
+// 提交一次读（调用方已确认日志开启）：过滤、去重、合并，必要时调用 profiler_log。
+// req 为请求长度，t0 为调用开始时刻，io_ns 为调用耗时；合并的区间取首次的 t0，req/io_ns 累加
+void read_filter_submit(OpType op, int fd, const char* path, off_t offset, size_t req, ssize_t ret,
+                        uint64_t t0, uint64_t io_ns);
+
+// 发出 fd 上的待发区间（close/dup 覆盖前调用）
+void read_filter_flush_fd(int fd);
+
+// 发出全部待发区间（exec/_exit/进程退出前调用）
+void read_filter_flush_all(void);
+
+// 发出起始早于 now_ns 两个合并窗口的待发区间（drain 线程每轮调用，见 trace_buffer_set_tick）
+void read_filter_flush_aged(uint64_t now_ns);
+
+#endif // READ_FILTER_H
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+#include "residency.h"
+#include "profiler_common.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#ifndef __NR_cachestat
+#define __NR_cachestat 451
+#endif
+
+// cachestat(2) 的参数结构（Linux 6.5+），自带定义以兼容旧头文件
+struct ift_cachestat_range { uint64_t off; uint64_t len; };
+struct ift_cachestat { uint64_t nr_cache, nr_dirty, nr_writeback, nr_evicted, nr_recently_evicted; };
+
+typedef struct {
+    char path[256];
+    pid_t pid;                  // 首个打开/映射该文件的进程（写入日志的 pid）
+    int fd;                     // -1：无法打开（权限等），retry 为 0 时不再重试
+    int retry;                  // 因 fd 耗尽（EMFILE/ENFILE）打开失败，下轮采样重试
+    off_t size;
+    void* map;                  // PROT_READ 映射，仅用于 mincore，不会触发缺页
+    size_t pages;
+    unsigned char* resident;    // 上次采样的页位图（每页 1 字节，低位有效）
+    uint64_t last_cache;        // 上次 cachestat 结果；未变化时跳过 mincore
+    uint64_t last_evicted;
+    int sampled;                // 是否已做过首次 mincore
+    int baseline;               // 首轮发现的文件：首次采样只建基线不输出
+} ResFile;
+
+static ResFile* files = NULL;
+static size_t file_count = 0, file_cap = 0;
+static int* index_slots = NULL;     // 路径 -> files 下标（开放寻址，-1 为空）
+static size_t index_cap = 0;
+
+// 被采样的进程（进程树成员）；residency_add_process 由监控线程调用，需加锁
+static pid_t* pids = NULL;
+static size_t pid_count = 0, pid_cap = 0;
+static pthread_mutex_t pid_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t sampler_thread;
+static volatile int sampler_running = 0;
+static int interval_ms = 50;
+static size_t max_files = 0;
+static int cachestat_ok = 1;
+static long page_size = 4096;
+static int first_pass = 1;
+static int emit_baseline = 0;
+static unsigned long long ranges_emitted = 0;
+
+static int verbose() { const char* v = getenv("IFETCHER_VERBOSE"); return (v == NULL || strcmp(v, "0") != 0); }
+
+static int env_int(const char* name, int defv) {
+    const char* s = getenv(name);
+    if (!s || !*s) return defv;
+    char* e = NULL;
+    long v = strtol(s, &e, 10);
+    return e == s ? defv : (int)v;
+}
+
+int residency_enabled(void) {
+    const char* s = getenv("IFETCHER_RESIDENCY");
+    return s && strcmp(s, "1") == 0;
+}
+
+static uint64_t hash_path(const char* s) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*s) { h ^= (unsigned char)*s++; h *= 1099511628211ULL; }
+    return h;
+}
+
+static int index_grow(void) {
+    size_t ncap = index_cap ? index_cap * 2 : 1024;
+    int* ns = (int*)malloc(ncap * sizeof(int));
+    if (!ns) return -1;
+    for (size_t i = 0; i < ncap; i++) ns[i] = -1;
+    for (size_t i = 0; i < file_count; i++) {
+        size_t j = hash_path(files[i].path) & (ncap - 1);
+        while (ns[j] >= 0) j = (j + 1) & (ncap - 1);
+        ns[j] = (int)i;
+    }
+    free(index_slots);
+    index_slots = ns;
+    index_cap = ncap;
+    return 0;
+}
+
+static ResFile* find_file(const char* path) {
+    if (!index_cap) return NULL;
+    size_t j = hash_path(path) & (index_cap - 1);
+    while (index_slots[j] >= 0) {
+        if (strcmp(files[index_slots[j]].path, path) == 0) return &files[index_slots[j]];
+        j = (j + 1) & (index_cap - 1);
+    }
+    return NULL;
+}
+
+static void unmap_file(ResFile* f) {
+    if (f->map) munmap(f->map, (size_t)f->pages * (size_t)page_size);
+    f->map = NULL;
+}
+
+// 文件大小变化时重建映射；新增部分的页视为未驻留
+static int map_file(ResFile* f, off_t size) {
+    unmap_file(f);
+    size_t pages = (size_t)((size + page_size - 1) / page_size);
+    if (pages == 0) { f->size = size; f->pages = 0; return 0; }
+    void* m = mmap(NULL, pages * (size_t)page_size, PROT_READ, MAP_SHARED, f->fd, 0);
+    if (m == MAP_FAILED) return -1;
+    unsigned char* r = (unsigned char*)realloc(f->resident, pages);
+    if (!r) { munmap(m, pages * (size_t)page_size); return -1; }
+    if (pages > f->pages) memset(r + f->pages, 0, pages - f->pages);
+    f->resident = r;
+    f->map = m;
+    f->pages = pages;
+    f->size = size;
+    return 0;
+}
+
+// 打开被跟踪的文件；fd 耗尽是暂时的，标记重试而不是永久放弃
+static void open_file(ResFile* f) {
+    f->fd = open(f->path, O_RDONLY | O_CLOEXEC);
+    f->retry = f->fd < 0 && (errno == EMFILE || errno == ENFILE);
+    struct stat st;
+    if (f->fd >= 0 && (fstat(f->fd, &st) != 0 || !S_ISREG(st.st_mode))) {
+        close(f->fd);
+        f->fd = -1;
+    }
+}
+
+// 开始跟踪一个新路径；非普通文件直接忽略
+static void track_path(pid_t pid, const char* path) {
+    if (find_file(path) || file_count >= max_files) return;
+    if ((file_count + 1) * 2 > index_cap && index_grow() != 0) return;
+    if (file_count == file_cap) {
+        size_t ncap = file_cap ? file_cap * 2 : 256;
+        ResFile* nf = (ResFile*)realloc(files, ncap * sizeof(ResFile));
+        if (!nf) return;
+        files = nf;
+        file_cap = ncap;
+    }
+    ResFile* f = &files[file_count];
+    memset(f, 0, sizeof(*f));
+    snprintf(f->path, sizeof(f->path), "%s", path);
+    f->pid = pid;
+    f->baseline = first_pass && !emit_baseline;
+    open_file(f);
+    size_t j = hash_path(f->path) & (index_cap - 1);
+    while (index_slots[j] >= 0) j = (j + 1) & (index_cap - 1);
+    index_slots[j] = (int)file_count;
+    file_count++;
+}
+
+// 发现目标进程当前打开的文件（/proc/<pid>/fd）与映射的文件（/proc/<pid>/maps）；进程已退出返回 -1
+static int discover_files(pid_t pid) {
+    char dir_path[64];
+    snprintf(dir_path, sizeof(dir_path), "/proc/%d/fd", pid);
+    DIR* d = opendir(dir_path);
+    if (!d && errno == ENOENT) return -1;
+    if (d) {
+        struct dirent* de;
+        char link[320], target[256];
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(link, sizeof(link), "%s/%s", dir_path, de->d_name);
+            ssize_t n = readlink(link, target, sizeof(target) - 1);
+            if (n <= 0 || target[0] != '/') continue;
+            target[n] = '\0';
+            track_path(pid, target);
+        }
+        closedir(d);
+    }
+
+    char maps_path[64];
+    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", pid);
+    FILE* fp = fopen(maps_path, "r");
+    if (!fp) return 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), fp)) {
+        char* p = strchr(line, '/');
+        if (!p) continue;
+        p[strcspn(p, "\n")] = '\0';
+        if (strstr(p, " (deleted)")) continue;
+        if (strncmp(p, "/memfd:", 7) == 0 || strncmp(p, "/SYSV", 5) == 0) continue;
+        track_path(pid, p);
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void emit_range(const ResFile* f, size_t first, size_t count) {
+    off_t offset = (off_t)first * page_size;
+    off_t len = (off_t)count * page_size;
+    if (offset + len > f->size) len = f->size - offset;
+    ProfilerLogEntry entry = {
+        .pid = f->pid,
+        .op_type = OP_CACHE,
+        .filename = f->path,
+        .offset = offset,
+        .size = (size_t)len,
+        .fd = -1,
+        .status = 0,
+        .err_no = 0
+    };
+    profiler_log(&entry);
+    ranges_emitted++;
+}
+
+static void sample_file(ResFile* f) {
+    if (f->fd < 0 && f->retry) open_file(f);
+    if (f->fd < 0) return;
+    struct stat st;
+    if (fstat(f->fd, &st) != 0) return;
+    if (st.st_size != f->size || (f->pages && !f->map)) {
+        if (map_file(f, st.st_size) != 0) { close(f->fd); f->fd = -1; return; }
+    }
+    if (f->pages == 0) return;
+
+    if (cachestat_ok && f->sampled) {
+        struct ift_cachestat_range range = { 0, 0 };
+        struct ift_cachestat cs;
+        if (syscall(__NR_cachestat, f->fd, &range, &cs, 0) == 0) {
+            if (cs.nr_cache == f->last_cache && cs.nr_evicted == f->last_evicted) return;
+            f->last_cache = cs.nr_cache;
+            f->last_evicted = cs.nr_evicted;
+        } else if (errno == ENOSYS) {
+            cachestat_ok = 0;
+        }
+    }
+
+    unsigned char* vec = (unsigned char*)malloc(f->pages);
+    if (!vec) return;
+    if (mincore(f->map, f->pages * (size_t)page_size, vec) != 0) { free(vec); return; }
+
+    int emit = !(f->baseline && !f->sampled);
+    size_t run_start = 0, run_len = 0;
+    for (size_t i = 0; i < f->pages; i++) {
+        int now_in = vec[i] & 1;
+        int is_new = now_in && !(f->resident[i] & 1);
+        if (is_new) {
+            if (run_len == 0) run_start = i;
+            run_len++;
+        } else if (run_len) {
+            if (emit) emit_range(f, run_start, run_len);
+            run_len = 0;
+        }
+        f->resident[i] = (unsigned char)now_in;
+    }
+    if (run_len && emit) emit_range(f, run_start, run_len);
+    free(vec);
+
+    if (!f->sampled && cachestat_ok) {
+        // 首次采样后记下 cachestat 基准
+        struct ift_cachestat_range range = { 0, 0 };
+        struct ift_cachestat cs;
+        if (syscall(__NR_cachestat, f->fd, &range, &cs, 0) == 0) {
+            f->last_cache = cs.nr_cache;
+            f->last_evicted = cs.nr_evicted;
+        } else if (errno == ENOSYS) {
+            cachestat_ok = 0;
+        }
+    }
+    f->sampled = 1;
+}
+
+// 页缓存是全局的：进程树内所有进程发现的文件合并为一个集合采样；已退出的进程移出列表
+static void sample_all(void) {
+    pthread_mutex_lock(&pid_mutex);
+    for (size_t i = 0; i < pid_count;) {
+        if (discover_files(pids[i]) != 0) pids[i] = pids[--pid_count];
+        else i++;
+    }
+    pthread_mutex_unlock(&pid_mutex);
+    for (size_t i = 0; i < file_count; i++) sample_file(&files[i]);
+    first_pass = 0;
+}
+
+static void add_pid(pid_t pid) {
+    pthread_mutex_lock(&pid_mutex);
+    if (pid_count == pid_cap) {
+        size_t ncap = pid_cap ? pid_cap * 2 : 16;
+        pid_t* np = (pid_t*)realloc(pids, ncap * sizeof(pid_t));
+        if (np) { pids = np; pid_cap = ncap; }
+    }
+    if (pid_count < pid_cap) pids[pid_count++] = pid;
+    pthread_mutex_unlock(&pid_mutex);
+}
+
+static void* sampler_thread_func(void* arg) {
+    (void)arg;
+    while (sampler_running) {
+        sample_all();
+        struct timespec ts;
+        ts.tv_sec = interval_ms / 1000;
+        ts.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+int residency_start(pid_t pid) {
+    pid_count = 0;
+    add_pid(pid);
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+    interval_ms = env_int("IFETCHER_RESIDENCY_INTERVAL_MS", 50);
+    if (interval_ms < 1) interval_ms = 1;
+    // 每个被跟踪文件常驻一个 fd：默认只用 RLIMIT_NOFILE 软限制的一半，给监控进程其余部分留余量
+    struct rlimit rl;
+    size_t def_files = 4096;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur / 2 < def_files)
+        def_files = rl.rlim_cur / 2 > 0 ? (size_t)(rl.rlim_cur / 2) : 1;
+    int mf = env_int("IFETCHER_RESIDENCY_MAX_FILES", (int)def_files);
+    max_files = mf > 0 ? (size_t)mf : def_files;
+    emit_baseline = env_int("IFETCHER_RESIDENCY_BASELINE", 0);
+    profiler_log_init();
+    sampler_running = 1;
+    if (pthread_create(&sampler_thread, NULL, sampler_thread_func, NULL) != 0) {
+        sampler_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void residency_stop(void) {
+    if (!sampler_running) return;
+    sampler_running = 0;
+    pthread_join(sampler_thread, NULL);
+    // 仍有进程存活时补最后一轮，捕获最后一个间隔内的变化
+    if (pid_count > 0) sample_all();
+    for (size_t i = 0; i < file_count; i++) {
+        unmap_file(&files[i]);
+        free(files[i].resident);
+        if (files[i].fd >= 0) close(files[i].fd);
+    }
+    if (verbose())
+        printf("Residency sampler: %zu files tracked, %llu page ranges logged%s\n",
+               file_count, ranges_emitted, cachestat_ok ? "" : " (mincore only)");
+    free(files); files = NULL; file_count = file_cap = 0;
+    free(index_slots); index_slots = NULL; index_cap = 0;
+    free(pids); pids = NULL; pid_count = pid_cap = 0;
+}
+
+void residency_add_process(pid_t pid) {
+    if (sampler_running) add_pid(pid);
+}
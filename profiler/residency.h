@@ -0,0 +1,27 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+#include <sys/types.h>
+
+// 页缓存驻留采样：周期性检查目标进程打开/映射的每个普通文件在页缓存中的页，
+// 将新进入页缓存的页区间按时间顺序写入 page_log（OP_CACHE）。
+// 优先用 cachestat(2) 判断文件是否有变化，有变化（或内核不支持）时再 mincore 取页位图。
+//
+// 环境变量：
+//   IFETCHER_RESIDENCY=1                 启用（proc_monitor 中默认关闭）
+//   IFETCHER_RESIDENCY_INTERVAL_MS       采样间隔，默认 50ms
+//   IFETCHER_RESIDENCY_MAX_FILES         最多跟踪的文件数，默认 RLIMIT_NOFILE 软限制的一半（至多 4096）
+//   IFETCHER_RESIDENCY_BASELINE=1        首轮发现的文件也输出已驻留页（默认只作基线）
+
+// 是否通过环境变量启用
+int residency_enabled(void);
+
+// 启动采样线程；成功返回 0
+int residency_start(pid_t pid);
+
+// 把进程树中新发现的进程加入文件发现（页缓存全局共享，所有进程的文件合并采样）
+void residency_add_process(pid_t pid);
+
+// 停止采样线程，做最后一次采样并释放资源
+void residency_stop(void);
+
+#endif // RESIDENCY_H
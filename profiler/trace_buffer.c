@@ -0,0 +1,289 @@
+#define _GNU_SOURCE
+#include "trace_buffer.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+
+// 每个线程一个单生产者/单消费者环：生产者为业务线程，消费者为 drain 线程
+typedef struct TraceRing {
+    _Atomic unsigned long head;   // 生产者写入位置
+    _Atomic unsigned long tail;   // 消费者读取位置
+    _Atomic int orphaned;         // 所属线程已退出，排空后由 drain 线程回收
+    _Atomic unsigned long dropped;
+    unsigned long mask;
+    TraceEvent* slots;
+    struct TraceRing* next;
+} TraceRing;
+
+#define RING_DEFAULT_SIZE 1024
+#define DRAIN_DEFAULT_INTERVAL_MS 20
+#define PUSH_WAIT_DEFAULT_MS 200
+
+static trace_sink_fn g_sink = NULL;
+static trace_flush_fn g_flush = NULL;
+static trace_tick_fn g_tick = NULL;
+static unsigned long ring_size = RING_DEFAULT_SIZE;
+static long drain_interval_ms = DRAIN_DEFAULT_INTERVAL_MS;
+static long push_wait_ms = PUSH_WAIT_DEFAULT_MS;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER; // 保护 ring 链表
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;    // 串行化出队与写盘
+static pthread_cond_t drain_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t space_cond = PTHREAD_COND_INITIALIZER;       // 每轮排空后广播，唤醒等待空位的生产者
+static TraceRing* rings = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_t drain_thread;
+static _Atomic int drain_started = 0;
+static _Atomic int drain_stop = 0;
+static _Atomic int shut_down = 0;
+static unsigned long total_dropped = 0;
+static pid_t cached_pid = 0;
+static __thread TraceRing* my_ring = NULL;
+static __thread int in_drain = 0;   // 本线程正在排空（持有 drain_mutex）：sink 中产生的事件不能再等待
+
+static long env_long(const char* name, long defv) {
+    const char* s = getenv(name);
+    if (!s || !*s) return defv;
+    char* e = NULL;
+    long v = strtol(s, &e, 10);
+    return (e == s || v <= 0) ? defv : v;
+}
+
+static void ring_thread_exit(void* p) {
+    TraceRing* r = (TraceRing*)p;
+    if (r) atomic_store_explicit(&r->orphaned, 1, memory_order_release);
+}
+
+// 出队单个环的全部事件；调用方持有 drain_mutex
+static void drain_ring(TraceRing* r) {
+    unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_acquire);
+    while (tail != head) {
+        TraceEvent* ev = &r->slots[tail & r->mask];
+        ev->entry.filename = ev->name;
+        if (g_sink) g_sink(ev);
+        tail++;
+    }
+    atomic_store_explicit(&r->tail, tail, memory_order_release);
+}
+
+// 排空所有环，回收已退出线程的空环；本轮有丢弃时向 sink 补一条 TRACE_EV_DROP。调用方持有 drain_mutex
+static void drain_all_locked(void) {
+    in_drain = 1;
+    unsigned long pass_dropped = 0;
+    pthread_mutex_lock(&registry_mutex);
+    TraceRing** pp = &rings;
+    while (*pp) {
+        TraceRing* r = *pp;
+        drain_ring(r);
+        unsigned long d = atomic_exchange_explicit(&r->dropped, 0, memory_order_relaxed);
+        pass_dropped += d;
+        if (atomic_load_explicit(&r->orphaned, memory_order_acquire) &&
+            atomic_load_explicit(&r->head, memory_order_acquire) == atomic_load_explicit(&r->tail, memory_order_relaxed)) {
+            *pp = r->next;
+            free(r->slots);
+            free(r);
+            continue;
+        }
+        pp = &r->next;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    pthread_cond_broadcast(&space_cond);
+    if (pass_dropped > 0) {
+        total_dropped += pass_dropped;
+        TraceEvent ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.kind = TRACE_EV_DROP;
+        clock_gettime(CLOCK_MONOTONIC, &ev.ts);
+        ev.entry.pid = cached_pid;
+        ev.entry.filename = ev.name;
+        ev.stat[0] = pass_dropped;
+        if (g_sink) g_sink(&ev);
+    }
+    if (g_flush) g_flush();
+    in_drain = 0;
+}
+
+static void* drain_thread_func(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&drain_mutex);
+    while (!atomic_load(&drain_stop)) {
+        drain_all_locked();
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        dl.tv_nsec += (drain_interval_ms % 1000) * 1000000L;
+        dl.tv_sec += drain_interval_ms / 1000 + dl.tv_nsec / 1000000000L;
+        dl.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&drain_cond, &drain_mutex, &dl);
+        if (g_tick) {
+            pthread_mutex_unlock(&drain_mutex);
+            g_tick(profiler_now_ns());
+            pthread_mutex_lock(&drain_mutex);
+        }
+    }
+    drain_all_locked();
+    pthread_mutex_unlock(&drain_mutex);
+    return NULL;
+}
+
+static void start_drain_thread(void) {
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&drain_started, &expected, 1)) return;
+    atomic_store(&drain_stop, 0);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+    if (pthread_create(&drain_thread, &attr, drain_thread_func, NULL) != 0) {
+        atomic_store(&drain_started, 0);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// fork 前持有两把锁并把 stdio 缓冲写盘，避免子进程继承未写出的数据后重复写出
+static void atfork_prepare(void) {
+    pthread_mutex_lock(&drain_mutex);
+    pthread_mutex_lock(&registry_mutex);
+    if (g_flush) g_flush();
+}
+
+static void atfork_parent(void) {
+    pthread_mutex_unlock(&registry_mutex);
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+// 子进程：丢弃继承来的待写事件（父进程负责写出），其它线程的环标记为孤儿，drain 线程按需重启
+static void atfork_child(void) {
+    cached_pid = getpid();
+    for (TraceRing* r = rings; r; r = r->next) {
+        atomic_store(&r->tail, atomic_load(&r->head));
+        atomic_store(&r->dropped, 0);
+        if (r != my_ring) atomic_store(&r->orphaned, 1);
+    }
+    total_dropped = 0;
+    atomic_store(&drain_started, 0);
+    atomic_store(&shut_down, 0);
+    atomic_store(&drain_stop, 0);
+    pthread_mutex_init(&registry_mutex, NULL);
+    pthread_mutex_init(&drain_mutex, NULL);
+    pthread_cond_init(&drain_cond, NULL);
+    pthread_cond_init(&space_cond, NULL);
+}
+
+static void init_once_func(void) {
+    unsigned long want = (unsigned long)env_long("IFETCHER_RING_SIZE", RING_DEFAULT_SIZE);
+    ring_size = 1;
+    while (ring_size < want) ring_size <<= 1;
+    drain_interval_ms = env_long("IFETCHER_DRAIN_INTERVAL_MS", DRAIN_DEFAULT_INTERVAL_MS);
+    push_wait_ms = env_long("IFETCHER_PUSH_WAIT_MS", PUSH_WAIT_DEFAULT_MS);
+    cached_pid = getpid();
+    pthread_key_create(&ring_key, ring_thread_exit);
+    pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+}
+
+void trace_buffer_init(trace_sink_fn sink, trace_flush_fn flush) {
+    pthread_once(&init_once, init_once_func);
+    if (sink) g_sink = sink;
+    if (flush) g_flush = flush;
+}
+
+void trace_buffer_set_tick(trace_tick_fn tick) {
+    g_tick = tick;
+}
+
+void trace_buffer_start(void) {
+    pthread_once(&init_once, init_once_func);
+    if (!atomic_load_explicit(&drain_started, memory_order_relaxed) &&
+        !atomic_load_explicit(&shut_down, memory_order_relaxed)) start_drain_thread();
+}
+
+static TraceRing* get_my_ring(void) {
+    if (my_ring) return my_ring;
+    TraceRing* r = (TraceRing*)calloc(1, sizeof(TraceRing));
+    if (!r) return NULL;
+    r->slots = (TraceEvent*)malloc(sizeof(TraceEvent) * ring_size);
+    if (!r->slots) { free(r); return NULL; }
+    r->mask = ring_size - 1;
+    pthread_mutex_lock(&registry_mutex);
+    r->next = rings;
+    rings = r;
+    pthread_mutex_unlock(&registry_mutex);
+    pthread_setspecific(ring_key, r);
+    my_ring = r;
+    return r;
+}
+
+int trace_buffer_push(const TraceEvent* ev) {
+    pthread_once(&init_once, init_once_func);
+    if (atomic_load_explicit(&shut_down, memory_order_relaxed)) {
+        // 退出阶段 drain 线程已停止：直接同步写出
+        TraceEvent tmp = *ev;
+        tmp.entry.filename = tmp.name;
+        pthread_mutex_lock(&drain_mutex);
+        if (g_sink) g_sink(&tmp);
+        if (g_flush) g_flush();
+        pthread_mutex_unlock(&drain_mutex);
+        return 0;
+    }
+    TraceRing* r = get_my_ring();
+    if (!r) return -1;
+    if (!atomic_load_explicit(&drain_started, memory_order_relaxed)) start_drain_thread();
+
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) >= ring_size && !in_drain) {
+        // 环满：唤醒 drain 线程并在其条件变量上等待空位，最多 push_wait_ms；drain 线程未能启动时就地排空
+        struct timespec dl;
+        clock_gettime(CLOCK_REALTIME, &dl);
+        dl.tv_nsec += (push_wait_ms % 1000) * 1000000L;
+        dl.tv_sec += push_wait_ms / 1000 + dl.tv_nsec / 1000000000L;
+        dl.tv_nsec %= 1000000000L;
+        pthread_mutex_lock(&drain_mutex);
+        while (head - atomic_load_explicit(&r->tail, memory_order_acquire) >= ring_size) {
+            if (!atomic_load_explicit(&drain_started, memory_order_relaxed)) { drain_all_locked(); continue; }
+            pthread_cond_signal(&drain_cond);
+            if (pthread_cond_timedwait(&space_cond, &drain_mutex, &dl) == ETIMEDOUT) break;
+        }
+        pthread_mutex_unlock(&drain_mutex);
+    }
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) >= ring_size) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return -1;
+    }
+    r->slots[head & r->mask] = *ev;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    // 过半时提前唤醒，平时依靠定时排空，避免每次写入都产生 futex 调用
+    if (head + 1 - atomic_load_explicit(&r->tail, memory_order_relaxed) == ring_size / 2) {
+        pthread_cond_signal(&drain_cond);
+    }
+    return 0;
+}
+
+void trace_buffer_flush(void) {
+    pthread_once(&init_once, init_once_func);
+    pthread_mutex_lock(&drain_mutex);
+    drain_all_locked();
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+void trace_buffer_shutdown(void) {
+    pthread_once(&init_once, init_once_func);
+    atomic_store(&shut_down, 1);
+    int expected = 1;
+    if (atomic_compare_exchange_strong(&drain_started, &expected, 0)) {
+        atomic_store(&drain_stop, 1);
+        pthread_mutex_lock(&drain_mutex);
+        pthread_cond_signal(&drain_cond);
+        pthread_mutex_unlock(&drain_mutex);
+        pthread_join(drain_thread, NULL);
+    }
+    trace_buffer_flush();
+    if (total_dropped > 0) {
+        fprintf(stderr, "[Profiler] Warning: %lu trace events dropped (ring full)\n", total_dropped);
+        total_dropped = 0;
+    }
+}
+
+pid_t trace_buffer_pid(void) {
+    pthread_once(&init_once, init_once_func);
+    return cached_pid;
+}
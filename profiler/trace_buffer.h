@@ -0,0 +1,53 @@
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+#include <time.h>
+#include "profiler_common.h"
+
+// 事件种类：读/映射日志条目、磁盘采样、进程 I/O 采样、设备信息，
+// 或 drain 线程合成的丢弃计数（stat[0] 为丢弃数，写入每个日志，供 analyzer 判断日志是否完整）
+typedef enum {
+    TRACE_EV_ENTRY,
+    TRACE_EV_DISKSTAT,
+    TRACE_EV_PROCIO,
+    TRACE_EV_DEVINFO,
+    TRACE_EV_DROP
+} TraceEventKind;
+
+// 环形缓冲中的定长事件：路径按值拷贝，格式化工作全部交给后台 drain 线程
+typedef struct {
+    TraceEventKind kind;
+    struct timespec ts;           // 采集时刻（CLOCK_MONOTONIC）
+    ProfilerLogEntry entry;       // entry.filename 在出队后指向 name
+    unsigned long long stat[8];   // diskstat 的 8 个增量字段；procio 用前 5 个（pid 在 entry.pid）；devinfo 用前 3 个
+    char name[256];               // 文件路径或设备名
+} TraceEvent;
+
+// drain 线程对每个出队事件调用 sink，一批事件写完后调用 flush
+typedef void (*trace_sink_fn)(const TraceEvent* ev);
+typedef void (*trace_flush_fn)(void);
+// drain 线程每轮排空前调用（不持有 drain_mutex，可再压入事件），now_ns 为 CLOCK_MONOTONIC
+typedef void (*trace_tick_fn)(uint64_t now_ns);
+
+// 初始化（幂等）：注册 sink/flush 与 pthread_atfork 处理函数
+void trace_buffer_init(trace_sink_fn sink, trace_flush_fn flush);
+
+// 注册 drain 线程的定时回调（libwrapper 用于发出闲置的读合并区间）
+void trace_buffer_set_tick(trace_tick_fn tick);
+
+// 确保 drain 线程已启动（尚无事件入环、但 tick 有工作要做时调用）
+void trace_buffer_start(void);
+
+// 将事件压入当前线程的 SPSC 环；环满时唤醒 drain 线程并阻塞等待空位，至多 IFETCHER_PUSH_WAIT_MS（默认 200ms）。
+// 成功返回 0，等待超时返回 -1（计入丢弃数，下一轮排空时以 TRACE_EV_DROP 写入日志）
+int trace_buffer_push(const TraceEvent* ev);
+
+// 同步排空所有线程的环并 flush（exec 前、退出前调用）
+void trace_buffer_flush(void);
+
+// 停止 drain 线程并排空剩余事件
+void trace_buffer_shutdown(void);
+
+// fork 后由 atfork 回调重置；外部可用于读取缓存的 pid
+pid_t trace_buffer_pid(void);
+
+#endif // TRACE_BUFFER_H
@@ -0,0 +1,82 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+/*
+ * IFetcher 二进制 trace 格式（profiler 写入，analyzer 读取）
+ *
+ * 文件由若干“块”顺序拼接而成，每块以一次 write() 追加（O_APPEND），
+ * 多个进程共享同一日志文件时块之间不会交错。
+ *
+ *   块   = IftBlockHeader + payload_len 字节的记录流
+ *   记录 = 1 字节类型标签 + 该类型固定的字段序列（LEB128 varint）
+ *
+ * - 时间戳：CLOCK_MONOTONIC 纳秒（v3 起；v1/v2 为 CLOCK_REALTIME），相对前一条记录的增量
+ *   （zigzag varint），块首以 base_ts_ns 为基准；SESSION 记录携带墙钟锚点，
+ *   日历时间 = wall_anchor_ns + (ts - mono_anchor_ns)；
+ * - 读偏移：相对同块上一条事件结束位置（offset+size）的增量，顺序读编码为 0；
+ * - 路径：每个会话（进程）维护字符串表，首次出现时写 IFT_REC_PATH，之后只写 id；
+ * - 每块的增量状态独立，块可单独解码；路径 id 在会话内全局有效。含 SESSION/PATH 记录的块
+ *   在 flags 中置 IFT_BLOCK_F_DEFS（v9 起），读端只需解码这些块即可得到任意位置的会话状态。
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#define IFT_BLOCK_MAGIC   0x42544649u   /* "IFTB" 小端 */
+#define IFT_VERSION       9   /* v2: EVENT/MMAP 追加 flags；v3: 单调时钟 + SESSION 墙钟锚点；v4: EVENT 追加请求长度与耗时；v5: EVENT 追加 tid；v6: PROCIO 记录；v7: DEVINFO 记录；v8: DROP 记录；v9: 块头 flags */
+#define IFT_BLOCK_MAX     (64 * 1024)
+#define IFT_PATH_ID_MAX   (1u << 24)    /* 会话内路径 id 上限：写端不再分配，读端视为损坏 */
+#define IFT_BLOCK_F_DEFS  0x1u          /* 块内含 SESSION 或 PATH 记录（v9） */
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t payload_len;
+    uint32_t pid;
+    uint64_t session;       // 会话 id：进程首次写日志时的单调时间戳（ns），fork 后重新生成
+    uint64_t base_ts_ns;    // 块内时间戳增量基准
+} IftBlockHeader;
+
+// 记录类型
+enum {
+    IFT_REC_SESSION  = 1,   // session, app, user, host, wall_anchor_ns(v3), mono_anchor_ns(v3)
+    IFT_REC_PATH     = 2,   // id, len, bytes
+    IFT_REC_EVENT    = 3,   // op, ts, pid, path_id, fd, offset, size, errno<<1|status, flags(v2), req_size(v4), io_ns(v4), tid(v5)
+    IFT_REC_MMAP     = 4,   // IFT_REC_EVENT 的 v2 字段 + addr_start, addr_len, file_offset
+    IFT_REC_DISKSTAT = 5,   // ts, dev_id, 8 个计数增量
+    IFT_REC_PROCIO   = 6,   // ts, pid, rchar, read_bytes, syscr, majflt, blkio_ms 的增量（v6）
+    IFT_REC_DEVINFO  = 7,   // ts, dev_id, rotational, queue_depth, logical_block_size（v7，每设备一次）
+    IFT_REC_DROP     = 8    // ts, pid, count：该进程自上一条 DROP 以来未能写入日志的事件数（v8）
+};
+
+// 操作类型名（编号与 profiler_common.h 中 OpType 一致）
+static inline const char* ift_op_name(uint64_t op) {
+    static const char* const names[] = {"READ", "FREAD", "MMAP", "PREAD", "READV", "PREADV",
+                                        "SENDFILE", "COPY_RANGE", "OPEN", "FOPEN", "CACHE", "FAULT",
+                                        "MUNMAP", "MREMAP", "MADVISE"};
+    return op < sizeof(names) / sizeof(names[0]) ? names[op] : "UNKNOWN";
+}
+
+static inline uint64_t ift_zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t ift_unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// 写入 varint，返回字节数（最多 10）
+static inline size_t ift_put_varint(unsigned char* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) { p[n++] = (unsigned char)(v | 0x80); v >>= 7; }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+// 读取 varint；越界返回 0
+static inline size_t ift_get_varint(const unsigned char* p, const unsigned char* end, uint64_t* out) {
+    uint64_t v = 0; int shift = 0; size_t n = 0;
+    while (p + n < end && shift < 64) {
+        unsigned char b = p[n++];
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) { *out = v; return n; }
+        shift += 7;
+    }
+    return 0;
+}
+
+#endif // TRACE_FORMAT_H
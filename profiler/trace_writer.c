@@ -0,0 +1,324 @@
+#include "trace_writer.h"
+#include <errno.h>
+
+// 会话内路径字符串表：开放寻址哈希，路径 -> id
+typedef struct {
+    char** keys;
+    uint32_t* ids;
+    size_t cap;
+    size_t count;
+} PathTable;
+
+struct TraceWriter {
+    int fd;
+    char* base_path;           // 非 NULL：按进程分流，写入 <base_path>.<pid>（首次写出时才创建）
+    pid_t pid;                 // 当前会话所属进程；fork 后与 profiler_getpid() 不一致时重置会话
+    uint64_t session;
+    int session_written;
+    uint64_t anchor_wall;      // 会话的墙钟锚点（见 trace_format.h）
+    uint64_t anchor_mono;
+    char app[512];
+    char user[64];
+    char host[64];
+    PathTable paths;
+    uint64_t base_ts;          // 当前块的时间基准
+    uint64_t prev_ts;
+    int64_t prev_end;          // 当前块上一条事件的 offset+size
+    size_t len;                // 当前块已写入的 payload 长度
+    uint16_t block_flags;      // 当前块的 IftBlockHeader.flags
+    unsigned long long block_events;   // 当前块中的事件数（写失败时计入丢弃）
+    unsigned long long dropped;        // 尚未写出 DROP 记录的丢弃数：路径表内存不足、块写入失败、环满
+    int write_failed;          // 已报告过写入失败
+    unsigned char buf[sizeof(IftBlockHeader) + IFT_BLOCK_MAX];
+};
+
+// 单条记录的最大编码长度（不含路径字符串）
+#define MAX_RECORD_BYTES 160
+
+static void begin_record(TraceWriter* w, uint64_t ts_ns, size_t need);
+
+static uint64_t ts_to_ns(const struct timespec* ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static uint64_t hash_str(const char* s) {
+    uint64_t h = 1469598103934665603ULL;
+    while (*s) { h ^= (unsigned char)*s++; h *= 1099511628211ULL; }
+    return h;
+}
+
+static void path_table_clear(PathTable* t) {
+    for (size_t i = 0; i < t->cap; i++) free(t->keys[i]);
+    free(t->keys); free(t->ids);
+    memset(t, 0, sizeof(*t));
+}
+
+static int path_table_grow(PathTable* t) {
+    size_t ncap = t->cap ? t->cap * 2 : 256;
+    char** nkeys = (char**)calloc(ncap, sizeof(char*));
+    uint32_t* nids = (uint32_t*)calloc(ncap, sizeof(uint32_t));
+    if (!nkeys || !nids) { free(nkeys); free(nids); return -1; }
+    for (size_t i = 0; i < t->cap; i++) {
+        if (!t->keys[i]) continue;
+        size_t j = hash_str(t->keys[i]) & (ncap - 1);
+        while (nkeys[j]) j = (j + 1) & (ncap - 1);
+        nkeys[j] = t->keys[i]; nids[j] = t->ids[i];
+    }
+    free(t->keys); free(t->ids);
+    t->keys = nkeys; t->ids = nids; t->cap = ncap;
+    return 0;
+}
+
+// 查找路径 id；不存在时分配新 id 并置 *is_new
+static int path_table_lookup(PathTable* t, const char* path, uint32_t* id, int* is_new) {
+    if ((t->count + 1) * 2 > t->cap && path_table_grow(t) != 0) return -1;
+    size_t j = hash_str(path) & (t->cap - 1);
+    while (t->keys[j]) {
+        if (strcmp(t->keys[j], path) == 0) { *id = t->ids[j]; *is_new = 0; return 0; }
+        j = (j + 1) & (t->cap - 1);
+    }
+    if (t->count >= IFT_PATH_ID_MAX) return -1;
+    t->keys[j] = strdup(path);
+    if (!t->keys[j]) return -1;
+    t->ids[j] = (uint32_t)t->count++;
+    *id = t->ids[j]; *is_new = 1;
+    return 0;
+}
+
+TraceWriter* trace_writer_open(const char* path) {
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return NULL;
+    TraceWriter* w = (TraceWriter*)calloc(1, sizeof(TraceWriter));
+    if (!w) { close(fd); return NULL; }
+    w->fd = fd;
+    return w;
+}
+
+static int open_stream(const char* base, pid_t pid) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s.%d", base, (int)pid);
+    return open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+TraceWriter* trace_writer_open_per_process(const char* path) {
+    // 先确认目录可写，失败时由调用方回退（流文件本身在首次写出时才创建）
+    char dir[512];
+    const char* slash = strrchr(path, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - path) : 1, slash ? path : ".");
+    if (access(dir[0] ? dir : "/", W_OK) != 0) return NULL;
+    TraceWriter* w = (TraceWriter*)calloc(1, sizeof(TraceWriter));
+    char* base = strdup(path);
+    if (!w || !base) { free(w); free(base); return NULL; }
+    w->fd = -1;
+    w->base_path = base;
+    return w;
+}
+
+void trace_writer_set_info(TraceWriter* w, const char* app, const char* user, const char* host) {
+    if (!w) return;
+    snprintf(w->app, sizeof(w->app), "%s", app ? app : "");
+    snprintf(w->user, sizeof(w->user), "%s", user ? user : "");
+    snprintf(w->host, sizeof(w->host), "%s", host ? host : "");
+}
+
+static unsigned char* payload(TraceWriter* w) { return w->buf + sizeof(IftBlockHeader); }
+
+static void put_varint(TraceWriter* w, uint64_t v) { w->len += ift_put_varint(payload(w) + w->len, v); }
+
+static void put_string(TraceWriter* w, const char* s, size_t n) {
+    put_varint(w, n);
+    memcpy(payload(w) + w->len, s, n);
+    w->len += n;
+}
+
+static void put_drop(TraceWriter* w, uint64_t ts_ns, pid_t pid, unsigned long long count);
+
+void trace_writer_flush(TraceWriter* w) {
+    if (!w) return;
+    if (w->dropped && w->pid == profiler_getpid()) {
+        // 本进程待报告的丢弃数随块写出；begin_record 可能先写出已满的当前块
+        unsigned long long n = w->dropped;
+        uint64_t ts_ns = w->len ? w->prev_ts : profiler_now_ns();
+        w->dropped = 0;
+        begin_record(w, ts_ns, MAX_RECORD_BYTES);
+        put_drop(w, ts_ns, w->pid, n);
+    }
+    if (w->len == 0) return;
+    if (w->fd < 0 && w->base_path) w->fd = open_stream(w->base_path, w->pid);
+    size_t total = sizeof(IftBlockHeader) + w->len, off = 0;
+    if (w->fd >= 0) {
+        IftBlockHeader h;
+        h.magic = IFT_BLOCK_MAGIC;
+        h.version = IFT_VERSION;
+        h.flags = w->block_flags;
+        h.payload_len = (uint32_t)w->len;
+        h.pid = (uint32_t)w->pid;
+        h.session = w->session;
+        h.base_ts_ns = w->base_ts;
+        memcpy(w->buf, &h, sizeof(h));
+        while (off < total) {
+            ssize_t n = write(w->fd, w->buf + off, total - off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            off += (size_t)n;
+        }
+    }
+    if (off < total) {
+        // 块未完整写出（磁盘满、I/O 错误）：其中的事件计为丢弃，随下一块的 DROP 记录报告；
+        // 已写出的半个块由 analyzer 跳过并在下一个块头处重新同步
+        int err = errno;
+        w->dropped += w->block_events;
+        if (!w->write_failed) {
+            fprintf(stderr, "[Profiler] Warning: trace write failed after %zu of %zu bytes (%s), %llu events lost\n",
+                    off, total, strerror(err), w->block_events);
+            w->write_failed = 1;
+        }
+    }
+    w->block_events = 0;
+    w->block_flags = 0;
+    w->len = 0;
+}
+
+// 开始一条记录：必要时切换会话/换块，并写入 SESSION 记录
+static void begin_record(TraceWriter* w, uint64_t ts_ns, size_t need) {
+    pid_t pid = profiler_getpid();
+    if (pid != w->pid) {
+        // 新进程（含 fork 后的子进程）：路径表与会话重新开始
+        w->len = 0;
+        w->block_events = 0;
+        w->block_flags = 0;
+        w->dropped = 0;     // 继承的计数属于父进程，由父进程报告
+        if (w->base_path && w->fd >= 0) {
+            // 分流模式：关闭继承自父进程的 fd，下次写出时打开本进程自己的流
+            close(w->fd);
+            w->fd = -1;
+        }
+        path_table_clear(&w->paths);
+        w->pid = pid;
+        w->session = ts_ns;
+        w->session_written = 0;
+        profiler_clock_anchor(&w->anchor_wall, &w->anchor_mono);
+    }
+    if (w->len + need > IFT_BLOCK_MAX) trace_writer_flush(w);
+    if (w->len == 0) {
+        w->base_ts = ts_ns;
+        w->prev_ts = ts_ns;
+        w->prev_end = 0;
+    }
+    if (!w->session_written) {
+        payload(w)[w->len++] = IFT_REC_SESSION;
+        put_varint(w, w->session);
+        put_string(w, w->app, strlen(w->app));
+        put_string(w, w->user, strlen(w->user));
+        put_string(w, w->host, strlen(w->host));
+        put_varint(w, w->anchor_wall);
+        put_varint(w, w->anchor_mono);
+        w->session_written = 1;
+        w->block_flags |= IFT_BLOCK_F_DEFS;
+    }
+}
+
+static void put_ts(TraceWriter* w, uint64_t ts_ns) {
+    put_varint(w, ift_zigzag((int64_t)(ts_ns - w->prev_ts)));
+    w->prev_ts = ts_ns;
+}
+
+// 取路径 id 写入 *id；首次出现时先写 PATH 记录。路径表内存不足或 id 用尽时返回 -1，
+// 调用方丢弃该条记录并计入丢弃数（不能退回某个已有 id，否则事件会记到别的文件上）
+static int put_path(TraceWriter* w, const char* path, uint32_t* id) {
+    int is_new = 0;
+    if (path_table_lookup(&w->paths, path, id, &is_new) != 0) { w->dropped++; return -1; }
+    if (is_new) {
+        size_t n = strlen(path);
+        payload(w)[w->len++] = IFT_REC_PATH;
+        put_varint(w, *id);
+        put_string(w, path, n);
+        w->block_flags |= IFT_BLOCK_F_DEFS;
+    }
+    return 0;
+}
+
+void trace_writer_event(TraceWriter* w, const struct timespec* ts, const ProfilerLogEntry* e) {
+    if (!w) return;
+    const char* path = e->filename ? e->filename : "unknown";
+    uint64_t ts_ns = ts_to_ns(ts);
+    begin_record(w, ts_ns, MAX_RECORD_BYTES + 2 * strlen(path) + 800);
+    uint32_t pid_id;
+    if (put_path(w, path, &pid_id) != 0) return;
+    w->block_events++;
+    int is_mmap = is_map_op(e->op_type);
+    payload(w)[w->len++] = is_mmap ? IFT_REC_MMAP : IFT_REC_EVENT;
+    put_varint(w, (uint64_t)e->op_type);
+    put_ts(w, ts_ns);
+    put_varint(w, (uint64_t)e->pid);
+    put_varint(w, pid_id);
+    put_varint(w, ift_zigzag(e->fd));
+    put_varint(w, ift_zigzag((int64_t)e->offset - w->prev_end));
+    put_varint(w, (uint64_t)e->size);
+    put_varint(w, ((uint64_t)(e->err_no < 0 ? 0 : e->err_no) << 1) | (e->status ? 1 : 0));
+    put_varint(w, (uint64_t)(unsigned)e->flags);
+    w->prev_end = (int64_t)e->offset + (int64_t)e->size;
+    if (!is_mmap) {
+        put_varint(w, (uint64_t)e->req_size);
+        put_varint(w, e->io_ns);
+        put_varint(w, (uint64_t)(uint32_t)e->tid);
+    } else {
+        put_varint(w, (uint64_t)e->addr_start);
+        put_varint(w, (uint64_t)(e->addr_end - e->addr_start));
+        put_varint(w, (uint64_t)e->file_offset);
+    }
+}
+
+void trace_writer_diskstat(TraceWriter* w, const struct timespec* ts, const char* dev_name,
+                           const unsigned long long* v) {
+    if (!w) return;
+    uint64_t ts_ns = ts_to_ns(ts);
+    begin_record(w, ts_ns, MAX_RECORD_BYTES + 2 * strlen(dev_name) + 800);
+    uint32_t dev_id;
+    if (put_path(w, dev_name, &dev_id) != 0) return;
+    w->block_events++;
+    payload(w)[w->len++] = IFT_REC_DISKSTAT;
+    put_ts(w, ts_ns);
+    put_varint(w, dev_id);
+    for (int i = 0; i < 8; i++) put_varint(w, v[i]);
+}
+
+void trace_writer_procio(TraceWriter* w, const struct timespec* ts, pid_t pid, const unsigned long long* v) {
+    if (!w) return;
+    uint64_t ts_ns = ts_to_ns(ts);
+    begin_record(w, ts_ns, MAX_RECORD_BYTES);
+    w->block_events++;
+    payload(w)[w->len++] = IFT_REC_PROCIO;
+    put_ts(w, ts_ns);
+    put_varint(w, (uint64_t)pid);
+    for (int i = 0; i < 5; i++) put_varint(w, v[i]);
+}
+
+void trace_writer_devinfo(TraceWriter* w, const struct timespec* ts, const char* dev_name, const unsigned long long* v) {
+    if (!w) return;
+    uint64_t ts_ns = ts_to_ns(ts);
+    begin_record(w, ts_ns, MAX_RECORD_BYTES + 2 * strlen(dev_name) + 800);
+    uint32_t dev_id;
+    if (put_path(w, dev_name, &dev_id) != 0) return;
+    w->block_events++;
+    payload(w)[w->len++] = IFT_REC_DEVINFO;
+    put_ts(w, ts_ns);
+    put_varint(w, dev_id);
+    for (int i = 0; i < 3; i++) put_varint(w, v[i]);
+}
+
+// 调用方已 begin_record
+static void put_drop(TraceWriter* w, uint64_t ts_ns, pid_t pid, unsigned long long count) {
+    payload(w)[w->len++] = IFT_REC_DROP;
+    put_ts(w, ts_ns);
+    put_varint(w, (uint64_t)pid);
+    put_varint(w, count);
+    w->block_events += count;   // 块写失败时连同这些计数一起再次报告
+}
+
+void trace_writer_drop(TraceWriter* w, const struct timespec* ts, pid_t pid, unsigned long long count) {
+    if (!w || count == 0) return;
+    uint64_t ts_ns = ts_to_ns(ts);
+    begin_record(w, ts_ns, MAX_RECORD_BYTES);
+    put_drop(w, ts_ns, pid, count);
+}
@@ -0,0 +1,39 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+#include <time.h>
+#include "profiler_common.h"
+#include "trace_format.h"
+
+// 单个二进制日志文件的写入器（格式见 trace_format.h）；调用方负责串行化
+typedef struct TraceWriter TraceWriter;
+
+// 以 O_APPEND 打开（不存在则创建）；失败返回 NULL
+TraceWriter* trace_writer_open(const char* path);
+
+// 按进程分流：每个进程（含 fork 出、未 exec 的子进程）写入各自的 <path>.<pid>，
+// 互不交错；各流的时间戳同为 CLOCK_MONOTONIC，由 analyzer 合并
+TraceWriter* trace_writer_open_per_process(const char* path);
+
+// 会话元信息：写入每个会话的第一块（SESSION 记录）
+void trace_writer_set_info(TraceWriter* w, const char* app, const char* user, const char* host);
+
+// 追加一条读/映射事件
+void trace_writer_event(TraceWriter* w, const struct timespec* ts, const ProfilerLogEntry* entry);
+
+// 追加一条磁盘采样（8 个计数增量，与 profiler_log_diskstat 参数顺序一致）
+void trace_writer_diskstat(TraceWriter* w, const struct timespec* ts, const char* dev_name,
+                           const unsigned long long* v);
+
+// 追加一条进程 I/O 采样（5 个计数增量，与 profiler_log_procio 参数顺序一致）
+void trace_writer_procio(TraceWriter* w, const struct timespec* ts, pid_t pid, const unsigned long long* v);
+
+// 追加一条设备信息（rotational, queue_depth, logical_block_size）
+void trace_writer_devinfo(TraceWriter* w, const struct timespec* ts, const char* dev_name, const unsigned long long* v);
+
+// 追加一条丢弃计数（DROP 记录）：pid 进程有 count 个事件未能写入日志
+void trace_writer_drop(TraceWriter* w, const struct timespec* ts, pid_t pid, unsigned long long count);
+
+// 将当前块以一次 write() 追加到文件
+void trace_writer_flush(TraceWriter* w);
+
+#endif // TRACE_WRITER_H
@@ -0,0 +1,384 @@
+// libwrapper 开销基准：在同一文件上以紧循环执行 read / pread / fread / mmap，
+// 分别在页缓存命中（cached）与未命中（uncached）、1~64 线程下，对比不预加载与 LD_PRELOAD=libwrapper.so 的表现。
+//
+// 每个配置在独立子进程中运行（父进程负责准备页缓存状态，自身不被预加载），输出：
+//   ns/call    各线程循环耗时之和 / 调用数
+//   sys/call   子进程 /proc/<pid>/io 的 syscr + syscw / 调用数（子进程退出后、回收前读取，含 drain 线程写日志）
+//   logB/call  预加载时写入日志目录的字节数 / 调用数（不预加载时为 0）
+// uncached 用 POSIX_FADV_DONTNEED 清空文件页缓存，各线程读互不重叠的区间并以 POSIX_FADV_RANDOM 关闭预读；
+// 每线程调用数因此受文件大小限制。mmap 的调用不计入 syscr/syscw，其 sys/call 只反映 wrapper 额外的读写。
+//
+// 用法：make bench && ./wrapper_bench
+// 环境变量：
+//   IFETCHER_BENCH_FILE       测试文件，默认 ./wrapper_bench.dat（不足大小时重新生成；不要放在 tmpfs 上）
+//   IFETCHER_BENCH_SIZE_MB    测试文件大小，默认 256
+//   IFETCHER_BENCH_BLOCK      每次调用的字节数（页大小的整数倍），默认 4096
+//   IFETCHER_BENCH_CALLS      每线程调用数上限，默认 20000
+//   IFETCHER_BENCH_THREADS    线程数列表，默认 1,2,4,8,16,32,64
+//   IFETCHER_BENCH_OPS        操作列表，默认 read,pread,fread,mmap
+//   IFETCHER_BENCH_CACHE      cached、uncached 或 both（默认）
+//   IFETCHER_BENCH_WRAPPER    libwrapper.so 路径，默认与本程序同目录
+// 预加载的子进程继承其余 IFETCHER_* 设置（IFETCHER_FILTER、IFETCHER_LOG_FORMAT 等），便于对比不同配置。
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MAX_THREADS 64
+
+enum { OP_B_READ, OP_B_PREAD, OP_B_FREAD, OP_B_MMAP, OP_B_COUNT };
+static const char* const op_names[OP_B_COUNT] = { "read", "pread", "fread", "mmap" };
+
+static const char* bench_file;
+static long block_size = 4096;
+
+static long env_long(const char* name, long defv) {
+    const char* s = getenv(name);
+    return (s && *s) ? atol(s) : defv;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 逗号分隔列表中是否含 name（列表为空视为全部）
+static int in_list(const char* list, const char* name) {
+    if (!list || !*list) return 1;
+    size_t n = strlen(name);
+    for (const char* p = list; *p; ) {
+        size_t len = strcspn(p, ",");
+        if (len == n && strncmp(p, name, n) == 0) return 1;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+/* ---------------- 子进程：执行一个配置 ---------------- */
+
+typedef struct {
+    int op;
+    int uncached;
+    long calls;
+    long first_block;       // 本线程区间的起始块号
+    long nblocks;           // 文件总块数
+    uint64_t elapsed_ns;
+    int failed;
+} Worker;
+
+static pthread_barrier_t start_barrier;
+
+static void* worker_main(void* arg) {
+    Worker* w = arg;
+    char* buf = malloc((size_t)block_size);
+    int fd = open(bench_file, O_RDONLY);
+    FILE* fp = NULL;
+    if (!buf || fd < 0) { w->failed = 1; pthread_barrier_wait(&start_barrier); free(buf); return NULL; }
+    if (w->uncached) posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+    off_t start = (off_t)w->first_block * block_size;
+    if (w->op == OP_B_READ) lseek(fd, start, SEEK_SET);
+    if (w->op == OP_B_FREAD) {
+        fp = fdopen(fd, "r");
+        if (fp) fseeko(fp, start, SEEK_SET);
+        else w->failed = 1;
+    }
+    volatile unsigned long sink = 0;
+    pthread_barrier_wait(&start_barrier);
+    uint64_t t0 = now_ns();
+    for (long i = 0; i < w->calls && !w->failed; i++) {
+        long blk = (w->first_block + i) % w->nblocks;
+        switch (w->op) {
+        case OP_B_READ:
+            if (blk == 0) lseek(fd, 0, SEEK_SET);
+            if (read(fd, buf, (size_t)block_size) <= 0) w->failed = 1;
+            break;
+        case OP_B_PREAD:
+            if (pread(fd, buf, (size_t)block_size, (off_t)blk * block_size) <= 0) w->failed = 1;
+            break;
+        case OP_B_FREAD:
+            if (blk == 0) fseeko(fp, 0, SEEK_SET);
+            if (fread(buf, 1, (size_t)block_size, fp) == 0) w->failed = 1;
+            break;
+        case OP_B_MMAP: {
+            unsigned char* p = mmap(NULL, (size_t)block_size, PROT_READ, MAP_SHARED, fd, (off_t)blk * block_size);
+            if (p == MAP_FAILED) { w->failed = 1; break; }
+            for (long off = 0; off < block_size; off += 4096) sink += p[off];
+            munmap(p, (size_t)block_size);
+            break;
+        }
+        }
+    }
+    w->elapsed_ns = now_ns() - t0;
+    if (fp) fclose(fp);
+    else close(fd);
+    free(buf);
+    return NULL;
+}
+
+// 结果以一行文本写入父进程给出的管道
+static int child_main(int op, int uncached, int threads, long calls, long nblocks, int result_fd) {
+    static Worker workers[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    pthread_barrier_init(&start_barrier, NULL, (unsigned)threads);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (Worker){ .op = op, .uncached = uncached, .calls = calls, .nblocks = nblocks,
+                               .first_block = (long)((long long)nblocks * t / threads) };
+        if (pthread_create(&tids[t], NULL, worker_main, &workers[t]) != 0) return 1;
+    }
+    uint64_t sum_ns = 0;
+    int failed = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        sum_ns += workers[t].elapsed_ns;
+        failed |= workers[t].failed;
+    }
+    dprintf(result_fd, "%d %llu\n", failed, (unsigned long long)sum_ns);
+    return failed;
+}
+
+/* ---------------- 父进程：准备文件与缓存状态，逐个配置运行子进程 ---------------- */
+
+static int prepare_file(long size_mb) {
+    struct stat st;
+    off_t want = (off_t)size_mb << 20;
+    if (stat(bench_file, &st) == 0 && st.st_size >= want) return 0;
+    int fd = open(bench_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    static char chunk[1 << 20];
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (char)(i * 131 + 7);
+    for (long i = 0; i < size_mb; i++) {
+        if (write(fd, chunk, sizeof(chunk)) != (ssize_t)sizeof(chunk)) { close(fd); return -1; }
+    }
+    fsync(fd);
+    close(fd);
+    return 0;
+}
+
+// 把文件读入页缓存，或把它从页缓存中清掉（脏页已在 prepare_file 中 fsync）
+static void set_cache_state(int uncached) {
+    int fd = open(bench_file, O_RDONLY);
+    if (fd < 0) return;
+    if (uncached) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    } else {
+        static char buf[1 << 20];
+        while (read(fd, buf, sizeof(buf)) > 0) {}
+    }
+    close(fd);
+}
+
+// 文件页缓存驻留比例（mincore），用于检查 uncached 是否真的生效
+static double resident_ratio(void) {
+    int fd = open(bench_file, O_RDONLY);
+    if (fd < 0) return 0.0;
+    struct stat st;
+    double ratio = 0.0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            size_t pages = ((size_t)st.st_size + 4095) / 4096, hit = 0;
+            unsigned char* vec = malloc(pages);
+            if (vec && mincore(map, (size_t)st.st_size, vec) == 0)
+                for (size_t i = 0; i < pages; i++) hit += vec[i] & 1;
+            free(vec);
+            munmap(map, (size_t)st.st_size);
+            ratio = (double)hit / (double)pages;
+        }
+    }
+    close(fd);
+    return ratio;
+}
+
+// 已退出但未回收的子进程的 syscr + syscw（整个线程组之和）
+static unsigned long long zombie_syscalls(pid_t pid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/io", (int)pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    unsigned long long r = 0, w = 0;
+    const char* p;
+    if ((p = strstr(buf, "syscr:")) != NULL) r = strtoull(p + 6, NULL, 10);
+    if ((p = strstr(buf, "syscw:")) != NULL) w = strtoull(p + 6, NULL, 10);
+    return r + w;
+}
+
+// 统计并清空日志目录
+static unsigned long long drain_log_dir(const char* dir) {
+    DIR* d = opendir(dir);
+    if (!d) return 0;
+    unsigned long long total = 0;
+    struct dirent* de;
+    char path[PATH_MAX];
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        struct stat st;
+        if (stat(path, &st) == 0) total += (unsigned long long)st.st_size;
+        unlink(path);
+    }
+    closedir(d);
+    return total;
+}
+
+typedef struct {
+    int ok;
+    double ns_per_call, sys_per_call, log_per_call;
+} RunResult;
+
+static RunResult run_child(const char* self, const char* wrapper, const char* log_dir,
+                           int op, int uncached, int threads, long calls, long nblocks) {
+    RunResult res = {0};
+    int pfd[2];
+    if (pipe(pfd) != 0) return res;
+    set_cache_state(uncached);
+    pid_t pid = fork();
+    if (pid < 0) { close(pfd[0]); close(pfd[1]); return res; }
+    if (pid == 0) {
+        close(pfd[0]);
+        if (wrapper) {
+            setenv("LD_PRELOAD", wrapper, 1);
+            setenv("IFETCHER_LOG_DIR", log_dir, 1);
+            setenv("IFETCHER_VERBOSE", "0", 1);
+            unsetenv("IFETCHER_GATE_FILE");
+            unsetenv("IFETCHER_CONTROL");
+        } else {
+            unsetenv("LD_PRELOAD");
+        }
+        char a_op[8], a_unc[8], a_thr[8], a_calls[24], a_blocks[24], a_fd[8];
+        snprintf(a_op, sizeof(a_op), "%d", op);
+        snprintf(a_unc, sizeof(a_unc), "%d", uncached);
+        snprintf(a_thr, sizeof(a_thr), "%d", threads);
+        snprintf(a_calls, sizeof(a_calls), "%ld", calls);
+        snprintf(a_blocks, sizeof(a_blocks), "%ld", nblocks);
+        snprintf(a_fd, sizeof(a_fd), "%d", pfd[1]);
+        execl(self, self, "--child", a_op, a_unc, a_thr, a_calls, a_blocks, a_fd, (char*)NULL);
+        _exit(127);
+    }
+    close(pfd[1]);
+    char line[128] = "";
+    FILE* rp = fdopen(pfd[0], "r");
+    if (rp) {
+        if (!fgets(line, sizeof(line), rp)) line[0] = '\0';
+        fclose(rp);
+    } else {
+        close(pfd[0]);
+    }
+    // 先等待退出但不回收，以便读取整个线程组最终的 I/O 计数（包括退出时写出的日志）
+    siginfo_t si;
+    waitid(P_PID, (id_t)pid, &si, WEXITED | WNOWAIT);
+    unsigned long long sys = zombie_syscalls(pid);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    unsigned long long log_bytes = wrapper ? drain_log_dir(log_dir) : 0;
+
+    int failed = 1;
+    unsigned long long sum_ns = 0;
+    if (sscanf(line, "%d %llu", &failed, &sum_ns) != 2 || failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return res;
+    double total = (double)calls * threads;
+    res.ok = 1;
+    res.ns_per_call = (double)sum_ns / total;
+    res.sys_per_call = (double)sys / total;
+    res.log_per_call = (double)log_bytes / total;
+    return res;
+}
+
+int main(int argc, char* argv[]) {
+    bench_file = getenv("IFETCHER_BENCH_FILE");
+    if (!bench_file || !*bench_file) bench_file = "wrapper_bench.dat";
+    block_size = env_long("IFETCHER_BENCH_BLOCK", 4096);
+    if (block_size < 4096) block_size = 4096;
+    block_size -= block_size % 4096;
+
+    if (argc == 8 && strcmp(argv[1], "--child") == 0)
+        return child_main(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atol(argv[5]), atol(argv[6]), atoi(argv[7]));
+
+    long size_mb = env_long("IFETCHER_BENCH_SIZE_MB", 256);
+    long max_calls = env_long("IFETCHER_BENCH_CALLS", 20000);
+    const char* ops = getenv("IFETCHER_BENCH_OPS");
+    const char* cache = getenv("IFETCHER_BENCH_CACHE");
+    const char* thread_list = getenv("IFETCHER_BENCH_THREADS");
+    if (!thread_list || !*thread_list) thread_list = "1,2,4,8,16,32,64";
+    if (size_mb < 1) size_mb = 1;
+    if (max_calls < 1) max_calls = 1;
+
+    char self[PATH_MAX], wrapper[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (n <= 0) { fprintf(stderr, "[WrapperBench] Error: cannot resolve own path\n"); return 1; }
+    self[n] = '\0';
+    const char* w = getenv("IFETCHER_BENCH_WRAPPER");
+    if (w && *w) {
+        if (!realpath(w, wrapper)) { fprintf(stderr, "[WrapperBench] Error: %s: %s\n", w, strerror(errno)); return 1; }
+    } else {
+        snprintf(wrapper, sizeof(wrapper), "%s", self);
+        char* slash = strrchr(wrapper, '/');
+        snprintf(slash + 1, sizeof(wrapper) - (size_t)(slash + 1 - wrapper), "libwrapper.so");
+    }
+    if (access(wrapper, R_OK) != 0) {
+        fprintf(stderr, "[WrapperBench] Error: %s not found (run make libwrapper.so)\n", wrapper);
+        return 1;
+    }
+    if (prepare_file(size_mb) != 0) {
+        fprintf(stderr, "[WrapperBench] Error: cannot create %s: %s\n", bench_file, strerror(errno));
+        return 1;
+    }
+    char log_dir[] = "/tmp/wrapper_bench.XXXXXX";
+    if (!mkdtemp(log_dir)) { fprintf(stderr, "[WrapperBench] Error: mkdtemp: %s\n", strerror(errno)); return 1; }
+
+    set_cache_state(1);
+    int can_drop = resident_ratio() < 0.5;
+    if (!can_drop) fprintf(stderr, "[WrapperBench] Warning: %s stays in page cache after DONTNEED (tmpfs?), uncached runs skipped\n", bench_file);
+
+    long nblocks = (long)((size_mb << 20) / block_size);
+    printf("[WrapperBench] file=%s size=%ldMB block=%ld wrapper=%s\n", bench_file, size_mb, block_size, wrapper);
+    printf("%-6s %-8s %4s %8s | %10s %10s %9s | %9s %9s | %10s\n",
+           "op", "cache", "thr", "calls", "ns/call", "+wrap ns", "overhead", "sys/call", "+wrap", "logB/call");
+    for (int op = 0; op < OP_B_COUNT; op++) {
+        if (!in_list(ops, op_names[op])) continue;
+        for (int uncached = 0; uncached <= 1; uncached++) {
+            const char* cname = uncached ? "uncached" : "cached";
+            if (cache && *cache && strcmp(cache, "both") != 0 && strcmp(cache, cname) != 0) continue;
+            if (uncached && !can_drop) continue;
+            for (const char* p = thread_list; *p; ) {
+                int threads = atoi(p);
+                p += strcspn(p, ",");
+                if (*p == ',') p++;
+                if (threads < 1 || threads > MAX_THREADS) continue;
+                // uncached：各线程区间互不重叠，总量不超过文件，避免读到本轮已缓存的页
+                long calls = uncached ? nblocks / threads : max_calls;
+                if (calls > max_calls) calls = max_calls;
+                if (calls < 1) continue;
+                RunResult bare = run_child(self, NULL, log_dir, op, uncached, threads, calls, nblocks);
+                RunResult wrapped = run_child(self, wrapper, log_dir, op, uncached, threads, calls, nblocks);
+                if (!bare.ok || !wrapped.ok) {
+                    printf("%-6s %-8s %4d %8ld | run failed\n", op_names[op], cname, threads, calls);
+                    continue;
+                }
+                printf("%-6s %-8s %4d %8ld | %10.0f %10.0f %8.2fx | %9.2f %9.2f | %10.1f\n",
+                       op_names[op], cname, threads, calls * threads,
+                       bare.ns_per_call, wrapped.ns_per_call, wrapped.ns_per_call / bare.ns_per_call,
+                       bare.sys_per_call, wrapped.sys_per_call, wrapped.log_per_call);
+                fflush(stdout);
+            }
+        }
+    }
+    rmdir(log_dir);
+    return 0;
+}